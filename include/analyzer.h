@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <bitset>
+#include <stdint.h>
+#include "field.h"
+#include "option.h"
+
+enum class analyzer_t: uint8_t {
+    STANDARD,       // split on spaces, then strip ASCII punctuation and lower case
+    VERBATIM,       // the whole value is a single token: the default of facet fields
+    ASCII,          // like STANDARD, but only ASCII characters are lower cased, so ICU is never used
+    WORD_BREAK,     // ICU word boundaries, for scripts that don't separate words with spaces
+    SEPARATORS      // like STANDARD, but also splits on the field's separator characters
+};
+
+namespace analyzers {
+    static const std::string STANDARD = "standard";
+    static const std::string VERBATIM = "verbatim";
+    static const std::string ASCII = "ascii";
+    static const std::string WORD_BREAK = "word_break";
+    static const std::string SEPARATORS = "separators";
+}
+
+/*
+ * Compiled tokenizer and normalizer of a string field. A field's indexed values, queries and filter values all go
+ * through the same analyzer, so that their tokens agree. Splitting and normalizing are separate steps, since typo
+ * costs are bounded by the length of a query token before it is normalized.
+ */
+class analyzer {
+private:
+    analyzer_t type;
+
+    // indexed by byte: only ASCII separators are allowed
+    std::bitset<128> separators;
+
+    void split_words(const std::string & text, std::vector<std::string> & tokens) const;
+
+    void split_separators(const std::string & text, std::vector<std::string> & tokens) const;
+
+public:
+    analyzer();
+
+    analyzer(const analyzer_t type, const std::string & separators = "");
+
+    // the analyzer of a field that has passed validate()
+    static analyzer for_field(const field & a_field);
+
+    // filter values on a field without an explicit analyzer are split and normalized, even on verbatim facets
+    static analyzer for_filter(const field & a_field);
+
+    // validates the text matching properties of a field: its analyzer, separators and infix indexing
+    static Option<bool> validate(const field & a_field);
+
+    analyzer_t get_type() const;
+
+    void split(const std::string & text, std::vector<std::string> & tokens) const;
+
+    void normalize(std::string & token) const;
+
+    // split() followed by normalize() of every token
+    void analyze(const std::string & text, std::vector<std::string> & tokens) const;
+};
@@ -10,16 +10,28 @@ void post_create_collection(http_req & req, http_res & res);
 
 void del_drop_collection(http_req & req, http_res & res);
 
+void put_alter_collection(http_req & req, http_res & res);
+
 void get_debug(http_req & req, http_res & res);
 
 void get_search(http_req & req, http_res & res);
 
+// queues the search in the order of the search scheduler, which is then run from the event loop
+void schedule_search(http_req & req, http_res & res);
+
+void on_run_search(void *data);
+
+void get_metrics_json(http_req & req, http_res & res);
+
 void get_collection_summary(http_req & req, http_res & res);
 
 void get_collection_export(http_req & req, http_res & res);
 
 void post_add_document(http_req & req, http_res & res);
 
+// a JSONL body, with one document per line, that is streamed in chunks
+void post_import_documents(http_req & req, http_res & res);
+
 void get_fetch_document(http_req & req, http_res & res);
 
 void del_remove_document(http_req & req, http_res & res);
@@ -28,7 +40,32 @@ void get_replication_updates(http_req &req, http_res &res);
 
 void on_send_response(void *data);
 
+// runs on the event loop, so that it never overlaps with a write or a search
+void on_spill_postings(void *data);
+
 void collection_export_handler(http_req* req, http_res* res, void* data);
 
+// end-points of a coordinator, which partitions collections across several nodes: async, since they wait on the nodes
+
+void coordinator_get_collections(http_req & req, http_res & res);
+
+void coordinator_post_create_collection(http_req & req, http_res & res);
+
+void coordinator_del_drop_collection(http_req & req, http_res & res);
+
+void coordinator_put_alter_collection(http_req & req, http_res & res);
+
+void coordinator_get_collection_summary(http_req & req, http_res & res);
+
+void coordinator_get_search(http_req & req, http_res & res);
+
+void coordinator_post_add_document(http_req & req, http_res & res);
+
+void coordinator_get_fetch_document(http_req & req, http_res & res);
+
+void coordinator_del_remove_document(http_req & req, http_res & res);
+
 static constexpr const char* SEND_RESPONSE_MSG = "send_response";
-static constexpr const char* REPLICATION_EVENT_MSG = "replication_event";
\ No newline at end of file
+static constexpr const char* REPLICATION_EVENT_MSG = "replication_event";
+static constexpr const char* SPILL_POSTINGS_MSG = "spill_postings";
+static constexpr const char* RUN_SEARCH_MSG = "run_search";
\ No newline at end of file
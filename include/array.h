@@ -9,15 +9,11 @@
 #include "array_base.h"
 
 class array: public array_base {
-private:
-    uint32_t inline unsorted_append_size_required(uint32_t value, uint32_t new_length) {
-        uint32_t m = std::min(min, value);
-        uint32_t M = std::max(max, value);
-        uint32_t bnew = required_bits(M - m);
-        return METADATA_OVERHEAD + 4 + for_compressed_size_bits(new_length, bnew);
+public:
+    array(): array_base(false) {
+
     }
 
-public:
     uint32_t at(uint32_t index);
 
     bool contains(uint32_t value);
@@ -4,8 +4,11 @@
 #include <cstdlib>
 #include <for.h>
 #include <cstring>
+#include <string>
 #include <limits>
 #include <iostream>
+#include "posting_codec.h"
+#include "index_memory.h"
 
 #define FOR_GROWTH_FACTOR 1.3
 #define FOR_ELE_SIZE sizeof(uint32_t)
@@ -20,19 +23,34 @@ protected:
     uint32_t min = std::numeric_limits<uint32_t>::max();
     uint32_t max = std::numeric_limits<uint32_t>::min();
 
+    // lists start out raw and the codec is picked again whenever they double in length
+    codec_t codec = codec_t::RAW;
+    const bool sorted;
+
+    static const uint32_t CODEC_REVIEW_MIN_LENGTH = 8;
+
     static inline uint32_t required_bits(const uint32_t v) {
         return (uint32_t) (v == 0 ? 0 : 32 - __builtin_clz(v));
     }
 
+    inline const posting_codec* get_codec() const {
+        return posting_codec::get(codec);
+    }
+
+    // returns false if the codec could not append the value
+    bool append_value(uint32_t value);
+
+    // replaces the contents with the given values, encoded with the codec that suits them best
+    void encode(const uint32_t *values, const uint32_t values_length);
+
 public:
-    array_base(const uint32_t n=2) {
+    array_base(const bool sorted, const uint32_t n=2): sorted(sorted) {
         size_bytes = METADATA_OVERHEAD + (n * FOR_ELE_SIZE);
-        in = new uint8_t[size_bytes];
-        memset(in, 0, size_bytes);
+        in = (uint8_t *) index_memory::zalloc(size_bytes);
     }
 
     ~array_base() {
-        delete[] in;
+        index_memory::free(in, size_bytes);
         in = nullptr;
     }
 
@@ -41,4 +59,20 @@ public:
     uint32_t getSizeInBytes();
 
     uint32_t getLength();
-};
\ No newline at end of file
+
+    // the largest value, which is the last one of a sorted list: only meaningful when the list is not empty
+    uint32_t getMax() const {
+        return max;
+    }
+
+    codec_t getCodec();
+
+    // values from `start_index` up to `end_index`, read together: cheaper than calling at() for each of them
+    void at_range(uint32_t start_index, uint32_t end_index, uint32_t* out);
+
+    // Appends the encoded list to `out`, and restores it from there: a list is moved out of memory and back
+    // without being decoded. deserialize() returns the number of bytes that it read.
+    void serialize(std::string & out) const;
+
+    size_t deserialize(const char* data);
+};
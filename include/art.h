@@ -98,12 +98,22 @@ typedef struct {
  * of arbitrary size, as they include the key.
  */
 typedef struct {
+    // null while the values are spilled to the store: see Index::spill_postings()
     art_values* values;
     int32_t max_score;
+
+    // number of documents of a spilled leaf, which orders the leaves without paging in their values
+    uint32_t spilled_length;
+
     uint32_t key_len;
     unsigned char key[];
 } art_leaf;
 
+// number of documents in the leaf, whether its values are in memory or spilled
+inline uint32_t art_leaf_length(const art_leaf* l) {
+    return (l->values != nullptr) ? l->values->ids.getLength() : l->spilled_length;
+}
+
 /**
  * Main struct, points to root.
  */
@@ -248,6 +258,13 @@ int art_iter_prefix(art_tree *t, const unsigned char *prefix, int prefix_len, ar
 int art_fuzzy_search(art_tree *t, const unsigned char *term, const int term_len, const int min_cost, const int max_cost,
                      const int max_words, const token_ordering token_order, const bool prefix, std::vector<art_leaf *> &results);
 
+/**
+ * Orders leaves the way that art_fuzzy_search() ranks its results: by number of documents, or by max score.
+ */
+bool compare_art_leaf_frequency(const art_leaf *a, const art_leaf *b);
+
+bool compare_art_leaf_score(const art_leaf *a, const art_leaf *b);
+
 int art_topk_iter(const art_node *root, token_ordering token_order, size_t max_results,
                          std::vector<art_leaf *> &results);
 
@@ -5,6 +5,7 @@
 #include <string>
 #include <unordered_map>
 #include <thread>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <art.h>
@@ -16,6 +17,22 @@
 #include <json.hpp>
 #include <field.h>
 #include <option.h>
+#include <search_results.h>
+
+// progress of a JSONL import, whose body is added a chunk at a time
+struct import_state {
+    // the end of the last chunk, when it was not the end of a line
+    std::string partial_line;
+
+    size_t num_lines = 0;
+    size_t num_imported = 0;
+    size_t num_failed = 0;
+
+    // line number and error of the first MAX_ERRORS documents that could not be added
+    std::vector<std::pair<size_t, std::string>> errors;
+
+    static const size_t MAX_ERRORS = 100;
+};
 
 class Collection {
 private:
@@ -42,24 +59,78 @@ private:
 
     std::unordered_map<std::string, field> sort_schema;
 
+    // fields that are only stored: they are not part of the index shards' schema, and have no field id
+    std::unordered_map<std::string, field> unindexed_schema;
+
     std::string default_sorting_field;
 
     size_t num_indices;
 
+    // when enabled, index shards keep the leaves of every document so that removals skip the store
+    bool forward_index;
+
+    // filter queries whose matching documents and facet counts are maintained by the index shards
+    std::vector<std::string> pinned_filters;
+
+    // ids of fields are never reused, so that the index shards can keep the slots of dropped fields
+    uint32_t next_field_id;
+
+    // Fields that were added to the schema, and that are being indexed for the existing documents by the backfill
+    // thread. New documents are validated against them, but they are not searchable until the backfill is done.
+    std::vector<field> backfill_fields;
+
+    std::thread* backfill_thread;
+
+    std::atomic<bool> backfill_done;
+
+    std::atomic<bool> backfill_stop;
+
+    std::atomic<size_t> num_backfilled;
+
     std::string get_doc_id_key(const std::string & doc_id);
 
     std::string get_seq_id_key(uint32_t seq_id);
 
+    std::string get_unindexed_key(uint32_t seq_id);
+
+    // the stored document, along with the values of its unindexed fields when they are asked for
+    StoreStatus get_document(const uint32_t seq_id, std::string & document, const bool include_unindexed);
+
     Option<uint32_t> validate_index_in_memory(const nlohmann::json &document, uint32_t seq_id);
 
+    Option<uint32_t> validate_field_value(const field & a_field, const nlohmann::json & value) const;
+
+    int32_t get_points(const nlohmann::json & document) const;
+
+    // a line of an import: blank lines are skipped
+    void import_document(std::string & line, import_state & state);
+
+    void backfill(rocksdb::Iterator* iter, const std::vector<field> fields);
+
+    // switches the schema over to the backfilled fields once the backfill thread is done
+    void apply_backfilled_fields();
+
+    Option<bool> parse_filter_query(const std::string & simple_filter_query, std::vector<filter> & filters) const;
+
+    Option<bool> parse_facet(const std::string & facet_field, std::vector<facet> & facets) const;
+
+    // over the bounds of the field's values in the whole collection: false when it has no values
+    bool get_numeric_facet_bounds(const field & facet_field, double & min, double & max) const;
+
+    static void make_auto_facet_ranges(const field & facet_field, const double min, const double max,
+                                       std::vector<facet_range> & ranges);
+
 public:
     Collection() = delete;
 
     Collection(const std::string name, const uint32_t collection_id, const uint32_t next_seq_id, Store *store,
-               const std::vector<field> & fields, const std::string & default_sorting_field, const size_t num_indices=4);
+               const std::vector<field> & fields, const std::string & default_sorting_field,
+               const size_t num_indices=DEFAULT_NUM_INDICES, const bool forward_index=false);
 
     ~Collection();
 
+    static const size_t DEFAULT_NUM_INDICES = 4;
+
     static std::string get_next_seq_id_key(const std::string & collection_name);
 
     static std::string get_meta_key(const std::string & collection_name);
@@ -92,11 +163,35 @@ public:
 
     Option<nlohmann::json> add(const std::string & json_str);
 
+    // Adds the documents of the next chunk of a JSONL body, one per line. The chunks can end anywhere: a line that
+    // is cut off is added with the next chunk, or with the last one.
+    void import_documents(const std::string & chunk, const bool last_chunk, import_state & state);
+
     Option<nlohmann::json> search(std::string query, const std::vector<std::string> search_fields,
                           const std::string & simple_filter_query, const std::vector<std::string> & facet_fields,
                           const std::vector<sort_by> & sort_fields, const int num_typos,
                           const size_t per_page = 10, const size_t page = 1,
-                          const token_ordering token_order = FREQUENCY, const bool prefix = false);
+                          const token_ordering token_order = FREQUENCY, const bool prefix = false,
+                          const bool explain_plan = false, const size_t facet_sample_percent = 100,
+                          const size_t facet_sample_threshold = 0, const std::string & facet_query = "",
+                          const bool infix = false, const bool mergeable = false,
+                          const bool include_unindexed = true);
+
+    // the search behind search(), with results that are yet to be encoded into a response
+    Option<search_results> run_search(std::string query, const std::vector<std::string> search_fields,
+                          const std::string & simple_filter_query, const std::vector<std::string> & facet_fields,
+                          const std::vector<sort_by> & sort_fields, const int num_typos,
+                          const size_t per_page = 10, const size_t page = 1,
+                          const token_ordering token_order = FREQUENCY, const bool prefix = false,
+                          const bool explain_plan = false, const size_t facet_sample_percent = 100,
+                          const size_t facet_sample_threshold = 0, const std::string & facet_query = "",
+                          const bool infix = false, const bool include_unindexed = true);
+
+    // A match-all query (`*`) with no filter, or with a pinned filter, gets its facet counts without visiting
+    // the matching documents. Returns the number of documents that match the filter.
+    Option<uint32_t> pin_filter(const std::string & simple_filter_query);
+
+    std::vector<std::string> get_pinned_filters();
 
     Option<nlohmann::json> get(const std::string & id);
 
@@ -104,9 +199,39 @@ public:
 
     Option<uint32_t> index_in_memory(const nlohmann::json & document, uint32_t seq_id);
 
+    // Drops fields right away and adds fields in the background: added fields are indexed for the stored
+    // documents in throttled batches while searches are served, and become searchable once that is done.
+    Option<bool> alter_schema(const std::vector<field> & add_fields, const std::vector<std::string> & drop_fields);
+
+    // an unindexed field can't have any of the properties that only make sense for an indexed one
+    static Option<bool> validate_unindexed_field(const field & a_field);
+
+    // Moves the posting lists of the fields that were not searched in the last `cold_after_ms` out of memory, into
+    // the store. Like writes, it must not run alongside a search. Returns the number of bytes that were moved.
+    size_t spill_cold_postings(const uint64_t cold_after_ms);
+
+    // leaves whose values are only in the store, summed over the index shards
+    size_t get_num_spilled_leaves();
+
+    std::vector<field> get_backfill_fields();
+
+    bool is_backfilling();
+
+    size_t get_num_backfilled();
+
+    // blocks until the added fields are searchable
+    void await_backfill();
+
+    // the backfill thread indexes this many documents at a time, and pauses in between
+    static const size_t BACKFILL_BATCH_SIZE = 1000;
+    static const size_t BACKFILL_BATCH_PAUSE_MS = 5;
+
     static const int MAX_SEARCH_TOKENS = 10;
     static const int MAX_RESULTS = 500;
 
+    // a numeric facet without ranges is counted into this many equal-width ranges
+    static const size_t NUM_AUTO_FACET_RANGES = 10;
+
     // strings under this length will be fully highlighted, instead of showing a snippet of relevant portion
     enum {SNIPPET_STR_ABOVE_LEN = 30};
 
@@ -115,5 +240,8 @@ public:
     static constexpr const char* COLLECTION_NEXT_SEQ_PREFIX = "$CS";
     static constexpr const char* SEQ_ID_PREFIX = "$SI";
     static constexpr const char* DOC_ID_PREFIX = "$DI";
+
+    // the values of a document's unindexed fields, by sequence id
+    static constexpr const char* UNINDEXED_PREFIX = "$SU";
 };
 
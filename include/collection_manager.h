@@ -24,12 +24,18 @@ private:
     static constexpr const char* COLLECTION_ID_KEY = "id";
     static constexpr const char* COLLECTION_SEARCH_FIELDS_KEY = "fields";
     static constexpr const char* COLLECTION_DEFAULT_SORTING_FIELD_KEY = "default_sorting_field";
+    static constexpr const char* COLLECTION_PINNED_FILTERS_KEY = "pinned_filters";
 
     std::string auth_key;
     std::string search_only_auth_key;
 
+    // whether collections keep a forward index for removing documents without reading them back
+    bool forward_index;
+
     CollectionManager();
 
+    static nlohmann::json fields_json(const std::vector<field> & fields);
+
     ~CollectionManager() = default;
 
 public:
@@ -41,7 +47,8 @@ public:
     CollectionManager(CollectionManager const&) = delete;
     void operator=(CollectionManager const&) = delete;
 
-    Option<bool> init(Store *store, const std::string & auth_key, const std::string & search_only_auth_key);
+    Option<bool> init(Store *store, const std::string & auth_key, const std::string & search_only_auth_key,
+                      const bool forward_index = false);
 
     // frees in-memory data structures when server is shutdown - helps us run a memory leak detecter properly
     void dispose();
@@ -55,7 +62,12 @@ public:
     bool search_only_auth_key_matches(std::string auth_key_sent);
 
     Option<Collection*> create_collection(const std::string name, const std::vector<field> & fields,
-                                          const std::string & default_sorting_field);
+                                          const std::string & default_sorting_field,
+                                          const std::vector<std::string> & pinned_filters = {});
+
+    // adds and drops fields of a live collection: added fields become searchable once they are backfilled
+    Option<bool> alter_collection(const std::string & collection_name, const std::vector<field> & add_fields,
+                                  const std::vector<std::string> & drop_fields);
 
     Collection* get_collection(const std::string & collection_name);
 
@@ -71,5 +83,8 @@ public:
 
     Store* get_store();
 
+    // moves the posting lists of the cold fields of every collection into the store: returns the bytes moved
+    size_t spill_cold_postings(const uint64_t cold_after_ms);
+
     static constexpr const char* NEXT_COLLECTION_ID_KEY = "$CI";
 };
\ No newline at end of file
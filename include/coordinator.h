@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <json.hpp>
+
+struct node_response {
+    // 0 when the node could not be reached
+    long status_code;
+    std::string body;
+};
+
+/*
+ * Singleton, for partitioning collections across several nodes: each node is a typesense server of its own. Every
+ * node has every collection, while a document is stored only on the node that its id hashes to. Searches are sent
+ * to all the nodes at once, and their results are merged like a collection merges the results of its index shards.
+ */
+class Coordinator {
+private:
+    // base URLs of the nodes: http(s)://<address>:<port>
+    std::vector<std::string> nodes;
+
+    std::string api_key;
+
+    Coordinator() = default;
+
+    ~Coordinator() = default;
+
+public:
+    static Coordinator & get_instance() {
+        static Coordinator instance;
+        return instance;
+    }
+
+    Coordinator(Coordinator const&) = delete;
+    void operator=(Coordinator const&) = delete;
+
+    void init(const std::vector<std::string> & nodes, const std::string & api_key);
+
+    size_t get_num_nodes() const;
+
+    // the node that stores the document with the given id: stable across processes, unlike std::hash
+    size_t get_owner(const std::string & doc_id) const;
+
+    node_response send(const size_t node, const std::string & method, const std::string & path,
+                       const std::string & body = "") const;
+
+    // sends the request to every node in parallel: responses are in the order of the nodes
+    std::vector<node_response> broadcast(const std::string & method, const std::string & path,
+                                         const std::string & body = "") const;
+
+    // Merges the results of the nodes for the given page, given that each node was asked for its first
+    // `page * per_page` hits in a mergeable form (i.e. with their sort keys and with all facet values)
+    static nlohmann::json merge_search_results(std::vector<nlohmann::json> & node_results, const size_t per_page,
+                                               const size_t page);
+
+    // Each node spreads the auto ranges of a numeric facet over the bounds of its own values, so their counts can't
+    // be merged unless the bounds are the same on every node. Rewrites the facet fields whose bounds differ into
+    // `field(auto min:max)` over the bounds of all the nodes, and returns whether the nodes must be searched again.
+    static bool resolve_auto_facet_ranges(const std::vector<nlohmann::json> & node_results,
+                                          std::vector<std::string> & facet_fields);
+};
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <string>
+#include <map>
+#include <limits>
+#include <algorithm>
+#include <sparsepp.h>
 #include "art.h"
 #include "option.h"
 #include "string_utils.h"
@@ -18,10 +22,46 @@ namespace field_types {
     static const std::string BOOL_ARRAY = "bool[]";
 }
 
+// Compiled form of the field types above: used in place of string comparisons on the indexing and search paths
+enum class field_type_t: uint8_t {
+    STRING,
+    INT32,
+    INT64,
+    FLOAT,
+    BOOL,
+    STRING_ARRAY,
+    INT32_ARRAY,
+    INT64_ARRAY,
+    FLOAT_ARRAY,
+    BOOL_ARRAY,
+    UNKNOWN
+};
+
+namespace field_types {
+    inline field_type_t to_type_id(const std::string & type) {
+        if(type == STRING) return field_type_t::STRING;
+        if(type == INT32) return field_type_t::INT32;
+        if(type == INT64) return field_type_t::INT64;
+        if(type == FLOAT) return field_type_t::FLOAT;
+        if(type == BOOL) return field_type_t::BOOL;
+        if(type == STRING_ARRAY) return field_type_t::STRING_ARRAY;
+        if(type == INT32_ARRAY) return field_type_t::INT32_ARRAY;
+        if(type == INT64_ARRAY) return field_type_t::INT64_ARRAY;
+        if(type == FLOAT_ARRAY) return field_type_t::FLOAT_ARRAY;
+        if(type == BOOL_ARRAY) return field_type_t::BOOL_ARRAY;
+        return field_type_t::UNKNOWN;
+    }
+}
+
 namespace fields {
     static const std::string name = "name";
     static const std::string type = "type";
     static const std::string facet = "facet";
+    static const std::string optional = "optional";
+    static const std::string analyzer = "analyzer";
+    static const std::string separators = "separators";
+    static const std::string infix = "infix";
+    static const std::string index = "index";
 }
 
 struct field {
@@ -29,42 +69,72 @@ struct field {
     std::string type;
     bool facet;
 
-    field(const std::string & name, const std::string & type, const bool & facet): name(name), type(type), facet(facet) {
+    // an optional field may be missing from a document: fields added to a live collection are optional, since
+    // the documents that were stored before the field was added need not have it
+    bool optional;
+
+    // how the values of a string field are split into tokens and normalized: see analyzer.h. An empty analyzer
+    // is the default one, which indexes facets verbatim.
+    std::string analyzer;
+
+    // the characters that the `separators` analyzer splits on, besides spaces
+    std::string separators;
+
+    // the field's tokens are also indexed by their trigrams, so that they can be matched anywhere within
+    bool infix;
+
+    // An unindexed field is only stored, for display: it can't be searched, filtered, faceted or sorted on. Its
+    // values are kept apart from the rest of the document, so that they are only read when the document is shown.
+    bool index;
+
+    // resolved once from `type`
+    field_type_t type_id;
+
+    // position of the field in the collection's schema: per-field index structures are addressed by this id
+    uint32_t id;
+
+    field(const std::string & name, const std::string & type, const bool & facet, const bool optional = false):
+          name(name), type(type), facet(facet), optional(optional), infix(false), index(true), type_id(field_types::to_type_id(type)), id(0) {
 
     }
 
     bool is_single_integer() const {
-        return (type == field_types::INT32 || type == field_types::INT64);
+        return (type_id == field_type_t::INT32 || type_id == field_type_t::INT64);
     }
 
     bool is_single_float() const {
-        return (type == field_types::FLOAT);
+        return (type_id == field_type_t::FLOAT);
     }
 
     bool is_single_bool() const {
-        return (type == field_types::BOOL);
+        return (type_id == field_type_t::BOOL);
     }
 
     bool is_integer() const {
-        return (type == field_types::INT32 || type == field_types::INT32_ARRAY ||
-               type == field_types::INT64 || type == field_types::INT64_ARRAY);
+        return (type_id == field_type_t::INT32 || type_id == field_type_t::INT32_ARRAY ||
+                type_id == field_type_t::INT64 || type_id == field_type_t::INT64_ARRAY);
     }
 
     bool is_float() const {
-        return (type == field_types::FLOAT || type == field_types::FLOAT_ARRAY);
+        return (type_id == field_type_t::FLOAT || type_id == field_type_t::FLOAT_ARRAY);
     }
 
     bool is_bool() const {
-        return (type == field_types::BOOL || type == field_types::BOOL_ARRAY);
+        return (type_id == field_type_t::BOOL || type_id == field_type_t::BOOL_ARRAY);
     }
 
     bool is_string() const {
-        return (type == field_types::STRING || type == field_types::STRING_ARRAY);
+        return (type_id == field_type_t::STRING || type_id == field_type_t::STRING_ARRAY);
     }
 
     bool is_facet() const {
         return facet;
     }
+
+    // single valued numerical and bool fields get a sort index
+    bool is_sortable() const {
+        return is_single_integer() || is_single_float() || is_single_bool();
+    }
 };
 
 struct filter {
@@ -96,6 +166,11 @@ struct filter {
 
         return Option<NUM_COMPARATOR>(400, "Numerical field has an invalid comparator.");
     }
+
+    bool operator==(const filter & other) const {
+        return field_name == other.field_name && values == other.values &&
+               compare_operator == other.compare_operator;
+    }
 };
 
 namespace sort_field_const {
@@ -120,11 +195,73 @@ struct sort_by {
     }
 };
 
+// A bucket of a numeric facet: values in [from, to), where a missing bound is an infinite one
+struct facet_range {
+    std::string label;
+    double from;
+    double to;
+};
+
+struct facet_stats {
+    double min;
+    double max;
+    double sum;
+    size_t count;
+
+    facet_stats(): min(std::numeric_limits<double>::infinity()), max(-std::numeric_limits<double>::infinity()),
+                   sum(0), count(0) {
+
+    }
+
+    void merge(const facet_stats & other) {
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        sum += other.sum;
+        count += other.count;
+    }
+};
+
 struct facet {
     const std::string field_name;
     std::map<std::string, size_t> result_map;
 
-    facet(const std::string field_name): field_name(field_name) {
+    // per-shard counts keyed on the shard's facet value index: converted into `result_map` once a shard is done
+    spp::sparse_hash_map<uint32_t, size_t> value_counts;
+
+    // numeric facets count their values into `ranges` instead, in the same order
+    bool is_numeric;
+    std::vector<facet_range> ranges;
+    std::vector<size_t> range_counts;
+    facet_stats stats;
+
+    // whether `ranges` were spread over the bounds [auto_min, auto_max] of the field's values, rather than asked for
+    bool auto_ranges;
+    double auto_min;
+    double auto_max;
+
+    // results beyond `sample_threshold` are counted on `sample_percent` of them, which makes the counts estimates
+    size_t sample_percent;
+    size_t sample_threshold;
+    bool sampled;
+
+    // when set, only values that match this query (by prefix, allowing typos) are counted: `query_values` are the
+    // shard's value indices that match it
+    std::string query;
+    spp::sparse_hash_set<uint32_t> query_values;
+
+    bool counts_value(const uint32_t value_index) const {
+        return query.empty() || query_values.count(value_index) != 0;
+    }
+
+    facet(const std::string field_name): field_name(field_name), is_numeric(false), auto_ranges(false),
+                                         auto_min(0), auto_max(0), sample_percent(100), sample_threshold(0),
+                                         sampled(false) {
+
+    }
+
+    facet(const std::string field_name, const std::vector<facet_range> & ranges):
+          field_name(field_name), is_numeric(true), ranges(ranges), range_counts(ranges.size(), 0),
+          auto_ranges(false), auto_min(0), auto_max(0), sample_percent(100), sample_threshold(0), sampled(false) {
 
     }
 };
@@ -136,14 +273,20 @@ struct facet_value {
 
     spp::sparse_hash_map<uint32_t, std::vector<uint32_t>> doc_values;
 
+    // live number of value entries across all documents, by value index: counted the way `do_facets` counts them,
+    // so that the facet counts of the whole collection are available without visiting the documents
+    std::vector<uint32_t> value_counts;
+
     uint32_t get_value_index(const std::string & value) {
-        if(value_index.count(value) != 0) {
-            return value_index[value];
+        auto value_index_it = value_index.find(value);
+        if(value_index_it != value_index.end()) {
+            return value_index_it->second;
         }
 
         uint32_t new_index = value_index.size();
         value_index.emplace(value, new_index);
         index_value.emplace(new_index, value);
+        value_counts.push_back(0);
         return new_index;
     }
 
@@ -151,7 +294,21 @@ struct facet_value {
         std::vector<uint32_t> value_vec(values.size());
         for(size_t i = 0; i < values.size(); i++) {
             value_vec[i] = get_value_index(values[i]);
+            value_counts[value_vec[i]] += 1;
         }
         doc_values.emplace(doc_seq_id, value_vec);
     }
+
+    void remove_values(uint32_t doc_seq_id) {
+        const auto doc_values_it = doc_values.find(doc_seq_id);
+        if(doc_values_it == doc_values.end()) {
+            return ;
+        }
+
+        for(const uint32_t value_index: doc_values_it->second) {
+            value_counts[value_index] -= 1;
+        }
+
+        doc_values.erase(doc_values_it);
+    }
 };
\ No newline at end of file
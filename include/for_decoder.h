@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+
+/*
+ * Decoding of libfor's frame of reference format: a 4 byte base and a 1 byte bit width, followed by the
+ * (value - base) deltas packed into a little endian bit stream, i.e. the i-th value occupies the bits
+ * [i * bits, (i+1) * bits) of the stream. Arrays are still written by libfor: only the read side is replaced here,
+ * with SSE4.1 and AVX2 kernels that are picked at runtime depending on what the CPU supports.
+ */
+class ForDecoder {
+private:
+    static inline uint32_t payload_length(const uint32_t length, const uint32_t bits) {
+        return (uint32_t) (((uint64_t) length * bits + 7) / 8);
+    }
+
+public:
+    static const uint32_t HEADER_LENGTH = 5;
+
+    // decodes `n` values starting at value index `start` from a payload of `payload_len` bytes
+    typedef void (*unpack_fn)(const uint8_t* payload, const uint32_t payload_len, const uint32_t base,
+                              const uint32_t bits, const uint32_t start, const uint32_t n, uint32_t* out);
+
+    static void unpack_scalar(const uint8_t* payload, const uint32_t payload_len, const uint32_t base,
+                              const uint32_t bits, const uint32_t start, const uint32_t n, uint32_t* out);
+
+    static void unpack_sse4(const uint8_t* payload, const uint32_t payload_len, const uint32_t base,
+                            const uint32_t bits, const uint32_t start, const uint32_t n, uint32_t* out);
+
+    static void unpack_avx2(const uint8_t* payload, const uint32_t payload_len, const uint32_t base,
+                            const uint32_t bits, const uint32_t start, const uint32_t n, uint32_t* out);
+
+    static bool has_sse4();
+
+    static bool has_avx2();
+
+    // the fastest kernel that this CPU supports
+    static unpack_fn get_unpacker();
+
+    static void uncompress(const uint8_t* in, const uint32_t length, uint32_t* out);
+
+    // Intersects a sorted, FOR encoded array with a sorted array of `ids`. The encoded array is decoded a block
+    // at a time and blocks that lie entirely below the next id are skipped without being decoded.
+    static size_t intersect(const uint8_t* in, const uint32_t length, const uint32_t* ids, const size_t ids_len,
+                            uint32_t* out);
+};
@@ -12,33 +12,62 @@ private:
     std::string url;
     std::string api_key;
 
-public:
-    HttpClient(std::string url, std::string api_key): url(url), api_key(api_key) {
-
-    }
-
-    static size_t curl_write (void *contents, size_t size, size_t nmemb, std::string *s) {
-        s->append((char*)contents, size*nmemb);
-        return size*nmemb;
-    }
-
-    long get_reponse(std::string & response) {
+    long perform(const std::string & method, const std::string & body, std::string & response) {
         CURL *curl = curl_easy_init();
         curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
         curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);  // to allow self-signed certs
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);        // requests are made from several threads
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, HttpClient::curl_write);
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
 
+        if(method != "GET") {
+            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.c_str());
+        }
+
+        if(!body.empty()) {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long) body.size());
+        }
+
         struct curl_slist *chunk = NULL;
         std::string api_key_header = std::string("x-typesense-api-key: ") + api_key;
         chunk = curl_slist_append(chunk, api_key_header.c_str());
+        chunk = curl_slist_append(chunk, "Content-Type: application/json");
         curl_easy_setopt(curl, CURLOPT_HTTPHEADER, chunk);
 
         curl_easy_perform(curl);
         long http_code = 0;
         curl_easy_getinfo (curl, CURLINFO_RESPONSE_CODE, &http_code);
         curl_easy_cleanup(curl);
+        curl_slist_free_all(chunk);
         response = buffer;
         return http_code;
     }
-};
\ No newline at end of file
+
+public:
+    HttpClient(std::string url, std::string api_key): url(url), api_key(api_key) {
+
+    }
+
+    static size_t curl_write (void *contents, size_t size, size_t nmemb, std::string *s) {
+        s->append((char*)contents, size*nmemb);
+        return size*nmemb;
+    }
+
+    // a status code of 0 means that no response was received
+    long get_reponse(std::string & response) {
+        return perform("GET", "", response);
+    }
+
+    long post_response(const std::string & body, std::string & response) {
+        return perform("POST", body, response);
+    }
+
+    long put_response(const std::string & body, std::string & response) {
+        return perform("PUT", body, response);
+    }
+
+    long delete_response(std::string & response) {
+        return perform("DELETE", "", response);
+    }
+};
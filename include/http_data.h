@@ -23,14 +23,14 @@ struct http_res {
 
     }
 
-    void send_200(const std::string & res_body) {
+    void send_200(std::string res_body) {
         status_code = 200;
-        body = res_body;
+        body = std::move(res_body);
     }
 
-    void send_201(const std::string & res_body) {
+    void send_201(std::string res_body) {
         status_code = 201;
-        body = res_body;
+        body = std::move(res_body);
     }
 
     void send_400(const std::string & message) {
@@ -63,9 +63,9 @@ struct http_res {
         body = "{\"message\": \"" + message + "\"}";
     }
 
-    void send_500(const std::string & res_body) {
+    void send_500(std::string res_body) {
         status_code = 500;
-        body = res_body;
+        body = std::move(res_body);
     }
 
     void send(uint32_t code, const std::string & message) {
@@ -78,6 +78,16 @@ struct http_req {
     h2o_req_t* _req;
     std::map<std::string, std::string> params;
     std::string body;
+
+    // value of the Accept header: the media types that the client can take as a response
+    std::string accept;
+
+    // The handler of a batched route is given the body one batch at a time, as `body`: more batches follow while
+    // this is set. The handler can clear it to skip the rest of the body, and responds once it's cleared.
+    bool body_pending;
+
+    // kept by a batched handler across the batches of a body
+    void* batch_state;
 };
 
 struct route_path {
@@ -86,6 +96,9 @@ struct route_path {
     void (*handler)(http_req &, http_res &);
     bool async;
 
+    // the handler is called for each batch of the body
+    bool batched;
+
     inline bool operator< (const route_path& rhs) const {
         return true;
     }
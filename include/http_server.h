@@ -78,7 +78,8 @@ public:
 
     void get(const std::string & path, void (*handler)(http_req & req, http_res & res), bool async = false);
 
-    void post(const std::string & path, void (*handler)(http_req & req, http_res & res), bool async = false);
+    void post(const std::string & path, void (*handler)(http_req & req, http_res & res), bool async = false,
+              bool batched = false);
 
     void put(const std::string & path, void (*handler)(http_req & req, http_res & res), bool async = false);
 
@@ -107,4 +108,10 @@ public:
 
     static constexpr const char* AUTH_HEADER = "x-typesense-api-key";
     static constexpr const char* STOP_SERVER_MESSAGE = "STOP_SERVER";
+
+    // Batches of the body of a batched route, so that the handler's own copies of it stay small.
+    // NOTE: h2o 2.2.4 buffers the whole body before the handler is called, so batches are cut from that buffer and
+    // bodies are bound by h2o's max_request_entity_size (1GB by default): larger imports are split into several
+    // requests. Reading a body as it arrives, with flow control, needs h2o >= 2.3.
+    static const size_t REQUEST_BODY_BATCH_SIZE = 1024 * 1024;
 };
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include <map>
 #include <mutex>
 #include <condition_variable>
 #include <art.h>
@@ -14,6 +15,9 @@
 #include <field.h>
 #include <option.h>
 #include "string_utils.h"
+#include "analyzer.h"
+#include "infix_index.h"
+#include "numeric_column.h"
 
 struct token_candidates {
     std::string token;
@@ -21,6 +25,55 @@ struct token_candidates {
     std::vector<art_leaf*> candidates;
 };
 
+// Incrementally maintained cardinality statistics of a field, used for planning searches.
+// The number of distinct keys of a field is the size of its ART tree, so only postings are counted here.
+struct field_stats {
+    size_t num_postings;    // number of (document, key) pairs
+
+    field_stats(): num_postings(0) {
+
+    }
+};
+
+enum search_execution {
+    TEXT_ONLY,      // there are no filters
+    FILTER_FIRST,   // filters are materialized into a list of ids that text matches are intersected with
+    TEXT_FIRST      // text matches are checked against the filters through the sort index
+};
+
+struct search_plan {
+    search_execution execution;
+    size_t estimated_filter_matches;
+    size_t estimated_text_matches;
+
+    search_plan(): execution(TEXT_ONLY), estimated_filter_matches(0), estimated_text_matches(0) {
+
+    }
+};
+
+// A filter on a single valued numerical or bool field, checked per candidate against the field's sort index
+struct filter_check {
+    const numeric_column* doc_values;
+    NUM_COMPARATOR compare_operator;
+    std::vector<number_t> values;
+};
+
+// Forward index entry of a document: `field_ends[i]` is the end of the i-th field's leaves in `leaves`
+struct doc_leaves {
+    std::vector<art_leaf*> leaves;
+    std::vector<uint32_t> field_ends;
+};
+
+// A filter whose matching documents, and the facet counts of those documents, are kept up to date as documents
+// are indexed and removed, so that a match-all query on that filter doesn't have to visit the documents
+struct pinned_filter {
+    std::vector<filter> filters;
+    spp::sparse_hash_set<uint32_t> doc_ids;
+
+    // indexed by facet field id, then by the field's facet value index
+    std::vector<std::vector<uint32_t>> value_counts;
+};
+
 struct search_args {
     std::string query;
     std::vector<std::string> search_fields;
@@ -32,21 +85,28 @@ struct search_args {
     size_t page;
     token_ordering token_order;
     bool prefix;
+    bool infix;
     std::vector<std::pair<int, Topster<512>::KV>> field_order_kvs;
     size_t all_result_ids_len;
     std::vector<std::vector<art_leaf*>> searched_queries;
+    search_plan plan;
     Option<uint32_t> outcome;
 
-    search_args(): outcome(0) {
+    // what the search cost the shard, for the accounting of the collection's usage
+    size_t num_scored_docs;
+    uint64_t cpu_time_us;
+
+    search_args(): outcome(0), num_scored_docs(0), cpu_time_us(0) {
 
     }
 
     search_args(std::string query, std::vector<std::string> search_fields, std::vector<filter> filters,
                 std::vector<facet> facets, std::vector<sort_by> sort_fields_std, int num_typos,
-                size_t per_page, size_t page, token_ordering token_order, bool prefix):
+                size_t per_page, size_t page, token_ordering token_order, bool prefix, bool infix):
             query(query), search_fields(search_fields), filters(filters), facets(facets),
             sort_fields_std(sort_fields_std), num_typos(num_typos), per_page(per_page), page(page),
-            token_order(token_order), prefix(prefix), all_result_ids_len(0), outcome(0) {
+            token_order(token_order), prefix(prefix), infix(infix), all_result_ids_len(0), outcome(0),
+            num_scored_docs(0), cpu_time_us(0) {
 
     }
 };
@@ -57,19 +117,84 @@ private:
 
     size_t num_documents;
 
-    std::unordered_map<std::string, field> search_schema;
+    // Indexes a single field's value for a document: one specialization of `index_field` per field type
+    typedef void (Index::*field_indexer_t)(const nlohmann::json & value, const field & a_field,
+                                           const uint32_t score, const uint32_t seq_id);
+
+    // Schema compiled into a dense vector that is addressed by `field::id`. Names are resolved to ids only
+    // once per query (via `field_ids`) so that the per-document and per-candidate paths are free of string
+    // comparisons and string-keyed lookups.
+    std::vector<field> schema;
+
+    std::vector<field_indexer_t> field_indexers;
+
+    typedef void (Index::*field_keys_t)(const nlohmann::json & value, const field & a_field,
+                                        std::vector<std::string> & keys) const;
 
-    std::unordered_map<std::string, field> facet_schema;
+    std::vector<field_keys_t> field_key_extractors;
 
-    std::unordered_map<std::string, field> sort_schema;
+    // compiled analyzer of each field, addressed by field id: used for indexing and for querying string fields
+    std::vector<analyzer> analyzers;
 
-    spp::sparse_hash_map<std::string, art_tree*> search_index;
+    std::unordered_map<std::string, uint32_t> field_ids;
 
-    spp::sparse_hash_map<std::string, facet_value> facet_index;
+    std::vector<uint32_t> facet_field_ids;
 
-    spp::sparse_hash_map<std::string, spp::sparse_hash_map<uint32_t, number_t>*> sort_index;
+    std::vector<uint32_t> sort_field_ids;
 
-    StringUtils string_utils;
+    // the following are indexed by field id and hold a nullptr / an empty value for fields they don't apply to
+
+    std::vector<art_tree*> search_index;
+
+    std::vector<facet_value> facet_index;
+
+    // dictionary of the values of each string facet field: the normalized tokens of a value lead to its value index
+    std::vector<art_tree*> facet_value_index;
+
+    // trigrams of the tokens of each infix field
+    std::vector<infix_index*> infix_indices;
+
+    // distinct values of each numeric facet field and their number of documents: the bounds of automatic facet
+    // ranges. The values of the documents themselves are in the field's sort index.
+    std::vector<std::map<double, uint32_t>> numeric_facet_values;
+
+    std::vector<numeric_column*> sort_index;
+
+    std::vector<field_stats> search_stats;
+
+    // Optional forward index: the leaves that each document contributed to, in field id order, so that a
+    // document can be removed without fetching and tokenizing it again. Leaves are stable: a leaf is freed only
+    // when its last document is removed.
+    bool forward_index_enabled;
+
+    spp::sparse_hash_map<uint32_t, doc_leaves> forward_index;
+
+    std::vector<pinned_filter> pinned_filters;
+
+    // by the search that is running
+    size_t num_scored_docs;
+
+    // Tiering of the posting lists. The leaves of a field that hasn't been searched for a while can have their
+    // values moved to the store's postings column family, while the tree itself stays in memory as the field's
+    // term dictionary. A leaf's values are paged back in, through the column family's block cache, when a search
+    // or a write needs that leaf. The store keeps its copy, which the next spill of the leaf overwrites.
+    Store* postings_store;
+
+    // the values of a spilled leaf are keyed by this prefix, the field id and the leaf's key
+    std::string postings_prefix;
+
+    // by field id: when the field was last searched, by postings_clock_ms()
+    std::vector<uint64_t> postings_accessed_ms;
+
+    // by field id: whether the store holds values of the field's leaves
+    std::vector<bool> postings_spilled;
+
+    // by field id: leaves whose values are only in the store
+    std::vector<size_t> num_spilled_leaves;
+
+    // Serializes the writes of the main thread with those of a schema backfill. A field that is being backfilled
+    // has its own slots in the per-field structures, but is not in `field_ids` yet, so searches never read them.
+    std::mutex write_mutex;
 
     static inline std::vector<art_leaf *> next_suggestion(const std::vector<token_candidates> &token_candidates_vec,
                                                           long long int n);
@@ -80,30 +205,79 @@ private:
 
     Option<uint32_t> do_filtering(uint32_t** filter_ids_out, const std::vector<filter> & filters);
 
+    search_plan plan_search(const std::string & query, const std::vector<uint32_t> & search_field_ids,
+                            const std::vector<filter> & filters, std::vector<filter_check> & filter_checks) const;
+
+    size_t estimate_filter_matches(const std::vector<filter> & filters) const;
+
+    size_t estimate_text_matches(const std::string & query, const std::vector<uint32_t> & search_field_ids) const;
+
+    size_t key_num_docs(art_tree *t, const std::string & key) const;
+
+    bool get_filter_checks(const std::vector<filter> & filters, std::vector<filter_check> & filter_checks) const;
+
+    static bool passes_filter_checks(const std::vector<filter_check> & filter_checks, const uint32_t seq_id);
+
+    static size_t probe_postings(const std::vector<art_leaf*> & query_suggestion, const uint32_t* filter_ids,
+                                 const size_t filter_ids_length, uint32_t** results_out);
+
     void do_facets(std::vector<facet> & facets, uint32_t* result_ids, size_t results_size);
 
+    void resolve_facet_values(std::vector<facet> & facets) const;
+
+    void index_facet_values(const field & a_field, const uint32_t seq_id, const std::vector<std::string> & values);
+
+    void match_facet_queries(std::vector<facet> & facets, const int num_typos) const;
+
+    void do_numeric_facet(facet & a_facet, const uint32_t* result_ids, const size_t results_size,
+                          const double scale) const;
+
+    static void add_value_counts(facet & a_facet, const std::vector<uint32_t> & value_counts);
+
+    const pinned_filter* get_pinned_filter(const std::vector<filter> & filters) const;
+
+    // whether the document passes the filter, as `do_filtering` would have decided
+    bool doc_matches_filter(const filter & a_filter, const uint32_t seq_id);
+
+    void count_pinned_values(pinned_filter & pinned, const uint32_t seq_id, const bool added,
+                             const std::vector<uint32_t> & count_field_ids);
+
+    void search_wildcard(const std::vector<filter> & filters, std::vector<facet> & facets,
+                         const std::vector<sort_by> & sort_fields, const size_t num_results, const bool count_only,
+                         const int field_order, std::vector<std::pair<int, Topster<512>::KV>> & field_order_kvs,
+                         size_t & all_result_ids_len, std::vector<std::vector<art_leaf*>> & searched_queries,
+                         search_plan & plan, Option<uint32_t> & outcome);
+
     void populate_token_positions(const std::vector<art_leaf *> &query_suggestion,
                                   spp::sparse_hash_map<const art_leaf *, uint32_t *> &leaf_to_indices,
                                   size_t result_index, std::vector<std::vector<uint16_t>> &token_positions) const;
 
-    void search_field(std::string & query, const std::string & field, uint32_t *filter_ids, size_t filter_ids_length,
-                      std::vector<facet> & facets, const std::vector<sort_by> & sort_fields,
+    void search_field(std::string & query, const uint32_t field_id, uint32_t *filter_ids, size_t filter_ids_length,
+                      const std::vector<filter_check> & filter_checks, std::vector<facet> & facets, const std::vector<sort_by> & sort_fields,
                       const int num_typos, const size_t num_results,
                       std::vector<std::vector<art_leaf*>> & searched_queries,
                       Topster<512> & topster, uint32_t** all_result_ids,
-                      size_t & all_result_ids_len, const token_ordering token_order = FREQUENCY, const bool prefix = false);
+                      size_t & all_result_ids_len, const token_ordering token_order = FREQUENCY, const bool prefix = false,
+                      const bool count_only = false, const bool infix = false);
 
-    void search_candidates(uint32_t* filter_ids, size_t filter_ids_length, std::vector<facet> & facets,
+    // leaves of the tokens of an infix field that contain `infix`, best first
+    void search_infix(const uint32_t field_id, const std::string & infix, const token_ordering token_order,
+                      const size_t max_candidates, std::vector<art_leaf*> & leaves) const;
+
+    void search_candidates(uint32_t* filter_ids, size_t filter_ids_length,
+                           const std::vector<filter_check> & filter_checks, std::vector<facet> & facets,
                            const std::vector<sort_by> & sort_fields, std::vector<token_candidates> & token_to_candidates,
                            const token_ordering token_order, std::vector<std::vector<art_leaf*>> & searched_queries,
                            Topster<512> & topster, size_t & total_results, uint32_t** all_result_ids,
-                           size_t & all_result_ids_len, const size_t & max_results, const bool prefix);
+                           size_t & all_result_ids_len, const size_t & max_results, const bool prefix,
+                           const bool count_only);
 
-    void index_string_field(const std::string & text, const uint32_t score, art_tree *t, uint32_t seq_id,
-                            const bool verbatim) const;
+    size_t index_string_field(const std::string & text, const uint32_t score, art_tree *t, uint32_t seq_id,
+                              const analyzer & field_analyzer, infix_index* infix = nullptr) const;
 
-    void index_string_array_field(const std::vector<std::string> & strings, const uint32_t score, art_tree *t,
-                                  uint32_t seq_id, const bool verbatim) const;
+    size_t index_string_array_field(const std::vector<std::string> & strings, const uint32_t score, art_tree *t,
+                                    uint32_t seq_id, const analyzer & field_analyzer,
+                                    infix_index* infix = nullptr) const;
 
     void index_int32_field(const int32_t value, const uint32_t score, art_tree *t, uint32_t seq_id) const;
 
@@ -121,14 +295,58 @@ private:
     
     void index_bool_array_field(const std::vector<bool> & values, const uint32_t score, art_tree *t, uint32_t seq_id) const;
 
+    template <field_type_t type>
+    void index_field(const nlohmann::json & value, const field & a_field, const uint32_t score, const uint32_t seq_id);
+
+    // Keys under which a field's value is found in the field's ART tree: one specialization per field type
+    template <field_type_t type>
+    void field_keys(const nlohmann::json & value, const field & a_field, std::vector<std::string> & keys) const;
+
+    static field_indexer_t get_field_indexer(const field_type_t type);
+
+    static field_keys_t get_field_keys(const field_type_t type);
+
+    void index_forward(const nlohmann::json & document, uint32_t seq_id);
+
+    void index_forward_field(const nlohmann::json & value, const field & a_field, const size_t field_index,
+                             doc_leaves & entry) const;
+
+    bool has_document(const uint32_t seq_id) const;
+
+    // removes `seq_id` from the leaf, which is freed when no documents are left in it
+    void remove_from_leaf(const uint32_t field_id, art_leaf* leaf, const uint32_t seq_id);
+
+    void remove_from_sort_and_facets(const uint32_t seq_id);
+
     void remove_and_shift_offset_index(sorted_array &offset_index, const uint32_t *indices_sorted,
                                        const uint32_t indices_length);
 
+    std::string postings_key_prefix(const uint32_t field_id) const;
+
+    // marks the field as searched, so that its postings stay in memory
+    void access_postings(const std::string & field_name);
+
+    // Pages the values of a spilled leaf back in. Takes a const leaf like the searches that find it: the leaf gets
+    // back the same values.
+    void load_leaf(const uint32_t field_id, const art_leaf* leaf);
+
+    void load_leaves(const uint32_t field_id, const std::vector<art_leaf*> & leaves);
+
+    // pages in the spilled leaves that writing or removing the document touches
+    void load_document_leaves(const nlohmann::json & document);
+
+    // returns the number of bytes that were moved to the store
+    size_t spill_postings(const uint32_t field_id);
+
+    // deletes the spilled values of a field that is dropped
+    void discard_postings(const uint32_t field_id);
+
 public:
     Index() = delete;
 
     Index(const std::string name, std::unordered_map<std::string, field> search_schema,
-          std::unordered_map<std::string, field> facet_schema, std::unordered_map<std::string, field> sort_schema);
+          std::unordered_map<std::string, field> facet_schema, std::unordered_map<std::string, field> sort_schema,
+          const bool forward_index_enabled = false);
 
     ~Index();
 
@@ -138,20 +356,79 @@ public:
                           const std::vector<filter> & filters, std::vector<facet> & facets,
                           std::vector<sort_by> sort_fields_std, const int num_typos,
                           const size_t per_page, const size_t page,
-                          const token_ordering token_order, const bool prefix,
+                          const token_ordering token_order, const bool prefix, const bool infix,
                           std::vector<std::pair<int, Topster<512>::KV>> & field_order_kv,
-                          size_t & all_result_ids_len, std::vector<std::vector<art_leaf*>> & searched_queries);
+                          size_t & all_result_ids_len, std::vector<std::vector<art_leaf*>> & searched_queries,
+                          search_plan & plan);
 
     Option<uint32_t> remove(const uint32_t seq_id, nlohmann::json & document);
 
+    // removes a document through the forward index, without needing the document itself
+    Option<uint32_t> remove(const uint32_t seq_id);
+
+    bool has_forward_index() const;
+
+    // smallest and largest value of a numeric facet field: false when the shard has no documents
+    bool get_numeric_facet_bounds(const std::string & field_name, double & min, double & max) const;
+
+    // materializes the documents matching the filters and their facet counts, which are then maintained
+    Option<uint32_t> pin_filter(const std::vector<filter> & filters);
+
     void score_results(const std::vector<sort_by> & sort_fields, const int & query_index, const uint32_t total_cost,
                        Topster<512> &topster, const std::vector<art_leaf *> & query_suggestion,
                        const uint32_t *result_ids, const size_t result_size) const;
 
     Option<uint32_t> index_in_memory(const nlohmann::json & document, uint32_t seq_id, int32_t points);
 
+    /*
+     * Schema changes on a live index. Like document writes, `add_field`, `publish_field` and `drop_field` are
+     * called from the main thread while no search is running. An added field is indexed for new documents right
+     * away, while `backfill` indexes it for the existing documents from another thread. It becomes visible to
+     * searches only once it is published.
+    */
+
+    void add_field(const field & new_field);
+
+    void backfill(const nlohmann::json & document, const uint32_t seq_id, const int32_t points,
+                  const std::vector<field> & backfill_fields);
+
+    void publish_field(const field & new_field);
+
+    void drop_field(const std::string & field_name);
+
+    // enables the tiering of the posting lists into the store, under the given key prefix
+    void set_postings_store(Store* store, const std::string & prefix);
+
+    // Moves the postings of the fields that were not searched in the last `cold_after_ms` to the store. Called from
+    // the main thread while no search is running, like the writes. Returns the number of bytes that were moved.
+    size_t spill_cold_postings(const uint64_t cold_after_ms);
+
+    size_t get_num_spilled_leaves() const;
+
+    static uint64_t postings_clock_ms();
+
+    // number of leaves whose values are written to the store at a time
+    static const size_t SPILL_BATCH_SIZE = 1000;
+
+    // matches every document: facet counts then come from the live counts instead of the documents
+    static constexpr const char* WILDCARD_QUERY = "*";
+
     static const int SEARCH_LIMIT_NUM = 100;  // for limiting number of results on multiple candidates / query rewrites
 
+    static const uint32_t TOPSTER_SIZE = 512;  // capacity of the Topster<512> of each search field
+
+    // most values of the facet field's tree that each token of a facet query is matched against, by frequency
+    static const int FACET_QUERY_MAX_VALUES = 1000;
+
+    // most tokens of an infix field that an infix search looks up and ranks: a short, common infix can be contained
+    // in a large part of the field's vocabulary, so the earliest added ones stand for the rest
+    static const size_t INFIX_MAX_TOKENS = 1000;
+
+    // Text matches are checked against the filters instead of materializing the filters only when there are
+    // at least this many times fewer text matches than filter matches: checking a candidate costs a hash lookup
+    // per filter, which is more than the cost of a materialized filter id
+    static const size_t TEXT_FIRST_FACTOR = 4;
+
     // strings under this length will be fully highlighted, instead of showing a snippet of relevant portion
     enum {SNIPPET_STR_ABOVE_LEN = 30};
 
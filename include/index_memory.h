@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+
+struct index_memory_stats {
+    size_t num_regions;
+
+    // regions that are backed by reserved huge pages (MAP_HUGETLB), rather than transparent ones (MADV_HUGEPAGE)
+    size_t num_hugetlb_regions;
+
+    size_t region_bytes;
+
+    // held by the indices, whether from huge page regions or not
+    size_t allocated_bytes;
+
+    // resident set of the whole process, as last sampled: 0 unless resident memory is counted
+    size_t resident_bytes;
+};
+
+enum memory_pressure {
+    MEMORY_PRESSURE_NONE,
+
+    // above the soft limit, writes are throttled
+    MEMORY_PRESSURE_SOFT,
+
+    // above the hard limit, writes are rejected while reads are still served
+    MEMORY_PRESSURE_HARD
+};
+
+/*
+ * Allocator for the long lived memory of the indices: ART nodes, leaves and posting lists. By default, it's the
+ * libc allocator. With huge pages, allocations are carved from 2MB regions that are backed by huge pages, so that
+ * walking the tree and decoding its postings takes far fewer TLB misses. Regions are mapped with MAP_HUGETLB when
+ * huge pages are reserved, and are otherwise advised to be backed by transparent huge pages.
+ *
+ * Allocations are rounded up to size classes, and freed blocks are kept on a free list per class for reuse: the
+ * regions themselves are never unmapped. Callers pass the size of an allocation when freeing or resizing it, like
+ * they do for the art_leaf keys and posting buffers that they already track the size of. Allocations that are
+ * larger than MAX_CLASS_SIZE always come from libc.
+ *
+ * The bytes that are allocated are counted either way, so that writes can be held back before the indices take up
+ * more memory than the node has. These are only the ART nodes, leaves and posting buffers: the facet and sort
+ * indices, the forward and infix indices, pinned filters and the like are allocated by their containers. When
+ * resident memory is counted, the limits are held against the process's resident set as well, which covers them.
+ */
+class index_memory {
+private:
+    // sizes are rounded up to 16 bytes up to 512 bytes, and then to quarters of a power of 2
+    static inline size_t size_class(const size_t size) {
+        if(size <= 512) {
+            return (size + 15) / 16 - (size != 0);
+        }
+
+        const size_t power = 63 - __builtin_clzll(size - 1);
+        const size_t step = (size_t) 1 << (power - 2);
+        const size_t quarters = (size - ((size_t) 1 << power) + step - 1) / step;
+        return 32 + (power - 9) * 4 + (quarters - 1);
+    }
+
+    static inline size_t class_size(const size_t size_class) {
+        if(size_class < 32) {
+            return (size_class + 1) * 16;
+        }
+
+        const size_t power = 9 + (size_class - 32) / 4;
+        return ((size_t) 1 << power) + ((size_class - 32) % 4 + 1) * ((size_t) 1 << (power - 2));
+    }
+
+    static void* alloc_block(const size_t size_class);
+
+    static void free_block(void* ptr, const size_t size_class);
+
+public:
+    static const size_t NUM_CLASSES = 60;
+
+    static const size_t REGION_SIZE = 2 * 1024 * 1024;
+
+    static const size_t MAX_CLASS_SIZE = 64 * 1024;
+
+    // must be called before any index memory is allocated, since blocks are freed the way they were allocated
+    static void use_huge_pages(const bool enabled);
+
+    static bool huge_pages_enabled();
+
+    static void* alloc(const size_t size);
+
+    // zero-initialized
+    static void* zalloc(const size_t size);
+
+    static void* realloc(void* ptr, const size_t old_size, const size_t new_size);
+
+    static void free(void* ptr, const size_t size);
+
+    static index_memory_stats get_stats();
+
+    // Holds the limits against the larger of the allocated bytes and the resident set of the process, which is
+    // sampled from /proc/self/statm at most once every RESIDENT_SAMPLE_INTERVAL_MS.
+    static void count_resident_memory(const bool enabled);
+
+    static const uint64_t RESIDENT_SAMPLE_INTERVAL_MS = 100;
+
+    // the bytes at which the memory is under pressure: 0 for no limit
+    static void set_limits(const size_t soft_limit, const size_t hard_limit);
+
+    static memory_pressure get_pressure();
+
+    // how far the bytes are from the soft limit towards the hard limit: 0 below the soft limit, and 1 at or above
+    // the hard limit, or above a soft limit without a hard limit
+    static float get_soft_pressure();
+
+    static size_t get_soft_limit();
+
+    static size_t get_hard_limit();
+};
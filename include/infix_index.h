@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sparsepp.h>
+#include "sorted_array.h"
+
+/*
+ * Trigram index over the distinct tokens of a string field, for infix (substring) searches. Each token gets a
+ * dense id, and each trigram of its bytes leads to the ids of the tokens that contain it. A search intersects the
+ * postings of the trigrams of the substring and then verifies the candidate tokens, since having every trigram
+ * of a substring does not mean having the substring itself.
+ *
+ * Like the facet value dictionary, tokens are never removed: the caller checks that a token is still indexed.
+ */
+class infix_index {
+private:
+    std::vector<std::string> tokens;
+
+    spp::sparse_hash_map<std::string, uint32_t> token_ids;
+
+    // the 3 bytes of a trigram, packed into the lower bytes of the key
+    spp::sparse_hash_map<uint32_t, sorted_array*> trigram_postings;
+
+    static inline uint32_t trigram(const std::string & str, const size_t i) {
+        return ((uint32_t) (uint8_t) str[i] << 16) | ((uint32_t) (uint8_t) str[i+1] << 8) | (uint8_t) str[i+2];
+    }
+
+public:
+    // shorter substrings have no trigrams to look up
+    static const size_t MIN_INFIX_LEN = 3;
+
+    infix_index() = default;
+
+    infix_index(const infix_index &) = delete;
+
+    infix_index & operator=(const infix_index &) = delete;
+
+    ~infix_index();
+
+    void add(const std::string & token);
+
+    // appends the tokens that contain `infix`, in the order that they were first added, stopping at `max_tokens`
+    void search(const std::string & infix, std::vector<std::string> & matching_tokens,
+                const size_t max_tokens = SIZE_MAX) const;
+
+    size_t num_tokens() const;
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <art.h>
+#include <number.h>
+
+/*
+ * The values of a single valued numeric field, by the sequence id of their document: what the sort index keeps for
+ * sorting, filtering and numeric facets.
+ *
+ * Values are kept in blocks of BLOCK_SPAN consecutive sequence ids. A block has a bitmap of the ids that have a
+ * value, and its values in the order of their ids, frame-of-reference (FOR) encoded: each value is stored as its
+ * difference from the smallest value of the block, in as few bits as the largest difference needs. Values are thus
+ * read back individually, without decoding their block. The smallest and largest value of each block let range
+ * filters skip the blocks that can't have a match. Writes that fit the frame of a block are made in place, and may
+ * leave these bounds wider than the block's values, which only makes them skip fewer blocks.
+ *
+ * Values are encoded as order preserving unsigned keys, so that integers and floats share the encoding.
+ */
+class numeric_column {
+private:
+    struct block {
+        uint64_t present[4];
+        uint64_t min_key;
+        uint64_t max_key;
+        uint16_t count;
+        uint8_t bits;
+        uint8_t* packed;
+    };
+
+    const bool is_float;
+
+    // indexed by `seq_id / BLOCK_SPAN`
+    std::vector<block*> blocks;
+
+    size_t num_values;
+
+    uint64_t to_key(const number_t & value) const;
+
+    number_t from_key(const uint64_t key) const;
+
+    static size_t rank(const block* b, const uint32_t offset);
+
+    static uint64_t key_at(const block* b, const size_t rank);
+
+    static size_t packed_size(const size_t count, const uint8_t bits);
+
+    // replaces the values of a block with the given keys, in the order of their ids
+    static void encode(block* b, const std::vector<uint64_t> & keys);
+
+    static void decode(const block* b, std::vector<uint64_t> & keys);
+
+    // Writes the key at the given rank without re-encoding the block, either over the value there or, with
+    // `append`, after the block's last value. Returns false when the key doesn't fit the block's smallest key and
+    // bits, in which case the block is left as is.
+    static bool put_in_place(block* b, const size_t value_rank, const uint64_t key, const bool append);
+
+    // whether any value in [min, max] can be compared with one of `values` successfully
+    static bool may_match(const number_t & min, const number_t & max, const NUM_COMPARATOR compare_operator,
+                          const std::vector<number_t> & values);
+
+    static bool matches(const number_t & value, const NUM_COMPARATOR compare_operator,
+                        const std::vector<number_t> & values);
+
+public:
+    static const uint32_t BLOCK_SPAN = 256;
+
+    // a larger difference is stored as is
+    static const uint8_t MAX_PACKED_BITS = 56;
+
+    explicit numeric_column(const bool is_float): is_float(is_float), num_values(0) {
+
+    }
+
+    numeric_column(const numeric_column &) = delete;
+
+    numeric_column & operator=(const numeric_column &) = delete;
+
+    ~numeric_column();
+
+    // replaces the value of the document when it already has one
+    void set(const uint32_t seq_id, const number_t & value);
+
+    bool get(const uint32_t seq_id, number_t & value) const;
+
+    bool contains(const uint32_t seq_id) const;
+
+    void erase(const uint32_t seq_id);
+
+    size_t size() const;
+
+    // the ids of the documents with a value, in ascending order: `ids` must have room for size() of them
+    void get_ids(uint32_t* ids) const;
+
+    // appends the ids of the documents whose value compares successfully with any of `values`, in ascending order
+    void filter(const NUM_COMPARATOR compare_operator, const std::vector<number_t> & values,
+                std::vector<uint32_t> & ids) const;
+
+    // memory of the blocks and of their values
+    size_t size_in_bytes() const;
+};
@@ -1,5 +1,14 @@
 #pragma once
 #include <stdint.h>
+#include <string>
+#include <utility>
+
+// Tag type for constructing the value of an Option in place
+struct option_in_place_t {
+
+};
+
+static const option_in_place_t option_in_place = option_in_place_t();
 
 template <typename T=uint32_t>
 class Option {
@@ -13,34 +22,56 @@ private:
 
 public:
 
-    Option(const T & value): value(value), is_ok(true) {
+    Option(const T & value): value(value), is_ok(true), error_code(0) {
+
+    }
+
+    Option(T && value): value(std::move(value)), is_ok(true), error_code(0) {
 
     }
 
-    Option(const uint32_t code, const std::string & error_msg): is_ok(false), error_msg(error_msg), error_code(code) {
+    // forwards the given arguments to T's constructor, e.g. Option<std::string>(option_in_place, 10, 'x')
+    template <typename... Args>
+    explicit Option(option_in_place_t, Args&&... args): value(std::forward<Args>(args)...), is_ok(true),
+                                                         error_code(0) {
 
     }
 
-    Option(const Option &obj) {
-        value = obj.value;
-        is_ok = obj.is_ok;
-        error_msg = obj.error_msg;
-        error_code = obj.error_code;
+    Option(const uint32_t code, const std::string & error_msg): value(), is_ok(false), error_msg(error_msg),
+                                                                 error_code(code) {
+
     }
 
+    Option(const Option & obj) = default;
+
+    Option(Option && obj) = default;
+
+    Option & operator=(const Option & obj) = default;
+
+    Option & operator=(Option && obj) = default;
+
     bool ok() const {
         return is_ok;
     }
 
-    T get() const {
+    const T & get() const & {
+        return value;
+    }
+
+    T & get() & {
         return value;
     }
 
-    std::string error() const {
+    // moves the value out of a temporary option, e.g. nlohmann::json doc = collection->get(id).get();
+    T get() && {
+        return std::move(value);
+    }
+
+    const std::string & error() const {
         return error_msg;
     }
 
     uint32_t code() const {
         return error_code;
     }
-};
\ No newline at end of file
+};
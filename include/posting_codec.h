@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+
+enum class codec_t: uint8_t {
+    FOR,    // frame of reference over the whole list (libfor)
+    BP128,  // blocks of 128 bit packed values, delta coded when sorted
+    VBYTE,  // variable byte integers, delta coded when sorted
+    RAW     // plain uint32_t values
+};
+
+/*
+ * Encodes the values of an array_base. Codecs are stateless: the encoded bytes, the number of values, and whether
+ * the values are sorted in ascending order are all passed in. Every value of a sorted list is >= the one before it,
+ * which lets codecs delta encode them.
+ */
+class posting_codec {
+public:
+    static const uint32_t RAW_MAX_LENGTH = 8;
+    static const uint32_t VBYTE_MAX_LENGTH = 256;
+    static const uint32_t BP128_MAX_AVERAGE_GAP = 64;
+
+    virtual ~posting_codec() {}
+
+    virtual codec_t type() const = 0;
+
+    virtual const char* name() const = 0;
+
+    // exact number of bytes that encode() will write
+    virtual uint32_t encoded_size(const uint32_t* values, const uint32_t length, const bool sorted) const = 0;
+
+    virtual uint32_t encode(const uint32_t* values, const uint32_t length, const bool sorted, uint8_t* out) const = 0;
+
+    virtual void decode(const uint8_t* in, const uint32_t length, const bool sorted, uint32_t* out) const = 0;
+
+    virtual uint32_t select(const uint8_t* in, const uint32_t length, const bool sorted, const uint32_t index) const = 0;
+
+    // the values from index `start` up to `end`, which are read together when the codec can't reach them directly
+    virtual void select_range(const uint8_t* in, const uint32_t length, const bool sorted, const uint32_t start,
+                              const uint32_t end, uint32_t* out) const;
+
+    // upper bound of the encoded size once `value` is appended to a list with the given `min` and `max`
+    virtual uint32_t append_size_required(const uint8_t* in, const uint32_t length_bytes, const uint32_t length,
+                                          const uint32_t min, const uint32_t max, const uint32_t value) const = 0;
+
+    // `in` must have room for append_size_required() bytes: returns the new encoded size, or 0 on failure
+    virtual uint32_t append(uint8_t* in, const uint32_t length_bytes, const uint32_t length, const bool sorted,
+                            const uint32_t max, const uint32_t value) const = 0;
+
+    // index of `value` in an unsorted list, or `length` when it is not present
+    virtual uint32_t linear_search(const uint8_t* in, const uint32_t length, const uint32_t value) const;
+
+    // Sorted lists only. Index of the first value >= `value`, which is returned in `actual`. Like libfor's
+    // for_lower_bound_search(), the last index is returned when every value is smaller.
+    virtual uint32_t lower_bound(const uint8_t* in, const uint32_t length, const uint32_t value,
+                                 uint32_t* actual) const;
+
+    // Sorted lists only: index of each of the sorted `values`, or `length` when it is not present
+    virtual void index_of(const uint8_t* in, const uint32_t length, const uint32_t* values, const size_t values_len,
+                          uint32_t* indices) const;
+
+    // Sorted lists only: intersects with the sorted `ids`, writing at most min(length, ids_len) values to `out`
+    virtual size_t intersect(const uint8_t* in, const uint32_t length, const uint32_t* ids, const size_t ids_len,
+                             uint32_t* out) const;
+
+    static const posting_codec* get(const codec_t type);
+
+    // Picks a codec from the length and the density of a list:
+    // - short lists are kept raw, since the codec headers outweigh any saving and raw values need no decoding
+    // - sorted lists with at least a block of values are delta coded with BP128 when they are dense (an average gap
+    //   of at most BP128_MAX_AVERAGE_GAP) and that is a clear saving over FOR, whose bit width depends on the range
+    //   of the whole list. BP128 finds a value's block through its directory, but then decodes the whole block,
+    //   while FOR unpacks just the one value: when the saving is small, FOR's cheaper lookups win.
+    // - unsorted lists use VByte when it is smaller, if they are short enough to be walked: a value can only be
+    //   reached by decoding the ones before it, so their values should be read with select_range()
+    // - otherwise FOR, which supports constant time random access
+    static codec_t choose(const uint32_t* values, const uint32_t length, const bool sorted);
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "option.h"
+
+/*
+ * Singleton, for warming up the caches after a restart: a sample of the searches is counted by their parameters
+ * and saved to a file, whose most frequent searches are replayed on startup, before the server is ready to accept
+ * requests. This pages in the parts of the indices and of the block cache that the usual traffic needs.
+ *
+ * Counts decay: they are halved every DECAY_EVERY recorded searches, so that the replayed searches follow the
+ * recent traffic rather than all the traffic since the log was started.
+ *
+ * Searches only update the counts in memory: the log is saved by a background thread every FLUSH_INTERVAL_MS,
+ * and when the server stops.
+ */
+class QueryLog {
+private:
+    std::string path;
+
+    // one in every `sample_rate` searches is recorded
+    size_t sample_rate;
+    std::atomic<size_t> num_searches;
+
+    // recording starts once the logged searches have been replayed, so that they are not counted again
+    std::atomic<bool> recording;
+
+    std::mutex mutex;
+
+    // held while the log is written, so that the counts are not held up by the disk
+    std::mutex flush_mutex;
+
+    // serialized parameters of a search => number of times that it was recorded
+    std::map<std::string, size_t> query_counts;
+    size_t num_recorded_since_flush;
+    size_t num_recorded_since_decay;
+
+    // halves every count, and forgets the searches whose count drops to 0
+    void decay();
+
+    QueryLog(): sample_rate(1), num_searches(0), recording(false), num_recorded_since_flush(0),
+                num_recorded_since_decay(0) {
+
+    }
+
+    ~QueryLog() = default;
+
+public:
+    // only the most frequent searches are kept when the log is saved
+    static const size_t MAX_QUERIES = 1000;
+
+    // how often the background thread saves the log, when searches were recorded since it was last saved
+    static const uint64_t FLUSH_INTERVAL_MS = 60 * 1000;
+
+    // the half-life of the counts, in recorded searches
+    static const size_t DECAY_EVERY = 1000;
+
+    static QueryLog & get_instance() {
+        static QueryLog instance;
+        return instance;
+    }
+
+    QueryLog(QueryLog const&) = delete;
+    void operator=(QueryLog const&) = delete;
+
+    // loads the searches that were logged before, when the file exists
+    Option<bool> init(const std::string & path, const size_t sample_rate);
+
+    // the parameters of the `n` most frequent searches, most frequent first
+    std::vector<std::map<std::string, std::string>> get_top_queries(const size_t n);
+
+    void start_recording();
+
+    // API keys and JSONP callbacks are not recorded
+    void record(const std::map<std::string, std::string> & params);
+
+    Option<bool> flush();
+
+    // saves the log only when searches were recorded since it was last saved
+    Option<bool> flush_if_recorded();
+
+    static constexpr const char* AUTH_PARAM = "x-typesense-api-key";
+    static constexpr const char* CALLBACK_PARAM = "callback";
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <json.hpp>
+#include "field.h"
+#include "index.h"
+#include "number.h"
+#include "option.h"
+
+struct search_hit {
+    // the stored JSON document, as is
+    std::string document;
+
+    // set only when the document had to be parsed for highlighting
+    nlohmann::json parsed_document;
+
+    // empty when there is nothing to highlight
+    std::string highlight_field;
+    std::string snippet;
+
+    // the keys that the hit was ranked on, across the index shards
+    uint64_t match_score;
+    number_t primary_attr;
+    number_t secondary_attr;
+    int field_order;
+};
+
+struct facet_result {
+    std::string field_name;
+    bool is_numeric;
+    bool sampled;
+
+    // string facets: values by descending count; numeric facets: range labels, in the order they were asked for
+    std::vector<std::string> values;
+    std::vector<size_t> counts;
+
+    facet_stats stats;
+
+    // numeric facets with auto ranges: the bounds of the field's values that the ranges were spread over
+    bool auto_ranges = false;
+    double auto_min = 0;
+    double auto_max = 0;
+};
+
+/*
+ * The results of a search, before they are encoded into a response: either as JSON, or in a compact binary form
+ * for services that call search at high rates, which is written without building a JSON document.
+ *
+ * Binary layout, with integers in little-endian and strings (`str`) as a u32 length followed by their bytes:
+ *
+ *   "TSR1"  u32 length of the rest
+ *   u64 found  u64 search_time_ms  u32 page
+ *   u32 num_hits, then for each hit: str document (as stored), str highlight field, str snippet
+ *   u32 num_facets, then for each facet:
+ *       str field_name  u8 flags (1: numeric, 2: sampled)  u32 num_counts
+ *       num_counts x str value, then num_counts x u64 count
+ *       numeric facets only: u64 stats count, f64 min, f64 max, f64 sum
+ *   u32 num_plans, then for each plan: u8 execution (0: text_only, 1: filter_first, 2: text_first),
+ *       u64 estimated_filter_matches, u64 estimated_text_matches
+ */
+struct search_results {
+    size_t found = 0;
+
+    std::vector<search_hit> hits;
+
+    std::vector<facet_result> facets;
+
+    // one plan per index shard, when the plan was asked to be explained
+    bool explain_plan = false;
+    std::vector<search_plan> plans;
+
+    // the page is past the last hit: such a page comes without facet counts
+    bool out_of_range = false;
+
+    // what the search cost the index shards, and the bytes of the documents that were read for its hits
+    size_t num_scored_docs = 0;
+    uint64_t cpu_time_us = 0;
+    size_t num_bytes_read = 0;
+
+    static constexpr const char* BINARY_CONTENT_TYPE = "application/x-typesense-binary";
+
+    static const size_t MAX_FACET_VALUES = 10;
+
+    // Hands the hits' documents over to the JSON result. A mergeable result, to be merged with the results of other
+    // collections, has the sort keys of each hit, all the values of its string facets, and the bounds that the auto
+    // ranges of its numeric facets were spread over.
+    Option<nlohmann::json> to_json(const bool mergeable);
+
+    std::string to_binary(const uint64_t search_time_ms, const uint32_t page) const;
+};
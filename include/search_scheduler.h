@@ -0,0 +1,141 @@
+#pragma once
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+#include <json.hpp>
+#include "option.h"
+
+struct tenant_limits {
+    // share of the search time that the tenant gets when searches of several tenants are waiting
+    double weight;
+
+    // searches that are waiting or running at the same time: 0 for no limit
+    size_t max_concurrent;
+
+    // 0 for no limit
+    size_t max_qps;
+
+    tenant_limits(): weight(1.0), max_concurrent(0), max_qps(0) {
+
+    }
+
+    tenant_limits(double weight, size_t max_concurrent, size_t max_qps):
+            weight(weight), max_concurrent(max_concurrent), max_qps(max_qps) {
+
+    }
+};
+
+struct tenant_usage {
+    size_t num_searches = 0;
+    size_t num_rejected = 0;
+
+    // of the index threads and of the thread that handled the request
+    uint64_t cpu_time_us = 0;
+
+    size_t num_scored_docs = 0;
+
+    // of the stored documents that were read for the hits
+    size_t num_bytes_read = 0;
+};
+
+/*
+ * Singleton that decides the order in which waiting searches are run, so that one tenant's heavy searches can't
+ * starve the others. A tenant is a collection.
+ *
+ * Searches are run one at a time, in weighted fair queuing order: each waiting search gets a virtual finish time,
+ * from the CPU time that the searches of its tenant recently took, divided by the tenant's weight. The search with
+ * the earliest finish time runs next. A tenant that is over its QPS limit, or that already has its maximum number
+ * of searches waiting or running, gets its search rejected instead.
+ *
+ * The resources that each tenant's searches used are accounted for as well.
+ */
+class SearchScheduler {
+private:
+    struct queued_search {
+        void* data;
+        double start_time;
+        double finish_time;
+    };
+
+    struct tenant_state {
+        tenant_limits limits;
+        std::deque<queued_search> queue;
+
+        // virtual time at which the tenant's last queued search finishes
+        double last_finish_time = 0;
+
+        // moving average of the CPU time of the tenant's searches: what the next one is expected to take
+        double mean_cost_us = 0;
+
+        size_t num_in_flight = 0;
+
+        // QPS limit, as a token bucket that holds up to a second of searches
+        double tokens = 0;
+        uint64_t last_refill_us = 0;
+
+        tenant_usage usage;
+    };
+
+    std::mutex mutex;
+
+    // the start time of the search that was run last
+    double virtual_time;
+
+    tenant_limits default_limits;
+    std::map<std::string, tenant_limits> limits_by_tenant;
+
+    std::map<std::string, tenant_state> tenants;
+
+    SearchScheduler(): virtual_time(0) {
+
+    }
+
+    ~SearchScheduler() = default;
+
+    tenant_state & get_tenant(const std::string & tenant);
+
+public:
+    // of a search whose tenant has not run one yet
+    static constexpr double INITIAL_COST_US = 1000;
+
+    // weight of the last search in the moving average of a tenant's searches
+    static constexpr double COST_SMOOTHING = 0.2;
+
+    static SearchScheduler & get_instance() {
+        static SearchScheduler instance;
+        return instance;
+    }
+
+    SearchScheduler(SearchScheduler const&) = delete;
+    void operator=(SearchScheduler const&) = delete;
+
+    // Forgets all tenants. The limits of individual tenants are given as a comma separated list of
+    // `<collection>:<weight>:<max concurrent>:<max qps>`, the other tenants get the default limits.
+    Option<bool> init(const tenant_limits & default_limits, const std::string & limits_by_tenant);
+
+    // a search that is admitted has to be enqueued, and later completed once it is run
+    Option<bool> admit(const std::string & tenant, const uint64_t now_us);
+
+    void enqueue(const std::string & tenant, void* data);
+
+    // the search that should run next, if any is waiting
+    bool next(std::string & tenant, void* & data);
+
+    // of an admitted search, whether it was run or not
+    void complete(const std::string & tenant);
+
+    void record_usage(const std::string & tenant, const tenant_usage & usage);
+
+    tenant_usage get_usage(const std::string & tenant);
+
+    // usage, limits and waiting searches of each tenant
+    nlohmann::json get_metrics();
+
+    static uint64_t clock_us();
+
+    // CPU time of the calling thread
+    static uint64_t thread_cpu_time_us();
+};
@@ -12,13 +12,6 @@
 class sorted_array: public array_base {
 private:
 
-    uint32_t inline sorted_append_size_required(uint32_t value, uint32_t new_length) {
-        uint32_t m = std::min(min, value);
-        uint32_t M = std::max(max, value);
-        uint32_t bnew = required_bits(M - m);
-        return METADATA_OVERHEAD + 4 + for_compressed_size_bits(new_length, bnew);
-    }
-
     uint32_t lower_bound_search_bits(const uint8_t *in, uint32_t imin, uint32_t imax, uint32_t base,
                                      uint32_t bits, uint32_t value, uint32_t *actual);
 
@@ -28,6 +21,10 @@ private:
 
 public:
 
+    sorted_array(): array_base(true) {
+
+    }
+
     void load(const uint32_t *sorted_array, const uint32_t array_length);
 
     uint32_t at(uint32_t index);
@@ -38,6 +35,10 @@ public:
 
     void indexOf(const uint32_t *values, const size_t values_len, uint32_t* indices);
 
+    // intersects with the given sorted ids without decompressing the whole array: *out is allocated like
+    // ArrayUtils::and_scalar() does, i.e. only when both arrays are non-empty
+    size_t intersect(const uint32_t *ids, const size_t ids_len, uint32_t** out);
+
     // returns false if malloc fails
     bool append(uint32_t value);
 
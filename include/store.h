@@ -5,12 +5,19 @@
 #include <string>
 #include <sstream>
 #include <memory>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <option.h>
 #include <rocksdb/db.h>
 #include <rocksdb/write_batch.h>
 #include <rocksdb/options.h>
 #include <rocksdb/merge_operator.h>
 #include <rocksdb/transaction_log.h>
+#include <rocksdb/table.h>
+#include <rocksdb/cache.h>
+#include <rocksdb/env.h>
+#include <rocksdb/rate_limiter.h>
 #include "string_utils.h"
 #include "logger.h"
 
@@ -31,6 +38,24 @@ public:
     }
 };
 
+struct store_io_stats {
+    // bytes that compactions still have to rewrite, to bring every level back under its target size
+    uint64_t pending_compaction_bytes = 0;
+
+    uint64_t num_running_compactions = 0;
+    uint64_t num_running_flushes = 0;
+
+    // bytes per second that writes are slowed down to while compactions catch up: 0 when they are not stalled
+    uint64_t delayed_write_rate = 0;
+    bool writes_stopped = false;
+
+    // bytes per second that flushes and compactions are limited to: 0 for no limit
+    int64_t io_rate_limit = 0;
+    int64_t rate_limited_bytes = 0;
+
+    uint64_t num_idle_compactions = 0;
+};
+
 enum StoreStatus {
     FOUND,
     NOT_FOUND,
@@ -48,16 +73,69 @@ private:
     rocksdb::DB *db;
     rocksdb::Options options;
 
+    // the handle that DB::Open() returns for the default column family, which is what every other method uses
+    rocksdb::ColumnFamilyHandle* default_cf;
+
+    // posting lists that the indices have moved out of memory: see Index::spill_postings()
+    rocksdb::ColumnFamilyHandle* postings_cf;
+
+    // Spilled postings are only valid for the lifetime of the in-memory indices, so they are written without the
+    // WAL: this also keeps them out of the updates that replicas fetch.
+    rocksdb::WriteOptions postings_write_options;
+
+    // milliseconds by a steady clock, of the last write to the default column family
+    std::atomic<uint64_t> last_write_ms;
+    std::atomic<uint64_t> last_compaction_ms;
+    std::atomic<uint64_t> num_idle_compactions;
+
+    static uint64_t now_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void written() {
+        last_write_ms = now_ms();
+    }
+
 public:
+    static constexpr const char* POSTINGS_COLUMN_FAMILY = "postings";
+
+    // the block cache of the postings column family, which keeps the recently paged in postings in memory
+    static const size_t POSTINGS_CACHE_SIZE = 64 * 1024 * 1024;
+
+    // compaction debt below which an idle store is left alone
+    static const uint64_t IDLE_COMPACTION_MIN_PENDING_BYTES = 64 * 1024 * 1024;
 
     Store() = delete;
 
+    /*
+     * Flushes and compactions share `background_threads`. `io_rate_limit_mb` (per second, 0 for no limit) caps how
+     * fast they write to the disk, and `low_io_priority` has the compaction threads yield the disk to the searches
+     * that fetch documents. Flushes keep their priority: when they fall behind, writes stall.
+     */
     Store(const std::string & state_dir_path,
           const size_t wal_ttl_secs = 24*60*60,
-          const size_t wal_size_mb = 1024): state_dir_path(state_dir_path) {
-        // Optimize RocksDB
-        options.IncreaseParallelism();
+          const size_t wal_size_mb = 1024,
+          const size_t background_threads = 16,
+          const size_t io_rate_limit_mb = 0,
+          const bool low_io_priority = false): state_dir_path(state_dir_path), last_write_ms(now_ms()),
+                                               last_compaction_ms(0), num_idle_compactions(0) {
+        // Optimize RocksDB: one of the threads is for flushes, so at least two are needed
+        options.IncreaseParallelism(std::max<int>(background_threads, 2));
         options.OptimizeLevelStyleCompaction();
+
+        if(io_rate_limit_mb != 0) {
+            // flushes are served ahead of compactions by the limiter
+            options.rate_limiter.reset(rocksdb::NewGenericRateLimiter(io_rate_limit_mb * 1024 * 1024));
+
+            // syncs the output of compactions as it is written, instead of in large bursts at the end
+            options.bytes_per_sync = 1024 * 1024;
+        }
+
+        if(low_io_priority) {
+            options.env->LowerThreadPoolIOPriority(rocksdb::Env::Priority::LOW);
+        }
+
         // create the DB if it's not already present
         options.create_if_missing = true;
         options.write_buffer_size = 4*1048576;
@@ -68,14 +146,43 @@ public:
         options.WAL_ttl_seconds = wal_ttl_secs;
         options.WAL_size_limit_MB = wal_size_mb;
 
+        options.create_missing_column_families = true;
+
+        rocksdb::BlockBasedTableOptions postings_table_options;
+        postings_table_options.block_cache = rocksdb::NewLRUCache(POSTINGS_CACHE_SIZE);
+
+        rocksdb::ColumnFamilyOptions postings_options;
+        postings_options.OptimizeLevelStyleCompaction();
+        postings_options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(postings_table_options));
+
+        std::vector<rocksdb::ColumnFamilyDescriptor> column_families = {
+            rocksdb::ColumnFamilyDescriptor(rocksdb::kDefaultColumnFamilyName, options),
+            rocksdb::ColumnFamilyDescriptor(POSTINGS_COLUMN_FAMILY, postings_options)
+        };
+
         // open DB
-        rocksdb::Status s = rocksdb::DB::Open(options, state_dir_path, &db);
+        std::vector<rocksdb::ColumnFamilyHandle*> handles;
+        rocksdb::Status s = rocksdb::DB::Open(options, state_dir_path, column_families, &handles, &db);
 
         if(!s.ok()) {
             LOG(ERR) << "Error while initializing store: " << s.ToString();
         }
 
         assert(s.ok());
+        default_cf = handles[0];
+
+        // the postings that were spilled by a previous run belong to indices that no longer exist
+        db->DropColumnFamily(handles[1]);
+        db->DestroyColumnFamilyHandle(handles[1]);
+        s = db->CreateColumnFamily(postings_options, POSTINGS_COLUMN_FAMILY, &postings_cf);
+
+        if(!s.ok()) {
+            LOG(ERR) << "Error while creating the postings column family: " << s.ToString();
+        }
+
+        assert(s.ok());
+
+        postings_write_options.disableWAL = true;
     }
 
     ~Store() {
@@ -84,11 +191,13 @@ public:
 
     bool insert(const std::string& key, const std::string& value) {
         rocksdb::Status status = db->Put(rocksdb::WriteOptions(), key, value);
+        written();
         return status.ok();
     }
 
     bool batch_write(rocksdb::WriteBatch& batch) {
         rocksdb::Status status = db->Write(rocksdb::WriteOptions(), &batch);
+        written();
         return status.ok();
     }
 
@@ -115,9 +224,47 @@ public:
 
     bool remove(const std::string& key) {
         rocksdb::Status status = db->Delete(rocksdb::WriteOptions(), key);
+        written();
+        return status.ok();
+    }
+
+    // writes to the postings column family, with `batch` holding only writes to it
+    bool postings_batch_write(rocksdb::WriteBatch& batch) {
+        rocksdb::Status status = db->Write(postings_write_options, &batch);
+        return status.ok();
+    }
+
+    // reads through the block cache of the postings column family
+    StoreStatus get_postings(const std::string& key, std::string& value) const {
+        rocksdb::Status status = db->Get(rocksdb::ReadOptions(), postings_cf, key, &value);
+
+        if(status.ok()) {
+            return StoreStatus::FOUND;
+        }
+
+        if(status.IsNotFound()) {
+            return StoreStatus::NOT_FOUND;
+        }
+
+        LOG(ERR) << "Error while fetching the postings of key: " << key << " - status is: " << status.ToString();
+        return StoreStatus::ERROR;
+    }
+
+    bool remove_postings(const std::string& key) {
+        rocksdb::Status status = db->Delete(postings_write_options, postings_cf, key);
         return status.ok();
     }
 
+    rocksdb::ColumnFamilyHandle* get_postings_cf() const {
+        return postings_cf;
+    }
+
+    rocksdb::Iterator* scan_postings(const std::string & prefix) {
+        rocksdb::Iterator *iter = db->NewIterator(rocksdb::ReadOptions(), postings_cf);
+        iter->Seek(prefix);
+        return iter;
+    }
+
     rocksdb::Iterator* scan(const std::string & prefix) {
         rocksdb::Iterator *iter = db->NewIterator(rocksdb::ReadOptions());
         iter->Seek(prefix);
@@ -140,6 +287,7 @@ public:
 
     void increment(const std::string & key, uint32_t value) {
         db->Merge(rocksdb::WriteOptions(), key, StringUtils::serialize_uint32_t(value));
+        written();
     }
 
     uint64_t get_latest_seq_number() const {
@@ -191,6 +339,11 @@ public:
     }
 
     void close() {
+        if(db != nullptr) {
+            db->DestroyColumnFamilyHandle(postings_cf);
+            db->DestroyColumnFamilyHandle(default_cf);
+        }
+
         delete db;
         db = nullptr;
     }
@@ -200,6 +353,62 @@ public:
         db->Flush(options);
     }
 
+    /*
+     * Compacts the default column family once no writes have come in for `idle_ms` and the compactions are behind
+     * by at least `min_pending_bytes`, so that the debt of a burst of writes is paid off while the disk is idle.
+     * A compaction is not repeated until there are new writes. Blocks until the compaction is done, so it must not
+     * be called from the event loop.
+     */
+    bool compact_if_idle(const uint64_t idle_ms, const uint64_t min_pending_bytes) {
+        const uint64_t last_write = last_write_ms;
+        if(now_ms() - last_write < idle_ms || last_compaction_ms >= last_write) {
+            return false;
+        }
+
+        uint64_t pending_bytes = 0;
+        db->GetIntProperty("rocksdb.estimate-pending-compaction-bytes", &pending_bytes);
+        if(pending_bytes < min_pending_bytes) {
+            return false;
+        }
+
+        LOG(INFO) << "Compacting the store while it is idle, " << pending_bytes << " bytes pending compaction.";
+
+        // does not hold up the automatic compactions, which are needed if writes come in during it
+        rocksdb::CompactRangeOptions compact_options;
+        compact_options.exclusive_manual_compaction = false;
+        rocksdb::Status status = db->CompactRange(compact_options, nullptr, nullptr);
+
+        last_compaction_ms = now_ms();
+
+        if(!status.ok()) {
+            LOG(ERR) << "Error while compacting the store: " << status.ToString();
+            return false;
+        }
+
+        num_idle_compactions++;
+        return true;
+    }
+
+    store_io_stats get_io_stats() {
+        store_io_stats stats;
+        uint64_t writes_stopped = 0;
+
+        db->GetIntProperty("rocksdb.estimate-pending-compaction-bytes", &stats.pending_compaction_bytes);
+        db->GetIntProperty("rocksdb.num-running-compactions", &stats.num_running_compactions);
+        db->GetIntProperty("rocksdb.num-running-flushes", &stats.num_running_flushes);
+        db->GetIntProperty("rocksdb.actual-delayed-write-rate", &stats.delayed_write_rate);
+        db->GetIntProperty("rocksdb.is-write-stopped", &writes_stopped);
+        stats.writes_stopped = (writes_stopped != 0);
+
+        if(options.rate_limiter != nullptr) {
+            stats.io_rate_limit = options.rate_limiter->GetBytesPerSecond();
+            stats.rate_limited_bytes = options.rate_limiter->GetTotalBytesThrough();
+        }
+
+        stats.num_idle_compactions = num_idle_compactions;
+        return stats;
+    }
+
     // Only for internal tests
     rocksdb::DB* _get_db_unsafe() const {
         return db;
@@ -86,6 +86,24 @@ struct StringUtils {
         return escaped.str();
     }
 
+    // percent-encodes everything but the unreserved characters of RFC 3986, for url_decode() to reverse
+    static std::string url_encode(const std::string & text) {
+        static const char* hex_digits = "0123456789ABCDEF";
+        std::string encoded;
+
+        for(const char c: text) {
+            if(isalnum((unsigned char) c) || c == '-' || c == '_' || c == '.' || c == '~') {
+                encoded += c;
+            } else {
+                encoded += '%';
+                encoded += hex_digits[((unsigned char) c) >> 4];
+                encoded += hex_digits[((unsigned char) c) & 15];
+            }
+        }
+
+        return encoded;
+    }
+
     // See: https://stackoverflow.com/a/19751887/131050
     static bool is_float(const std::string &s) {
         std::string::const_iterator it = s.begin();
@@ -134,7 +152,8 @@ struct StringUtils {
         std::transform(str.begin(), str.end(), str.begin(), ::toupper);
     }
 
-    void unicode_normalize(std::string& str) const;
+    // strips ASCII punctuation and lower cases: ICU is needed only when there are non-ASCII characters
+    static void unicode_normalize(std::string& str);
 
     /* https://stackoverflow.com/a/34571089/131050 */
     static std::string base64_encode(const std::string &in) {
@@ -0,0 +1,186 @@
+#include "analyzer.h"
+
+#include <memory>
+#include <unicode/brkiter.h>
+#include "string_utils.h"
+
+// Break iterators are expensive to create, but stateful: each value is split by a clone of this one
+static const icu::BreakIterator* word_break_prototype() {
+    static std::unique_ptr<icu::BreakIterator> prototype([]() {
+        UErrorCode status = U_ZERO_ERROR;
+        icu::BreakIterator* iter = icu::BreakIterator::createWordInstance(icu::Locale::getRoot(), status);
+        if(U_FAILURE(status)) {
+            delete iter;
+            return (icu::BreakIterator*) nullptr;
+        }
+        return iter;
+    }());
+
+    return prototype.get();
+}
+
+analyzer::analyzer(): type(analyzer_t::STANDARD) {
+
+}
+
+analyzer::analyzer(const analyzer_t type, const std::string & separators): type(type) {
+    for(const char c: separators) {
+        if((int)(c) >= 0) {
+            this->separators.set((size_t) c);
+        }
+    }
+}
+
+analyzer analyzer::for_field(const field & a_field) {
+    if(a_field.analyzer.empty()) {
+        return analyzer(a_field.facet ? analyzer_t::VERBATIM : analyzer_t::STANDARD);
+    }
+
+    if(a_field.analyzer == analyzers::VERBATIM) {
+        return analyzer(analyzer_t::VERBATIM);
+    }
+
+    if(a_field.analyzer == analyzers::ASCII) {
+        return analyzer(analyzer_t::ASCII);
+    }
+
+    if(a_field.analyzer == analyzers::WORD_BREAK) {
+        return analyzer(analyzer_t::WORD_BREAK);
+    }
+
+    if(a_field.analyzer == analyzers::SEPARATORS) {
+        return analyzer(analyzer_t::SEPARATORS, a_field.separators);
+    }
+
+    return analyzer(analyzer_t::STANDARD);
+}
+
+analyzer analyzer::for_filter(const field & a_field) {
+    return a_field.analyzer.empty() ? analyzer(analyzer_t::STANDARD) : for_field(a_field);
+}
+
+Option<bool> analyzer::validate(const field & a_field) {
+    if(a_field.infix && (!a_field.is_string() || a_field.facet)) {
+        return Option<bool>(400, "Field `" + a_field.name + "` can't have an infix index: only string fields "
+                                 "that are not facets can.");
+    }
+
+    if(a_field.analyzer.empty() && a_field.separators.empty()) {
+        return Option<bool>(true);
+    }
+
+    if(!a_field.is_string()) {
+        return Option<bool>(400, "Field `" + a_field.name + "` is not a string field, so it can't have an analyzer.");
+    }
+
+    if(a_field.analyzer != analyzers::STANDARD && a_field.analyzer != analyzers::VERBATIM &&
+       a_field.analyzer != analyzers::ASCII && a_field.analyzer != analyzers::WORD_BREAK &&
+       a_field.analyzer != analyzers::SEPARATORS) {
+        return Option<bool>(400, "Field `" + a_field.name + "` has an unknown analyzer `" + a_field.analyzer + "`.");
+    }
+
+    // facet values are counted and filtered on as they are
+    if(a_field.facet && a_field.analyzer != analyzers::VERBATIM) {
+        return Option<bool>(400, "Facet field `" + a_field.name + "` can only have the `verbatim` analyzer.");
+    }
+
+    if(a_field.analyzer == analyzers::WORD_BREAK && word_break_prototype() == nullptr) {
+        return Option<bool>(500, "The word break rules could not be loaded.");
+    }
+
+    if(a_field.analyzer == analyzers::SEPARATORS) {
+        const bool ascii = std::all_of(a_field.separators.begin(), a_field.separators.end(),
+                                       [](char c) { return (int)(c) >= 0; });
+        if(a_field.separators.empty() || !ascii) {
+            return Option<bool>(400, "The `separators` of field `" + a_field.name + "` should be a non-empty "
+                                     "string of ASCII characters.");
+        }
+    } else if(!a_field.separators.empty()) {
+        return Option<bool>(400, "Only the `separators` analyzer of field `" + a_field.name + "` takes separators.");
+    }
+
+    return Option<bool>(true);
+}
+
+analyzer_t analyzer::get_type() const {
+    return type;
+}
+
+void analyzer::split(const std::string & text, std::vector<std::string> & tokens) const {
+    switch(type) {
+        case analyzer_t::VERBATIM:
+            tokens.push_back(text);
+            break;
+        case analyzer_t::WORD_BREAK:
+            split_words(text, tokens);
+            break;
+        case analyzer_t::SEPARATORS:
+            split_separators(text, tokens);
+            break;
+        default:
+            StringUtils::split(text, tokens, " ");
+            break;
+    }
+}
+
+void analyzer::split_words(const std::string & text, std::vector<std::string> & tokens) const {
+    std::unique_ptr<icu::BreakIterator> iter(word_break_prototype()->clone());
+    const icu::UnicodeString u_text = icu::UnicodeString::fromUTF8(text);
+    iter->setText(u_text);
+
+    int32_t start = iter->first();
+    for(int32_t end = iter->next(); end != icu::BreakIterator::DONE; start = end, end = iter->next()) {
+        // spaces and punctuation are segments of their own
+        if(iter->getRuleStatus() == UBRK_WORD_NONE) {
+            continue;
+        }
+
+        std::string token;
+        u_text.tempSubStringBetween(start, end).toUTF8String(token);
+        tokens.push_back(token);
+    }
+}
+
+void analyzer::split_separators(const std::string & text, std::vector<std::string> & tokens) const {
+    size_t token_start = 0;
+
+    for(size_t i = 0; i <= text.size(); i++) {
+        const bool at_separator = (i == text.size()) || text[i] == ' ' ||
+                                  ((int)(text[i]) >= 0 && separators.test((size_t) text[i]));
+        if(!at_separator) {
+            continue;
+        }
+
+        if(i > token_start) {
+            tokens.push_back(text.substr(token_start, i - token_start));
+        }
+
+        token_start = i + 1;
+    }
+}
+
+void analyzer::normalize(std::string & token) const {
+    switch(type) {
+        case analyzer_t::VERBATIM:
+            break;
+        case analyzer_t::ASCII:
+            token.erase(std::remove_if(token.begin(), token.end(), [](char c) {
+                return (int)(c) >= 0 && !std::isalnum(c);
+            }), token.end());
+
+            std::transform(token.begin(), token.end(), token.begin(), [](char c) {
+                return ((int)(c) >= 0) ? (char) ::tolower(c) : c;
+            });
+            break;
+        default:
+            StringUtils::unicode_normalize(token);
+            break;
+    }
+}
+
+void analyzer::analyze(const std::string & text, std::vector<std::string> & tokens) const {
+    split(text, tokens);
+    for(std::string & token: tokens) {
+        normalize(token);
+    }
+}
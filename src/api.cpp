@@ -6,6 +6,10 @@
 #include "string_utils.h"
 #include "collection.h"
 #include "collection_manager.h"
+#include "coordinator.h"
+#include "query_log.h"
+#include "search_scheduler.h"
+#include "index_memory.h"
 #include "logger.h"
 
 nlohmann::json collection_summary_json(Collection *collection) {
@@ -22,11 +26,42 @@ nlohmann::json collection_summary_json(Collection *collection) {
         field_json[fields::name] = coll_field.name;
         field_json[fields::type] = coll_field.type;
         field_json[fields::facet] = coll_field.facet;
+
+        if(!coll_field.analyzer.empty()) {
+            field_json[fields::analyzer] = coll_field.analyzer;
+        }
+
+        if(!coll_field.separators.empty()) {
+            field_json[fields::separators] = coll_field.separators;
+        }
+
+        if(coll_field.infix) {
+            field_json[fields::infix] = true;
+        }
+
+        if(!coll_field.index) {
+            field_json[fields::index] = false;
+        }
+
         fields_arr.push_back(field_json);
     }
 
     json_response["fields"] = fields_arr;
     json_response["default_sorting_field"] = collection->get_default_sorting_field();
+    json_response["pinned_filters"] = collection->get_pinned_filters();
+
+    const std::vector<field> & backfill_fields = collection->get_backfill_fields();
+    if(!backfill_fields.empty()) {
+        nlohmann::json backfill_json;
+        backfill_json["fields"] = nlohmann::json::array();
+        for(const field & backfill_field: backfill_fields) {
+            backfill_json["fields"].push_back(backfill_field.name);
+        }
+
+        backfill_json["num_documents"] = collection->get_num_backfilled();
+        json_response["backfill"] = backfill_json;
+    }
+
     return json_response;
 }
 
@@ -34,7 +69,9 @@ bool handle_authentication(const route_path & rpath, const std::string & auth_ke
     CollectionManager & collectionManager = CollectionManager::get_instance();
 
     return collectionManager.auth_key_matches(auth_key) ||
-           (rpath.handler == get_search && collectionManager.search_only_auth_key_matches(auth_key));
+           ((rpath.handler == get_search || rpath.handler == schedule_search ||
+             rpath.handler == coordinator_get_search) &&
+            collectionManager.search_only_auth_key_matches(auth_key));
 }
 
 void get_collections(http_req & req, http_res & res) {
@@ -50,6 +87,85 @@ void get_collections(http_req & req, http_res & res) {
     res.send_200(json_response.dump());
 }
 
+Option<bool> parse_fields(nlohmann::json & fields_json, std::vector<field> & fields) {
+    for(nlohmann::json & field_json: fields_json) {
+        if(!field_json.is_object() ||
+            field_json.count(fields::name) == 0 || field_json.count(fields::type) == 0 ||
+            !field_json.at(fields::name).is_string() || !field_json.at(fields::type).is_string()) {
+
+            return Option<bool>(400, "Wrong format for `fields`. It should be an array of objects containing "
+                                     "`name`, `type` and optionally, `facet` properties.");
+        }
+
+        if(field_json.count("facet") != 0 && !field_json.at(fields::facet).is_boolean()) {
+            return Option<bool>(400, std::string("The `facet` property of the field `") +
+                                     field_json.at(fields::name).get<std::string>() + "` should be a boolean.");
+        }
+
+        if(field_json.count("facet") == 0) {
+            field_json["facet"] = false;
+        }
+
+        for(const std::string & property: {fields::infix, fields::index}) {
+            if(field_json.count(property) != 0 && !field_json.at(property).is_boolean()) {
+                return Option<bool>(400, "The `" + property + "` property of the field `" +
+                                         field_json.at(fields::name).get<std::string>() + "` should be a boolean.");
+            }
+        }
+
+        for(const std::string & property: {fields::analyzer, fields::separators}) {
+            if(field_json.count(property) != 0 && !field_json.at(property).is_string()) {
+                return Option<bool>(400, "The `" + property + "` property of the field `" +
+                                         field_json.at(fields::name).get<std::string>() + "` should be a string.");
+            }
+        }
+
+        fields.push_back(
+            field(field_json["name"], field_json["type"], field_json["facet"])
+        );
+
+        fields.back().analyzer = field_json.value(fields::analyzer, "");
+        fields.back().separators = field_json.value(fields::separators, "");
+        fields.back().infix = field_json.value(fields::infix, false);
+        fields.back().index = field_json.value(fields::index, true);
+    }
+
+    return Option<bool>(true);
+}
+
+// writes that were turned away because of the memory that the indices take, since the server started
+static size_t num_throttled_writes = 0;
+static size_t num_rejected_writes = 0;
+
+// above the soft limit, the share of writes that is turned away grows with the memory, up to all of them at the
+// hard limit: each write adds the share to the debt, and the write that brings it to 1 is turned away
+static float throttle_debt = 0;
+
+static Option<bool> admit_write() {
+    const memory_pressure pressure = index_memory::get_pressure();
+
+    if(pressure == MEMORY_PRESSURE_HARD) {
+        num_rejected_writes++;
+        return Option<bool>(503, "The indices are above their hard memory limit: writes are rejected until memory "
+                                 "is freed.");
+    }
+
+    if(pressure == MEMORY_PRESSURE_NONE) {
+        throttle_debt = 0;
+        return Option<bool>(true);
+    }
+
+    throttle_debt += index_memory::get_soft_pressure();
+    if(throttle_debt >= 1) {
+        throttle_debt -= 1;
+        num_throttled_writes++;
+        return Option<bool>(429, "The indices are above their soft memory limit: writes are throttled. "
+                                 "Please retry later.");
+    }
+
+    return Option<bool>(true);
+}
+
 void post_create_collection(http_req & req, http_res & res) {
     nlohmann::json req_json;
 
@@ -96,32 +212,30 @@ void post_create_collection(http_req & req, http_res & res) {
                             "[{\"name\": \"<field_name>\", \"type\": \"<field_type>\"}]");
     }
 
-    for(nlohmann::json & field_json: req_json["fields"]) {
-        if(!field_json.is_object() ||
-            field_json.count(fields::name) == 0 || field_json.count(fields::type) == 0 ||
-            !field_json.at(fields::name).is_string() || !field_json.at(fields::type).is_string()) {
+    Option<bool> fields_op = parse_fields(req_json["fields"], fields);
+    if(!fields_op.ok()) {
+        return res.send_400(fields_op.error());
+    }
 
-            return res.send_400("Wrong format for `fields`. It should be an array of objects containing "
-                                "`name`, `type` and optionally, `facet` properties.");
-        }
+    const char* PINNED_FILTERS = "pinned_filters";
+    std::vector<std::string> pinned_filters;
 
-        if(field_json.count("facet") != 0 && !field_json.at(fields::facet).is_boolean()) {
-            return res.send_400(std::string("The `facet` property of the field `") +
-                                field_json.at(fields::name).get<std::string>() + "` should be a boolean.");
+    if(req_json.count(PINNED_FILTERS) != 0) {
+        if(!req_json[PINNED_FILTERS].is_array()) {
+            return res.send_400(std::string("`") + PINNED_FILTERS + "` should be an array of filter queries.");
         }
 
-        if(field_json.count("facet") == 0) {
-            field_json["facet"] = false;
+        for(const nlohmann::json & pinned_filter: req_json[PINNED_FILTERS]) {
+            if(!pinned_filter.is_string()) {
+                return res.send_400(std::string("`") + PINNED_FILTERS + "` should be an array of filter queries.");
+            }
+            pinned_filters.push_back(pinned_filter.get<std::string>());
         }
-
-        fields.push_back(
-            field(field_json["name"], field_json["type"], field_json["facet"])
-        );
     }
 
     const std::string & default_sorting_field = req_json[DEFAULT_SORTING_FIELD].get<std::string>();
     const Option<Collection*> & collection_op =
-            collectionManager.create_collection(req_json["name"], fields, default_sorting_field);
+            collectionManager.create_collection(req_json["name"], fields, default_sorting_field, pinned_filters);
 
     if(collection_op.ok()) {
         nlohmann::json json_response = collection_summary_json(collection_op.get());
@@ -150,14 +264,99 @@ void del_drop_collection(http_req & req, http_res & res) {
     res.send_200(collection_json.dump());
 }
 
+void put_alter_collection(http_req & req, http_res & res) {
+    nlohmann::json req_json;
+
+    try {
+        req_json = nlohmann::json::parse(req.body);
+    } catch(const std::exception& e) {
+        LOG(ERR) << "JSON error: " << e.what();
+        return res.send_400("Bad JSON.");
+    }
+
+    CollectionManager & collectionManager = CollectionManager::get_instance();
+    Collection* collection = collectionManager.get_collection(req.params["collection"]);
+
+    if(!collection) {
+        return res.send_404();
+    }
+
+    const char* ADD_FIELDS = "add_fields";
+    const char* DROP_FIELDS = "drop_fields";
+
+    std::vector<field> add_fields;
+    std::vector<std::string> drop_fields;
+
+    if(req_json.count(ADD_FIELDS) != 0) {
+        if(!req_json[ADD_FIELDS].is_array()) {
+            return res.send_400(std::string("`") + ADD_FIELDS + "` should be an array of fields.");
+        }
+
+        Option<bool> fields_op = parse_fields(req_json[ADD_FIELDS], add_fields);
+        if(!fields_op.ok()) {
+            return res.send_400(fields_op.error());
+        }
+    }
+
+    if(req_json.count(DROP_FIELDS) != 0) {
+        if(!req_json[DROP_FIELDS].is_array()) {
+            return res.send_400(std::string("`") + DROP_FIELDS + "` should be an array of field names.");
+        }
+
+        for(const nlohmann::json & field_name: req_json[DROP_FIELDS]) {
+            if(!field_name.is_string()) {
+                return res.send_400(std::string("`") + DROP_FIELDS + "` should be an array of field names.");
+            }
+            drop_fields.push_back(field_name.get<std::string>());
+        }
+    }
+
+    // dropping fields only frees memory
+    if(!add_fields.empty()) {
+        Option<bool> admit_op = admit_write();
+        if(!admit_op.ok()) {
+            return res.send(admit_op.code(), admit_op.error());
+        }
+    }
+
+    Option<bool> alter_op = collectionManager.alter_collection(req.params["collection"], add_fields, drop_fields);
+
+    if(!alter_op.ok()) {
+        return res.send(alter_op.code(), alter_op.error());
+    }
+
+    // added fields show up in the summary's `backfill` until they are searchable
+    nlohmann::json json_response = collection_summary_json(collection);
+    res.send_200(json_response.dump());
+}
+
 void get_debug(http_req & req, http_res & res) {
     nlohmann::json result;
     result["version"] = TYPESENSE_VERSION;
     res.send_200(result.dump());
 }
 
+static void split_facet_by(const std::string & facet_by, std::vector<std::string> & facet_fields) {
+    // the ranges of a numeric facet are comma separated as well: `price(0:10,10:100),brand`
+    std::vector<std::string> facet_by_parts;
+    StringUtils::split(facet_by, facet_by_parts, ",");
+
+    bool within_ranges = false;
+    for(const std::string & facet_by_part: facet_by_parts) {
+        if(within_ranges) {
+            facet_fields.back() += "," + facet_by_part;
+        } else {
+            facet_fields.push_back(facet_by_part);
+        }
+
+        within_ranges = (facet_fields.back().find('(') != std::string::npos &&
+                         facet_fields.back().find(')') == std::string::npos);
+    }
+}
+
 void get_search(http_req & req, http_res & res) {
     auto begin = std::chrono::high_resolution_clock::now();
+    const uint64_t cpu_begin_us = SearchScheduler::thread_cpu_time_us();
 
     const char *NUM_TYPOS = "num_typos";
     const char *PREFIX = "prefix";
@@ -170,6 +369,13 @@ void get_search(http_req & req, http_res & res) {
     const char *PAGE = "page";
     const char *CALLBACK = "callback";
     const char *RANK_TOKENS_BY = "rank_tokens_by";
+    const char *EXPLAIN_PLAN = "explain_plan";
+    const char *FACET_SAMPLE_PERCENT = "facet_sample_percent";
+    const char *FACET_SAMPLE_THRESHOLD = "facet_sample_threshold";
+    const char *FACET_QUERY = "facet_query";
+    const char *INFIX = "infix";
+    const char *MERGEABLE = "mergeable";
+    const char *INCLUDE_UNINDEXED = "include_unindexed";
 
     if(req.params.count(NUM_TYPOS) == 0) {
         req.params[NUM_TYPOS] = "2";
@@ -207,13 +413,29 @@ void get_search(http_req & req, http_res & res) {
         return res.send_400("Parameter `" + std::string(PAGE) + "` must be an unsigned integer.");
     }
 
+    if(req.params.count(FACET_SAMPLE_PERCENT) == 0) {
+        req.params[FACET_SAMPLE_PERCENT] = "100";
+    }
+
+    if(req.params.count(FACET_SAMPLE_THRESHOLD) == 0) {
+        req.params[FACET_SAMPLE_THRESHOLD] = "0";
+    }
+
+    if(!StringUtils::is_uint64_t(req.params[FACET_SAMPLE_PERCENT])) {
+        return res.send_400("Parameter `" + std::string(FACET_SAMPLE_PERCENT) + "` must be an unsigned integer.");
+    }
+
+    if(!StringUtils::is_uint64_t(req.params[FACET_SAMPLE_THRESHOLD])) {
+        return res.send_400("Parameter `" + std::string(FACET_SAMPLE_THRESHOLD) + "` must be an unsigned integer.");
+    }
+
     std::string filter_str = req.params.count(FILTER) != 0 ? req.params[FILTER] : "";
 
     std::vector<std::string> search_fields;
     StringUtils::split(req.params[QUERY_BY], search_fields, ",");
 
     std::vector<std::string> facet_fields;
-    StringUtils::split(req.params[FACET_BY], facet_fields, ",");
+    split_facet_by(req.params[FACET_BY], facet_fields);
 
     std::vector<sort_by> sort_fields;
     if(req.params.count(SORT_BY) != 0) {
@@ -245,6 +467,16 @@ void get_search(http_req & req, http_res & res) {
     }
 
     bool prefix = (req.params[PREFIX] == "true");
+    bool explain_plan = (req.params.count(EXPLAIN_PLAN) != 0 && req.params[EXPLAIN_PLAN] == "true");
+
+    // only query fields with an infix index are matched within their tokens
+    bool infix = (req.params.count(INFIX) != 0 && req.params[INFIX] == "true");
+
+    // asked by a coordinator, which merges the results of several nodes
+    bool mergeable = (req.params.count(MERGEABLE) != 0 && req.params[MERGEABLE] == "true");
+
+    // the values of unindexed fields are stored apart, and are only read for hits that are going to be shown
+    bool include_unindexed = (req.params.count(INCLUDE_UNINDEXED) == 0 || req.params[INCLUDE_UNINDEXED] == "true");
 
     if(req.params.count(RANK_TOKENS_BY) == 0) {
         req.params[RANK_TOKENS_BY] = "DEFAULT_SORTING_FIELD";
@@ -253,14 +485,46 @@ void get_search(http_req & req, http_res & res) {
     StringUtils::toupper(req.params[RANK_TOKENS_BY]);
     token_ordering token_order = (req.params[RANK_TOKENS_BY] == "DEFAULT_SORTING_FIELD") ? MAX_SCORE : FREQUENCY;
 
-    Option<nlohmann::json> result_op = collection->search(req.params[QUERY], search_fields, filter_str, facet_fields,
-                                               sort_fields, std::stoi(req.params[NUM_TYPOS]),
+    // services that call search at high rates can ask for a binary response, which skips JSON altogether: results
+    // that are merged by a coordinator or wrapped in a JSONP callback remain JSON
+    bool binary = (req.accept.find(search_results::BINARY_CONTENT_TYPE) != std::string::npos &&
+                   !mergeable && req.params.count(CALLBACK) == 0);
+
+    Option<search_results> results_op = collection->run_search(req.params[QUERY], search_fields, filter_str,
+                                               facet_fields, sort_fields, std::stoi(req.params[NUM_TYPOS]),
                                                std::stoi(req.params[PER_PAGE]), std::stoi(req.params[PAGE]),
-                                               token_order, prefix);
+                                               token_order, prefix, explain_plan,
+                                               std::stoi(req.params[FACET_SAMPLE_PERCENT]),
+                                               std::stoi(req.params[FACET_SAMPLE_THRESHOLD]),
+                                               req.params.count(FACET_QUERY) != 0 ? req.params[FACET_QUERY] : "",
+                                               infix, include_unindexed);
 
     uint64_t timeMillis = std::chrono::duration_cast<std::chrono::milliseconds>(
                                std::chrono::high_resolution_clock::now() - begin).count();
 
+    // accounted to the collection up to the encoding of the response
+    tenant_usage usage;
+    usage.num_searches = 1;
+    usage.cpu_time_us = SearchScheduler::thread_cpu_time_us() - cpu_begin_us;
+
+    if(results_op.ok()) {
+        usage.cpu_time_us += results_op.get().cpu_time_us;
+        usage.num_scored_docs = results_op.get().num_scored_docs;
+        usage.num_bytes_read = results_op.get().num_bytes_read;
+
+        // a sample of the searches is replayed on startup, to warm up the caches
+        QueryLog::get_instance().record(req.params);
+    }
+
+    SearchScheduler::get_instance().record_usage(req.params["collection"], usage);
+
+    if(results_op.ok() && binary) {
+        res.content_type_header = search_results::BINARY_CONTENT_TYPE;
+        return res.send_200(results_op.get().to_binary(timeMillis, std::stoi(req.params[PAGE])));
+    }
+
+    Option<nlohmann::json> result_op = results_op.ok() ? results_op.get().to_json(mergeable) :
+                                       Option<nlohmann::json>(results_op.code(), results_op.error());
 
     if(!result_op.ok()) {
         const std::string & json_res_body = (req.params.count(CALLBACK) == 0) ? result_op.error() :
@@ -268,17 +532,17 @@ void get_search(http_req & req, http_res & res) {
         return res.send(result_op.code(), json_res_body);
     }
 
-    nlohmann::json result = result_op.get();
+    nlohmann::json result = std::move(result_op).get();
     result["search_time_ms"] = timeMillis;
     result["page"] = std::stoi(req.params[PAGE]);
-    const std::string & results_json_str = result.dump();
+    std::string results_json_str = result.dump();
 
     //struct rusage r_usage;
     //getrusage(RUSAGE_SELF,&r_usage);
     //LOG(INFO) << "Memory usage: " << r_usage.ru_maxrss;
 
     if(req.params.count(CALLBACK) == 0) {
-        res.send_200(results_json_str);
+        res.send_200(std::move(results_json_str));
     } else {
         res.send_200(req.params[CALLBACK] + "(" + results_json_str + ");");
     }
@@ -286,6 +550,71 @@ void get_search(http_req & req, http_res & res) {
     //LOG(INFO) << "Time taken: " << timeMillis << "ms";
 }
 
+void schedule_search(http_req & req, http_res & res) {
+    if(CollectionManager::get_instance().get_collection(req.params["collection"]) == nullptr) {
+        res.send_404();
+        return res.server->send_response(&req, &res);
+    }
+
+    SearchScheduler & scheduler = SearchScheduler::get_instance();
+    Option<bool> admit_op = scheduler.admit(req.params["collection"], SearchScheduler::clock_us());
+
+    if(!admit_op.ok()) {
+        res.send(admit_op.code(), admit_op.error());
+        return res.server->send_response(&req, &res);
+    }
+
+    // the searches that are waiting when the message arrives are run in the scheduler's order, one per message
+    scheduler.enqueue(req.params["collection"], new request_response{&req, &res});
+    res.server->send_message(RUN_SEARCH_MSG, nullptr);
+}
+
+void on_run_search(void *data) {
+    SearchScheduler & scheduler = SearchScheduler::get_instance();
+    std::string collection_name;
+    void* queued_req_res;
+
+    if(!scheduler.next(collection_name, queued_req_res)) {
+        return ;
+    }
+
+    request_response* req_res = static_cast<request_response*>(queued_req_res);
+    get_search(*req_res->req, *req_res->response);
+    scheduler.complete(collection_name);
+
+    req_res->response->server->send_response(req_res->req, req_res->response);
+    delete req_res;
+}
+
+void get_metrics_json(http_req & req, http_res & res) {
+    nlohmann::json result;
+    result["collections"] = SearchScheduler::get_instance().get_metrics();
+
+    const memory_pressure pressure = index_memory::get_pressure();
+    nlohmann::json & memory = result["index_memory"];
+    const index_memory_stats stats = index_memory::get_stats();
+    memory["allocated_bytes"] = stats.allocated_bytes;
+    memory["resident_bytes"] = stats.resident_bytes;
+    memory["soft_limit_bytes"] = index_memory::get_soft_limit();
+    memory["hard_limit_bytes"] = index_memory::get_hard_limit();
+    memory["pressure"] = (pressure == MEMORY_PRESSURE_HARD) ? "hard" : (pressure == MEMORY_PRESSURE_SOFT) ? "soft" :
+                         "none";
+    memory["throttled_writes"] = num_throttled_writes;
+    memory["rejected_writes"] = num_rejected_writes;
+
+    const store_io_stats io_stats = CollectionManager::get_instance().get_store()->get_io_stats();
+    nlohmann::json & store = result["store"];
+    store["pending_compaction_bytes"] = io_stats.pending_compaction_bytes;
+    store["running_compactions"] = io_stats.num_running_compactions;
+    store["running_flushes"] = io_stats.num_running_flushes;
+    store["delayed_write_rate"] = io_stats.delayed_write_rate;
+    store["writes_stopped"] = io_stats.writes_stopped;
+    store["io_rate_limit"] = io_stats.io_rate_limit;
+    store["rate_limited_bytes"] = io_stats.rate_limited_bytes;
+    store["idle_compactions"] = io_stats.num_idle_compactions;
+    res.send_200(result.dump());
+}
+
 void get_collection_summary(http_req & req, http_res & res) {
     CollectionManager & collectionManager = CollectionManager::get_instance();
     Collection* collection = collectionManager.get_collection(req.params["collection"]);
@@ -354,6 +683,11 @@ void post_add_document(http_req & req, http_res & res) {
         return res.send_404();
     }
 
+    Option<bool> admit_op = admit_write();
+    if(!admit_op.ok()) {
+        return res.send(admit_op.code(), admit_op.error());
+    }
+
     Option<nlohmann::json> inserted_doc_op = collection->add(req.body);
 
     if(!inserted_doc_op.ok()) {
@@ -363,6 +697,49 @@ void post_add_document(http_req & req, http_res & res) {
     }
 }
 
+void post_import_documents(http_req & req, http_res & res) {
+    import_state* state = static_cast<import_state*>(req.batch_state);
+    if(state == nullptr) {
+        state = new import_state();
+        req.batch_state = state;
+    }
+
+    // admitted for each batch, since a large import can push the memory past a limit
+    Collection* collection = CollectionManager::get_instance().get_collection(req.params["collection"]);
+    Option<bool> admit_op = (collection == nullptr) ? Option<bool>(404, "Not Found") : admit_write();
+
+    if(admit_op.ok()) {
+        collection->import_documents(req.body, !req.body_pending, *state);
+        if(req.body_pending) {
+            return ;
+        }
+    }
+
+    // an import that is cut short still tells how far it got, so that it can be resumed after the lines it read
+    nlohmann::json response;
+    if(admit_op.ok()) {
+        response["success"] = (state->num_failed == 0);
+    } else {
+        response["message"] = admit_op.error();
+        req.body_pending = false;
+    }
+
+    response["num_lines"] = state->num_lines;
+    response["num_imported"] = state->num_imported;
+    response["num_failed"] = state->num_failed;
+    response["errors"] = nlohmann::json::array();
+
+    for(const auto & line_error: state->errors) {
+        response["errors"].push_back({{"line", line_error.first}, {"error", line_error.second}});
+    }
+
+    res.status_code = admit_op.ok() ? 200 : admit_op.code();
+    res.body = response.dump();
+
+    delete state;
+    req.batch_state = nullptr;
+}
+
 void get_fetch_document(http_req & req, http_res & res) {
     std::string doc_id = req.params["id"];
 
@@ -401,8 +778,7 @@ void del_remove_document(http_req & req, http_res & res) {
     if(!deleted_id_op.ok()) {
         res.send(deleted_id_op.code(), deleted_id_op.error());
     } else {
-        nlohmann::json doc = doc_option.get();
-        res.send_200(doc.dump());
+        res.send_200(doc_option.get().dump());
     }
 }
 
@@ -448,4 +824,290 @@ void on_send_response(void *data) {
     request_response* req_res = static_cast<request_response*>(data);
     req_res->response->server->send_response(req_res->req, req_res->response);
     delete req_res;
-}
\ No newline at end of file
+}
+
+void on_spill_postings(void *data) {
+    uint64_t* cold_after_ms = static_cast<uint64_t*>(data);
+    const size_t num_bytes = CollectionManager::get_instance().spill_cold_postings(*cold_after_ms);
+    delete cold_after_ms;
+
+    if(num_bytes != 0) {
+        LOG(INFO) << "Moved " << num_bytes << " bytes of cold posting lists to the disk.";
+    }
+}
+// Coordinator end-points: collections are partitioned across the nodes given to the coordinator
+
+static void send_node_response(http_res & res, const node_response & response) {
+    if(response.status_code == 0) {
+        return res.send(503, "A node of the partitioned collection could not be reached.");
+    }
+
+    res.status_code = (uint32_t) response.status_code;
+    res.body = response.body;
+}
+
+static const node_response* first_failure(const std::vector<node_response> & responses) {
+    for(const node_response & response: responses) {
+        if(response.status_code < 200 || response.status_code >= 300) {
+            return &response;
+        }
+    }
+
+    return nullptr;
+}
+
+// the first response that is not a success, or else the response of the first node
+static void send_broadcast_response(http_res & res, const std::vector<node_response> & responses) {
+    const node_response* failure = first_failure(responses);
+    send_node_response(res, failure != nullptr ? *failure : responses[0]);
+}
+
+static std::string collection_path(http_req & req) {
+    return "/collections/" + StringUtils::url_encode(req.params["collection"]);
+}
+
+static std::string document_path(http_req & req) {
+    return collection_path(req) + "/documents/" + StringUtils::url_encode(req.params["id"]);
+}
+
+// the collection summaries of the first node, with the documents of all the nodes: always as an array
+static Option<nlohmann::json> merge_collection_summaries(const std::vector<node_response> & responses) {
+    std::vector<nlohmann::json> node_summaries;
+
+    for(const node_response & response: responses) {
+        try {
+            nlohmann::json summaries = nlohmann::json::parse(response.body);
+            node_summaries.push_back(summaries.is_array() ? summaries : nlohmann::json::array({summaries}));
+        } catch(...) {
+            return Option<nlohmann::json>(500, "Could not parse the response of a node.");
+        }
+    }
+
+    std::map<std::string, size_t> num_documents;
+    for(const nlohmann::json & summaries: node_summaries) {
+        for(const nlohmann::json & summary: summaries) {
+            num_documents[summary["name"].get<std::string>()] += summary["num_documents"].get<size_t>();
+        }
+    }
+
+    for(nlohmann::json & summary: node_summaries[0]) {
+        summary["num_documents"] = num_documents[summary["name"].get<std::string>()];
+    }
+
+    return Option<nlohmann::json>(node_summaries[0]);
+}
+
+// Waiting on the nodes would hold up the event loop, so requests are forwarded from a thread of their own, and
+// the event loop is only asked to send the response
+static void forward_async(http_req & req, http_res & res, void (*forward)(http_req & req, http_res & res)) {
+    std::thread forward_thread([&req, &res, forward]() {
+        forward(req, res);
+        res.server->send_message(SEND_RESPONSE_MSG, new request_response{&req, &res});
+    });
+
+    forward_thread.detach();
+}
+
+static void forward_get_collections(http_req & req, http_res & res) {
+    std::vector<node_response> responses = Coordinator::get_instance().broadcast("GET", "/collections");
+    const node_response* failure = first_failure(responses);
+    if(failure != nullptr) {
+        return send_node_response(res, *failure);
+    }
+
+    Option<nlohmann::json> summaries_op = merge_collection_summaries(responses);
+    if(!summaries_op.ok()) {
+        return res.send(summaries_op.code(), summaries_op.error());
+    }
+
+    res.send_200(summaries_op.get().dump());
+}
+
+static void forward_get_collection_summary(http_req & req, http_res & res) {
+    std::vector<node_response> responses = Coordinator::get_instance().broadcast("GET", collection_path(req));
+    const node_response* failure = first_failure(responses);
+    if(failure != nullptr) {
+        return send_node_response(res, *failure);
+    }
+
+    Option<nlohmann::json> summaries_op = merge_collection_summaries(responses);
+    if(!summaries_op.ok()) {
+        return res.send(summaries_op.code(), summaries_op.error());
+    }
+
+    res.send_200(summaries_op.get()[0].dump());
+}
+
+static void forward_post_create_collection(http_req & req, http_res & res) {
+    send_broadcast_response(res, Coordinator::get_instance().broadcast("POST", "/collections", req.body));
+}
+
+static void forward_del_drop_collection(http_req & req, http_res & res) {
+    send_broadcast_response(res, Coordinator::get_instance().broadcast("DELETE", collection_path(req)));
+}
+
+static void forward_put_alter_collection(http_req & req, http_res & res) {
+    send_broadcast_response(res, Coordinator::get_instance().broadcast("PUT", collection_path(req), req.body));
+}
+
+static void forward_post_add_document(http_req & req, http_res & res) {
+    nlohmann::json document;
+
+    try {
+        document = nlohmann::json::parse(req.body);
+    } catch(...) {
+        return res.send_400("Bad JSON.");
+    }
+
+    // the id decides the node that the document is stored on, so it can't be left to the node to assign
+    if(!document.is_object() || document.count("id") == 0 || !document["id"].is_string()) {
+        return res.send_400("A document of a partitioned collection must have a string `id`.");
+    }
+
+    Coordinator & coordinator = Coordinator::get_instance();
+    const size_t owner = coordinator.get_owner(document["id"].get<std::string>());
+    send_node_response(res, coordinator.send(owner, "POST", collection_path(req) + "/documents", req.body));
+}
+
+static void forward_get_fetch_document(http_req & req, http_res & res) {
+    Coordinator & coordinator = Coordinator::get_instance();
+    send_node_response(res, coordinator.send(coordinator.get_owner(req.params["id"]), "GET", document_path(req)));
+}
+
+static void forward_del_remove_document(http_req & req, http_res & res) {
+    Coordinator & coordinator = Coordinator::get_instance();
+    send_node_response(res, coordinator.send(coordinator.get_owner(req.params["id"]), "DELETE",
+                                             document_path(req)));
+}
+
+static void forward_get_search(http_req & req, http_res & res) {
+    auto begin = std::chrono::high_resolution_clock::now();
+
+    const char *PER_PAGE = "per_page";
+    const char *PAGE = "page";
+    const char *CALLBACK = "callback";
+    const char *FACET_BY = "facet_by";
+
+    if(req.params.count(PER_PAGE) == 0) {
+        req.params[PER_PAGE] = "10";
+    }
+
+    if(req.params.count(PAGE) == 0) {
+        req.params[PAGE] = "1";
+    }
+
+    if(!StringUtils::is_uint64_t(req.params[PER_PAGE])) {
+        return res.send_400("Parameter `" + std::string(PER_PAGE) + "` must be an unsigned integer.");
+    }
+
+    if(!StringUtils::is_uint64_t(req.params[PAGE])) {
+        return res.send_400("Parameter `" + std::string(PAGE) + "` must be an unsigned integer.");
+    }
+
+    const size_t per_page = std::stoul(req.params[PER_PAGE]);
+    const size_t page = std::stoul(req.params[PAGE]);
+
+    if(page == 0) {
+        return res.send_400("Parameter `" + std::string(PAGE) + "` must be greater than 0.");
+    }
+
+    std::vector<nlohmann::json> node_results;
+
+    // the nodes are searched a second time only when they spread the auto ranges of a facet over different bounds
+    for(size_t round = 0; round < 2; round++) {
+        // any of the nodes could have all the hits of the page, so each is asked for the hits up to the page
+        std::string query = std::string("?") + PAGE + "=1&" + PER_PAGE + "=" + std::to_string(page * per_page) +
+                            "&mergeable=true";
+
+        for(const auto & param: req.params) {
+            if(param.first != "collection" && param.first != PAGE && param.first != PER_PAGE &&
+               param.first != CALLBACK) {
+                query += "&" + StringUtils::url_encode(param.first) + "=" + StringUtils::url_encode(param.second);
+            }
+        }
+
+        std::vector<node_response> responses = Coordinator::get_instance().broadcast(
+                "GET", collection_path(req) + "/documents/search" + query);
+
+        const node_response* failure = first_failure(responses);
+        if(failure != nullptr) {
+            return send_node_response(res, *failure);
+        }
+
+        node_results.clear();
+        for(const node_response & response: responses) {
+            try {
+                node_results.push_back(nlohmann::json::parse(response.body));
+            } catch(...) {
+                return res.send(500, "Could not parse the response of a node.");
+            }
+        }
+
+        std::vector<std::string> facet_fields;
+        if(req.params.count(FACET_BY) != 0) {
+            split_facet_by(req.params[FACET_BY], facet_fields);
+        }
+
+        if(!Coordinator::resolve_auto_facet_ranges(node_results, facet_fields)) {
+            break;
+        }
+
+        std::string facet_by;
+        for(const std::string & facet_field: facet_fields) {
+            facet_by += (facet_by.empty() ? "" : ",") + facet_field;
+        }
+
+        req.params[FACET_BY] = facet_by;
+    }
+
+    nlohmann::json result = Coordinator::merge_search_results(node_results, per_page, page);
+
+    uint64_t timeMillis = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - begin).count();
+
+    result["search_time_ms"] = timeMillis;
+    result["page"] = page;
+    std::string results_json_str = result.dump();
+
+    if(req.params.count(CALLBACK) == 0) {
+        res.send_200(std::move(results_json_str));
+    } else {
+        res.send_200(req.params[CALLBACK] + "(" + results_json_str + ");");
+    }
+}
+
+void coordinator_get_collections(http_req & req, http_res & res) {
+    forward_async(req, res, forward_get_collections);
+}
+
+void coordinator_get_collection_summary(http_req & req, http_res & res) {
+    forward_async(req, res, forward_get_collection_summary);
+}
+
+void coordinator_post_create_collection(http_req & req, http_res & res) {
+    forward_async(req, res, forward_post_create_collection);
+}
+
+void coordinator_del_drop_collection(http_req & req, http_res & res) {
+    forward_async(req, res, forward_del_drop_collection);
+}
+
+void coordinator_put_alter_collection(http_req & req, http_res & res) {
+    forward_async(req, res, forward_put_alter_collection);
+}
+
+void coordinator_post_add_document(http_req & req, http_res & res) {
+    forward_async(req, res, forward_post_add_document);
+}
+
+void coordinator_get_fetch_document(http_req & req, http_res & res) {
+    forward_async(req, res, forward_get_fetch_document);
+}
+
+void coordinator_del_remove_document(http_req & req, http_res & res) {
+    forward_async(req, res, forward_del_remove_document);
+}
+
+void coordinator_get_search(http_req & req, http_res & res) {
+    forward_async(req, res, forward_get_search);
+}
@@ -2,7 +2,7 @@
 
 uint32_t* array_base::uncompress() {
     uint32_t *out = new uint32_t[length];
-    for_uncompress(in, out, length);
+    get_codec()->decode(in, length, sorted, out);
     return out;
 }
 
@@ -13,3 +13,88 @@ uint32_t array_base::getSizeInBytes() {
 uint32_t array_base::getLength() {
     return length;
 }
+
+codec_t array_base::getCodec() {
+    return codec;
+}
+
+void array_base::at_range(uint32_t start_index, uint32_t end_index, uint32_t* out) {
+    get_codec()->select_range(in, length, sorted, start_index, end_index, out);
+}
+
+bool array_base::append_value(uint32_t value) {
+    const posting_codec* list_codec = get_codec();
+    uint32_t size_required = list_codec->append_size_required(in, length_bytes, length, min, max, value);
+
+    if(size_required+FOR_ELE_SIZE > size_bytes) {
+        // grow the array first
+        size_t new_size = (size_t) (size_required * FOR_GROWTH_FACTOR);
+        uint8_t *new_location = (uint8_t *) index_memory::realloc(in, size_bytes, new_size);
+        if(new_location == NULL) {
+            abort();
+        }
+        in = new_location;
+        size_bytes = (uint32_t) new_size;
+    }
+
+    uint32_t new_length_bytes = list_codec->append(in, length_bytes, length, sorted, max, value);
+    if(new_length_bytes == 0) return false;
+
+    length_bytes = new_length_bytes;
+    length++;
+
+    if(value < min) min = value;
+    if(value > max) max = value;
+
+    if(length >= CODEC_REVIEW_MIN_LENGTH && (length & (length - 1)) == 0) {
+        // the list has doubled in length: its length and density might now suit another codec
+        uint32_t *values = uncompress();
+        if(posting_codec::choose(values, length, sorted) != codec) {
+            encode(values, length);
+        }
+        delete[] values;
+    }
+
+    return true;
+}
+
+void array_base::encode(const uint32_t *values, const uint32_t values_length) {
+    codec = posting_codec::choose(values, values_length, sorted);
+    const posting_codec* list_codec = get_codec();
+
+    uint32_t encoded_size = list_codec->encoded_size(values, values_length, sorted);
+    uint32_t size_required = (uint32_t) ((encoded_size + METADATA_OVERHEAD + FOR_ELE_SIZE) * FOR_GROWTH_FACTOR);
+    uint8_t *out = (uint8_t *) index_memory::alloc(size_required);
+    uint32_t actual_size = list_codec->encode(values, values_length, sorted, out);
+
+    index_memory::free(in, size_bytes);
+    in = out;
+    length = values_length;
+    size_bytes = size_required;
+    length_bytes = actual_size;
+}
+
+void array_base::serialize(std::string & out) const {
+    const uint32_t header[4] = {length, length_bytes, min, max};
+    out.append((const char*) header, sizeof(header));
+    out.push_back((char) codec);
+    out.append((const char*) in, length_bytes);
+}
+
+size_t array_base::deserialize(const char* data) {
+    uint32_t header[4];
+    memcpy(header, data, sizeof(header));
+    length = header[0];
+    length_bytes = header[1];
+    min = header[2];
+    max = header[3];
+    codec = (codec_t) data[sizeof(header)];
+
+    // with the same slack that encode() leaves for appends
+    index_memory::free(in, size_bytes);
+    size_bytes = (uint32_t) ((length_bytes + METADATA_OVERHEAD + FOR_ELE_SIZE) * FOR_GROWTH_FACTOR);
+    in = (uint8_t *) index_memory::zalloc(size_bytes);
+    memcpy(in, data + sizeof(header) + 1, length_bytes);
+
+    return sizeof(header) + 1 + length_bytes;
+}
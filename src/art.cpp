@@ -13,6 +13,7 @@
 #include <queue>
 #include <stdint.h>
 #include "art.h"
+#include "index_memory.h"
 #include "logger.h"
 
 /**
@@ -40,7 +41,7 @@ void art_int_fuzzy_recurse(art_node *n, int depth, const unsigned char* int_str,
                            NUM_COMPARATOR comparator, std::vector<const art_leaf *> &results);
 
 bool compare_art_leaf_frequency(const art_leaf *a, const art_leaf *b) {
-    return a->values->ids.getLength() > b->values->ids.getLength();
+    return art_leaf_length(a) > art_leaf_length(b);
 }
 
 bool compare_art_leaf_score(const art_leaf *a, const art_leaf *b) {
@@ -52,14 +53,14 @@ bool compare_art_node_frequency(const art_node *a, const art_node *b) {
 
     if(IS_LEAF(a)) {
         art_leaf* al = (art_leaf *) LEAF_RAW(a);
-        a_value = al->values->ids.getLength();
+        a_value = art_leaf_length(al);
     } else {
         a_value = a->max_token_count;
     }
 
     if(IS_LEAF(b)) {
         art_leaf* bl = (art_leaf *) LEAF_RAW(b);
-        b_value = bl->values->ids.getLength();
+        b_value = art_leaf_length(bl);
     } else {
         b_value = b->max_token_count;
     }
@@ -99,30 +100,38 @@ bool compare_art_node_score_pq(const art_node* a, const art_node* b) {
  * Allocates a node of the given type,
  * initializes to zero and sets the type.
  */
-static art_node* alloc_node(uint8_t type) {
-    art_node* n;
+static size_t node_size(uint8_t type) {
     switch (type) {
         case NODE4:
-            n = (art_node *) calloc(1, sizeof(art_node4));
-            break;
+            return sizeof(art_node4);
         case NODE16:
-            n = (art_node *) calloc(1, sizeof(art_node16));
-            break;
+            return sizeof(art_node16);
         case NODE48:
-            n = (art_node *) calloc(1, sizeof(art_node48));
-            break;
+            return sizeof(art_node48);
         case NODE256:
-            n = (art_node *) calloc(1, sizeof(art_node256));
-            break;
+            return sizeof(art_node256);
         default:
             abort();
     }
+}
+
+static art_node* alloc_node(uint8_t type) {
+    art_node* n = (art_node *) index_memory::zalloc(node_size(type));
     n->type = type;
     n->max_score = 0;
     n->max_token_count = 0;
     return n;
 }
 
+// takes any of the node types, which all start with an art_node
+static void free_node(void* n) {
+    index_memory::free(n, node_size(((art_node *) n)->type));
+}
+
+static void free_leaf(art_leaf* l) {
+    index_memory::free(l, sizeof(art_leaf) + l->key_len);
+}
+
 /**
  * Initializes an ART tree
  * @return 0 on success.
@@ -142,7 +151,7 @@ static void destroy_node(art_node *n) {
     if (IS_LEAF(n)) {
         art_leaf *leaf = (art_leaf *) LEAF_RAW(n);
         delete leaf->values;
-        free(leaf);
+        free_leaf(leaf);
         return;
     }
 
@@ -189,7 +198,7 @@ static void destroy_node(art_node *n) {
     }
 
     // Free ourself on the way up
-    free(n);
+    free_node(n);
 }
 
 /**
@@ -428,9 +437,10 @@ static void add_document_to_leaf(const art_document *document, art_leaf *leaf) {
 }
 
 static art_leaf* make_leaf(const unsigned char *key, uint32_t key_len, art_document *document) {
-    art_leaf *l = (art_leaf *) malloc(sizeof(art_leaf) + key_len);
+    art_leaf *l = (art_leaf *) index_memory::alloc(sizeof(art_leaf) + key_len);
     l->values = new art_values;
     l->max_score = 0;
+    l->spilled_length = 0;
     l->key_len = key_len;
     memcpy(l->key, key, key_len);
     add_document_to_leaf(document, l);
@@ -458,7 +468,7 @@ static void copy_header(art_node *dest, art_node *src) {
 static void add_child256(art_node256 *n, art_node **ref, unsigned char c, void *child) {
     (void)ref;
     n->n.max_score = MAX(n->n.max_score, ((art_leaf *) LEAF_RAW(child))->max_score);
-    n->n.max_token_count = MAX(n->n.max_token_count, ((art_leaf *) LEAF_RAW(child))->values->ids.getLength());
+    n->n.max_token_count = MAX(n->n.max_token_count, art_leaf_length((art_leaf *) LEAF_RAW(child)));
     n->n.num_children++;
     n->children[c] = (art_node *) child;
 }
@@ -468,7 +478,7 @@ static void add_child48(art_node48 *n, art_node **ref, unsigned char c, void *ch
         int pos = 0;
         while (n->children[pos]) pos++;
         n->n.max_score = MAX(n->n.max_score, ((art_leaf *) LEAF_RAW(child))->max_score);
-        n->n.max_token_count = MAX(n->n.max_token_count, ((art_leaf *) LEAF_RAW(child))->values->ids.getLength());
+        n->n.max_token_count = MAX(n->n.max_token_count, art_leaf_length((art_leaf *) LEAF_RAW(child)));
         n->children[pos] = (art_node *) child;
         n->keys[c] = pos + 1;
         n->n.num_children++;
@@ -481,7 +491,7 @@ static void add_child48(art_node48 *n, art_node **ref, unsigned char c, void *ch
         }
         copy_header((art_node*)new_n, (art_node*)n);
         *ref = (art_node*)new_n;
-        free(n);
+        free_node(n);
         add_child256(new_n, ref, c, child);
     }
 }
@@ -510,7 +520,7 @@ static void add_child16(art_node16 *n, art_node **ref, unsigned char c, void *ch
 
         // Set the child
         n->n.max_score = MAX(n->n.max_score, ((art_leaf *) LEAF_RAW(child))->max_score);
-        n->n.max_token_count = MAX(n->n.max_token_count, ((art_leaf *) LEAF_RAW(child))->values->ids.getLength());
+        n->n.max_token_count = MAX(n->n.max_token_count, art_leaf_length((art_leaf *) LEAF_RAW(child)));
         n->keys[idx] = c;
         n->children[idx] = (art_node *) child;
         n->n.num_children++;
@@ -526,7 +536,7 @@ static void add_child16(art_node16 *n, art_node **ref, unsigned char c, void *ch
         }
         copy_header((art_node*)new_n, (art_node*)n);
         *ref = (art_node*)new_n;
-        free(n);
+        free_node(n);
         add_child48(new_n, ref, c, child);
     }
 }
@@ -544,7 +554,7 @@ static void add_child4(art_node4 *n, art_node **ref, unsigned char c, void *chil
                 (n->n.num_children - idx)*sizeof(void*));
 
         int32_t child_max_score = IS_LEAF(child) ? ((art_leaf *) LEAF_RAW(child))->max_score : ((art_node *) child)->max_score;
-        uint32_t child_token_count = IS_LEAF(child) ? ((art_leaf *) LEAF_RAW(child))->values->ids.getLength() : ((art_node *) child)->max_token_count;
+        uint32_t child_token_count = IS_LEAF(child) ? art_leaf_length((art_leaf *) LEAF_RAW(child)) : ((art_node *) child)->max_token_count;
 
         n->n.max_score = MAX(n->n.max_score, child_max_score);
         n->n.max_token_count = MAX(n->n.max_token_count, child_token_count);
@@ -563,7 +573,7 @@ static void add_child4(art_node4 *n, art_node **ref, unsigned char c, void *chil
                 sizeof(unsigned char)*n->n.num_children);
         copy_header((art_node*)new_n, (art_node*)n);
         *ref = (art_node*)new_n;
-        free(n);
+        free_node(n);
         add_child16(new_n, ref, c, child);
     }
 }
@@ -736,7 +746,7 @@ static void remove_child256(art_node256 *n, art_node **ref, unsigned char c) {
                 pos++;
             }
         }
-        free(n);
+        free_node(n);
     }
 }
 
@@ -760,7 +770,7 @@ static void remove_child48(art_node48 *n, art_node **ref, unsigned char c) {
                 child++;
             }
         }
-        free(n);
+        free_node(n);
     }
 }
 
@@ -776,7 +786,7 @@ static void remove_child16(art_node16 *n, art_node **ref, art_node **l) {
         copy_header((art_node*)new_n, (art_node*)n);
         memcpy(new_n->keys, n->keys, 4);
         memcpy(new_n->children, n->children, 4*sizeof(void*));
-        free(n);
+        free_node(n);
     }
 }
 
@@ -807,7 +817,7 @@ static void remove_child4(art_node4 *n, art_node **ref, art_node **l) {
             child->partial_len += n->n.partial_len + 1;
         }
         *ref = child;
-        free(n);
+        free_node(n);
     }
 }
 
@@ -886,7 +896,7 @@ void* art_delete(art_tree *t, const unsigned char *key, int key_len) {
     if (l) {
         t->size--;
         void *old = l->values;
-        free(l);
+        free_leaf(l);
         return old;
     }
     return NULL;
@@ -1147,7 +1157,9 @@ static inline void copyIntArray2(const int *src, int *dest, const int len) {
     }
 }
 
-static inline int levenshtein_dist(const int depth, const char p, const char c, const unsigned char* term, const int term_len,
+// key chars are compared as unsigned, like the term, so that multi-byte UTF-8 chars can match
+static inline int levenshtein_dist(const int depth, const unsigned char p, const unsigned char c,
+                                   const unsigned char* term, const int term_len,
                                    const int* irow, const int* jrow, int* krow) {
     int row_min = std::numeric_limits<int>::max();
     const int columns = term_len+1;
@@ -1,6 +1,8 @@
 #include "collection.h"
 
 #include <numeric>
+#include <cmath>
+#include <sstream>
 #include <chrono>
 #include <array_utils.h>
 #include <match_score.h>
@@ -13,34 +15,57 @@
 
 Collection::Collection(const std::string name, const uint32_t collection_id, const uint32_t next_seq_id, Store *store,
                        const std::vector<field> &fields, const std::string & default_sorting_field,
-                       const size_t num_indices):
+                       const size_t num_indices, const bool forward_index):
                        name(name), collection_id(collection_id), next_seq_id(next_seq_id), store(store),
-                       fields(fields), default_sorting_field(default_sorting_field), num_indices(num_indices) {
+                       fields(fields), default_sorting_field(default_sorting_field), num_indices(num_indices),
+                       forward_index(forward_index), backfill_thread(nullptr), backfill_done(false),
+                       backfill_stop(false), num_backfilled(0) {
+
+    for(field & field: this->fields) {
+        // create_collection() rejects repeated fields, but collections that were created before it did can have
+        // them: the first one is kept, as it always was
+        if(search_schema.count(field.name) != 0 || unindexed_schema.count(field.name) != 0) {
+            continue;
+        }
 
-    for(const field& field: fields) {
+        if(!field.index) {
+            unindexed_schema.emplace(field.name, field);
+            continue;
+        }
+
+        // field ids are dense, in schema order
+        field.id = search_schema.size();
         search_schema.emplace(field.name, field);
 
         if(field.is_facet()) {
-            facet_value fvalue;
             facet_schema.emplace(field.name, field);
         }
 
-        if(field.is_single_integer() || field.is_single_float() || field.is_single_bool()) {
+        if(field.is_sortable()) {
             sort_schema.emplace(field.name, field);
         }
     }
 
     for(size_t i = 0; i < num_indices; i++) {
-        Index* index = new Index(name+std::to_string(i), search_schema, facet_schema, sort_schema);
+        Index* index = new Index(name+std::to_string(i), search_schema, facet_schema, sort_schema, forward_index);
+        index->set_postings_store(store, std::to_string(collection_id) + "_" + std::to_string(i) + "_");
         indices.push_back(index);
         std::thread* thread = new std::thread(&Index::run_search, index);
         index_threads.push_back(thread);
     }
 
+    next_field_id = search_schema.size();
     num_documents = 0;
 }
 
 Collection::~Collection() {
+    if(backfill_thread != nullptr) {
+        backfill_stop = true;
+        backfill_thread->join();
+        delete backfill_thread;
+        backfill_thread = nullptr;
+    }
+
     for(size_t i = 0; i < indices.size(); i++) {
         std::thread *t = index_threads[i];
         Index* index = indices[i];
@@ -84,11 +109,10 @@ Option<nlohmann::json> Collection::add(const std::string & json_str) {
         return Option<nlohmann::json>(400, "Document's `id` field should be a string.");
     }
 
-    std::string doc_id = document["id"];
-    Option<nlohmann::json> doc_option = get(doc_id);
+    const std::string & doc_id = document["id"];
 
     // we need to check if document ID already exists before attempting to index
-    if(doc_option.ok()) {
+    if(store->contains(get_doc_id_key(doc_id))) {
         return Option<nlohmann::json>(409, std::string("A document with id ") + doc_id + " already exists.");
     }
 
@@ -98,16 +122,78 @@ Option<nlohmann::json> Collection::add(const std::string & json_str) {
         return Option<nlohmann::json>(index_memory_op.code(), index_memory_op.error());
     }
 
+    // the unindexed values are moved out of the document while it's stored, and back into it for the response
+    nlohmann::json unindexed_values = nlohmann::json::object();
+    for(const std::pair<std::string, field> & field_pair: unindexed_schema) {
+        const auto value_it = document.find(field_pair.first);
+        if(value_it != document.end()) {
+            unindexed_values[field_pair.first] = std::move(*value_it);
+            document.erase(value_it);
+        }
+    }
+
     rocksdb::WriteBatch batch;
-    batch.Put(get_doc_id_key(document["id"]), seq_id_str);
+    batch.Put(get_doc_id_key(doc_id), seq_id_str);
     batch.Put(get_seq_id_key(seq_id), document.dump());
+
+    if(!unindexed_values.empty()) {
+        batch.Put(get_unindexed_key(seq_id), unindexed_values.dump());
+    }
+
     bool write_ok = store->batch_write(batch);
 
     if(!write_ok) {
         return Option<nlohmann::json>(500, "Could not write to on-disk storage.");
     }
 
-    return Option<nlohmann::json>(document);
+    for(auto it = unindexed_values.begin(); it != unindexed_values.end(); ++it) {
+        document[it.key()] = std::move(it.value());
+    }
+
+    return Option<nlohmann::json>(std::move(document));
+}
+
+void Collection::import_documents(const std::string & chunk, const bool last_chunk, import_state & state) {
+    size_t line_start = 0;
+    size_t line_end;
+
+    while((line_end = chunk.find('\n', line_start)) != std::string::npos) {
+        state.partial_line.append(chunk, line_start, line_end - line_start);
+        import_document(state.partial_line, state);
+        state.partial_line.clear();
+        line_start = line_end + 1;
+    }
+
+    state.partial_line.append(chunk, line_start, std::string::npos);
+
+    if(last_chunk && !state.partial_line.empty()) {
+        import_document(state.partial_line, state);
+        state.partial_line.clear();
+    }
+}
+
+void Collection::import_document(std::string & line, import_state & state) {
+    state.num_lines++;
+
+    if(!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+
+    if(line.find_first_not_of(" \t") == std::string::npos) {
+        return ;
+    }
+
+    Option<nlohmann::json> add_op = add(line);
+
+    if(add_op.ok()) {
+        state.num_imported++;
+        return ;
+    }
+
+    state.num_failed++;
+    if(state.errors.size() < import_state::MAX_ERRORS) {
+        state.errors.emplace_back(state.num_lines, add_op.error());
+    }
 }
 
 Option<uint32_t> Collection::validate_index_in_memory(const nlohmann::json &document, uint32_t seq_id) {
@@ -132,75 +218,45 @@ Option<uint32_t> Collection::validate_index_in_memory(const nlohmann::json &docu
 
     for(const std::pair<std::string, field> & field_pair: search_schema) {
         const std::string & field_name = field_pair.first;
+        const auto value_it = document.find(field_name);
+
+        if(value_it == document.end()) {
+            if(field_pair.second.optional) {
+                continue;
+            }
 
-        if(document.count(field_name) == 0) {
             return Option<>(400, "Field `" + field_name  + "` has been declared in the schema, "
                     "but is not found in the document.");
         }
 
-        if(field_pair.second.type == field_types::STRING) {
-            if(!document[field_name].is_string()) {
-                return Option<>(400, "Field `" + field_name  + "` must be a string.");
-            }
-        } else if(field_pair.second.type == field_types::INT32) {
-            if(!document[field_name].is_number_integer()) {
-                return Option<>(400, "Field `" + field_name  + "` must be an int32.");
-            }
-
-            if(document[field_name].get<int64_t>() > INT32_MAX) {
-                return Option<>(400, "Field `" + field_name  + "` exceeds maximum value of int32.");
-            }
-        } else if(field_pair.second.type == field_types::INT64) {
-            if(!document[field_name].is_number_integer()) {
-                return Option<>(400, "Field `" + field_name  + "` must be an int64.");
-            }
-        } else if(field_pair.second.type == field_types::FLOAT) {
-            if(!document[field_name].is_number()) { // allows integer to be passed to a float field
-                return Option<>(400, "Field `" + field_name  + "` must be a float.");
-            }
-        } else if(field_pair.second.type == field_types::BOOL) {
-            if(!document[field_name].is_boolean()) {
-                return Option<>(400, "Field `" + field_name  + "` must be a bool.");
-            }
-        } else if(field_pair.second.type == field_types::STRING_ARRAY) {
-            if(!document[field_name].is_array()) {
-                return Option<>(400, "Field `" + field_name  + "` must be a string array.");
-            }
-            if(document[field_name].size() > 0 && !document[field_name][0].is_string()) {
-                return Option<>(400, "Field `" + field_name  + "` must be a string array.");
-            }
-        } else if(field_pair.second.type == field_types::INT32_ARRAY) {
-            if(!document[field_name].is_array()) {
-                return Option<>(400, "Field `" + field_name  + "` must be an int32 array.");
-            }
+        Option<uint32_t> value_op = validate_field_value(field_pair.second, *value_it);
+        if(!value_op.ok()) {
+            return value_op;
+        }
+    }
 
-            if(document[field_name].size() > 0 && !document[field_name][0].is_number_integer()) {
-                return Option<>(400, "Field `" + field_name  + "` must be an int32 array.");
-            }
-        } else if(field_pair.second.type == field_types::INT64_ARRAY) {
-            if(!document[field_name].is_array()) {
-                return Option<>(400, "Field `" + field_name  + "` must be an int64 array.");
-            }
+    for(const field & a_field: backfill_fields) {
+        const auto value_it = document.find(a_field.name);
+        if(value_it == document.end()) {
+            continue;
+        }
 
-            if(document[field_name].size() > 0 && !document[field_name][0].is_number_integer()) {
-                return Option<>(400, "Field `" + field_name  + "` must be an int64 array.");
-            }
-        } else if(field_pair.second.type == field_types::FLOAT_ARRAY) {
-            if(!document[field_name].is_array()) {
-                return Option<>(400, "Field `" + field_name  + "` must be a float array.");
-            }
+        Option<uint32_t> value_op = validate_field_value(a_field, *value_it);
+        if(!value_op.ok()) {
+            return value_op;
+        }
+    }
 
-            if(document[field_name].size() > 0 && !document[field_name][0].is_number_float()) {
-                return Option<>(400, "Field `" + field_name  + "` must be a float array.");
-            }
-        } else if(field_pair.second.type == field_types::BOOL_ARRAY) {
-            if(!document[field_name].is_array()) {
-                return Option<>(400, "Field `" + field_name  + "` must be a bool array.");
-            }
+    // unindexed values are only stored, but are still held to their declared type
+    for(const std::pair<std::string, field> & field_pair: unindexed_schema) {
+        const auto value_it = document.find(field_pair.first);
+        if(value_it == document.end()) {
+            continue;
+        }
 
-            if(document[field_name].size() > 0 && !document[field_name][0].is_boolean()) {
-                return Option<>(400, "Field `" + field_name  + "` must be a bool array.");
-            }
+        Option<uint32_t> value_op = validate_field_value(field_pair.second, *value_it);
+        if(!value_op.ok()) {
+            return value_op;
         }
     }
 
@@ -208,15 +264,19 @@ Option<uint32_t> Collection::validate_index_in_memory(const nlohmann::json &docu
         const std::string & field_name = field_pair.first;
 
         if(document.count(field_name) == 0) {
+            if(field_pair.second.optional) {
+                continue;
+            }
+
             return Option<>(400, "Field `" + field_name  + "` has been declared as a facet field in the schema, "
                     "but is not found in the document.");
         }
 
-        if(field_pair.second.type == field_types::STRING) {
+        if(field_pair.second.type_id == field_type_t::STRING) {
             if(!document[field_name].is_string()) {
                 return Option<>(400, "Facet field `" + field_name  + "` must be a string.");
             }
-        } else if(field_pair.second.type == field_types::STRING_ARRAY) {
+        } else if(field_pair.second.type_id == field_type_t::STRING_ARRAY) {
             if(!document[field_name].is_array()) {
                 return Option<>(400, "Facet field `" + field_name  + "` must be a string array.");
             }
@@ -224,21 +284,83 @@ Option<uint32_t> Collection::validate_index_in_memory(const nlohmann::json &docu
             if(document[field_name].size() > 0 && !document[field_name][0].is_string()) {
                 return Option<>(400, "Facet field `" + field_name  + "` must be a string array.");
             }
+        } else if(field_pair.second.is_single_integer() || field_pair.second.is_single_float()) {
+            // already validated as a numerical field above
         } else {
-            return Option<>(400, "Facet field `" + field_name  + "` must be a string or a string[].");
+            return Option<>(400, "Facet field `" + field_name  + "` must be a string, a string[] or a single "
+                                 "integer or float.");
         }
     }
 
     return Option<>(200);
 }
 
-Option<uint32_t> Collection::index_in_memory(const nlohmann::json &document, uint32_t seq_id) {
-    Option<uint32_t> validation_op = validate_index_in_memory(document, seq_id);
+Option<uint32_t> Collection::validate_field_value(const field & a_field, const nlohmann::json & value) const {
+    const std::string & field_name = a_field.name;
 
-    if(!validation_op.ok()) {
-        return validation_op;
+    switch(a_field.type_id) {
+        case field_type_t::STRING:
+            if(!value.is_string()) {
+                return Option<>(400, "Field `" + field_name  + "` must be a string.");
+            }
+            break;
+        case field_type_t::INT32:
+            if(!value.is_number_integer()) {
+                return Option<>(400, "Field `" + field_name  + "` must be an int32.");
+            }
+
+            if(value.get<int64_t>() > INT32_MAX) {
+                return Option<>(400, "Field `" + field_name  + "` exceeds maximum value of int32.");
+            }
+            break;
+        case field_type_t::INT64:
+            if(!value.is_number_integer()) {
+                return Option<>(400, "Field `" + field_name  + "` must be an int64.");
+            }
+            break;
+        case field_type_t::FLOAT:
+            if(!value.is_number()) { // allows integer to be passed to a float field
+                return Option<>(400, "Field `" + field_name  + "` must be a float.");
+            }
+            break;
+        case field_type_t::BOOL:
+            if(!value.is_boolean()) {
+                return Option<>(400, "Field `" + field_name  + "` must be a bool.");
+            }
+            break;
+        case field_type_t::STRING_ARRAY:
+            if(!value.is_array() || (value.size() > 0 && !value[0].is_string())) {
+                return Option<>(400, "Field `" + field_name  + "` must be a string array.");
+            }
+            break;
+        case field_type_t::INT32_ARRAY:
+            if(!value.is_array() || (value.size() > 0 && !value[0].is_number_integer())) {
+                return Option<>(400, "Field `" + field_name  + "` must be an int32 array.");
+            }
+            break;
+        case field_type_t::INT64_ARRAY:
+            if(!value.is_array() || (value.size() > 0 && !value[0].is_number_integer())) {
+                return Option<>(400, "Field `" + field_name  + "` must be an int64 array.");
+            }
+            break;
+        case field_type_t::FLOAT_ARRAY:
+            if(!value.is_array() || (value.size() > 0 && !value[0].is_number_float())) {
+                return Option<>(400, "Field `" + field_name  + "` must be a float array.");
+            }
+            break;
+        case field_type_t::BOOL_ARRAY:
+            if(!value.is_array() || (value.size() > 0 && !value[0].is_boolean())) {
+                return Option<>(400, "Field `" + field_name  + "` must be a bool array.");
+            }
+            break;
+        default:
+            break;
     }
 
+    return Option<>(200);
+}
+
+int32_t Collection::get_points(const nlohmann::json & document) const {
     int32_t points = 0;
 
     if(!default_sorting_field.empty()) {
@@ -253,55 +375,41 @@ Option<uint32_t> Collection::index_in_memory(const nlohmann::json &document, uin
         }
     }
 
-    Index* index = indices[seq_id % num_indices];
-    index->index_in_memory(document, seq_id, points);
-
-    num_documents += 1;
-    return Option<>(200);
+    return points;
 }
 
-Option<nlohmann::json> Collection::search(std::string query, const std::vector<std::string> search_fields,
-                                  const std::string & simple_filter_query, const std::vector<std::string> & facet_fields,
-                                  const std::vector<sort_by> & sort_fields, const int num_typos,
-                                  const size_t per_page, const size_t page,
-                                  const token_ordering token_order, const bool prefix) {
-    std::vector<facet> facets;
-
-    // validate search fields
-    for(const std::string & field_name: search_fields) {
-        if(search_schema.count(field_name) == 0) {
-            std::string error = "Could not find a field named `" + field_name + "` in the schema.";
-            return Option<nlohmann::json>(404, error);
-        }
+Option<uint32_t> Collection::index_in_memory(const nlohmann::json &document, uint32_t seq_id) {
+    apply_backfilled_fields();
 
-        field search_field = search_schema.at(field_name);
-        if(search_field.type != field_types::STRING && search_field.type != field_types::STRING_ARRAY) {
-            std::string error = "Field `" + field_name + "` should be a string or a string array.";
-            return Option<nlohmann::json>(400, error);
-        }
+    Option<uint32_t> validation_op = validate_index_in_memory(document, seq_id);
 
-        if(search_field.facet) {
-            std::string error = "Field `" + field_name + "` is a faceted field - it cannot be used as a query field.";
-            return Option<nlohmann::json>(400, error);
-        }
+    if(!validation_op.ok()) {
+        return validation_op;
     }
 
-    // validate filter fields
+    Index* index = indices[seq_id % num_indices];
+    index->index_in_memory(document, seq_id, get_points(document));
+
+    num_documents += 1;
+    return Option<>(200);
+}
+
+Option<bool> Collection::parse_filter_query(const std::string & simple_filter_query,
+                                          std::vector<filter> & filters) const {
     std::vector<std::string> filter_blocks;
     StringUtils::split(simple_filter_query, filter_blocks, "&&");
 
-    std::vector<filter> filters;
     for(const std::string & filter_block: filter_blocks) {
         // split into [field_name, value]
         std::vector<std::string> expression_parts;
         StringUtils::split(filter_block, expression_parts, ":");
         if(expression_parts.size() != 2) {
-            return Option<nlohmann::json>(400, "Could not parse the filter query.");
+            return Option<bool>(400, "Could not parse the filter query.");
         }
 
         const std::string & field_name = expression_parts[0];
         if(search_schema.count(field_name) == 0) {
-            return Option<nlohmann::json>(404, "Could not find a filter field named `" + field_name + "` in the schema.");
+            return Option<bool>(404, "Could not find a filter field named `" + field_name + "` in the schema.");
         }
 
         field _field = search_schema.at(field_name);
@@ -316,11 +424,11 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
 
                 for(const std::string & filter_value: filter_values) {
                     if(_field.is_integer() && !StringUtils::is_integer(filter_value)) {
-                        return Option<nlohmann::json>(400, "Error with field `" + _field.name + "`: Not an integer.");
+                        return Option<bool>(400, "Error with field `" + _field.name + "`: Not an integer.");
                     }
 
                     if(_field.is_float() && !StringUtils::is_float(filter_value)) {
-                        return Option<nlohmann::json>(400, "Error with field `" + _field.name + "`: Not a float.");
+                        return Option<bool>(400, "Error with field `" + _field.name + "`: Not a float.");
                     }
                 }
 
@@ -328,7 +436,7 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
             } else {
                 Option<NUM_COMPARATOR> op_comparator = filter::extract_num_comparator(raw_value);
                 if(!op_comparator.ok()) {
-                    return Option<nlohmann::json>(400, "Error with field `" + _field.name + "`: " + op_comparator.error());
+                    return Option<bool>(400, "Error with field `" + _field.name + "`: " + op_comparator.error());
                 }
 
                 // extract numerical value
@@ -345,18 +453,18 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
                 filter_value = StringUtils::trim(filter_value);
 
                 if(_field.is_integer() && !StringUtils::is_integer(filter_value)) {
-                    return Option<nlohmann::json>(400, "Error with field `" + _field.name + "`: Not an integer.");
+                    return Option<bool>(400, "Error with field `" + _field.name + "`: Not an integer.");
                 }
 
                 if(_field.is_float() && !StringUtils::is_float(filter_value)) {
-                    return Option<nlohmann::json>(400, "Error with field `" + _field.name + "`: Not a float.");
+                    return Option<bool>(400, "Error with field `" + _field.name + "`: Not a float.");
                 }
 
                 f = {field_name, {filter_value}, op_comparator.get()};
             }
         } else if(_field.is_bool()) {
             if(raw_value != "true" && raw_value != "false") {
-                return Option<nlohmann::json>(400, "Value of field `" + _field.name + "`: must be `true` or `false`.");
+                return Option<bool>(400, "Value of field `" + _field.name + "`: must be `true` or `false`.");
             }
             std::string bool_value = (raw_value == "true") ? "1" : "0";
             f = {field_name, {bool_value}, EQUALS};
@@ -369,19 +477,543 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
                 f = {field_name, {raw_value}, EQUALS};
             }
         } else {
-            return Option<nlohmann::json>(400, "Error with field `" + _field.name + "`: Unidentified field type.");
+            return Option<bool>(400, "Error with field `" + _field.name + "`: Unidentified field type.");
         }
 
         filters.push_back(f);
     }
 
-    // validate facet fields
-    for(const std::string & field_name: facet_fields) {
-        if(facet_schema.count(field_name) == 0) {
-            std::string error = "Could not find a facet field named `" + field_name + "` in the schema.";
-            return Option<nlohmann::json>(404, error);
+    return Option<bool>(true);
+}
+
+Option<bool> Collection::parse_facet(const std::string & facet_field, std::vector<facet> & facets) const {
+    // either `field_name`, or `field_name(from:to, ...)` for the ranges of a numeric facet, where a missing bound
+    // is an open one, or `field_name(auto min:max)` for auto ranges spread over the given bounds instead of over
+    // those of the collection: a coordinator asks for these, so that its nodes count into the same ranges
+    const size_t ranges_start = facet_field.find('(');
+    std::string field_name = facet_field.substr(0, ranges_start);
+    StringUtils::trim(field_name);
+
+    if(facet_schema.count(field_name) == 0) {
+        std::string error = "Could not find a facet field named `" + field_name + "` in the schema.";
+        return Option<bool>(404, error);
+    }
+
+    const field & facet_field_def = facet_schema.at(field_name);
+
+    if(!facet_field_def.is_single_integer() && !facet_field_def.is_single_float()) {
+        if(ranges_start != std::string::npos) {
+            return Option<bool>(400, "Facet field `" + field_name + "` is not numeric, so it can't have ranges.");
         }
+
         facets.push_back(facet(field_name));
+        return Option<bool>(true);
+    }
+
+    std::vector<facet_range> ranges;
+
+    if(ranges_start == std::string::npos) {
+        double min, max;
+        if(!get_numeric_facet_bounds(facet_field_def, min, max)) {
+            facets.push_back(facet(field_name, ranges));
+            return Option<bool>(true);
+        }
+
+        make_auto_facet_ranges(facet_field_def, min, max, ranges);
+        facets.push_back(facet(field_name, ranges));
+        facets.back().auto_ranges = true;
+        facets.back().auto_min = min;
+        facets.back().auto_max = max;
+        return Option<bool>(true);
+    }
+
+    if(facet_field[facet_field.size() - 1] != ')') {
+        return Option<bool>(400, "Could not parse the ranges of facet field `" + field_name + "`.");
+    }
+
+    std::string ranges_str = facet_field.substr(ranges_start + 1, facet_field.size() - ranges_start - 2);
+    StringUtils::trim(ranges_str);
+
+    const std::string AUTO_PREFIX = "auto ";
+    if(ranges_str.compare(0, AUTO_PREFIX.size(), AUTO_PREFIX) == 0) {
+        std::vector<std::string> bounds;
+        StringUtils::split(ranges_str.substr(AUTO_PREFIX.size()), bounds, ":");
+
+        // the bounds are written with all their digits, in exponent notation too, so that they read back exactly
+        char* min_end = nullptr;
+        char* max_end = nullptr;
+        const double min = (bounds.size() == 2) ? std::strtod(bounds[0].c_str(), &min_end) : 0;
+        const double max = (bounds.size() == 2) ? std::strtod(bounds[1].c_str(), &max_end) : 0;
+
+        if(bounds.size() != 2 || *min_end != '\0' || *max_end != '\0' || !std::isfinite(min) ||
+           !std::isfinite(max) || min > max) {
+            return Option<bool>(400, "The auto ranges of facet field `" + field_name +
+                                     "` should have bounds of the form `min:max`.");
+        }
+
+        make_auto_facet_ranges(facet_field_def, min, max, ranges);
+        facets.push_back(facet(field_name, ranges));
+        facets.back().auto_ranges = true;
+        facets.back().auto_min = min;
+        facets.back().auto_max = max;
+        return Option<bool>(true);
+    }
+
+    std::vector<std::string> range_strs;
+    StringUtils::split(ranges_str, range_strs, ",");
+
+    for(std::string & range_str: range_strs) {
+        const size_t colon_pos = range_str.find(':');
+        if(colon_pos == std::string::npos) {
+            return Option<bool>(400, "Range `" + range_str + "` of facet field `" + field_name +
+                                     "` should be of the form `from:to`.");
+        }
+
+        std::string from_str = range_str.substr(0, colon_pos);
+        std::string to_str = range_str.substr(colon_pos + 1);
+        StringUtils::trim(from_str);
+        StringUtils::trim(to_str);
+
+        if((!from_str.empty() && !StringUtils::is_float(from_str) && !StringUtils::is_integer(from_str)) ||
+           (!to_str.empty() && !StringUtils::is_float(to_str) && !StringUtils::is_integer(to_str)) ||
+           (from_str.empty() && to_str.empty())) {
+            return Option<bool>(400, "Range `" + range_str + "` of facet field `" + field_name +
+                                     "` should have numerical bounds.");
+        }
+
+        facet_range range;
+        range.label = from_str + ":" + to_str;
+        range.from = from_str.empty() ? -std::numeric_limits<double>::infinity() : std::atof(from_str.c_str());
+        range.to = to_str.empty() ? std::numeric_limits<double>::infinity() : std::atof(to_str.c_str());
+        ranges.push_back(range);
+    }
+
+    facets.push_back(facet(field_name, ranges));
+    return Option<bool>(true);
+}
+
+bool Collection::get_numeric_facet_bounds(const field & facet_field, double & min, double & max) const {
+    // Shards have to count into the same ranges, so these are spread over the field's values in the whole
+    // collection, rather than over those of the results. Index threads are idle in between searches.
+    min = std::numeric_limits<double>::infinity();
+    max = -std::numeric_limits<double>::infinity();
+
+    for(Index* index: indices) {
+        double index_min, index_max;
+        if(index->get_numeric_facet_bounds(facet_field.name, index_min, index_max)) {
+            min = std::min(min, index_min);
+            max = std::max(max, index_max);
+        }
+    }
+
+    return min <= max;
+}
+
+void Collection::make_auto_facet_ranges(const field & facet_field, const double min, const double max,
+                                        std::vector<facet_range> & ranges) {
+    double width = (max - min) / NUM_AUTO_FACET_RANGES;
+    if(facet_field.is_single_integer()) {
+        width = std::max(1.0, std::ceil(width));
+    }
+
+    for(size_t i = 0; i < NUM_AUTO_FACET_RANGES; i++) {
+        facet_range range;
+        range.from = min + i * width;
+        range.to = min + (i + 1) * width;
+
+        // the last range ends just past the largest value, so that the largest value is counted in it
+        const bool last = (i == NUM_AUTO_FACET_RANGES - 1) || range.to > max;
+        if(last) {
+            range.to = std::nextafter(max, std::numeric_limits<double>::infinity());
+        }
+
+        std::stringstream label;
+        label << range.from << ":" << (last ? max : range.to);
+        range.label = label.str();
+        ranges.push_back(range);
+
+        if(last) {
+            break;
+        }
+    }
+}
+
+Option<uint32_t> Collection::pin_filter(const std::string & simple_filter_query) {
+    apply_backfilled_fields();
+
+    std::vector<filter> filters;
+    Option<bool> filter_op = parse_filter_query(simple_filter_query, filters);
+    if(!filter_op.ok()) {
+        return Option<uint32_t>(filter_op.code(), filter_op.error());
+    }
+
+    if(filters.empty()) {
+        return Option<uint32_t>(400, "A pinned filter needs at least one filter expression.");
+    }
+
+    // like document writes, pinning is done from the main thread while no search is running
+    uint32_t num_matches = 0;
+    for(Index* index: indices) {
+        Option<uint32_t> pin_op = index->pin_filter(filters);
+        if(!pin_op.ok()) {
+            return pin_op;
+        }
+        num_matches += pin_op.get();
+    }
+
+    if(std::find(pinned_filters.begin(), pinned_filters.end(), simple_filter_query) == pinned_filters.end()) {
+        pinned_filters.push_back(simple_filter_query);
+    }
+
+    return Option<uint32_t>(num_matches);
+}
+
+std::vector<std::string> Collection::get_pinned_filters() {
+    return pinned_filters;
+}
+
+Option<bool> Collection::alter_schema(const std::vector<field> & add_fields,
+                                      const std::vector<std::string> & drop_fields) {
+    apply_backfilled_fields();
+
+    if(backfill_thread != nullptr) {
+        return Option<bool>(409, "The fields that were last added to the schema are still being indexed.");
+    }
+
+    std::vector<std::string> pinned_field_names;
+    for(const std::string & pinned_filter: pinned_filters) {
+        std::vector<filter> filters;
+        parse_filter_query(pinned_filter, filters);
+        for(const filter & a_filter: filters) {
+            pinned_field_names.push_back(a_filter.field_name);
+        }
+    }
+
+    for(const std::string & field_name: drop_fields) {
+        if(search_schema.count(field_name) == 0 && unindexed_schema.count(field_name) == 0) {
+            return Option<bool>(404, "Could not find a field named `" + field_name + "` in the schema.");
+        }
+
+        if(field_name == default_sorting_field) {
+            return Option<bool>(400, "The default sorting field `" + field_name + "` can't be dropped.");
+        }
+
+        if(std::find(pinned_field_names.begin(), pinned_field_names.end(), field_name) != pinned_field_names.end()) {
+            return Option<bool>(400, "Field `" + field_name + "` is used by a pinned filter, so it can't be dropped.");
+        }
+    }
+
+    for(size_t i = 0; i < add_fields.size(); i++) {
+        const field & new_field = add_fields[i];
+        const bool dropped = std::find(drop_fields.begin(), drop_fields.end(), new_field.name) != drop_fields.end();
+        const bool repeated = std::any_of(add_fields.begin(), add_fields.begin() + i,
+                                          [&new_field](const field & f) { return f.name == new_field.name; });
+
+        const bool exists = search_schema.count(new_field.name) != 0 || unindexed_schema.count(new_field.name) != 0;
+
+        if((exists && !dropped) || repeated) {
+            return Option<bool>(409, "Field `" + new_field.name + "` already exists in the schema.");
+        }
+
+        if(new_field.name.empty() || new_field.type_id == field_type_t::UNKNOWN) {
+            return Option<bool>(400, "Field `" + new_field.name + "` has an invalid type `" + new_field.type + "`.");
+        }
+
+        if(new_field.facet && !new_field.is_string() && !new_field.is_single_integer() &&
+           !new_field.is_single_float()) {
+            return Option<bool>(400, "Facet field `" + new_field.name + "` must be a string, a string[] or a single "
+                                     "integer or float.");
+        }
+
+        Option<bool> analyzer_op = analyzer::validate(new_field);
+        if(!analyzer_op.ok()) {
+            return analyzer_op;
+        }
+
+        Option<bool> unindexed_op = validate_unindexed_field(new_field);
+        if(!unindexed_op.ok()) {
+            return unindexed_op;
+        }
+    }
+
+    // dropping needs no backfill, and is done while no search is running, like document writes
+    for(const std::string & field_name: drop_fields) {
+        for(Index* index: indices) {
+            index->drop_field(field_name);
+        }
+
+        search_schema.erase(field_name);
+        facet_schema.erase(field_name);
+        sort_schema.erase(field_name);
+        unindexed_schema.erase(field_name);
+        fields.erase(std::remove_if(fields.begin(), fields.end(),
+                                    [&field_name](const field & f) { return f.name == field_name; }), fields.end());
+    }
+
+    // Unindexed fields have nothing to backfill. Values that stored documents already have for them stay where
+    // they are, and are returned with the documents all the same. Likewise, the values of an unindexed field that
+    // is added back as an indexed one are only indexed for the documents that are written from then on.
+    bool backfill_needed = false;
+
+    for(const field & add_field: add_fields) {
+        if(!add_field.index) {
+            fields.push_back(add_field);
+            fields.back().optional = true;
+            unindexed_schema.emplace(add_field.name, fields.back());
+        } else {
+            backfill_needed = true;
+        }
+    }
+
+    if(!backfill_needed) {
+        return Option<bool>(true);
+    }
+
+    for(const field & add_field: add_fields) {
+        if(!add_field.index) {
+            continue;
+        }
+
+        field new_field = add_field;
+        new_field.optional = true;
+        new_field.id = next_field_id++;
+
+        for(Index* index: indices) {
+            index->add_field(new_field);
+        }
+
+        backfill_fields.push_back(new_field);
+    }
+
+    // Documents written from now on are indexed with the new fields, while the iterator sees only the documents
+    // that were written before: so every document is indexed exactly once.
+    rocksdb::Iterator* iter = store->scan(get_seq_id_collection_prefix());
+
+    backfill_done = false;
+    backfill_stop = false;
+    num_backfilled = 0;
+    backfill_thread = new std::thread(&Collection::backfill, this, iter, backfill_fields);
+
+    return Option<bool>(true);
+}
+
+void Collection::backfill(rocksdb::Iterator* iter, const std::vector<field> fields) {
+    const std::string seq_id_prefix = get_seq_id_collection_prefix();
+    size_t batch_size = 0;
+
+    while(!backfill_stop && iter->Valid() && iter->key().starts_with(seq_id_prefix)) {
+        // the key ends with the serialized sequence id
+        const rocksdb::Slice & key = iter->key();
+        const uint32_t seq_id = StringUtils::deserialize_uint32_t(std::string(key.data() + key.size() - 4, 4));
+
+        nlohmann::json document;
+        try {
+            document = nlohmann::json::parse(iter->value().ToString());
+        } catch(...) {
+            LOG(ERR) << "Error while parsing stored document from collection " << name << " with key: "
+                     << key.ToString();
+            iter->Next();
+            continue;
+        }
+
+        // the document might predate a field, or have a value of another type
+        std::vector<field> doc_fields;
+        for(const field & a_field: fields) {
+            const auto value_it = document.find(a_field.name);
+            if(value_it != document.end() && validate_field_value(a_field, *value_it).ok()) {
+                doc_fields.push_back(a_field);
+            }
+        }
+
+        if(!doc_fields.empty()) {
+            indices[seq_id % num_indices]->backfill(document, seq_id, get_points(document), doc_fields);
+        }
+
+        num_backfilled++;
+        iter->Next();
+
+        if(++batch_size == BACKFILL_BATCH_SIZE) {
+            batch_size = 0;
+            std::this_thread::sleep_for(std::chrono::milliseconds(BACKFILL_BATCH_PAUSE_MS));
+        }
+    }
+
+    delete iter;
+    backfill_done = true;
+}
+
+void Collection::apply_backfilled_fields() {
+    if(backfill_thread == nullptr || !backfill_done) {
+        return ;
+    }
+
+    backfill_thread->join();
+    delete backfill_thread;
+    backfill_thread = nullptr;
+
+    for(const field & new_field: backfill_fields) {
+        for(Index* index: indices) {
+            index->publish_field(new_field);
+        }
+
+        fields.push_back(new_field);
+        search_schema.emplace(new_field.name, new_field);
+
+        if(new_field.is_facet()) {
+            facet_schema.emplace(new_field.name, new_field);
+        }
+
+        if(new_field.is_sortable()) {
+            sort_schema.emplace(new_field.name, new_field);
+        }
+    }
+
+    backfill_fields.clear();
+}
+
+size_t Collection::spill_cold_postings(const uint64_t cold_after_ms) {
+    apply_backfilled_fields();
+
+    // the backfill thread writes to the shards in between, so their fields stay as they are until it's done
+    if(backfill_thread != nullptr) {
+        return 0;
+    }
+
+    size_t num_bytes = 0;
+    for(Index* index: indices) {
+        num_bytes += index->spill_cold_postings(cold_after_ms);
+    }
+
+    return num_bytes;
+}
+
+size_t Collection::get_num_spilled_leaves() {
+    size_t num_leaves = 0;
+    for(Index* index: indices) {
+        num_leaves += index->get_num_spilled_leaves();
+    }
+
+    return num_leaves;
+}
+
+std::vector<field> Collection::get_backfill_fields() {
+    apply_backfilled_fields();
+    return backfill_fields;
+}
+
+bool Collection::is_backfilling() {
+    apply_backfilled_fields();
+    return backfill_thread != nullptr;
+}
+
+size_t Collection::get_num_backfilled() {
+    return num_backfilled;
+}
+
+void Collection::await_backfill() {
+    while(backfill_thread != nullptr && !backfill_done) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(BACKFILL_BATCH_PAUSE_MS));
+    }
+
+    apply_backfilled_fields();
+}
+
+Option<nlohmann::json> Collection::search(std::string query, const std::vector<std::string> search_fields,
+                                  const std::string & simple_filter_query, const std::vector<std::string> & facet_fields,
+                                  const std::vector<sort_by> & sort_fields, const int num_typos,
+                                  const size_t per_page, const size_t page,
+                                  const token_ordering token_order, const bool prefix, const bool explain_plan,
+                                  const size_t facet_sample_percent, const size_t facet_sample_threshold,
+                                  const std::string & facet_query, const bool infix, const bool mergeable,
+                                  const bool include_unindexed) {
+    Option<search_results> results_op = run_search(query, search_fields, simple_filter_query, facet_fields,
+                                                   sort_fields, num_typos, per_page, page, token_order, prefix,
+                                                   explain_plan, facet_sample_percent, facet_sample_threshold,
+                                                   facet_query, infix, include_unindexed);
+
+    if(!results_op.ok()) {
+        return Option<nlohmann::json>(results_op.code(), results_op.error());
+    }
+
+    return results_op.get().to_json(mergeable);
+}
+
+Option<search_results> Collection::run_search(std::string query, const std::vector<std::string> search_fields,
+                                  const std::string & simple_filter_query, const std::vector<std::string> & facet_fields,
+                                  const std::vector<sort_by> & sort_fields, const int num_typos,
+                                  const size_t per_page, const size_t page,
+                                  const token_ordering token_order, const bool prefix, const bool explain_plan,
+                                  const size_t facet_sample_percent, const size_t facet_sample_threshold,
+                                  const std::string & facet_query, const bool infix,
+                                  const bool include_unindexed) {
+    apply_backfilled_fields();
+
+    std::vector<facet> facets;
+
+    // validate search fields
+    for(const std::string & field_name: search_fields) {
+        if(search_schema.count(field_name) == 0) {
+            std::string error = "Could not find a field named `" + field_name + "` in the schema.";
+            return Option<search_results>(404, error);
+        }
+
+        const field & search_field = search_schema.at(field_name);
+        if(!search_field.is_string()) {
+            std::string error = "Field `" + field_name + "` should be a string or a string array.";
+            return Option<search_results>(400, error);
+        }
+
+        if(search_field.facet) {
+            std::string error = "Field `" + field_name + "` is a faceted field - it cannot be used as a query field.";
+            return Option<search_results>(400, error);
+        }
+    }
+
+    // validate filter fields
+    std::vector<filter> filters;
+    Option<bool> filter_op = parse_filter_query(simple_filter_query, filters);
+    if(!filter_op.ok()) {
+        return Option<search_results>(filter_op.code(), filter_op.error());
+    }
+
+    // validate facet fields
+    for(const std::string & facet_field: facet_fields) {
+        Option<bool> facet_op = parse_facet(facet_field, facets);
+        if(!facet_op.ok()) {
+            return Option<search_results>(facet_op.code(), facet_op.error());
+        }
+    }
+
+    if(facet_sample_percent < 1 || facet_sample_percent > 100) {
+        return Option<search_results>(400, "Facet sample percent must be an integer between 1 and 100.");
+    }
+
+    for(facet & a_facet: facets) {
+        a_facet.sample_percent = facet_sample_percent;
+        a_facet.sample_threshold = facet_sample_threshold;
+    }
+
+    if(!facet_query.empty()) {
+        // `field_name: query`, on one of the string facets that are asked for
+        const size_t colon_pos = facet_query.find(':');
+        std::string facet_query_field = facet_query.substr(0, colon_pos);
+        StringUtils::trim(facet_query_field);
+
+        auto facet_it = std::find_if(facets.begin(), facets.end(), [&](const facet & a_facet) {
+            return a_facet.field_name == facet_query_field;
+        });
+
+        if(colon_pos == std::string::npos || facet_it == facets.end()) {
+            return Option<search_results>(400, "Facet query should be of the form `field_name: value`, on one of "
+                                               "the facet fields that are asked for.");
+        }
+
+        if(facet_it->is_numeric) {
+            return Option<search_results>(400, "Facet query field `" + facet_query_field + "` should be a string.");
+        }
+
+        std::string facet_query_value = facet_query.substr(colon_pos + 1);
+        facet_it->query = StringUtils::trim(facet_query_value);
     }
 
     // validate sort fields and standardize
@@ -391,7 +1023,7 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
     for(const sort_by & _sort_field: sort_fields) {
         if(sort_schema.count(_sort_field.name) == 0) {
             std::string error = "Could not find a field named `" + _sort_field.name + "` in the schema for sorting.";
-            return Option<nlohmann::json>(404, error);
+            return Option<search_results>(404, error);
         }
 
         std::string sort_order = _sort_field.order;
@@ -399,7 +1031,7 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
 
         if(sort_order != sort_field_const::asc && sort_order != sort_field_const::desc) {
             std::string error = "Order for field` " + _sort_field.name + "` should be either ASC or DESC.";
-            return Option<nlohmann::json>(400, error);
+            return Option<search_results>(400, error);
         }
 
         sort_fields_std.push_back({_sort_field.name, sort_order});
@@ -412,12 +1044,12 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
     // check for valid pagination
     if(page < 1) {
         std::string message = "Page must be an integer of value greater than 0.";
-        return Option<nlohmann::json>(422, message);
+        return Option<search_results>(422, message);
     }
 
     if((page * per_page) > MAX_RESULTS) {
         std::string message = "Only the first " + std::to_string(MAX_RESULTS) + " results are available.";
-        return Option<nlohmann::json>(422, message);
+        return Option<search_results>(422, message);
     }
 
     //auto begin = std::chrono::high_resolution_clock::now();
@@ -426,11 +1058,13 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
     std::vector<std::vector<art_leaf*>> searched_queries;
     std::vector<std::pair<int, Topster<512>::KV>> field_order_kvs;
     size_t total_found = 0;
+    search_results results;
+    results.explain_plan = explain_plan;
 
     // send data to individual index threads
     for(Index* index: indices) {
         index->search_params = search_args(query, search_fields, filters, facets, sort_fields_std,
-                                           num_typos, per_page, page, token_order, prefix);
+                                           num_typos, per_page, page, token_order, prefix, infix);
         {
             std::lock_guard<std::mutex> lk(index->m);
             index->ready = true;
@@ -440,7 +1074,7 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
         //std::this_thread::sleep_for(std::chrono::milliseconds(400));
     }
 
-    Option<nlohmann::json> index_search_op({});  // stores the last error across all index threads
+    Option<bool> index_search_op(true);  // stores the last error across all index threads
 
     for(Index* index: indices) {
         // wait for the worker
@@ -449,9 +1083,12 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
             index->cv.wait(lk, [index]{return index->processed;});
         }
 
+        results.num_scored_docs += index->search_params.num_scored_docs;
+        results.cpu_time_us += index->search_params.cpu_time_us;
+
         if(!index->search_params.outcome.ok()) {
-            index_search_op = Option<nlohmann::json>(index->search_params.outcome.code(),
-                                                    index->search_params.outcome.error());
+            index_search_op = Option<bool>(index->search_params.outcome.code(),
+                                           index->search_params.outcome.error());
         }
 
         if(!index_search_op.ok()) {
@@ -465,13 +1102,21 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
             field_order_kvs.push_back(field_order_kv);
         }
 
-        searched_queries.insert(searched_queries.end(), index->search_params.searched_queries.begin(),
-                                index->search_params.searched_queries.end());
+        // the index's search params are overwritten on the next search, so their queries can be moved
+        searched_queries.insert(searched_queries.end(),
+                                std::make_move_iterator(index->search_params.searched_queries.begin()),
+                                std::make_move_iterator(index->search_params.searched_queries.end()));
 
         for(size_t fi = 0; fi < index->search_params.facets.size(); fi++) {
             auto & this_facet = index->search_params.facets[fi];
             auto & acc_facet = facets[fi];
 
+            acc_facet.sampled = acc_facet.sampled || this_facet.sampled;
+            acc_facet.stats.merge(this_facet.stats);
+            for(size_t ri = 0; ri < this_facet.range_counts.size(); ri++) {
+                acc_facet.range_counts[ri] += this_facet.range_counts[ri];
+            }
+
             for(auto & facet_kv: this_facet.result_map) {
                 size_t count = 0;
 
@@ -487,10 +1132,15 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
         }
 
         total_found += index->search_params.all_result_ids_len;
+
+        if(explain_plan) {
+            // one plan per index shard, since each shard plans against its own statistics
+            results.plans.push_back(index->search_params.plan);
+        }
     }
 
     if(!index_search_op.ok()) {
-        return index_search_op;
+        return Option<search_results>(index_search_op.code(), index_search_op.error());
     }
 
     // All fields are sorted descending
@@ -500,16 +1150,15 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
                  std::tie(b.second.match_score, b.second.primary_attr, b.second.secondary_attr, b.first, b.second.key);
     });
 
-    nlohmann::json result = nlohmann::json::object();
-
-    result["hits"] = nlohmann::json::array();
-    result["found"] = total_found;
+    results.found = total_found;
 
     const int start_result_index = (page - 1) * per_page;
     const int kvsize = field_order_kvs.size();
 
-    if(start_result_index > (kvsize - 1)) {
-        return Option<nlohmann::json>(result);
+    // per_page=0 asks only for `found` and the facet counts, so it has no page to be out of range of
+    if(per_page != 0 && start_result_index > (kvsize - 1)) {
+        results.out_of_range = true;
+        return Option<search_results>(std::move(results));
     }
 
     const int end_result_index = std::min(int(page * per_page), kvsize) - 1;
@@ -517,56 +1166,67 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
     // construct results array
     for(int field_order_kv_index = start_result_index; field_order_kv_index <= end_result_index; field_order_kv_index++) {
         const auto & field_order_kv = field_order_kvs[field_order_kv_index];
-        const std::string& seq_id_key = get_seq_id_key((uint32_t) field_order_kv.second.key);
+        const uint32_t seq_id = (uint32_t) field_order_kv.second.key;
 
-        std::string json_doc_str;
-        StoreStatus json_doc_status = store->get(seq_id_key, json_doc_str);
+        search_hit hit;
+        StoreStatus json_doc_status = get_document(seq_id, hit.document, include_unindexed);
 
         if(json_doc_status != StoreStatus::FOUND) {
-            LOG(ERR) << "Could not locate the JSON document for sequence ID: " << seq_id_key;
+            LOG(ERR) << "Could not locate the JSON document for sequence ID: " << seq_id;
             continue;
         }
 
-        nlohmann::json wrapper_doc;
-        nlohmann::json document;
-
-        try {
-            document = nlohmann::json::parse(json_doc_str);
-        } catch(...) {
-            return Option<nlohmann::json>(500, "Error while parsing stored document.");
-        }
+        results.num_bytes_read += hit.document.size();
 
-        wrapper_doc["document"] = document;
-        //wrapper_doc["match_score"] = field_order_kv.second.match_score;
-        //wrapper_doc["seq_id"] = (uint32_t) field_order_kv.second.key;
+        hit.match_score = field_order_kv.second.match_score;
+        hit.primary_attr = field_order_kv.second.primary_attr;
+        hit.secondary_attr = field_order_kv.second.secondary_attr;
+        hit.field_order = field_order_kv.first;
 
-        // highlight query words in the result
-        const std::string & field_name = search_fields[search_fields.size() - field_order_kv.first];
-        field search_field = search_schema.at(field_name);
+        // highlight query words in the result: a match-all query has no words to highlight
+        const std::vector<art_leaf*> & query_leaves = searched_queries[field_order_kv.second.query_index];
+        const std::string field_name = query_leaves.empty() ? "" :
+                                         search_fields[search_fields.size() - field_order_kv.first];
 
         // only string fields are supported for now
-        if(search_field.type == field_types::STRING) {
+        if(!query_leaves.empty() && search_schema.at(field_name).type_id == field_type_t::STRING) {
+            // only a highlighted document is parsed here: the JSON response uses it instead of parsing it again
+            try {
+                hit.parsed_document = nlohmann::json::parse(hit.document);
+            } catch(...) {
+                return Option<search_results>(500, "Error while parsing stored document.");
+            }
+
+            nlohmann::json & document = hit.parsed_document;
+
+            // split like the field's values were when they were indexed, so that token positions line up
             std::vector<std::string> tokens;
-            StringUtils::split(document[field_name], tokens, " ");
+            analyzer::for_field(search_schema.at(field_name)).split(document[field_name], tokens);
 
             // positions in the document of each token in the query
             std::vector<std::vector<uint16_t>> token_positions;
 
-            for (const art_leaf *token_leaf : searched_queries[field_order_kv.second.query_index]) {
+            for (const art_leaf *token_leaf : query_leaves) {
                 std::vector<uint16_t> positions;
                 uint32_t doc_index = token_leaf->values->ids.indexOf(field_order_kv.second.key);
                 if(doc_index == token_leaf->values->ids.getLength()) {
                     continue;
                 }
 
-                uint32_t start_offset = token_leaf->values->offset_index.at(doc_index);
-                uint32_t end_offset = (doc_index == token_leaf->values->ids.getLength() - 1) ?
-                                      token_leaf->values->offsets.getLength() :
-                                      token_leaf->values->offset_index.at(doc_index+1);
+                uint32_t offset_bounds[2];
 
-                while(start_offset < end_offset) {
-                    positions.push_back((uint16_t) token_leaf->values->offsets.at(start_offset));
-                    start_offset++;
+                if(doc_index == token_leaf->values->ids.getLength() - 1) {
+                    offset_bounds[0] = token_leaf->values->offset_index.at(doc_index);
+                    offset_bounds[1] = token_leaf->values->offsets.getLength();
+                } else {
+                    token_leaf->values->offset_index.at_range(doc_index, doc_index+2, offset_bounds);
+                }
+
+                std::vector<uint32_t> offsets(offset_bounds[1] - offset_bounds[0]);
+                token_leaf->values->offsets.at_range(offset_bounds[0], offset_bounds[1], offsets.data());
+
+                for(const uint32_t offset: offsets) {
+                    positions.push_back((uint16_t) offset);
                 }
 
                 token_positions.push_back(positions);
@@ -606,22 +1266,36 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
                 snippet_stream << tokens[snippet_index];
             }
 
-            wrapper_doc["highlight"] = nlohmann::json::object();
-            wrapper_doc["highlight"][field_name] = snippet_stream.str();
+            hit.highlight_field = field_name;
+            hit.snippet = snippet_stream.str();
         }
 
-        result["hits"].push_back(wrapper_doc);
+        results.hits.push_back(std::move(hit));
     }
 
-    result["facet_counts"] = nlohmann::json::array();
-
     // populate facets
     for(const facet & a_facet: facets) {
-        nlohmann::json facet_result = nlohmann::json::object();
-        facet_result["field_name"] = a_facet.field_name;
-        facet_result["counts"] = nlohmann::json::array();
+        facet_result result;
+        result.field_name = a_facet.field_name;
+        result.is_numeric = a_facet.is_numeric;
+        result.sampled = a_facet.sampled;
+
+        if(a_facet.is_numeric) {
+            // ranges are returned in the order they were asked for, empty ones included
+            for(size_t i = 0; i < a_facet.ranges.size(); i++) {
+                result.values.push_back(a_facet.ranges[i].label);
+                result.counts.push_back(a_facet.range_counts[i]);
+            }
+
+            result.stats = a_facet.stats;
+            result.auto_ranges = a_facet.auto_ranges;
+            result.auto_min = a_facet.auto_min;
+            result.auto_max = a_facet.auto_max;
+            results.facets.push_back(std::move(result));
+            continue;
+        }
 
-        // keep only top 10 facets
+        // all values are kept: how many of them are returned is up to the encoding of the response
         std::vector<std::pair<std::string, size_t>> value_to_count;
         for (auto itr = a_facet.result_map.begin(); itr != a_facet.result_map.end(); ++itr) {
             value_to_count.push_back(*itr);
@@ -632,21 +1306,18 @@ Option<nlohmann::json> Collection::search(std::string query, const std::vector<s
                       return a.second > b.second;
                   });
 
-        for(size_t i = 0; i < std::min((size_t)10, value_to_count.size()); i++) {
-            auto & kv = value_to_count[i];
-            nlohmann::json facet_value_count = nlohmann::json::object();
-            facet_value_count["value"] = kv.first;
-            facet_value_count["count"] = kv.second;
-            facet_result["counts"].push_back(facet_value_count);
+        for(auto & kv: value_to_count) {
+            result.values.push_back(std::move(kv.first));
+            result.counts.push_back(kv.second);
         }
 
-        result["facet_counts"].push_back(facet_result);
+        results.facets.push_back(std::move(result));
     }
 
     //long long int timeMillis = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - begin).count();
     //!LOG(INFO) << "Time taken for result calc: " << timeMillis << "us";
     //!store->print_memory_usage();
-    return result;
+    return Option<search_results>(std::move(results));
 }
 
 Option<nlohmann::json> Collection::get(const std::string & id) {
@@ -664,7 +1335,7 @@ Option<nlohmann::json> Collection::get(const std::string & id) {
     uint32_t seq_id = (uint32_t) std::stol(seq_id_str);
 
     std::string parsed_document;
-    StoreStatus doc_status = store->get(get_seq_id_key(seq_id), parsed_document);
+    StoreStatus doc_status = get_document(seq_id, parsed_document, true);
 
     if(doc_status == StoreStatus::NOT_FOUND) {
         LOG(ERR) << "Sequence ID exists, but document is missing for id: " << id;
@@ -682,10 +1353,12 @@ Option<nlohmann::json> Collection::get(const std::string & id) {
         return Option<nlohmann::json>(500, "Error while parsing stored document.");
     }
 
-    return Option<nlohmann::json>(document);
+    return Option<nlohmann::json>(std::move(document));
 }
 
 Option<std::string> Collection::remove(const std::string & id, const bool remove_from_store) {
+    apply_backfilled_fields();
+
     std::string seq_id_str;
     StoreStatus seq_id_status = store->get(get_doc_id_key(id), seq_id_str);
 
@@ -698,32 +1371,42 @@ Option<std::string> Collection::remove(const std::string & id, const bool remove
     }
 
     uint32_t seq_id = (uint32_t) std::stol(seq_id_str);
+    Index* index = indices[seq_id % num_indices];
 
-    std::string parsed_document;
-    StoreStatus doc_status = store->get(get_seq_id_key(seq_id), parsed_document);
+    if(index->has_forward_index()) {
+        // the forward index knows what to remove from the in-memory index, so the document is not needed
+        Option<uint32_t> remove_op = index->remove(seq_id);
+        if(!remove_op.ok()) {
+            LOG(ERR) << "Sequence ID exists, but document is missing in the forward index for id: " << id;
+            return Option<std::string>(404, "Could not find a document with id: " + id);
+        }
+    } else {
+        std::string parsed_document;
+        StoreStatus doc_status = store->get(get_seq_id_key(seq_id), parsed_document);
 
-    if(doc_status == StoreStatus::NOT_FOUND) {
-        LOG(ERR) << "Sequence ID exists, but document is missing for id: " << id;
-        return Option<std::string>(404, "Could not find a document with id: " + id);
-    }
+        if(doc_status == StoreStatus::NOT_FOUND) {
+            LOG(ERR) << "Sequence ID exists, but document is missing for id: " << id;
+            return Option<std::string>(404, "Could not find a document with id: " + id);
+        }
 
-    if(doc_status == StoreStatus::ERROR) {
-        return Option<std::string>(500, "Error while fetching the document.");
-    }
+        if(doc_status == StoreStatus::ERROR) {
+            return Option<std::string>(500, "Error while fetching the document.");
+        }
 
-    nlohmann::json document;
-    try {
-        document = nlohmann::json::parse(parsed_document);
-    } catch(...) {
-        return Option<std::string>(500, "Error while parsing stored document.");
-    }
+        nlohmann::json document;
+        try {
+            document = nlohmann::json::parse(parsed_document);
+        } catch(...) {
+            return Option<std::string>(500, "Error while parsing stored document.");
+        }
 
-    Index* index = indices[seq_id % num_indices];
-    index->remove(seq_id, document);
+        index->remove(seq_id, document);
+    }
 
     if(remove_from_store) {
         store->remove(get_doc_id_key(id));
         store->remove(get_seq_id_key(seq_id));
+        store->remove(get_unindexed_key(seq_id));
     }
 
     num_documents -= 1;
@@ -742,6 +1425,48 @@ std::string Collection::get_seq_id_key(uint32_t seq_id) {
     return get_seq_id_collection_prefix() + "_" + serialized_id;
 }
 
+std::string Collection::get_unindexed_key(uint32_t seq_id) {
+    return std::to_string(collection_id) + "_" + UNINDEXED_PREFIX + "_" + StringUtils::serialize_uint32_t(seq_id);
+}
+
+StoreStatus Collection::get_document(const uint32_t seq_id, std::string & document, const bool include_unindexed) {
+    StoreStatus doc_status = store->get(get_seq_id_key(seq_id), document);
+
+    if(doc_status != StoreStatus::FOUND || !include_unindexed) {
+        return doc_status;
+    }
+
+    std::string unindexed_values;
+    StoreStatus unindexed_status = store->get(get_unindexed_key(seq_id), unindexed_values);
+
+    if(unindexed_status == StoreStatus::NOT_FOUND) {
+        return StoreStatus::FOUND;
+    }
+
+    if(unindexed_status == StoreStatus::ERROR || document.size() < 2 || unindexed_values.size() < 2) {
+        return StoreStatus::ERROR;
+    }
+
+    // Both are non-empty JSON objects: the document has an `id`, and empty values are not stored. So the values
+    // are spliced into the document, without parsing either of them.
+    document.back() = ',';
+    document.append(unindexed_values, 1, std::string::npos);
+    return StoreStatus::FOUND;
+}
+
+Option<bool> Collection::validate_unindexed_field(const field & a_field) {
+    if(a_field.index) {
+        return Option<bool>(true);
+    }
+
+    if(a_field.facet || a_field.infix || !a_field.analyzer.empty() || !a_field.separators.empty()) {
+        return Option<bool>(400, "Field `" + a_field.name + "` is not indexed, so it can't be a facet, or have an "
+                                 "infix index or an analyzer.");
+    }
+
+    return Option<bool>(true);
+}
+
 std::string Collection::get_doc_id_key(const std::string & doc_id) {
     return std::to_string(collection_id) + "_" + DOC_ID_PREFIX + "_" + doc_id;
 }
@@ -792,6 +1517,7 @@ std::vector<field> Collection::get_sort_fields() {
 }
 
 std::vector<field> Collection::get_fields() {
+    apply_backfilled_fields();
     return fields;
 }
 
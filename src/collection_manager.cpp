@@ -3,11 +3,47 @@
 #include <vector>
 #include <json.hpp>
 #include "collection_manager.h"
+#include "logger.h"
 
-CollectionManager::CollectionManager() {
+CollectionManager::CollectionManager(): forward_index(false) {
 
 }
 
+nlohmann::json CollectionManager::fields_json(const std::vector<field> & fields) {
+    nlohmann::json fields_json = nlohmann::json::array();
+
+    for(const field & field: fields) {
+        nlohmann::json field_val;
+        field_val[fields::name] = field.name;
+        field_val[fields::type] = field.type;
+        field_val[fields::facet] = field.facet;
+
+        if(field.optional) {
+            field_val[fields::optional] = true;
+        }
+
+        if(!field.analyzer.empty()) {
+            field_val[fields::analyzer] = field.analyzer;
+        }
+
+        if(!field.separators.empty()) {
+            field_val[fields::separators] = field.separators;
+        }
+
+        if(field.infix) {
+            field_val[fields::infix] = true;
+        }
+
+        if(!field.index) {
+            field_val[fields::index] = false;
+        }
+
+        fields_json.push_back(field_val);
+    }
+
+    return fields_json;
+}
+
 Collection* CollectionManager::init_collection(const nlohmann::json & collection_meta,
                                                const uint32_t collection_next_seq_id) {
     std::string this_collection_name = collection_meta[COLLECTION_NAME_KEY].get<std::string>();
@@ -16,7 +52,16 @@ Collection* CollectionManager::init_collection(const nlohmann::json & collection
     nlohmann::json fields_map = collection_meta[COLLECTION_SEARCH_FIELDS_KEY];
 
     for (nlohmann::json::iterator it = fields_map.begin(); it != fields_map.end(); ++it) {
-        fields.push_back({it.value()[fields::name], it.value()[fields::type], it.value()[fields::facet]});
+        const bool optional = it.value().count(fields::optional) != 0 && it.value()[fields::optional].get<bool>();
+        fields.push_back({it.value()[fields::name], it.value()[fields::type], it.value()[fields::facet], optional});
+
+        if(it.value().count(fields::analyzer) != 0) {
+            fields.back().analyzer = it.value()[fields::analyzer].get<std::string>();
+            fields.back().separators = it.value().value(fields::separators, "");
+        }
+
+        fields.back().infix = it.value().count(fields::infix) != 0 && it.value()[fields::infix].get<bool>();
+        fields.back().index = it.value().count(fields::index) == 0 || it.value()[fields::index].get<bool>();
     }
 
     std::string default_sorting_field = collection_meta[COLLECTION_DEFAULT_SORTING_FIELD_KEY].get<std::string>();
@@ -26,7 +71,20 @@ Collection* CollectionManager::init_collection(const nlohmann::json & collection
                                             collection_next_seq_id,
                                             store,
                                             fields,
-                                            default_sorting_field);
+                                            default_sorting_field,
+                                            Collection::DEFAULT_NUM_INDICES,
+                                            forward_index);
+
+    // pinned before the documents are indexed, which then keep the pinned counts up to date
+    if(collection_meta.count(COLLECTION_PINNED_FILTERS_KEY) != 0) {
+        for(const std::string & pinned_filter: collection_meta[COLLECTION_PINNED_FILTERS_KEY]) {
+            Option<uint32_t> pin_op = collection->pin_filter(pinned_filter);
+            if(!pin_op.ok()) {
+                LOG(ERR) << "Could not pin the filter `" << pinned_filter << "` of collection "
+                         << this_collection_name << ": " << pin_op.error();
+            }
+        }
+    }
 
     return collection;
 }
@@ -37,10 +95,11 @@ void CollectionManager::add_to_collections(Collection* collection) {
 }
 
 Option<bool> CollectionManager::init(Store *store, const std::string & auth_key,
-                                     const std::string & search_only_auth_key) {
+                                     const std::string & search_only_auth_key, const bool forward_index) {
     this->store = store;
     this->auth_key = auth_key;
     this->search_only_auth_key = search_only_auth_key;
+    this->forward_index = forward_index;
 
     std::string next_collection_id_str;
     StoreStatus next_coll_id_status = store->get(NEXT_COLLECTION_ID_KEY, next_collection_id_str);
@@ -142,28 +201,60 @@ bool CollectionManager::search_only_auth_key_matches(std::string auth_key_sent)
 }
 
 Option<Collection*> CollectionManager::create_collection(const std::string name, const std::vector<field> & fields,
-                                                         const std::string & default_sorting_field) {
+                                                         const std::string & default_sorting_field,
+                                                         const std::vector<std::string> & pinned_filters) {
     if(store->contains(Collection::get_meta_key(name))) {
         return Option<Collection*>(409, std::string("A collection with name `") + name + "` already exists.");
     }
 
-    nlohmann::json collection_meta;
+    for(size_t i = 0; i < fields.size(); i++) {
+        const field & field = fields[i];
 
-    nlohmann::json fields_json = nlohmann::json::array();;
-    for(const field & field: fields) {
-        nlohmann::json field_val;
-        field_val[fields::name] = field.name;
-        field_val[fields::type] = field.type;
-        field_val[fields::facet] = field.facet;
-        fields_json.push_back(field_val);
+        // fields are addressed by name, so a repeated one could only shadow the first
+        for(size_t j = 0; j < i; j++) {
+            if(fields[j].name == field.name) {
+                return Option<Collection*>(400, "Field `" + field.name + "` is declared more than once in the schema.");
+            }
+        }
+
+        Option<bool> analyzer_op = analyzer::validate(field);
+        if(!analyzer_op.ok()) {
+            return Option<Collection*>(analyzer_op.code(), analyzer_op.error());
+        }
+
+        Option<bool> unindexed_op = Collection::validate_unindexed_field(field);
+        if(!unindexed_op.ok()) {
+            return Option<Collection*>(unindexed_op.code(), unindexed_op.error());
+        }
+
+        if(!field.index && field.name == default_sorting_field) {
+            return Option<Collection*>(400, "The default sorting field `" + field.name + "` must be indexed.");
+        }
     }
 
+    nlohmann::json collection_meta;
+
     collection_meta[COLLECTION_NAME_KEY] = name;
     collection_meta[COLLECTION_ID_KEY] = next_collection_id;
-    collection_meta[COLLECTION_SEARCH_FIELDS_KEY] = fields_json;
+    collection_meta[COLLECTION_SEARCH_FIELDS_KEY] = fields_json(fields);
     collection_meta[COLLECTION_DEFAULT_SORTING_FIELD_KEY] = default_sorting_field;
 
-    Collection* new_collection = new Collection(name, next_collection_id, 0, store, fields, default_sorting_field);
+    if(!pinned_filters.empty()) {
+        collection_meta[COLLECTION_PINNED_FILTERS_KEY] = pinned_filters;
+    }
+
+    Collection* new_collection = new Collection(name, next_collection_id, 0, store, fields, default_sorting_field,
+                                                Collection::DEFAULT_NUM_INDICES, forward_index);
+
+    for(const std::string & pinned_filter: pinned_filters) {
+        Option<uint32_t> pin_op = new_collection->pin_filter(pinned_filter);
+        if(!pin_op.ok()) {
+            delete new_collection;
+            return Option<Collection*>(pin_op.code(), "Error with pinned filter `" + pinned_filter + "`: " +
+                                                      pin_op.error());
+        }
+    }
+
     next_collection_id++;
 
     rocksdb::WriteBatch batch;
@@ -181,6 +272,44 @@ Option<Collection*> CollectionManager::create_collection(const std::string name,
     return Option<Collection*>(new_collection);
 }
 
+Option<bool> CollectionManager::alter_collection(const std::string & collection_name,
+                                                 const std::vector<field> & add_fields,
+                                                 const std::vector<std::string> & drop_fields) {
+    Collection* collection = get_collection(collection_name);
+    if(collection == nullptr) {
+        return Option<bool>(404, "No collection with name `" + collection_name + "` found.");
+    }
+
+    std::string collection_meta_json;
+    StoreStatus status = store->get(Collection::get_meta_key(collection_name), collection_meta_json);
+
+    if(status != StoreStatus::FOUND) {
+        return Option<bool>(500, "Could not read the collection's meta data from on-disk storage.");
+    }
+
+    Option<bool> alter_op = collection->alter_schema(add_fields, drop_fields);
+    if(!alter_op.ok()) {
+        return alter_op;
+    }
+
+    // Fields that are still being backfilled are persisted as well: on a restart, all documents are indexed
+    // from the store again, with the new fields.
+    std::vector<field> fields = collection->get_fields();
+    const std::vector<field> & backfill_fields = collection->get_backfill_fields();
+    fields.insert(fields.end(), backfill_fields.begin(), backfill_fields.end());
+
+    nlohmann::json collection_meta = nlohmann::json::parse(collection_meta_json);
+    collection_meta[COLLECTION_SEARCH_FIELDS_KEY] = fields_json(fields);
+
+    bool write_ok = store->insert(Collection::get_meta_key(collection_name), collection_meta.dump());
+
+    if(!write_ok) {
+        return Option<bool>(500, "Could not write to on-disk storage.");
+    }
+
+    return Option<bool>(true);
+}
+
 Collection* CollectionManager::get_collection(const std::string & collection_name) {
     if(collections.count(collection_name) != 0) {
         return collections.at(collection_name);
@@ -250,6 +379,15 @@ void CollectionManager::set_next_collection_id(uint32_t next_id) {
     next_collection_id = next_id;
 }
 
+size_t CollectionManager::spill_cold_postings(const uint64_t cold_after_ms) {
+    size_t num_bytes = 0;
+    for(auto & name_collection: collections) {
+        num_bytes += name_collection.second->spill_cold_postings(cold_after_ms);
+    }
+
+    return num_bytes;
+}
+
 Store* CollectionManager::get_store() {
     return store;
 }
\ No newline at end of file
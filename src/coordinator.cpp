@@ -0,0 +1,232 @@
+#include "coordinator.h"
+
+#include <map>
+#include <thread>
+#include <limits>
+#include <sstream>
+#include <algorithm>
+#include "http_client.h"
+#include "string_utils.h"
+
+void Coordinator::init(const std::vector<std::string> & nodes, const std::string & api_key) {
+    // not thread safe, so it is done before any request is sent
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    this->nodes = nodes;
+    this->api_key = api_key;
+}
+
+size_t Coordinator::get_num_nodes() const {
+    return nodes.size();
+}
+
+size_t Coordinator::get_owner(const std::string & doc_id) const {
+    // 64-bit FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for(const char c: doc_id) {
+        hash ^= (uint8_t) c;
+        hash *= 1099511628211ULL;
+    }
+
+    return (size_t) (hash % nodes.size());
+}
+
+node_response Coordinator::send(const size_t node, const std::string & method, const std::string & path,
+                                const std::string & body) const {
+    HttpClient client(nodes[node] + path, api_key);
+    node_response response;
+
+    if(method == "POST") {
+        response.status_code = client.post_response(body, response.body);
+    } else if(method == "PUT") {
+        response.status_code = client.put_response(body, response.body);
+    } else if(method == "DELETE") {
+        response.status_code = client.delete_response(response.body);
+    } else {
+        response.status_code = client.get_reponse(response.body);
+    }
+
+    return response;
+}
+
+std::vector<node_response> Coordinator::broadcast(const std::string & method, const std::string & path,
+                                                  const std::string & body) const {
+    std::vector<node_response> responses(nodes.size());
+    std::vector<std::thread> threads;
+
+    for(size_t node = 0; node < nodes.size(); node++) {
+        threads.emplace_back([this, node, &method, &path, &body, &responses]() {
+            responses[node] = send(node, method, path, body);
+        });
+    }
+
+    for(std::thread & thread: threads) {
+        thread.join();
+    }
+
+    return responses;
+}
+
+static void merge_facet_counts(nlohmann::json & facet_result, nlohmann::json & node_facet_result) {
+    if(node_facet_result.value("sampled", false)) {
+        facet_result["sampled"] = true;
+    }
+
+    if(facet_result.count("stats") != 0) {
+        // ranges are in the order they were asked for, so they line up across nodes
+        for(size_t i = 0; i < facet_result["counts"].size() && i < node_facet_result["counts"].size(); i++) {
+            facet_result["counts"][i]["count"] = facet_result["counts"][i]["count"].get<size_t>() +
+                                                 node_facet_result["counts"][i]["count"].get<size_t>();
+        }
+
+        nlohmann::json & stats = facet_result["stats"];
+        const nlohmann::json & node_stats = node_facet_result["stats"];
+        if(node_stats["count"].get<size_t>() == 0) {
+            return ;
+        }
+
+        if(stats["count"].get<size_t>() == 0) {
+            stats = node_stats;
+            return ;
+        }
+
+        stats["count"] = stats["count"].get<size_t>() + node_stats["count"].get<size_t>();
+        stats["min"] = std::min(stats["min"].get<double>(), node_stats["min"].get<double>());
+        stats["max"] = std::max(stats["max"].get<double>(), node_stats["max"].get<double>());
+        stats["sum"] = stats["sum"].get<double>() + node_stats["sum"].get<double>();
+        stats["avg"] = stats["sum"].get<double>() / stats["count"].get<size_t>();
+        return ;
+    }
+
+    std::map<std::string, size_t> value_counts;
+    for(const nlohmann::json * counts: {&facet_result["counts"], &node_facet_result["counts"]}) {
+        for(const nlohmann::json & value_count: *counts) {
+            value_counts[value_count["value"].get<std::string>()] += value_count["count"].get<size_t>();
+        }
+    }
+
+    facet_result["counts"] = nlohmann::json::array();
+    for(const auto & value_count: value_counts) {
+        facet_result["counts"].push_back({{"value", value_count.first}, {"count", value_count.second}});
+    }
+}
+
+nlohmann::json Coordinator::merge_search_results(std::vector<nlohmann::json> & node_results, const size_t per_page,
+                                                 const size_t page) {
+    nlohmann::json result = nlohmann::json::object();
+    result["found"] = 0;
+
+    std::vector<nlohmann::json> hits;
+
+    for(nlohmann::json & node_result: node_results) {
+        result["found"] = result["found"].get<size_t>() + node_result["found"].get<size_t>();
+
+        for(nlohmann::json & hit: node_result["hits"]) {
+            hits.push_back(std::move(hit));
+        }
+
+        if(node_result.count("search_plans") != 0) {
+            for(nlohmann::json & search_plan: node_result["search_plans"]) {
+                result["search_plans"].push_back(std::move(search_plan));
+            }
+        }
+
+        if(node_result.count("facet_counts") == 0) {
+            continue;
+        }
+
+        if(result.count("facet_counts") == 0) {
+            result["facet_counts"] = std::move(node_result["facet_counts"]);
+            continue;
+        }
+
+        for(size_t i = 0; i < result["facet_counts"].size(); i++) {
+            merge_facet_counts(result["facet_counts"][i], node_result["facet_counts"][i]);
+        }
+    }
+
+    // like a collection's shards, ties go to the earlier node
+    std::stable_sort(hits.begin(), hits.end(), [](const nlohmann::json & a, const nlohmann::json & b) {
+        return b.value("sort_keys", nlohmann::json()) < a.value("sort_keys", nlohmann::json());
+    });
+
+    result["hits"] = nlohmann::json::array();
+    for(size_t i = (page - 1) * per_page; i < hits.size() && i < page * per_page; i++) {
+        hits[i].erase("sort_keys");
+        result["hits"].push_back(std::move(hits[i]));
+    }
+
+    if(result.count("facet_counts") == 0) {
+        return result;
+    }
+
+    // keep only top 10 facets
+    for(nlohmann::json & facet_result: result["facet_counts"]) {
+        if(facet_result.count("stats") != 0) {
+            facet_result.erase("auto_bounds");
+            continue;
+        }
+
+        nlohmann::json & counts = facet_result["counts"];
+        std::vector<nlohmann::json> value_counts(counts.begin(), counts.end());
+        std::stable_sort(value_counts.begin(), value_counts.end(),
+                         [](const nlohmann::json & a, const nlohmann::json & b) {
+                             return a["count"].get<size_t>() > b["count"].get<size_t>();
+                         });
+
+        counts = nlohmann::json::array();
+        for(size_t i = 0; i < std::min((size_t) 10, value_counts.size()); i++) {
+            counts.push_back(std::move(value_counts[i]));
+        }
+    }
+
+    return result;
+}
+
+bool Coordinator::resolve_auto_facet_ranges(const std::vector<nlohmann::json> & node_results,
+                                            std::vector<std::string> & facet_fields) {
+    bool resolved = false;
+
+    // facet results are in the order of the facet fields
+    for(size_t i = 0; i < facet_fields.size(); i++) {
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+        bool same_bounds = true;
+        size_t num_bounded_nodes = 0;
+
+        for(const nlohmann::json & node_result: node_results) {
+            if(node_result.count("facet_counts") == 0 || i >= node_result["facet_counts"].size() ||
+               node_result["facet_counts"][i].count("auto_bounds") == 0) {
+                // a node without values in the field has no auto ranges of its own
+                continue;
+            }
+
+            num_bounded_nodes++;
+
+            const nlohmann::json & bounds = node_result["facet_counts"][i]["auto_bounds"];
+            const double node_min = bounds["min"].get<double>();
+            const double node_max = bounds["max"].get<double>();
+
+            if(min <= max && (node_min != min || node_max != max)) {
+                same_bounds = false;
+            }
+
+            min = std::min(min, node_min);
+            max = std::max(max, node_max);
+        }
+
+        if(num_bounded_nodes == 0 || (same_bounds && num_bounded_nodes == node_results.size())) {
+            continue;
+        }
+
+        // with all their digits, so that every node reads back the same bounds
+        std::stringstream facet_field;
+        facet_field.precision(std::numeric_limits<double>::max_digits10);
+        facet_field << StringUtils::trim(facet_fields[i]) << "(auto " << min << ":" << max << ")";
+
+        facet_fields[i] = facet_field.str();
+        resolved = true;
+    }
+
+    return resolved;
+}
@@ -0,0 +1,243 @@
+#include "for_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FOR_DECODER_X86
+#include <immintrin.h>
+#endif
+
+// Reads the value at `index`. 8 bytes are read wherever the payload allows it, so that a value spanning up to
+// 5 bytes can be shifted out of a single word.
+static inline uint32_t extract_value(const uint8_t* payload, const uint32_t payload_len, const uint32_t bits,
+                                     const uint64_t mask, const uint32_t index) {
+    const uint64_t bit_offset = (uint64_t) index * bits;
+    const uint32_t byte_offset = (uint32_t) (bit_offset >> 3);
+
+    uint64_t word = 0;
+    if(byte_offset + 8 <= payload_len) {
+        memcpy(&word, payload + byte_offset, 8);
+    } else {
+        memcpy(&word, payload + byte_offset, payload_len - byte_offset);
+    }
+
+    return (uint32_t) ((word >> (bit_offset & 7)) & mask);
+}
+
+static inline uint64_t value_mask(const uint32_t bits) {
+    return (bits == 32) ? 0xFFFFFFFFULL : ((1ULL << bits) - 1);
+}
+
+void ForDecoder::unpack_scalar(const uint8_t* payload, const uint32_t payload_len, const uint32_t base,
+                               const uint32_t bits, const uint32_t start, const uint32_t n, uint32_t* out) {
+    if(bits == 0) {
+        std::fill_n(out, n, base);
+        return ;
+    }
+
+    const uint64_t mask = value_mask(bits);
+
+    for(uint32_t i = 0; i < n; i++) {
+        out[i] = base + extract_value(payload, payload_len, bits, mask, start + i);
+    }
+}
+
+#ifdef FOR_DECODER_X86
+
+// Handles widths of up to 24 bits: 4 values are shuffled into their own 32-bit lanes and each lane is shifted left
+// by (7 - bit offset) through a multiplication, since SSE has no per-lane variable shifts. The values then all sit
+// at bit 7 of their lanes. The byte layout of a group of 4 values repeats every 8 values (8 values take up exactly
+// `bits` bytes), so only 2 shuffle patterns are needed.
+__attribute__((target("sse4.1")))
+void ForDecoder::unpack_sse4(const uint8_t* payload, const uint32_t payload_len, const uint32_t base,
+                             const uint32_t bits, const uint32_t start, const uint32_t n, uint32_t* out) {
+    if(bits == 0 || bits > 24) {
+        return unpack_scalar(payload, payload_len, base, bits, start, n, out);
+    }
+
+    __m128i shuffles[2];
+    __m128i multipliers[2];
+
+    for(uint32_t p = 0; p < 2; p++) {
+        const uint64_t first_bit = (uint64_t) (start + p * 4) * bits;
+        uint8_t shuffle[16];
+        uint32_t multiplier[4];
+
+        for(uint32_t k = 0; k < 4; k++) {
+            const uint64_t bit_offset = first_bit + (uint64_t) k * bits;
+            const uint8_t relative_byte = (uint8_t) ((bit_offset >> 3) - (first_bit >> 3));
+            for(uint8_t m = 0; m < 4; m++) {
+                shuffle[k * 4 + m] = relative_byte + m;
+            }
+            multiplier[k] = 1u << (7 - (bit_offset & 7));
+        }
+
+        shuffles[p] = _mm_loadu_si128((const __m128i *) shuffle);
+        multipliers[p] = _mm_loadu_si128((const __m128i *) multiplier);
+    }
+
+    const __m128i mask = _mm_set1_epi32((int) value_mask(bits));
+    const __m128i base_v = _mm_set1_epi32((int) base);
+
+    uint32_t i = 0;
+    uint32_t p = 0;
+
+    while(i + 4 <= n) {
+        const uint32_t byte_offset = (uint32_t) (((uint64_t) (start + i) * bits) >> 3);
+        if(byte_offset + 16 > payload_len) {
+            break;
+        }
+
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (payload + byte_offset)), shuffles[p]);
+        v = _mm_srli_epi32(_mm_mullo_epi32(v, multipliers[p]), 7);
+        v = _mm_add_epi32(_mm_and_si128(v, mask), base_v);
+        _mm_storeu_si128((__m128i *) (out + i), v);
+
+        i += 4;
+        p ^= 1;
+    }
+
+    unpack_scalar(payload, payload_len, base, bits, start + i, n - i, out + i);
+}
+
+// Gathers the 8 bytes that each value starts in and shifts every 64-bit lane by its own bit offset. Works for all
+// widths, since a value never spans more than 5 bytes.
+__attribute__((target("avx2")))
+void ForDecoder::unpack_avx2(const uint8_t* payload, const uint32_t payload_len, const uint32_t base,
+                             const uint32_t bits, const uint32_t start, const uint32_t n, uint32_t* out) {
+    if(bits == 0 || (uint64_t) (start + n) * bits >= (1ULL << 32)) {
+        // bit offsets are computed in 32-bit lanes
+        return unpack_scalar(payload, payload_len, base, bits, start, n, out);
+    }
+
+    const __m256i mask = _mm256_set1_epi64x((long long) value_mask(bits));
+    const __m128i base_v = _mm_set1_epi32((int) base);
+    const __m128i bits_v = _mm_set1_epi32((int) bits);
+    const __m128i seven = _mm_set1_epi32(7);
+    const __m256i low_dwords = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+
+    __m128i indices = _mm_add_epi32(_mm_set1_epi32((int) start), _mm_setr_epi32(0, 1, 2, 3));
+    const __m128i four = _mm_set1_epi32(4);
+
+    uint32_t i = 0;
+
+    while(i + 4 <= n) {
+        const uint32_t last_byte_offset = (uint32_t) (((uint64_t) (start + i + 3) * bits) >> 3);
+        if(last_byte_offset + 8 > payload_len) {
+            break;
+        }
+
+        const __m128i bit_offsets = _mm_mullo_epi32(indices, bits_v);
+        const __m128i byte_offsets = _mm_srli_epi32(bit_offsets, 3);
+        const __m256i shifts = _mm256_cvtepu32_epi64(_mm_and_si128(bit_offsets, seven));
+
+        __m256i words = _mm256_i32gather_epi64((const long long *) payload, byte_offsets, 1);
+        words = _mm256_and_si256(_mm256_srlv_epi64(words, shifts), mask);
+
+        const __m128i values = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(words, low_dwords));
+        _mm_storeu_si128((__m128i *) (out + i), _mm_add_epi32(values, base_v));
+
+        indices = _mm_add_epi32(indices, four);
+        i += 4;
+    }
+
+    unpack_scalar(payload, payload_len, base, bits, start + i, n - i, out + i);
+}
+
+bool ForDecoder::has_sse4() {
+    static const bool supported = __builtin_cpu_supports("sse4.1");
+    return supported;
+}
+
+bool ForDecoder::has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+#else
+
+void ForDecoder::unpack_sse4(const uint8_t* payload, const uint32_t payload_len, const uint32_t base,
+                             const uint32_t bits, const uint32_t start, const uint32_t n, uint32_t* out) {
+    unpack_scalar(payload, payload_len, base, bits, start, n, out);
+}
+
+void ForDecoder::unpack_avx2(const uint8_t* payload, const uint32_t payload_len, const uint32_t base,
+                             const uint32_t bits, const uint32_t start, const uint32_t n, uint32_t* out) {
+    unpack_scalar(payload, payload_len, base, bits, start, n, out);
+}
+
+bool ForDecoder::has_sse4() {
+    return false;
+}
+
+bool ForDecoder::has_avx2() {
+    return false;
+}
+
+#endif
+
+ForDecoder::unpack_fn ForDecoder::get_unpacker() {
+    static const unpack_fn unpacker = has_avx2() ? &ForDecoder::unpack_avx2 :
+                                      has_sse4() ? &ForDecoder::unpack_sse4 : &ForDecoder::unpack_scalar;
+    return unpacker;
+}
+
+void ForDecoder::uncompress(const uint8_t* in, const uint32_t length, uint32_t* out) {
+    if(length == 0) {
+        return ;
+    }
+
+    uint32_t base;
+    memcpy(&base, in, sizeof(base));
+    const uint32_t bits = in[4];
+
+    get_unpacker()(in + HEADER_LENGTH, payload_length(length, bits), base, bits, 0, length, out);
+}
+
+size_t ForDecoder::intersect(const uint8_t* in, const uint32_t length, const uint32_t* ids, const size_t ids_len,
+                             uint32_t* out) {
+    if(length == 0 || ids_len == 0) {
+        return 0;
+    }
+
+    uint32_t base;
+    memcpy(&base, in, sizeof(base));
+    const uint32_t bits = in[4];
+    const uint8_t* payload = in + HEADER_LENGTH;
+    const uint32_t payload_len = payload_length(length, bits);
+    const unpack_fn unpack = get_unpacker();
+
+    const uint32_t BLOCK_SIZE = 128;
+    uint32_t block[BLOCK_SIZE];
+
+    size_t id_index = 0;
+    size_t out_len = 0;
+
+    for(uint32_t block_start = 0; block_start < length && id_index < ids_len; block_start += BLOCK_SIZE) {
+        const uint32_t block_len = std::min(BLOCK_SIZE, length - block_start);
+
+        uint32_t block_last;
+        unpack_scalar(payload, payload_len, base, bits, block_start + block_len - 1, 1, &block_last);
+        if(block_last < ids[id_index]) {
+            continue;
+        }
+
+        unpack(payload, payload_len, base, bits, block_start, block_len, block);
+
+        uint32_t block_index = 0;
+        while(block_index < block_len && id_index < ids_len) {
+            if(block[block_index] < ids[id_index]) {
+                block_index++;
+            } else if(block[block_index] > ids[id_index]) {
+                id_index++;
+            } else {
+                out[out_len++] = block[block_index];
+                block_index++;
+                id_index++;
+            }
+        }
+    }
+
+    return out_len;
+}
@@ -2,6 +2,7 @@
 #include "http_server.h"
 #include "string_utils.h"
 #include <regex>
+#include <algorithm>
 #include <thread>
 #include <signal.h>
 #include <h2o.h>
@@ -220,7 +221,9 @@ const char* HttpServer::get_status_reason(uint32_t status_code) {
         case 404: return "Not Found";
         case 409: return "Conflict";
         case 422: return "Unprocessable Entity";
+        case 429: return "Too Many Requests";
         case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
         default: return "";
     }
 }
@@ -266,7 +269,6 @@ int HttpServer::catch_all_handler(h2o_handler_t *_self, h2o_req_t *req) {
 
     std::string query_str(query.base, query.len);
     std::map<std::string, std::string> query_map = parse_query(query_str);
-    const std::string & req_body = std::string(req->entity.base, req->entity.len);
 
     // Extract auth key from header. If that does not exist, look for a GET parameter.
     std::string auth_key_from_header = "";
@@ -279,6 +281,13 @@ int HttpServer::catch_all_handler(h2o_handler_t *_self, h2o_req_t *req) {
         auth_key_from_header = query_map[AUTH_HEADER];
     }
 
+    std::string accept = "";
+    ssize_t accept_header_cursor = h2o_find_header(&req->headers, H2O_TOKEN_ACCEPT, -1);
+    if(accept_header_cursor != -1) {
+        h2o_iovec_t & slot = req->headers.entries[accept_header_cursor].value;
+        accept = std::string(slot.base, slot.len);
+    }
+
     // Handle CORS
     if(self->http_server->cors_enabled) {
         h2o_add_header_by_str(&req->pool, &req->res.headers, H2O_STRLIT("access-control-allow-origin"),
@@ -347,9 +356,29 @@ int HttpServer::catch_all_handler(h2o_handler_t *_self, h2o_req_t *req) {
                 }
             }
 
-            http_req* request = new http_req{req, query_map, req_body};
             http_res* response = new http_res();
             response->server = self->http_server;
+
+            if(rpath.batched) {
+                // the body is handed over in batches, rather than copied as a whole, all within this turn: h2o frees
+                // the body along with the request when the client goes away, which can happen on any later turn
+                http_req* request = new http_req{req, query_map, "", accept, true, nullptr};
+                size_t offset = 0;
+
+                while(request->body_pending) {
+                    const size_t batch_len = std::min(REQUEST_BODY_BATCH_SIZE, req->entity.len - offset);
+                    request->body.assign(req->entity.base + offset, batch_len);
+                    offset += batch_len;
+                    request->body_pending = (offset < req->entity.len);
+                    (rpath.handler)(*request, *response);
+                }
+
+                self->http_server->send_response(request, response);
+                return 0;
+            }
+
+            http_req* request = new http_req{req, query_map, std::string(req->entity.base, req->entity.len), accept,
+                                             false, nullptr};
             (rpath.handler)(*request, *response);
 
             if(!rpath.async) {
@@ -382,10 +411,13 @@ void HttpServer::send_response(http_req* request, const http_res* response) {
     h2o_req_t* req = request->_req;
     h2o_generator_t generator = {NULL, NULL};
 
-    h2o_iovec_t body = h2o_strdup(&req->pool, response->body.c_str(), SIZE_MAX);
+    // the body is not necessarily text, so it is copied by its size
+    h2o_iovec_t body = h2o_strdup(&req->pool, response->body.data(), response->body.size());
+    h2o_iovec_t content_type = h2o_strdup(&req->pool, response->content_type_header.data(),
+                                          response->content_type_header.size());
     req->res.status = response->status_code;
     req->res.reason = get_status_reason(response->status_code);
-    h2o_add_header(&req->pool, &req->res.headers, H2O_TOKEN_CONTENT_TYPE, NULL, H2O_STRLIT("application/json; charset=utf-8"));
+    h2o_add_header(&req->pool, &req->res.headers, H2O_TOKEN_CONTENT_TYPE, NULL, content_type.base, content_type.len);
     h2o_start_response(req, &generator);
     h2o_send(req, &body, 1, H2O_SEND_STATE_FINAL);
 
@@ -457,28 +489,29 @@ void HttpServer::set_auth_handler(bool (*handler)(const route_path & rpath, cons
 void HttpServer::get(const std::string & path, void (*handler)(http_req &, http_res &), bool async) {
     std::vector<std::string> path_parts;
     StringUtils::split(path, path_parts, "/");
-    route_path rpath = {"GET", path_parts, handler, async};
+    route_path rpath = {"GET", path_parts, handler, async, false};
     routes.push_back(rpath);
 }
 
-void HttpServer::post(const std::string & path, void (*handler)(http_req &, http_res &), bool async) {
+void HttpServer::post(const std::string & path, void (*handler)(http_req &, http_res &), bool async,
+                      bool batched) {
     std::vector<std::string> path_parts;
     StringUtils::split(path, path_parts, "/");
-    route_path rpath = {"POST", path_parts, handler, async};
+    route_path rpath = {"POST", path_parts, handler, async, batched};
     routes.push_back(rpath);
 }
 
 void HttpServer::put(const std::string & path, void (*handler)(http_req &, http_res &), bool async) {
     std::vector<std::string> path_parts;
     StringUtils::split(path, path_parts, "/");
-    route_path rpath = {"PUT", path_parts, handler, async};
+    route_path rpath = {"PUT", path_parts, handler, async, false};
     routes.push_back(rpath);
 }
 
 void HttpServer::del(const std::string & path, void (*handler)(http_req &, http_res &), bool async) {
     std::vector<std::string> path_parts;
     StringUtils::split(path, path_parts, "/");
-    route_path rpath = {"DELETE", path_parts, handler, async};
+    route_path rpath = {"DELETE", path_parts, handler, async, false};
     routes.push_back(rpath);
 }
 
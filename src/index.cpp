@@ -1,6 +1,8 @@
 #include "index.h"
 
 #include <numeric>
+#include <cmath>
+#include <random>
 #include <chrono>
 #include <unordered_map>
 #include <array_utils.h>
@@ -8,27 +10,73 @@
 #include <string_utils.h>
 #include <art.h>
 #include "logger.h"
+#include "search_scheduler.h"
 
 Index::Index(const std::string name, std::unordered_map<std::string, field> search_schema,
-             std::unordered_map<std::string, field> facet_schema, std::unordered_map<std::string, field> sort_schema):
-        name(name), search_schema(search_schema), facet_schema(facet_schema), sort_schema(sort_schema) {
+             std::unordered_map<std::string, field> facet_schema, std::unordered_map<std::string, field> sort_schema,
+             const bool forward_index_enabled):
+        name(name), forward_index_enabled(forward_index_enabled), num_scored_docs(0), postings_store(nullptr) {
 
-    for(const auto pair: search_schema) {
+    size_t num_fields = 0;
+    for(const auto & pair: search_schema) {
+        num_fields = std::max(num_fields, (size_t) pair.second.id + 1);
+    }
+
+    search_index.resize(num_fields, nullptr);
+    facet_index.resize(num_fields);
+    numeric_facet_values.resize(num_fields);
+    sort_index.resize(num_fields, nullptr);
+    search_stats.resize(num_fields);
+    postings_accessed_ms.resize(num_fields, postings_clock_ms());
+    postings_spilled.resize(num_fields, false);
+    num_spilled_leaves.resize(num_fields, 0);
+
+    for(const auto & pair: search_schema) {
+        const field & a_field = pair.second;
         art_tree *t = new art_tree;
         art_tree_init(t);
-        search_index.emplace(pair.first, t);
+        search_index[a_field.id] = t;
+        field_ids.emplace(a_field.name, a_field.id);
+        schema.push_back(a_field);
+    }
+
+    // dense and in id order, so that indexing walks the per-field structures sequentially
+    std::sort(schema.begin(), schema.end(), [](const field & a, const field & b) { return a.id < b.id; });
+
+    for(const field & a_field: schema) {
+        field_indexers.push_back(get_field_indexer(a_field.type_id));
+        field_key_extractors.push_back(get_field_keys(a_field.type_id));
+        analyzers.push_back(analyzer::for_field(a_field));
     }
 
-    for(const auto pair: facet_schema) {
-        facet_value fvalue;
-        facet_index.emplace(pair.first, fvalue);
+    facet_value_index.resize(num_fields, nullptr);
+    infix_indices.resize(num_fields, nullptr);
+
+    for(const field & a_field: schema) {
+        if(a_field.infix) {
+            infix_indices[a_field.id] = new infix_index;
+        }
+    }
+
+    for(const auto & pair: facet_schema) {
+        facet_field_ids.push_back(pair.second.id);
+
+        if(pair.second.is_string()) {
+            art_tree *t = new art_tree;
+            art_tree_init(t);
+            facet_value_index[pair.second.id] = t;
+        }
     }
 
-    for(const auto pair: sort_schema) {
-        spp::sparse_hash_map<uint32_t, number_t> * doc_to_score = new spp::sparse_hash_map<uint32_t, number_t>();
-        sort_index.emplace(pair.first, doc_to_score);
+    for(const auto & pair: sort_schema) {
+        sort_index[pair.second.id] = new numeric_column(pair.second.is_single_float());
+        sort_field_ids.push_back(pair.second.id);
     }
 
+    // the sort index of the first sort field holds every document, so it can't be that of an optional field
+    std::stable_partition(sort_field_ids.begin(), sort_field_ids.end(),
+                          [this](const uint32_t field_id) { return !schema[field_id].optional; });
+
     num_documents = 0;
 
     ready = false;
@@ -37,84 +85,65 @@ Index::Index(const std::string name, std::unordered_map<std::string, field> sear
 }
 
 Index::~Index() {
-    for(auto & name_tree: search_index) {
-        art_tree_destroy(name_tree.second);
-        delete name_tree.second;
-        name_tree.second = nullptr;
+    for(art_tree* & t: search_index) {
+        if(t != nullptr) {
+            art_tree_destroy(t);
+            delete t;
+            t = nullptr;
+        }
     }
 
     search_index.clear();
 
-    for(auto & name_map: sort_index) {
-        delete name_map.second;
-        name_map.second = nullptr;
+    for(art_tree* & t: facet_value_index) {
+        if(t != nullptr) {
+            art_tree_destroy(t);
+            delete t;
+            t = nullptr;
+        }
+    }
+
+    for(infix_index* & infix: infix_indices) {
+        delete infix;
+        infix = nullptr;
+    }
+
+    for(auto & doc_to_score: sort_index) {
+        delete doc_to_score;
+        doc_to_score = nullptr;
     }
 
     sort_index.clear();
 }
 
 Option<uint32_t> Index::index_in_memory(const nlohmann::json &document, uint32_t seq_id, int32_t points) {
-    // assumes that validation has already been done
-    for(const std::pair<std::string, field> & field_pair: search_schema) {
-        const std::string & field_name = field_pair.first;
-        art_tree *t = search_index.at(field_name);
-
-        if(field_pair.second.type == field_types::STRING) {
-            const std::string & text = document[field_name];
-            index_string_field(text, points, t, seq_id, field_pair.second.is_facet());
-        } else if(field_pair.second.type == field_types::INT32) {
-            uint32_t value = document[field_name];
-            index_int32_field(value, points, t, seq_id);
-        } else if(field_pair.second.type == field_types::INT64) {
-            uint64_t value = document[field_name];
-            index_int64_field(value, points, t, seq_id);
-        } else if(field_pair.second.type == field_types::FLOAT) {
-            float value = document[field_name];
-            index_float_field(value, points, t, seq_id);
-        } else if(field_pair.second.type == field_types::BOOL) {
-            bool value = document[field_name];
-            index_bool_field(value, points, t, seq_id);
-        } else if(field_pair.second.type == field_types::STRING_ARRAY) {
-            std::vector<std::string> strings = document[field_name];
-            index_string_array_field(strings, points, t, seq_id, field_pair.second.is_facet());
-        } else if(field_pair.second.type == field_types::INT32_ARRAY) {
-            std::vector<int32_t> values = document[field_name];
-            index_int32_array_field(values, points, t, seq_id);
-        } else if(field_pair.second.type == field_types::INT64_ARRAY) {
-            std::vector<int64_t> values = document[field_name];
-            index_int64_array_field(values, points, t, seq_id);
-        } else if(field_pair.second.type == field_types::FLOAT_ARRAY) {
-            std::vector<float> values = document[field_name];
-            index_float_array_field(values, points, t, seq_id);
-        } else if(field_pair.second.type == field_types::BOOL_ARRAY) {
-            std::vector<bool> values = document[field_name];
-            index_bool_array_field(values, points, t, seq_id);
-        }
-
-        // add numerical values automatically into sort index
-        if(field_pair.second.type == field_types::INT32 || field_pair.second.type == field_types::INT64 ||
-                field_pair.second.type == field_types::FLOAT || field_pair.second.type == field_types::BOOL) {
-            spp::sparse_hash_map<uint32_t, number_t> *doc_to_score = sort_index.at(field_pair.first);
-
-            if(document[field_pair.first].is_number_integer()) {
-                doc_to_score->emplace(seq_id, document[field_pair.first].get<int64_t>());
-            } else if(document[field_pair.first].is_number_float()) {
-                doc_to_score->emplace(seq_id, document[field_pair.first].get<float>());
-            } else if(document[field_pair.first].is_boolean()) {
-                doc_to_score->emplace(seq_id, (int64_t) document[field_pair.first].get<bool>());
-            }
+    std::unique_lock<std::mutex> lock(write_mutex);
+    load_document_leaves(document);
+
+    // assumes that validation has already been done: only optional fields can be missing
+    for(size_t i = 0; i < schema.size(); i++) {
+        const field & a_field = schema[i];
+        const auto value_it = document.find(a_field.name);
+        if(value_it != document.end()) {
+            (this->*field_indexers[i])(*value_it, a_field, points, seq_id);
         }
     }
 
-    for(const std::pair<std::string, field> & field_pair: facet_schema) {
-        const std::string & field_name = field_pair.first;
-        facet_value & fvalue = facet_index.at(field_name);
-        if(field_pair.second.type == field_types::STRING) {
-            const std::string & value = document[field_name];
-            fvalue.index_values(seq_id, { value });
-        } else if(field_pair.second.type == field_types::STRING_ARRAY) {
-            const std::vector<std::string> & values = document[field_name];
-            fvalue.index_values(seq_id, values);
+    if(forward_index_enabled) {
+        index_forward(document, seq_id);
+    }
+
+    for(pinned_filter & pinned: pinned_filters) {
+        bool matches = true;
+        for(const filter & a_filter: pinned.filters) {
+            if(!doc_matches_filter(a_filter, seq_id)) {
+                matches = false;
+                break;
+            }
+        }
+
+        if(matches && pinned.doc_ids.insert(seq_id).second) {
+            count_pinned_values(pinned, seq_id, true, facet_field_ids);
         }
     }
 
@@ -122,6 +151,282 @@ Option<uint32_t> Index::index_in_memory(const nlohmann::json &document, uint32_t
     return Option<>(200);
 }
 
+template <>
+void Index::index_field<field_type_t::STRING>(const nlohmann::json & value, const field & a_field,
+                                              const uint32_t score, const uint32_t seq_id) {
+    const std::string & text = value.get_ref<const std::string &>();
+    search_stats[a_field.id].num_postings += index_string_field(text, score, search_index[a_field.id], seq_id,
+                                                               analyzers[a_field.id], infix_indices[a_field.id]);
+
+    if(a_field.facet) {
+        index_facet_values(a_field, seq_id, { text });
+    }
+}
+
+template <>
+void Index::index_field<field_type_t::INT32>(const nlohmann::json & value, const field & a_field,
+                                             const uint32_t score, const uint32_t seq_id) {
+    const int32_t int_value = value.get<int32_t>();
+    index_int32_field(int_value, score, search_index[a_field.id], seq_id);
+    search_stats[a_field.id].num_postings++;
+
+    // add numerical values automatically into sort index
+    sort_index[a_field.id]->set(seq_id, (int64_t) int_value);
+
+    if(a_field.facet) {
+        numeric_facet_values[a_field.id][int_value] += 1;
+    }
+}
+
+template <>
+void Index::index_field<field_type_t::INT64>(const nlohmann::json & value, const field & a_field,
+                                             const uint32_t score, const uint32_t seq_id) {
+    const int64_t int_value = value.get<int64_t>();
+    index_int64_field(int_value, score, search_index[a_field.id], seq_id);
+    search_stats[a_field.id].num_postings++;
+    sort_index[a_field.id]->set(seq_id, int_value);
+
+    if(a_field.facet) {
+        numeric_facet_values[a_field.id][int_value] += 1;
+    }
+}
+
+template <>
+void Index::index_field<field_type_t::FLOAT>(const nlohmann::json & value, const field & a_field,
+                                             const uint32_t score, const uint32_t seq_id) {
+    // integers are allowed in a float field
+    const float float_value = value.get<float>();
+    index_float_field(float_value, score, search_index[a_field.id], seq_id);
+    search_stats[a_field.id].num_postings++;
+    sort_index[a_field.id]->set(seq_id, float_value);
+
+    if(a_field.facet) {
+        numeric_facet_values[a_field.id][float_value] += 1;
+    }
+}
+
+template <>
+void Index::index_field<field_type_t::BOOL>(const nlohmann::json & value, const field & a_field,
+                                            const uint32_t score, const uint32_t seq_id) {
+    const bool bool_value = value.get<bool>();
+    index_bool_field(bool_value, score, search_index[a_field.id], seq_id);
+    search_stats[a_field.id].num_postings++;
+    sort_index[a_field.id]->set(seq_id, (int64_t) bool_value);
+}
+
+template <>
+void Index::index_field<field_type_t::STRING_ARRAY>(const nlohmann::json & value, const field & a_field,
+                                                    const uint32_t score, const uint32_t seq_id) {
+    const std::vector<std::string> & strings = value.get<std::vector<std::string>>();
+    search_stats[a_field.id].num_postings += index_string_array_field(strings, score, search_index[a_field.id],
+                                                                     seq_id, analyzers[a_field.id],
+                                                                     infix_indices[a_field.id]);
+
+    if(a_field.facet) {
+        index_facet_values(a_field, seq_id, strings);
+    }
+}
+
+template <>
+void Index::index_field<field_type_t::INT32_ARRAY>(const nlohmann::json & value, const field & a_field,
+                                                   const uint32_t score, const uint32_t seq_id) {
+    const std::vector<int32_t> & values = value.get<std::vector<int32_t>>();
+    index_int32_array_field(values, score, search_index[a_field.id], seq_id);
+    search_stats[a_field.id].num_postings += values.size();
+}
+
+template <>
+void Index::index_field<field_type_t::INT64_ARRAY>(const nlohmann::json & value, const field & a_field,
+                                                   const uint32_t score, const uint32_t seq_id) {
+    const std::vector<int64_t> & values = value.get<std::vector<int64_t>>();
+    index_int64_array_field(values, score, search_index[a_field.id], seq_id);
+    search_stats[a_field.id].num_postings += values.size();
+}
+
+template <>
+void Index::index_field<field_type_t::FLOAT_ARRAY>(const nlohmann::json & value, const field & a_field,
+                                                   const uint32_t score, const uint32_t seq_id) {
+    const std::vector<float> & values = value.get<std::vector<float>>();
+    index_float_array_field(values, score, search_index[a_field.id], seq_id);
+    search_stats[a_field.id].num_postings += values.size();
+}
+
+template <>
+void Index::index_field<field_type_t::BOOL_ARRAY>(const nlohmann::json & value, const field & a_field,
+                                                  const uint32_t score, const uint32_t seq_id) {
+    const std::vector<bool> & values = value.get<std::vector<bool>>();
+    index_bool_array_field(values, score, search_index[a_field.id], seq_id);
+    search_stats[a_field.id].num_postings += values.size();
+}
+
+template <>
+void Index::index_field<field_type_t::UNKNOWN>(const nlohmann::json & value, const field & a_field,
+                                               const uint32_t score, const uint32_t seq_id) {
+
+}
+
+Index::field_indexer_t Index::get_field_indexer(const field_type_t type) {
+    switch(type) {
+        case field_type_t::STRING: return &Index::index_field<field_type_t::STRING>;
+        case field_type_t::INT32: return &Index::index_field<field_type_t::INT32>;
+        case field_type_t::INT64: return &Index::index_field<field_type_t::INT64>;
+        case field_type_t::FLOAT: return &Index::index_field<field_type_t::FLOAT>;
+        case field_type_t::BOOL: return &Index::index_field<field_type_t::BOOL>;
+        case field_type_t::STRING_ARRAY: return &Index::index_field<field_type_t::STRING_ARRAY>;
+        case field_type_t::INT32_ARRAY: return &Index::index_field<field_type_t::INT32_ARRAY>;
+        case field_type_t::INT64_ARRAY: return &Index::index_field<field_type_t::INT64_ARRAY>;
+        case field_type_t::FLOAT_ARRAY: return &Index::index_field<field_type_t::FLOAT_ARRAY>;
+        case field_type_t::BOOL_ARRAY: return &Index::index_field<field_type_t::BOOL_ARRAY>;
+        default: return &Index::index_field<field_type_t::UNKNOWN>;
+    }
+}
+
+template <>
+void Index::field_keys<field_type_t::STRING>(const nlohmann::json & value, const field & a_field,
+                                             std::vector<std::string> & keys) const {
+    analyzers[a_field.id].analyze(value.get_ref<const std::string &>(), keys);
+    for(auto & key: keys) {
+        key.push_back('\0');  // string keys are stored along with the terminating \0 char
+    }
+}
+
+template <>
+void Index::field_keys<field_type_t::STRING_ARRAY>(const nlohmann::json & value, const field & a_field,
+                                                   std::vector<std::string> & keys) const {
+    for(const nlohmann::json & str: value) {
+        std::vector<std::string> str_keys;
+        field_keys<field_type_t::STRING>(str, a_field, str_keys);
+        keys.insert(keys.end(), std::make_move_iterator(str_keys.begin()), std::make_move_iterator(str_keys.end()));
+    }
+}
+
+template <>
+void Index::field_keys<field_type_t::INT32>(const nlohmann::json & value, const field & a_field,
+                                            std::vector<std::string> & keys) const {
+    const int KEY_LEN = 8;
+    unsigned char key[KEY_LEN];
+    encode_int32(value.get<int32_t>(), key);
+    keys.push_back(std::string((char*)key, KEY_LEN));
+}
+
+template <>
+void Index::field_keys<field_type_t::INT64>(const nlohmann::json & value, const field & a_field,
+                                            std::vector<std::string> & keys) const {
+    const int KEY_LEN = 8;
+    unsigned char key[KEY_LEN];
+    encode_int64(value.get<int64_t>(), key);
+    keys.push_back(std::string((char*)key, KEY_LEN));
+}
+
+template <>
+void Index::field_keys<field_type_t::FLOAT>(const nlohmann::json & value, const field & a_field,
+                                            std::vector<std::string> & keys) const {
+    const int KEY_LEN = 8;
+    unsigned char key[KEY_LEN];
+    encode_float(value.get<float>(), key);
+    keys.push_back(std::string((char*)key, KEY_LEN));
+}
+
+template <>
+void Index::field_keys<field_type_t::BOOL>(const nlohmann::json & value, const field & a_field,
+                                           std::vector<std::string> & keys) const {
+    keys.push_back(value.get<bool>() ? "1" : "0");
+}
+
+template <>
+void Index::field_keys<field_type_t::INT32_ARRAY>(const nlohmann::json & value, const field & a_field,
+                                                  std::vector<std::string> & keys) const {
+    for(const nlohmann::json & element: value) {
+        field_keys<field_type_t::INT32>(element, a_field, keys);
+    }
+}
+
+template <>
+void Index::field_keys<field_type_t::INT64_ARRAY>(const nlohmann::json & value, const field & a_field,
+                                                  std::vector<std::string> & keys) const {
+    for(const nlohmann::json & element: value) {
+        field_keys<field_type_t::INT64>(element, a_field, keys);
+    }
+}
+
+template <>
+void Index::field_keys<field_type_t::FLOAT_ARRAY>(const nlohmann::json & value, const field & a_field,
+                                                  std::vector<std::string> & keys) const {
+    for(const nlohmann::json & element: value) {
+        field_keys<field_type_t::FLOAT>(element, a_field, keys);
+    }
+}
+
+template <>
+void Index::field_keys<field_type_t::BOOL_ARRAY>(const nlohmann::json & value, const field & a_field,
+                                                 std::vector<std::string> & keys) const {
+    for(const nlohmann::json & element: value) {
+        field_keys<field_type_t::BOOL>(element, a_field, keys);
+    }
+}
+
+template <>
+void Index::field_keys<field_type_t::UNKNOWN>(const nlohmann::json & value, const field & a_field,
+                                              std::vector<std::string> & keys) const {
+
+}
+
+Index::field_keys_t Index::get_field_keys(const field_type_t type) {
+    switch(type) {
+        case field_type_t::STRING: return &Index::field_keys<field_type_t::STRING>;
+        case field_type_t::INT32: return &Index::field_keys<field_type_t::INT32>;
+        case field_type_t::INT64: return &Index::field_keys<field_type_t::INT64>;
+        case field_type_t::FLOAT: return &Index::field_keys<field_type_t::FLOAT>;
+        case field_type_t::BOOL: return &Index::field_keys<field_type_t::BOOL>;
+        case field_type_t::STRING_ARRAY: return &Index::field_keys<field_type_t::STRING_ARRAY>;
+        case field_type_t::INT32_ARRAY: return &Index::field_keys<field_type_t::INT32_ARRAY>;
+        case field_type_t::INT64_ARRAY: return &Index::field_keys<field_type_t::INT64_ARRAY>;
+        case field_type_t::FLOAT_ARRAY: return &Index::field_keys<field_type_t::FLOAT_ARRAY>;
+        case field_type_t::BOOL_ARRAY: return &Index::field_keys<field_type_t::BOOL_ARRAY>;
+        default: return &Index::field_keys<field_type_t::UNKNOWN>;
+    }
+}
+
+void Index::index_forward(const nlohmann::json & document, uint32_t seq_id) {
+    doc_leaves entry;
+    entry.field_ends.reserve(schema.size());
+
+    for(size_t i = 0; i < schema.size(); i++) {
+        const field & a_field = schema[i];
+        const auto value_it = document.find(a_field.name);
+
+        if(value_it == document.end()) {
+            entry.field_ends.push_back((uint32_t) entry.leaves.size());
+        } else {
+            index_forward_field(*value_it, a_field, i, entry);
+        }
+    }
+
+    entry.leaves.shrink_to_fit();
+    forward_index.emplace(seq_id, std::move(entry));
+}
+
+void Index::index_forward_field(const nlohmann::json & value, const field & a_field, const size_t field_index,
+                                doc_leaves & entry) const {
+    std::vector<std::string> keys;
+    (this->*field_key_extractors[field_index])(value, a_field, keys);
+
+    const size_t field_begin = entry.leaves.size();
+
+    for(const std::string & key: keys) {
+        art_leaf* leaf = (art_leaf *) art_search(search_index[a_field.id], (const unsigned char *) key.data(),
+                                                 (int) key.length());
+        if(leaf != nullptr) {
+            entry.leaves.push_back(leaf);
+        }
+    }
+
+    // a repeated token must be removed only once: its leaf could be freed on the first removal
+    std::sort(entry.leaves.begin() + field_begin, entry.leaves.end());
+    entry.leaves.erase(std::unique(entry.leaves.begin() + field_begin, entry.leaves.end()), entry.leaves.end());
+    entry.field_ends.push_back((uint32_t) entry.leaves.size());
+}
+
 void Index::index_int32_field(const int32_t value, uint32_t score, art_tree *t, uint32_t seq_id) const {
     const int KEY_LEN = 8;
     unsigned char key[KEY_LEN];
@@ -215,21 +520,15 @@ void Index::index_float_field(const float value, uint32_t score, art_tree *t, ui
 }
 
 
-void Index::index_string_field(const std::string & text, const uint32_t score, art_tree *t,
-                                    uint32_t seq_id, const bool verbatim) const {
+size_t Index::index_string_field(const std::string & text, const uint32_t score, art_tree *t,
+                                    uint32_t seq_id, const analyzer & field_analyzer,
+                                    infix_index* infix) const {
     std::vector<std::string> tokens;
     std::unordered_map<std::string, std::vector<uint32_t>> token_to_offsets;
 
-    if(verbatim) {
-        tokens.push_back(text);
-        token_to_offsets[text].push_back(0);
-    } else {
-        StringUtils::split(text, tokens, " ");
-        for(uint32_t i=0; i<tokens.size(); i++) {
-            auto & token = tokens[i];
-            string_utils.unicode_normalize(token);
-            token_to_offsets[token].push_back(i);
-        }
+    field_analyzer.analyze(text, tokens);
+    for(uint32_t i=0; i<tokens.size(); i++) {
+        token_to_offsets[tokens[i]].push_back(i);
     }
 
     for(auto & kv: token_to_offsets) {
@@ -247,6 +546,8 @@ void Index::index_string_field(const std::string & text, const uint32_t score, a
         art_leaf* leaf = (art_leaf *) art_search(t, key, key_len);
         if(leaf != NULL) {
             num_hits = leaf->values->ids.getLength();
+        } else if(infix != nullptr) {
+            infix->add(kv.first);
         }
 
         num_hits += 1;
@@ -259,13 +560,18 @@ void Index::index_string_field(const std::string & text, const uint32_t score, a
         delete [] art_doc.offsets;
         art_doc.offsets = nullptr;
     }
+
+    return token_to_offsets.size();
 }
 
-void Index::index_string_array_field(const std::vector<std::string> & strings, const uint32_t score, art_tree *t,
-                                          uint32_t seq_id, const bool verbatim) const {
+size_t Index::index_string_array_field(const std::vector<std::string> & strings, const uint32_t score, art_tree *t,
+                                          uint32_t seq_id, const analyzer & field_analyzer,
+                                          infix_index* infix) const {
+    size_t num_keys = 0;
     for(const std::string & str: strings) {
-        index_string_field(str, score, t, seq_id, verbatim);
+        num_keys += index_string_field(str, score, t, seq_id, field_analyzer, infix);
     }
+    return num_keys;
 }
 
 void Index::index_int32_array_field(const std::vector<int32_t> & values, const uint32_t score, art_tree *t,
@@ -296,32 +602,381 @@ void Index::index_float_array_field(const std::vector<float> & values, const uin
     }
 }
 
+void Index::index_facet_values(const field & a_field, const uint32_t seq_id,
+                               const std::vector<std::string> & values) {
+    facet_value & fvalue = facet_index[a_field.id];
+    const size_t num_values = fvalue.value_index.size();
+    fvalue.index_values(seq_id, values);
+
+    // values are never removed from the dictionary, so a value is added to it only when it is first seen: since
+    // value indices only grow, they are appended to the dictionary's postings in order
+    for(uint32_t value_index = num_values; value_index < fvalue.value_index.size(); value_index++) {
+        index_string_field(fvalue.index_value.at(value_index), 0, facet_value_index[a_field.id], value_index,
+                           analyzer());
+    }
+}
+
+void Index::match_facet_queries(std::vector<facet> & facets, const int num_typos) const {
+    const int max_cost = (num_typos < 0 || num_typos > 2) ? 2 : num_typos;
+
+    for(facet & a_facet: facets) {
+        if(a_facet.query.empty()) {
+            continue;
+        }
+
+        std::vector<std::string> tokens;
+        analyzer().analyze(a_facet.query, tokens);
+        art_tree* t = facet_value_index[field_ids.at(a_facet.field_name)];
+
+        // a value has to match every token: the last one as a prefix, since the query is being typed
+        uint32_t* matches = nullptr;
+        size_t matches_length = 0;
+
+        for(size_t i = 0; i < tokens.size(); i++) {
+            const bool prefix = (i == tokens.size() - 1);
+            const int token_len = prefix ? (int) tokens[i].length() : (int) tokens[i].length() + 1;
+            std::vector<art_leaf*> leaves;
+
+            // fewest typos first, as in a search
+            for(int cost = 0; cost <= max_cost && leaves.empty(); cost++) {
+                art_fuzzy_search(t, (const unsigned char *) tokens[i].c_str(), token_len, cost, cost,
+                                 FACET_QUERY_MAX_VALUES, FREQUENCY, prefix, leaves);
+            }
+
+            std::vector<std::pair<uint32_t*, size_t>> leaf_values;
+            for(const art_leaf* leaf: leaves) {
+                leaf_values.push_back(std::make_pair(leaf->values->ids.uncompress(), leaf->values->ids.getLength()));
+            }
+
+            uint32_t* token_matches = nullptr;
+            size_t token_matches_length = 0;
+            for(const std::pair<uint32_t*, size_t> & values: leaf_values) {
+                uint32_t* out = nullptr;
+                token_matches_length = ArrayUtils::or_scalar(token_matches, token_matches_length, values.first,
+                                                             values.second, &out);
+                delete [] token_matches;
+                delete [] values.first;
+                token_matches = out;
+            }
+
+            if(i == 0) {
+                matches = token_matches;
+                matches_length = token_matches_length;
+            } else {
+                uint32_t* out = nullptr;
+                matches_length = ArrayUtils::and_scalar(matches, matches_length, token_matches,
+                                                        token_matches_length, &out);
+                delete [] matches;
+                delete [] token_matches;
+                matches = out;
+            }
+        }
+
+        a_facet.query_values.clear();
+        a_facet.query_values.insert(matches, matches + matches_length);
+        delete [] matches;
+    }
+}
+
 void Index::do_facets(std::vector<facet> & facets, uint32_t* result_ids, size_t results_size) {
+    std::vector<uint32_t> sample_ids;
+
     for(auto & a_facet: facets) {
+        const uint32_t* facet_ids = result_ids;
+        size_t facet_ids_length = results_size;
+        double scale = 1.0;
+
+        if(a_facet.sample_percent < 100 && results_size > a_facet.sample_threshold) {
+            // Count on a sample of the results, and scale the counts back up. One id is drawn at random from each
+            // of `sample_size` equal slices of the results: a fixed stride would alias with ids that are periodic,
+            // like those of a shard are. Seeded, so that a search always gets the same estimates.
+            const size_t sample_size = std::max((size_t) 1, results_size * a_facet.sample_percent / 100);
+            if(sample_ids.size() != sample_size) {
+                std::minstd_rand rng((uint32_t) results_size);
+                sample_ids.resize(sample_size);
+                for(size_t i = 0; i < sample_size; i++) {
+                    const size_t slice_start = (uint64_t) i * results_size / sample_size;
+                    const size_t slice_end = (uint64_t) (i + 1) * results_size / sample_size;
+                    sample_ids[i] = result_ids[slice_start + rng() % (slice_end - slice_start)];
+                }
+            }
+
+            facet_ids = sample_ids.data();
+            facet_ids_length = sample_size;
+            scale = (double) results_size / sample_size;
+            a_facet.sampled = true;
+        }
+
+        if(a_facet.is_numeric) {
+            do_numeric_facet(a_facet, facet_ids, facet_ids_length, scale);
+            continue;
+        }
+
         // assumed that facet fields have already been validated upstream
-        const field & facet_field = facet_schema.at(a_facet.field_name);
-        const facet_value & fvalue = facet_index.at(facet_field.name);
+        const facet_value & fvalue = facet_index[field_ids.at(a_facet.field_name)];
+
+        spp::sparse_hash_map<uint32_t, size_t> sample_counts;
+        spp::sparse_hash_map<uint32_t, size_t> & value_counts = (scale == 1.0) ? a_facet.value_counts : sample_counts;
 
-        for(size_t i = 0; i < results_size; i++) {
-            uint32_t doc_seq_id = result_ids[i];
-            if(fvalue.doc_values.count(doc_seq_id) != 0) {
+        for(size_t i = 0; i < facet_ids_length; i++) {
+            uint32_t doc_seq_id = facet_ids[i];
+            const auto doc_values_it = fvalue.doc_values.find(doc_seq_id);
+            if(doc_values_it != fvalue.doc_values.end()) {
                 // for every result document, get the values associated and increment counter
-                const std::vector<uint32_t> & value_indices = fvalue.doc_values.at(doc_seq_id);
+                const std::vector<uint32_t> & value_indices = doc_values_it->second;
                 for(size_t j = 0; j < value_indices.size(); j++) {
-                    const std::string & facet_value = fvalue.index_value.at(value_indices.at(j));
-                    a_facet.result_map[facet_value] += 1;
+                    if(a_facet.counts_value(value_indices[j])) {
+                        value_counts[value_indices[j]] += 1;
+                    }
+                }
+            }
+        }
+
+        for(const auto & sample_count: sample_counts) {
+            a_facet.value_counts[sample_count.first] += (size_t) std::llround(sample_count.second * scale);
+        }
+    }
+}
+
+void Index::do_numeric_facet(facet & a_facet, const uint32_t* result_ids, const size_t results_size,
+                             const double scale) const {
+    // gather the values of the results from the field's column, so that the stats and the range counts are tight
+    // loops over a contiguous array
+    const numeric_column* doc_values = sort_index[field_ids.at(a_facet.field_name)];
+    std::vector<double> values;
+    values.reserve(results_size);
+
+    for(size_t i = 0; i < results_size; i++) {
+        number_t value;
+        if(doc_values->get(result_ids[i], value)) {
+            values.push_back(value.is_float ? (double) value.floatval : (double) value.intval);
+        }
+    }
+
+    const double* vals = values.data();
+    const size_t num_values = values.size();
+
+    facet_stats stats;
+    for(size_t i = 0; i < num_values; i++) {
+        stats.min = vals[i] < stats.min ? vals[i] : stats.min;
+        stats.max = vals[i] > stats.max ? vals[i] : stats.max;
+        stats.sum += vals[i];
+    }
+    stats.sum *= scale;
+    stats.count = (size_t) std::llround(num_values * scale);
+    a_facet.stats.merge(stats);
+
+    for(size_t r = 0; r < a_facet.ranges.size(); r++) {
+        const double from = a_facet.ranges[r].from;
+        const double to = a_facet.ranges[r].to;
+        size_t count = 0;
+
+        for(size_t i = 0; i < num_values; i++) {
+            count += (vals[i] >= from) & (vals[i] < to);
+        }
+
+        a_facet.range_counts[r] += (size_t) std::llround(count * scale);
+    }
+}
+
+bool Index::get_numeric_facet_bounds(const std::string & field_name, double & min, double & max) const {
+    const std::map<double, uint32_t> & values = numeric_facet_values[field_ids.at(field_name)];
+    if(values.empty()) {
+        return false;
+    }
+
+    min = values.begin()->first;
+    max = values.rbegin()->first;
+    return true;
+}
+
+void Index::add_value_counts(facet & a_facet, const std::vector<uint32_t> & value_counts) {
+    for(uint32_t value_index = 0; value_index < value_counts.size(); value_index++) {
+        if(value_counts[value_index] != 0 && a_facet.counts_value(value_index)) {
+            a_facet.value_counts[value_index] += value_counts[value_index];
+        }
+    }
+}
+
+const pinned_filter* Index::get_pinned_filter(const std::vector<filter> & filters) const {
+    for(const pinned_filter & pinned: pinned_filters) {
+        if(pinned.filters == filters) {
+            return &pinned;
+        }
+    }
+
+    return nullptr;
+}
+
+void Index::count_pinned_values(pinned_filter & pinned, const uint32_t seq_id, const bool added,
+                                const std::vector<uint32_t> & count_field_ids) {
+    for(const uint32_t facet_field_id: count_field_ids) {
+        const facet_value & fvalue = facet_index[facet_field_id];
+        const auto doc_values_it = fvalue.doc_values.find(seq_id);
+        if(doc_values_it == fvalue.doc_values.end()) {
+            continue;
+        }
+
+        std::vector<uint32_t> & value_counts = pinned.value_counts[facet_field_id];
+        for(const uint32_t value_index: doc_values_it->second) {
+            if(value_index >= value_counts.size()) {
+                value_counts.resize(value_index + 1, 0);
+            }
+
+            if(added) {
+                value_counts[value_index] += 1;
+            } else {
+                value_counts[value_index] -= 1;
+            }
+        }
+    }
+}
+
+bool Index::doc_matches_filter(const filter & a_filter, const uint32_t seq_id) {
+    const auto field_id_it = field_ids.find(a_filter.field_name);
+    if(field_id_it == field_ids.end()) {
+        // `do_filtering` ignores such filters as well
+        return true;
+    }
+
+    const field & f = schema[field_id_it->second];
+    art_tree* t = search_index[f.id];
+
+    if(sort_index[f.id] != nullptr) {
+        std::vector<filter_check> filter_checks;
+        get_filter_checks({a_filter}, filter_checks);
+        return passes_filter_checks(filter_checks, seq_id);
+    }
+
+    for(const std::string & filter_value: a_filter.values) {
+        if(f.is_integer() || f.is_float()) {
+            std::vector<const art_leaf*> leaves;
+
+            if(f.type_id == field_type_t::INT32_ARRAY) {
+                art_int32_search(t, (int32_t) std::stoi(filter_value), a_filter.compare_operator, leaves);
+            } else if(f.type_id == field_type_t::INT64_ARRAY) {
+                art_int64_search(t, (int64_t) std::stoll(filter_value), a_filter.compare_operator, leaves);
+            } else {
+                art_float_search(t, (float) std::atof(filter_value.c_str()), a_filter.compare_operator, leaves);
+            }
+
+            for(const art_leaf* leaf: leaves) {
+                load_leaf(f.id, leaf);
+                if(leaf->values->ids.contains(seq_id)) {
+                    return true;
+                }
+            }
+        } else if(f.is_bool()) {
+            const art_leaf* leaf = (const art_leaf *) art_search(t, (const unsigned char*) filter_value.c_str(),
+                                                                 filter_value.length());
+            if(leaf != nullptr) {
+                load_leaf(f.id, leaf);
+            }
+
+            if(leaf != nullptr && leaf->values->ids.contains(seq_id)) {
+                return true;
+            }
+        } else if(f.is_string()) {
+            std::vector<std::string> str_tokens;
+            analyzer::for_filter(f).analyze(filter_value, str_tokens);
+
+            // an exact match needs every token that is in the index, and the first token has to be in the index
+            bool value_matches = !str_tokens.empty();
+
+            for(size_t i = 0; i < str_tokens.size(); i++) {
+                const std::string & str_token = str_tokens[i];
+                const art_leaf* leaf = (const art_leaf *) art_search(t, (const unsigned char*) str_token.c_str(),
+                                                                     str_token.length()+1);
+                if(leaf == nullptr) {
+                    if(i == 0) {
+                        value_matches = false;
+                        break;
+                    }
+                    continue;
+                }
+
+                load_leaf(f.id, leaf);
+
+                if(!leaf->values->ids.contains(seq_id)) {
+                    value_matches = false;
+                    break;
                 }
             }
+
+            if(value_matches) {
+                return true;
+            }
         }
     }
+
+    return false;
+}
+
+Option<uint32_t> Index::pin_filter(const std::vector<filter> & filters) {
+    std::unique_lock<std::mutex> lock(write_mutex);
+
+    for(const filter & a_filter: filters) {
+        access_postings(a_filter.field_name);
+    }
+
+    const pinned_filter* existing = get_pinned_filter(filters);
+    if(existing != nullptr) {
+        return Option<uint32_t>(existing->doc_ids.size());
+    }
+
+    uint32_t* filter_ids = nullptr;
+    Option<uint32_t> op_filter_ids_length = do_filtering(&filter_ids, filters);
+    if(!op_filter_ids_length.ok()) {
+        return op_filter_ids_length;
+    }
+
+    pinned_filter pinned;
+    pinned.filters = filters;
+    pinned.value_counts.resize(facet_index.size());
+
+    for(uint32_t i = 0; i < op_filter_ids_length.get(); i++) {
+        pinned.doc_ids.insert(filter_ids[i]);
+        count_pinned_values(pinned, filter_ids[i], true, facet_field_ids);
+    }
+
+    delete [] filter_ids;
+    pinned_filters.push_back(std::move(pinned));
+
+    return op_filter_ids_length;
 }
 
-void Index::search_candidates(uint32_t* filter_ids, size_t filter_ids_length, std::vector<facet> & facets,
-                                   const std::vector<sort_by> & sort_fields,
-                                   std::vector<token_candidates> & token_candidates_vec, const token_ordering token_order,
-                                   std::vector<std::vector<art_leaf*>> & searched_queries, Topster<512> & topster,
-                                   size_t & total_results, uint32_t** all_result_ids, size_t & all_result_ids_len,
-                                   const size_t & max_results, const bool prefix) {
+size_t Index::probe_postings(const std::vector<art_leaf*> & query_suggestion, const uint32_t* filter_ids,
+                             const size_t filter_ids_length, uint32_t** results_out) {
+    uint32_t* results = new uint32_t[filter_ids_length];
+    size_t results_length = 0;
+
+    for(size_t i = 0; i < filter_ids_length; i++) {
+        bool found_in_all = true;
+
+        // `query_suggestion` is sorted on posting length, so the rarest token rules out a filter id first
+        for(const art_leaf* leaf: query_suggestion) {
+            if(!leaf->values->ids.contains(filter_ids[i])) {
+                found_in_all = false;
+                break;
+            }
+        }
+
+        if(found_in_all) {
+            results[results_length++] = filter_ids[i];
+        }
+    }
+
+    *results_out = results;
+    return results_length;
+}
+
+void Index::search_candidates(uint32_t* filter_ids, size_t filter_ids_length,
+                              const std::vector<filter_check> & filter_checks, std::vector<facet> & facets,
+                              const std::vector<sort_by> & sort_fields,
+                              std::vector<token_candidates> & token_candidates_vec, const token_ordering token_order,
+                              std::vector<std::vector<art_leaf*>> & searched_queries, Topster<512> & topster,
+                              size_t & total_results, uint32_t** all_result_ids, size_t & all_result_ids_len,
+                              const size_t & max_results, const bool prefix, const bool count_only) {
     const long long combination_limit = 10;
 
     auto product = []( long long a, token_candidates & b ) { return a*b.candidates.size(); };
@@ -336,62 +991,79 @@ void Index::search_candidates(uint32_t* filter_ids, size_t filter_ids_length, st
         }*/
 
         // initialize results with the starting element (for further intersection)
-        size_t result_size = query_suggestion[0]->values->ids.getLength();
-        if(result_size == 0) {
+        const size_t min_posting_length = query_suggestion[0]->values->ids.getLength();
+        if(min_posting_length == 0) {
             continue;
         }
 
         uint32_t total_cost = 0;
-        uint32_t* result_ids = query_suggestion[0]->values->ids.uncompress();
-
         for(auto tc: token_candidates_vec) {
             total_cost += tc.cost;
         }
 
-        // intersect the document ids for each token to find docs that contain all the tokens (stored in `result_ids`)
-        for(size_t i=1; i < query_suggestion.size(); i++) {
-            uint32_t* out = nullptr;
-            uint32_t* ids = query_suggestion[i]->values->ids.uncompress();
-            result_size = ArrayUtils::and_scalar(ids, query_suggestion[i]->values->ids.getLength(), result_ids, result_size, &out);
-            delete[] ids;
-            delete[] result_ids;
-            result_ids = out;
-        }
-
-        if(filter_ids != nullptr) {
-            // intersect once again with filter ids
-            uint32_t* filtered_result_ids = nullptr;
-            size_t filtered_results_size = ArrayUtils::and_scalar(filter_ids, filter_ids_length, result_ids,
-                                                                  result_size, &filtered_result_ids);
+        uint32_t* result_ids = nullptr;
+        size_t result_size = 0;
 
-            uint32_t* new_all_result_ids;
-            all_result_ids_len = ArrayUtils::or_scalar(*all_result_ids, all_result_ids_len, filtered_result_ids,
-                                  filtered_results_size, &new_all_result_ids);
-            delete [] *all_result_ids;
-            *all_result_ids = new_all_result_ids;
+        if(filter_ids != nullptr && filter_ids_length * std::log2(min_posting_length + 1) < min_posting_length) {
+            // very selective filters: looking up the few filter ids in the postings is cheaper than
+            // decompressing and intersecting the postings
+            result_size = probe_postings(query_suggestion, filter_ids, filter_ids_length, &result_ids);
+        } else {
+            result_size = min_posting_length;
+            result_ids = query_suggestion[0]->values->ids.uncompress();
+
+            // intersect the document ids for each token to find docs that contain all the tokens
+            for(size_t i=1; i < query_suggestion.size(); i++) {
+                uint32_t* out = nullptr;
+                result_size = query_suggestion[i]->values->ids.intersect(result_ids, result_size, &out);
+                delete[] result_ids;
+                result_ids = out;
+            }
 
-            do_facets(facets, filtered_result_ids, filtered_results_size);
+            if(filter_ids != nullptr) {
+                // intersect once again with filter ids
+                uint32_t* filtered_result_ids = nullptr;
+                result_size = ArrayUtils::and_scalar(filter_ids, filter_ids_length, result_ids,
+                                                     result_size, &filtered_result_ids);
+                delete[] result_ids;
+                result_ids = filtered_result_ids;
+            }
+        }
 
-            // go through each matching document id and calculate match score
-            score_results(sort_fields, searched_queries.size(), total_cost, topster, query_suggestion,
-                          filtered_result_ids, filtered_results_size);
+        if(!filter_checks.empty()) {
+            size_t num_passed = 0;
+            for(size_t i = 0; i < result_size; i++) {
+                if(passes_filter_checks(filter_checks, result_ids[i])) {
+                    result_ids[num_passed++] = result_ids[i];
+                }
+            }
+            result_size = num_passed;
+        }
 
-            delete[] filtered_result_ids;
-            delete[] result_ids;
-        } else {
-            do_facets(facets, result_ids, result_size);
+        uint32_t* new_all_result_ids;
+        all_result_ids_len = ArrayUtils::or_scalar(*all_result_ids, all_result_ids_len, result_ids,
+                                                   result_size, &new_all_result_ids);
+        delete [] *all_result_ids;
+        *all_result_ids = new_all_result_ids;
 
-            uint32_t* new_all_result_ids;
-            all_result_ids_len = ArrayUtils::or_scalar(*all_result_ids, all_result_ids_len, result_ids,
-                                  result_size, &new_all_result_ids);
-            delete [] *all_result_ids;
-            *all_result_ids = new_all_result_ids;
+        do_facets(facets, result_ids, result_size);
 
+        if(count_only) {
+            // No hits are returned, so nothing is scored: the topster only keeps track of how many distinct
+            // documents the field has matched, since that decides when query relaxation stops. Once it is
+            // full, its size no longer changes.
+            for(size_t i = 0; i < result_size && topster.size < Index::TOPSTER_SIZE; i++) {
+                topster.add(result_ids[i], searched_queries.size(), 0, number_t(), number_t());
+            }
+        } else {
+            // go through each matching document id and calculate match score
+            num_scored_docs += result_size;
             score_results(sort_fields, searched_queries.size(), total_cost, topster, query_suggestion,
                           result_ids, result_size);
-            delete[] result_ids;
         }
 
+        delete[] result_ids;
+
         total_results += topster.size;
         searched_queries.push_back(query_suggestion);
 
@@ -428,24 +1100,37 @@ Option<uint32_t> Index::do_filtering(uint32_t** filter_ids_out, const std::vecto
     for(size_t i = 0; i < filters.size(); i++) {
         const filter & a_filter = filters[i];
 
-        if(search_index.count(a_filter.field_name) != 0) {
-            art_tree* t = search_index.at(a_filter.field_name);
-            field f = search_schema.at(a_filter.field_name);
-            std::vector<std::pair<uint32_t*, size_t>> filter_result_array_pairs;
+        const auto field_id_it = field_ids.find(a_filter.field_name);
 
-            if(f.is_integer()) {
+        if(field_id_it != field_ids.end()) {
+            art_tree* t = search_index[field_id_it->second];
+            const field & f = schema[field_id_it->second];
+            std::vector<std::pair<uint32_t*, size_t>> filter_result_array_pairs;
+            std::vector<filter_check> filter_checks;
+
+            if(a_filter.compare_operator != EQUALS && (f.is_integer() || f.is_float()) &&
+               get_filter_checks({a_filter}, filter_checks)) {
+                // a range over the column skips its blocks that are out of range, instead of visiting a leaf per value
+                std::vector<uint32_t> ids;
+                filter_checks[0].doc_values->filter(a_filter.compare_operator, filter_checks[0].values, ids);
+
+                uint32_t* column_ids = new uint32_t[ids.size()];
+                std::copy(ids.begin(), ids.end(), column_ids);
+                filter_result_array_pairs.push_back(std::make_pair(column_ids, ids.size()));
+            } else if(f.is_integer()) {
                 std::vector<const art_leaf*> leaves;
 
                 for(const std::string & filter_value: a_filter.values) {
-                    if(f.type == field_types::INT32 || f.type == field_types::INT32_ARRAY) {
+                    if(f.type_id == field_type_t::INT32 || f.type_id == field_type_t::INT32_ARRAY) {
                         int32_t value = (int32_t) std::stoi(filter_value);
                         art_int32_search(t, value, a_filter.compare_operator, leaves);
                     } else {
-                        int64_t value = (int64_t) std::stoi(filter_value);
+                        int64_t value = (int64_t) std::stoll(filter_value);
                         art_int64_search(t, value, a_filter.compare_operator, leaves);
                     }
 
                     for(const art_leaf* leaf: leaves) {
+                        load_leaf(f.id, leaf);
                         filter_result_array_pairs.push_back(std::make_pair(leaf->values->ids.uncompress(),
                                                                 leaf->values->ids.getLength()));
                     }
@@ -457,6 +1142,7 @@ Option<uint32_t> Index::do_filtering(uint32_t** filter_ids_out, const std::vecto
                     float value = (float) std::atof(filter_value.c_str());
                     art_float_search(t, value, a_filter.compare_operator, leaves);
                     for(const art_leaf* leaf: leaves) {
+                        load_leaf(f.id, leaf);
                         filter_result_array_pairs.push_back(std::make_pair(leaf->values->ids.uncompress(),
                                                                 leaf->values->ids.getLength()));
                     }
@@ -468,6 +1154,7 @@ Option<uint32_t> Index::do_filtering(uint32_t** filter_ids_out, const std::vecto
                     art_leaf* leaf = (art_leaf *) art_search(t, (const unsigned char*) filter_value.c_str(),
                                                              filter_value.length());
                     if(leaf) {
+                        load_leaf(f.id, leaf);
                         filter_result_array_pairs.push_back(std::make_pair(leaf->values->ids.uncompress(),
                                                                            leaf->values->ids.getLength()));
                     }
@@ -476,30 +1163,28 @@ Option<uint32_t> Index::do_filtering(uint32_t** filter_ids_out, const std::vecto
                 for(const std::string & filter_value: a_filter.values) {
                     // we have to tokenize the string, standardize it and then do an exact match
                     std::vector<std::string> str_tokens;
-                    StringUtils::split(filter_value, str_tokens, " ");
+                    analyzer::for_filter(f).analyze(filter_value, str_tokens);
 
                     uint32_t* filtered_ids = nullptr;
                     size_t filtered_size = 0;
 
                     for(size_t i = 0; i < str_tokens.size(); i++) {
-                        std::string & str_token = str_tokens[i];
-                        string_utils.unicode_normalize(str_token);
+                        const std::string & str_token = str_tokens[i];
                         art_leaf* leaf = (art_leaf *) art_search(t, (const unsigned char*) str_token.c_str(),
                                                                  str_token.length()+1);
                         if(leaf == nullptr) {
                             continue;
                         }
 
+                        load_leaf(f.id, leaf);
+
                         if(i == 0) {
                             filtered_ids = leaf->values->ids.uncompress();
                             filtered_size = leaf->values->ids.getLength();
                         } else {
                             // do AND for an exact match
                             uint32_t* out = nullptr;
-                            uint32_t* leaf_ids = leaf->values->ids.uncompress();
-                            filtered_size = ArrayUtils::and_scalar(filtered_ids, filtered_size, leaf_ids,
-                                                                   leaf->values->ids.getLength(), &out);
-                            delete[] leaf_ids;
+                            filtered_size = leaf->values->ids.intersect(filtered_ids, filtered_size, &out);
                             delete[] filtered_ids;
                             filtered_ids = out;
                         }
@@ -530,8 +1215,183 @@ Option<uint32_t> Index::do_filtering(uint32_t** filter_ids_out, const std::vecto
         }
     }
 
-    *filter_ids_out = filter_ids;
-    return Option<>(filter_ids_length);
+    *filter_ids_out = filter_ids;
+    return Option<>(filter_ids_length);
+}
+
+size_t Index::key_num_docs(art_tree *t, const std::string & key) const {
+    const art_leaf* leaf = (const art_leaf *) art_search(t, (const unsigned char *) key.data(), key.length());
+    return (leaf == nullptr) ? 0 : art_leaf_length(leaf);
+}
+
+size_t Index::estimate_filter_matches(const std::vector<filter> & filters) const {
+    if(num_documents == 0) {
+        return 0;
+    }
+
+    // filters are ANDed: assume that they are independent and combine their selectivities
+    double selectivity = 1.0;
+
+    for(const filter & a_filter: filters) {
+        const auto field_id_it = field_ids.find(a_filter.field_name);
+        if(field_id_it == field_ids.end()) {
+            continue;
+        }
+
+        const field & f = schema[field_id_it->second];
+        art_tree* t = search_index[f.id];
+        const size_t num_keys = art_size(t);
+
+        if(num_keys == 0) {
+            return 0;
+        }
+
+        double filter_matches = 0;
+
+        if(a_filter.compare_operator != EQUALS) {
+            // without a histogram of the values, assume that a range matches a third of the documents
+            filter_matches = num_documents / 3.0;
+        } else if(f.is_string()) {
+            for(const std::string & filter_value: a_filter.values) {
+                std::vector<std::string> keys;
+                field_keys<field_type_t::STRING>(filter_value, f, keys);
+
+                // exact match of all the tokens: bounded by the rarest token
+                size_t value_matches = keys.empty() ? 0 : num_documents;
+                for(const std::string & key: keys) {
+                    value_matches = std::min(value_matches, key_num_docs(t, key));
+                }
+
+                filter_matches += value_matches;
+            }
+        } else if(f.is_bool()) {
+            for(const std::string & filter_value: a_filter.values) {
+                filter_matches += key_num_docs(t, filter_value);
+            }
+        } else {
+            // average number of documents per distinct value
+            filter_matches = a_filter.values.size() * ((double) search_stats[f.id].num_postings / num_keys);
+        }
+
+        selectivity *= std::min(1.0, filter_matches / num_documents);
+    }
+
+    return (size_t) (selectivity * num_documents);
+}
+
+size_t Index::estimate_text_matches(const std::string & query, const std::vector<uint32_t> & search_field_ids) const {
+    size_t text_matches = 0;
+
+    for(const uint32_t field_id: search_field_ids) {
+        std::vector<std::string> tokens;
+        analyzers[field_id].analyze(query, tokens);
+
+        for(auto & token: tokens) {
+            token.push_back('\0');
+        }
+
+        art_tree* t = search_index[field_id];
+        const size_t num_keys = art_size(t);
+        if(num_keys == 0 || tokens.empty()) {
+            continue;
+        }
+
+        // tokens that are not found verbatim could still match through typos or as a prefix
+        const size_t avg_key_docs = search_stats[field_id].num_postings / num_keys;
+        size_t field_matches = num_documents;
+
+        for(const std::string & token: tokens) {
+            const size_t token_docs = key_num_docs(t, token);
+            field_matches = std::min(field_matches, token_docs != 0 ? token_docs : avg_key_docs);
+        }
+
+        text_matches += field_matches;
+    }
+
+    return text_matches;
+}
+
+bool Index::get_filter_checks(const std::vector<filter> & filters, std::vector<filter_check> & filter_checks) const {
+    for(const filter & a_filter: filters) {
+        const auto field_id_it = field_ids.find(a_filter.field_name);
+        if(field_id_it == field_ids.end() || sort_index[field_id_it->second] == nullptr) {
+            // only single valued fields have a document -> value mapping to check against
+            return false;
+        }
+
+        const field & f = schema[field_id_it->second];
+        filter_check check;
+        check.doc_values = sort_index[f.id];
+        check.compare_operator = a_filter.compare_operator;
+
+        for(const std::string & filter_value: a_filter.values) {
+            if(f.is_single_float()) {
+                check.values.push_back((float) std::atof(filter_value.c_str()));
+            } else if(f.is_single_bool()) {
+                check.values.push_back((int64_t) (filter_value == "1"));
+            } else {
+                check.values.push_back((int64_t) std::stoll(filter_value));
+            }
+        }
+
+        filter_checks.push_back(check);
+    }
+
+    return true;
+}
+
+bool Index::passes_filter_checks(const std::vector<filter_check> & filter_checks, const uint32_t seq_id) {
+    for(const filter_check & check: filter_checks) {
+        number_t doc_value;
+        if(!check.doc_values->get(seq_id, doc_value)) {
+            return false;
+        }
+
+        bool passed = false;
+
+        for(const number_t & value: check.values) {
+            switch(check.compare_operator) {
+                case LESS_THAN: passed = doc_value < value; break;
+                case LESS_THAN_EQUALS: passed = !(doc_value > value); break;
+                case EQUALS: passed = doc_value == value; break;
+                case GREATER_THAN: passed = doc_value > value; break;
+                case GREATER_THAN_EQUALS: passed = !(doc_value < value); break;
+            }
+
+            if(passed) {
+                break;
+            }
+        }
+
+        if(!passed) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+search_plan Index::plan_search(const std::string & query, const std::vector<uint32_t> & search_field_ids,
+                               const std::vector<filter> & filters, std::vector<filter_check> & filter_checks) const {
+    search_plan plan;
+
+    if(filters.empty()) {
+        return plan;
+    }
+
+    plan.estimated_filter_matches = estimate_filter_matches(filters);
+    plan.estimated_text_matches = estimate_text_matches(query, search_field_ids);
+
+    const bool checkable = get_filter_checks(filters, filter_checks);
+
+    if(checkable && plan.estimated_text_matches * TEXT_FIRST_FACTOR < plan.estimated_filter_matches) {
+        plan.execution = TEXT_FIRST;
+    } else {
+        plan.execution = FILTER_FIRST;
+        filter_checks.clear();
+    }
+
+    return plan;
 }
 
 void Index::run_search() {
@@ -545,11 +1405,17 @@ void Index::run_search() {
         }
 
         // after the wait, we own the lock.
+        const uint64_t cpu_begin_us = SearchScheduler::thread_cpu_time_us();
+        num_scored_docs = 0;
+
         search(search_params.outcome, search_params.query, search_params.search_fields,
                search_params.filters, search_params.facets,
                search_params.sort_fields_std, search_params.num_typos, search_params.per_page, search_params.page,
-               search_params.token_order, search_params.prefix, search_params.field_order_kvs,
-               search_params.all_result_ids_len, search_params.searched_queries);
+               search_params.token_order, search_params.prefix, search_params.infix, search_params.field_order_kvs,
+               search_params.all_result_ids_len, search_params.searched_queries, search_params.plan);
+
+        search_params.num_scored_docs = num_scored_docs;
+        search_params.cpu_time_us = SearchScheduler::thread_cpu_time_us() - cpu_begin_us;
 
         // hand control back to main thread
         processed = true;
@@ -565,21 +1431,53 @@ void Index::search(Option<uint32_t> & outcome, std::string query, const std::vec
                              const std::vector<filter> & filters, std::vector<facet> & facets,
                              std::vector<sort_by> sort_fields_std, const int num_typos,
                              const size_t per_page, const size_t page, const token_ordering token_order,
-                             const bool prefix, std::vector<std::pair<int, Topster<512>::KV>> & field_order_kvs,
-                             size_t & all_result_ids_len, std::vector<std::vector<art_leaf*>> & searched_queries) {
+                             const bool prefix, const bool infix,
+                             std::vector<std::pair<int, Topster<512>::KV>> & field_order_kvs,
+                             size_t & all_result_ids_len, std::vector<std::vector<art_leaf*>> & searched_queries,
+                             search_plan & plan) {
 
     const size_t num_results = (page * per_page);
 
-    // process the filters first
+    // per_page=0 only asks for `found` and the facet counts
+    const bool count_only = (per_page == 0);
 
-    uint32_t* filter_ids = nullptr;
-    Option<uint32_t> op_filter_ids_length = do_filtering(&filter_ids, filters);
-    if(!op_filter_ids_length.ok()) {
-        outcome = Option<uint32_t>(op_filter_ids_length);
+    for(const std::string & field_name: search_fields) {
+        access_postings(field_name);
+    }
+
+    for(const filter & a_filter: filters) {
+        access_postings(a_filter.field_name);
+    }
+
+    match_facet_queries(facets, num_typos);
+
+    if(query == WILDCARD_QUERY) {
+        search_wildcard(filters, facets, sort_fields_std, num_results, count_only, search_fields.size(),
+                        field_order_kvs, all_result_ids_len, searched_queries, plan, outcome);
         return ;
     }
 
-    const uint32_t filter_ids_length = op_filter_ids_length.get();
+    std::vector<uint32_t> search_field_ids;
+    for(const std::string & search_field: search_fields) {
+        search_field_ids.push_back(field_ids.at(search_field));
+    }
+
+    // process the filters first, unless the text matches are few enough to be checked against the filters
+    std::vector<filter_check> filter_checks;
+    plan = plan_search(query, search_field_ids, filters, filter_checks);
+
+    uint32_t* filter_ids = nullptr;
+    uint32_t filter_ids_length = 0;
+
+    if(plan.execution == FILTER_FIRST) {
+        Option<uint32_t> op_filter_ids_length = do_filtering(&filter_ids, filters);
+        if(!op_filter_ids_length.ok()) {
+            outcome = Option<uint32_t>(op_filter_ids_length);
+            return ;
+        }
+
+        filter_ids_length = op_filter_ids_length.get();
+    }
 
     // Order of `fields` are used to sort results
     //auto begin = std::chrono::high_resolution_clock::now();
@@ -587,14 +1485,20 @@ void Index::search(Option<uint32_t> & outcome, std::string query, const std::vec
 
     for(size_t i = 0; i < search_fields.size(); i++) {
         Topster<512> topster;
-        const std::string & field = search_fields[i];
-        // proceed to query search only when no filters are provided or when filtering produces results
-        if(filters.size() == 0 || filter_ids_length > 0) {
-            search_field(query, field, filter_ids, filter_ids_length, facets, sort_fields_std, num_typos, num_results,
-                         searched_queries, topster, &all_result_ids, all_result_ids_len, token_order, prefix);
-            topster.sort();
+        const uint32_t field_id = search_field_ids[i];
+        // proceed to query search only when filters were not materialized or when filtering produces results
+        if(plan.execution != FILTER_FIRST || filter_ids_length > 0) {
+            search_field(query, field_id, filter_ids, filter_ids_length, filter_checks, facets, sort_fields_std, num_typos, num_results,
+                         searched_queries, topster, &all_result_ids, all_result_ids_len, token_order, prefix,
+                         count_only, infix);
+        }
+
+        if(count_only) {
+            continue;
         }
 
+        topster.sort();
+
         // order of fields specified matter: matching docs from earlier fields are more important
         for(uint32_t t = 0; t < topster.size && t < num_results; t++) {
             field_order_kvs.push_back(std::make_pair(search_fields.size() - i, topster.getKV(t)));
@@ -604,12 +1508,112 @@ void Index::search(Option<uint32_t> & outcome, std::string query, const std::vec
     delete [] filter_ids;
     delete [] all_result_ids;
 
+    resolve_facet_values(facets);
+
     //long long int timeMillis = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - begin).count();
     //!LOG(INFO) << "Time taken for result calc: " << timeMillis << "us";
 
     outcome = Option<uint32_t>(field_order_kvs.size());
 }
 
+void Index::resolve_facet_values(std::vector<facet> & facets) const {
+    // facet counts are accumulated against this shard's value indices: resolve them to the values themselves
+    for(auto & a_facet: facets) {
+        const facet_value & fvalue = facet_index[field_ids.at(a_facet.field_name)];
+        for(const auto & value_count: a_facet.value_counts) {
+            a_facet.result_map[fvalue.index_value.at(value_count.first)] += value_count.second;
+        }
+        a_facet.value_counts.clear();
+    }
+}
+
+void Index::search_wildcard(const std::vector<filter> & filters, std::vector<facet> & facets,
+                            const std::vector<sort_by> & sort_fields, const size_t num_results, const bool count_only,
+                            const int field_order, std::vector<std::pair<int, Topster<512>::KV>> & field_order_kvs,
+                            size_t & all_result_ids_len, std::vector<std::vector<art_leaf*>> & searched_queries,
+                            search_plan & plan, Option<uint32_t> & outcome) {
+    uint32_t* result_ids = nullptr;
+    size_t result_size = 0;
+
+    // the counts are live for the whole collection and for pinned filters, so only other filters need the
+    // documents to be visited
+    const pinned_filter* pinned = get_pinned_filter(filters);
+    const bool has_numeric_facets = std::any_of(facets.begin(), facets.end(),
+                                                [](const facet & a_facet) { return a_facet.is_numeric; });
+    const bool needs_ids = !count_only || has_numeric_facets || (!filters.empty() && pinned == nullptr);
+
+    plan.execution = filters.empty() ? TEXT_ONLY : FILTER_FIRST;
+
+    if(filters.empty()) {
+        result_size = num_documents;
+
+        for(auto & a_facet: facets) {
+            if(!a_facet.is_numeric) {
+                add_value_counts(a_facet, facet_index[field_ids.at(a_facet.field_name)].value_counts);
+            }
+        }
+
+        if(needs_ids && !sort_field_ids.empty()) {
+            // every document has a value for every sort field
+            const numeric_column* doc_values = sort_index[sort_field_ids[0]];
+            result_ids = new uint32_t[doc_values->size()];
+            result_size = doc_values->size();
+            doc_values->get_ids(result_ids);
+        }
+    } else if(pinned != nullptr) {
+        result_size = pinned->doc_ids.size();
+
+        for(auto & a_facet: facets) {
+            if(!a_facet.is_numeric) {
+                add_value_counts(a_facet, pinned->value_counts[field_ids.at(a_facet.field_name)]);
+            }
+        }
+
+        if(needs_ids) {
+            result_ids = new uint32_t[result_size];
+            std::copy(pinned->doc_ids.begin(), pinned->doc_ids.end(), result_ids);
+        }
+    }
+
+    if(filters.empty() || pinned != nullptr) {
+        // numeric facets have no live counts: their values are scanned for the documents
+        for(auto & a_facet: facets) {
+            if(a_facet.is_numeric) {
+                do_numeric_facet(a_facet, result_ids, result_size, 1.0);
+            }
+        }
+    } else {
+        Option<uint32_t> op_filter_ids_length = do_filtering(&result_ids, filters);
+        if(!op_filter_ids_length.ok()) {
+            outcome = Option<uint32_t>(op_filter_ids_length);
+            return ;
+        }
+
+        result_size = op_filter_ids_length.get();
+        do_facets(facets, result_ids, result_size);
+    }
+
+    all_result_ids_len = result_size;
+
+    if(!count_only) {
+        // there are no query tokens to match, so the hits are ordered only on the sort fields
+        Topster<512> topster;
+        num_scored_docs += result_size;
+        score_results(sort_fields, searched_queries.size(), 0, topster, {}, result_ids, result_size);
+        searched_queries.push_back({});
+
+        topster.sort();
+        for(uint32_t t = 0; t < topster.size && t < num_results; t++) {
+            field_order_kvs.push_back(std::make_pair(field_order, topster.getKV(t)));
+        }
+    }
+
+    delete [] result_ids;
+
+    resolve_facet_values(facets);
+    outcome = Option<uint32_t>(field_order_kvs.size());
+}
+
 /*
    1. Split the query into tokens
    2. Outer loop will generate bounded cartesian product with costs for each token
@@ -619,13 +1623,15 @@ void Index::search(Option<uint32_t> & outcome, std::string query, const std::vec
    4. Intersect the lists to find docs that match each phrase
    5. Sort the docs based on some ranking criteria
 */
-void Index::search_field(std::string & query, const std::string & field, uint32_t *filter_ids, size_t filter_ids_length,
-                              std::vector<facet> & facets, const std::vector<sort_by> & sort_fields, const int num_typos,
+void Index::search_field(std::string & query, const uint32_t field_id, uint32_t *filter_ids, size_t filter_ids_length,
+                              const std::vector<filter_check> & filter_checks, std::vector<facet> & facets, const std::vector<sort_by> & sort_fields, const int num_typos,
                               const size_t num_results, std::vector<std::vector<art_leaf*>> & searched_queries,
                               Topster<512> &topster, uint32_t** all_result_ids, size_t & all_result_ids_len,
-                              const token_ordering token_order, const bool prefix) {
+                              const token_ordering token_order, const bool prefix, const bool count_only,
+                              const bool infix) {
+    const analyzer & field_analyzer = analyzers[field_id];
     std::vector<std::string> tokens;
-    StringUtils::split(query, tokens, " ");
+    field_analyzer.split(query, tokens);
 
     const size_t max_cost = (num_typos < 0 || num_typos > 2) ? 2 : num_typos;
 
@@ -654,7 +1660,7 @@ void Index::search_field(std::string & query, const std::string & field, uint32_
         }
 
         token_to_costs.push_back(all_costs);
-        string_utils.unicode_normalize(tokens[token_index]);
+        field_analyzer.normalize(tokens[token_index]);
     }
 
     // stores candidates for each token, i.e. i-th index would have all possible tokens with a cost of "c"
@@ -693,10 +1699,22 @@ void Index::search_field(std::string & query, const std::string & field, uint32_
                 const bool prefix_search = prefix && ((token_index == tokens.size()-1) ? true : false);
                 const size_t token_len = prefix_search ? (int) token.length() : (int) token.length() + 1;
 
-                // If this is a prefix search, look for more candidates and do a union of those document IDs
-                const int max_candidates = prefix_search ? 10 : 3;
-                art_fuzzy_search(search_index.at(field), (const unsigned char *) token.c_str(), token_len,
-                                 costs[token_index], costs[token_index], max_candidates, token_order, prefix_search, leaves);
+                // an infix search matches tokens that contain the query token exactly: typos are left to the
+                // fuzzy search, as are query tokens that are too short to have trigrams
+                const bool infix_search = infix && costs[token_index] == 0 && infix_indices[field_id] != nullptr &&
+                                          token.length() >= infix_index::MIN_INFIX_LEN;
+
+                // If this is a prefix or an infix search, look for more candidates and do a union of those document IDs
+                const int max_candidates = (prefix_search || infix_search) ? 10 : 3;
+
+                if(infix_search) {
+                    search_infix(field_id, token, token_order, max_candidates, leaves);
+                } else {
+                    art_fuzzy_search(search_index[field_id], (const unsigned char *) token.c_str(), token_len,
+                                     costs[token_index], costs[token_index], max_candidates, token_order, prefix_search, leaves);
+                }
+
+                load_leaves(field_id, leaves);
 
                 if(!leaves.empty()) {
                     token_cost_cache.emplace(token_cost_hash, leaves);
@@ -733,9 +1751,9 @@ void Index::search_field(std::string & query, const std::string & field, uint32_
 
         if(token_candidates_vec.size() != 0 && token_candidates_vec.size() == tokens.size()) {
             // If all tokens were found, go ahead and search for candidates with what we have so far
-            search_candidates(filter_ids, filter_ids_length, facets, sort_fields, token_candidates_vec,
+            search_candidates(filter_ids, filter_ids_length, filter_checks, facets, sort_fields, token_candidates_vec,
                               token_order, searched_queries, topster, total_results, all_result_ids, all_result_ids_len,
-                              Index::SEARCH_LIMIT_NUM, prefix);
+                              Index::SEARCH_LIMIT_NUM, prefix, count_only);
 
             if (total_results >= Index::SEARCH_LIMIT_NUM) {
                 // If we don't find enough results, we continue outerloop (looking at tokens with greater cost)
@@ -767,10 +1785,32 @@ void Index::search_field(std::string & query, const std::string & field, uint32_
             truncated_query += " " + token_count_pairs.at(i).first;
         }
 
-        return search_field(truncated_query, field, filter_ids, filter_ids_length, facets, sort_fields, num_typos,
+        return search_field(truncated_query, field_id, filter_ids, filter_ids_length, filter_checks, facets,
+                            sort_fields, num_typos,
                             num_results, searched_queries, topster, all_result_ids, all_result_ids_len,
-                            token_order, prefix);
+                            token_order, prefix, count_only, infix);
+    }
+}
+
+void Index::search_infix(const uint32_t field_id, const std::string & infix, const token_ordering token_order,
+                         const size_t max_candidates, std::vector<art_leaf*> & leaves) const {
+    std::vector<std::string> tokens;
+    infix_indices[field_id]->search(infix, tokens, INFIX_MAX_TOKENS);
+
+    for(const std::string & token: tokens) {
+        // the infix index keeps the tokens that are no longer in any document
+        art_leaf* leaf = (art_leaf *) art_search(search_index[field_id], (const unsigned char *) token.c_str(),
+                                                 (int) token.length() + 1);
+        if(leaf != nullptr) {
+            leaves.push_back(leaf);
+        }
     }
+
+    // only the best `max_candidates` leaves are kept, so there is no need to order the rest
+    const size_t num_best = std::min(leaves.size(), max_candidates);
+    std::partial_sort(leaves.begin(), leaves.begin() + num_best, leaves.end(),
+                      (token_order == FREQUENCY) ? compare_art_leaf_frequency : compare_art_leaf_score);
+    leaves.resize(num_best);
 }
 
 void Index::log_leaves(const int cost, const std::string &token, const std::vector<art_leaf *> &leaves) const {
@@ -798,8 +1838,8 @@ void Index::score_results(const std::vector<sort_by> & sort_fields, const int &
         leaf_to_indices.emplace(token_leaf, indices);
     }
 
-    spp::sparse_hash_map<uint32_t, number_t> * primary_rank_scores = nullptr;
-    spp::sparse_hash_map<uint32_t, number_t> * secondary_rank_scores = nullptr;
+    const numeric_column* primary_rank_scores = nullptr;
+    const numeric_column* secondary_rank_scores = nullptr;
 
     // Used for asc/desc ordering. NOTE: Topster keeps biggest keys (i.e. it's desc in nature)
     number_t primary_rank_factor;
@@ -807,10 +1847,11 @@ void Index::score_results(const std::vector<sort_by> & sort_fields, const int &
 
     if(sort_fields.size() > 0) {
         // assumed that rank field exists in the index - checked earlier in the chain
-        primary_rank_scores = sort_index.at(sort_fields[0].name);
+        const uint32_t sort_field_id = field_ids.at(sort_fields[0].name);
+        primary_rank_scores = sort_index[sort_field_id];
 
         // initialize primary_rank_factor
-        field sort_field = sort_schema.at(sort_fields[0].name);
+        const field & sort_field = schema[sort_field_id];
         if(sort_field.is_single_integer()) {
             primary_rank_factor = ((int64_t) 1);
         } else {
@@ -823,10 +1864,11 @@ void Index::score_results(const std::vector<sort_by> & sort_fields, const int &
     }
 
     if(sort_fields.size() > 1) {
-        secondary_rank_scores = sort_index.at(sort_fields[1].name);
+        const uint32_t sort_field_id = field_ids.at(sort_fields[1].name);
+        secondary_rank_scores = sort_index[sort_field_id];
 
         // initialize secondary_rank_factor
-        field sort_field = sort_schema.at(sort_fields[1].name);
+        const field & sort_field = schema[sort_field_id];
         if(sort_field.is_single_integer()) {
             secondary_rank_factor = ((int64_t) 1);
         } else {
@@ -852,7 +1894,9 @@ void Index::score_results(const std::vector<sort_by> & sort_fields, const int &
 
         uint64_t match_score = 0;
 
-        if(query_suggestion.size() == 1) {
+        if(query_suggestion.empty()) {
+            // match-all query: ordered only on the sort fields
+        } else if(query_suggestion.size() == 1) {
             match_score = single_token_match_score;
         } else {
             std::vector<std::vector<uint16_t>> token_positions;
@@ -870,13 +1914,11 @@ void Index::score_results(const std::vector<sort_by> & sort_fields, const int &
         number_t secondary_rank_score = default_score;
 
         if(primary_rank_scores) {
-            auto it = primary_rank_scores->find(seq_id);
-            primary_rank_score = (it == primary_rank_scores->end()) ? default_score : it->second;
+            primary_rank_scores->get(seq_id, primary_rank_score);
         }
 
         if(secondary_rank_scores) {
-            auto it = secondary_rank_scores->find(seq_id);
-            secondary_rank_score = (it == secondary_rank_scores->end()) ? default_score : it->second;
+            secondary_rank_scores->get(seq_id, secondary_rank_score);
         }
 
         const number_t & primary_rank_value = primary_rank_score * primary_rank_factor;
@@ -913,14 +1955,20 @@ void Index::populate_token_positions(const std::vector<art_leaf *> &query_sugges
                 continue;
             }
 
-            uint32_t start_offset = token_leaf->values->offset_index.at(doc_index);
-            uint32_t end_offset = (doc_index == token_leaf->values->ids.getLength() - 1) ?
-                                  token_leaf->values->offsets.getLength() :
-                                  token_leaf->values->offset_index.at(doc_index+1);
+            uint32_t offset_bounds[2];
+
+            if(doc_index == token_leaf->values->ids.getLength() - 1) {
+                offset_bounds[0] = token_leaf->values->offset_index.at(doc_index);
+                offset_bounds[1] = token_leaf->values->offsets.getLength();
+            } else {
+                token_leaf->values->offset_index.at_range(doc_index, doc_index+2, offset_bounds);
+            }
+
+            std::vector<uint32_t> offsets(offset_bounds[1] - offset_bounds[0]);
+            token_leaf->values->offsets.at_range(offset_bounds[0], offset_bounds[1], offsets.data());
 
-            while(start_offset < end_offset) {
-                positions.push_back((uint16_t) token_leaf->values->offsets.at(start_offset));
-                start_offset++;
+            for(const uint32_t offset: offsets) {
+                positions.push_back((uint16_t) offset);
             }
 
             token_positions.push_back(positions);
@@ -980,130 +2028,460 @@ void Index::remove_and_shift_offset_index(sorted_array &offset_index, const uint
     delete[] new_array;
 }
 
-Option<uint32_t> Index::remove(const uint32_t seq_id, nlohmann::json & document) {
-    for(auto & name_field: search_schema) {
-        // Go through all the field names and find the keys+values so that they can be removed from in-memory index
-        std::vector<std::string> tokens;
-        if(name_field.second.type == field_types::STRING) {
-            StringUtils::split(document[name_field.first], tokens, " ");
-        } else if(name_field.second.type == field_types::STRING_ARRAY) {
-            tokens = document[name_field.first].get<std::vector<std::string>>();
-        } else if(name_field.second.type == field_types::INT32) {
-            const int KEY_LEN = 8;
-            unsigned char key[KEY_LEN];
-            int32_t value = document[name_field.first].get<int32_t>();
-            encode_int32(value, key);
-            tokens.push_back(std::string((char*)key, KEY_LEN));
-        } else if(name_field.second.type == field_types::INT32_ARRAY) {
-            std::vector<int32_t> values = document[name_field.first].get<std::vector<int32_t>>();
-            for(const int32_t value: values) {
-                const int KEY_LEN = 8;
-                unsigned char key[KEY_LEN];
-                encode_int32(value, key);
-                tokens.push_back(std::string((char*)key, KEY_LEN));
-            }
-        } else if(name_field.second.type == field_types::INT64) {
-            const int KEY_LEN = 8;
-            unsigned char key[KEY_LEN];
-            int64_t value = document[name_field.first].get<int64_t>();
-            encode_int64(value, key);
-            tokens.push_back(std::string((char*)key, KEY_LEN));
-        } else if(name_field.second.type == field_types::INT64_ARRAY) {
-            std::vector<int64_t> values = document[name_field.first].get<std::vector<int64_t>>();
-            for(const int64_t value: values) {
-                const int KEY_LEN = 8;
-                unsigned char key[KEY_LEN];
-                encode_int64(value, key);
-                tokens.push_back(std::string((char*)key, KEY_LEN));
-            }
-        } else if(name_field.second.type == field_types::FLOAT) {
-            const int KEY_LEN = 8;
-            unsigned char key[KEY_LEN];
-            int64_t value = document[name_field.first].get<int64_t>();
-            encode_float(value, key);
-            tokens.push_back(std::string((char*)key, KEY_LEN));
-        } else if(name_field.second.type == field_types::FLOAT_ARRAY) {
-            std::vector<float> values = document[name_field.first].get<std::vector<float>>();
-            for(const float value: values) {
-                const int KEY_LEN = 8;
-                unsigned char key[KEY_LEN];
-                encode_float(value, key);
-                tokens.push_back(std::string((char*)key, KEY_LEN));
-            }
-        } else if(name_field.second.type == field_types::BOOL) {
-            const int KEY_LEN = 1;
-            unsigned char key[KEY_LEN];
-            bool value = document[name_field.first].get<bool>();
-            key[0] = value ? '1' : '0';
-            tokens.push_back(std::string((char*)key, KEY_LEN));
-        } else if(name_field.second.type == field_types::BOOL_ARRAY) {
-            std::vector<bool> values = document[name_field.first].get<std::vector<bool>>();
-            for(const bool value: values) {
-                const int KEY_LEN = 1;
-                unsigned char key[KEY_LEN];
-                key[0] = value ? '1' : '0';
-                tokens.push_back(std::string((char*)key, KEY_LEN));
-            }
+void Index::remove_from_leaf(const uint32_t field_id, art_leaf* leaf, const uint32_t seq_id) {
+    load_leaf(field_id, leaf);
+    uint32_t seq_id_values[1] = {seq_id};
+    uint32_t doc_index = leaf->values->ids.indexOf(seq_id);
+
+    if(doc_index == leaf->values->ids.getLength()) {
+        // not found - happens when 2 tokens repeat in a field, e.g "is it or is is not?"
+        return ;
+    }
+
+    uint32_t start_offset = leaf->values->offset_index.at(doc_index);
+    uint32_t end_offset = (doc_index == leaf->values->ids.getLength() - 1) ?
+                          leaf->values->offsets.getLength() :
+                          leaf->values->offset_index.at(doc_index+1);
+
+    uint32_t doc_indices[1] = {doc_index};
+    remove_and_shift_offset_index(leaf->values->offset_index, doc_indices, 1);
+
+    leaf->values->offsets.remove_index(start_offset, end_offset);
+    leaf->values->ids.remove_values(seq_id_values, 1);
+    search_stats[field_id].num_postings--;
+
+    /*len = leaf->values->offset_index.getLength();
+    for(auto i=0; i<len; i++) {
+        LOG(INFO) << "i: " << i << ", val: " << leaf->values->offset_index.at(i);
+    }
+    LOG(INFO) << "----";*/
+
+    if(leaf->values->ids.getLength() == 0) {
+        // the key lives inside the leaf that is being freed
+        const std::string key((const char *) leaf->key, leaf->key_len);
+
+        if(postings_spilled[field_id]) {
+            postings_store->remove_postings(postings_key_prefix(field_id) + key);
         }
 
-        for(auto & token: tokens) {
-            const unsigned char *key;
-            int key_len;
+        art_values* values = (art_values*) art_delete(search_index[field_id], (const unsigned char *) key.data(),
+                                                      (int) key.length());
+        delete values;
+        values = nullptr;
+    }
+}
 
-            if(name_field.second.type == field_types::STRING_ARRAY || name_field.second.type == field_types::STRING) {
-                string_utils.unicode_normalize(token);
-                key = (const unsigned char *) token.c_str();
-                key_len = (int) (token.length() + 1);
-            } else {
-                key = (const unsigned char *) token.c_str();
-                key_len = (int) (token.length());
+void Index::remove_from_sort_and_facets(const uint32_t seq_id) {
+    // the pinned counts are decremented with the document's facet values, so this has to come first
+    for(pinned_filter & pinned: pinned_filters) {
+        if(pinned.doc_ids.erase(seq_id) != 0) {
+            count_pinned_values(pinned, seq_id, false, facet_field_ids);
+        }
+    }
+
+    // remove facets if any
+    for(const uint32_t facet_field_id: facet_field_ids) {
+        facet_index[facet_field_id].remove_values(seq_id);
+
+        if(sort_index[facet_field_id] != nullptr) {
+            number_t value;
+            if(sort_index[facet_field_id]->get(seq_id, value)) {
+                std::map<double, uint32_t> & values = numeric_facet_values[facet_field_id];
+                const auto value_it = values.find(value.is_float ? (double) value.floatval : (double) value.intval);
+                if(value_it != values.end() && --value_it->second == 0) {
+                    values.erase(value_it);
+                }
             }
+        }
+    }
 
-            art_leaf* leaf = (art_leaf *) art_search(search_index.at(name_field.first), key, key_len);
-            if(leaf != NULL) {
-                uint32_t seq_id_values[1] = {seq_id};
-                uint32_t doc_index = leaf->values->ids.indexOf(seq_id);
+    // remove sort index if any
+    for(const uint32_t sort_field_id: sort_field_ids) {
+        sort_index[sort_field_id]->erase(seq_id);
+    }
+}
 
-                if(doc_index == leaf->values->ids.getLength()) {
-                    // not found - happens when 2 tokens repeat in a field, e.g "is it or is is not?"
-                    continue;
-                }
+Option<uint32_t> Index::remove(const uint32_t seq_id, nlohmann::json & document) {
+    if(forward_index.count(seq_id) != 0) {
+        return remove(seq_id);
+    }
 
-                uint32_t start_offset = leaf->values->offset_index.at(doc_index);
-                uint32_t end_offset = (doc_index == leaf->values->ids.getLength() - 1) ?
-                                      leaf->values->offsets.getLength() :
-                                      leaf->values->offset_index.at(doc_index+1);
+    std::unique_lock<std::mutex> lock(write_mutex);
 
-                uint32_t doc_indices[1] = {doc_index};
-                remove_and_shift_offset_index(leaf->values->offset_index, doc_indices, 1);
+    for(size_t i = 0; i < schema.size(); i++) {
+        // Go through all the fields and find the keys+values so that they can be removed from in-memory index
+        const field & a_field = schema[i];
+        const auto value_it = document.find(a_field.name);
+        if(value_it == document.end()) {
+            continue;
+        }
 
-                leaf->values->offsets.remove_index(start_offset, end_offset);
-                leaf->values->ids.remove_values(seq_id_values, 1);
+        std::vector<std::string> keys;
+        (this->*field_key_extractors[i])(*value_it, a_field, keys);
 
-                /*len = leaf->values->offset_index.getLength();
-                for(auto i=0; i<len; i++) {
-                    LOG(INFO) << "i: " << i << ", val: " << leaf->values->offset_index.at(i);
-                }
-                LOG(INFO) << "----";*/
+        art_tree* t = search_index[a_field.id];
 
-                if(leaf->values->ids.getLength() == 0) {
-                    art_values* values = (art_values*) art_delete(search_index.at(name_field.first), key, key_len);
-                    delete values;
-                    values = nullptr;
-                }
+        for(const std::string & key: keys) {
+            art_leaf* leaf = (art_leaf *) art_search(t, (const unsigned char *) key.data(), (int) key.length());
+            if(leaf != NULL) {
+                remove_from_leaf(a_field.id, leaf, seq_id);
             }
         }
     }
 
-    // remove facets if any
-    for(auto & field_facet_value: facet_index) {
-        field_facet_value.second.doc_values.erase(seq_id);
+    remove_from_sort_and_facets(seq_id);
+    num_documents -= 1;
+
+    return Option<uint32_t>(seq_id);
+}
+
+Option<uint32_t> Index::remove(const uint32_t seq_id) {
+    std::unique_lock<std::mutex> lock(write_mutex);
+
+    auto doc_leaves_it = forward_index.find(seq_id);
+    if(doc_leaves_it == forward_index.end()) {
+        return Option<uint32_t>(404, "Document is not found in the forward index.");
     }
 
-    // remove sort index if any
-    for(auto & field_doc_value_map: sort_index) {
-        field_doc_value_map.second->erase(seq_id);
+    const doc_leaves & entry = doc_leaves_it->second;
+    size_t leaf_index = 0;
+
+    // a field that is still being backfilled might not have an entry yet
+    for(size_t i = 0; i < entry.field_ends.size(); i++) {
+        for(; leaf_index < entry.field_ends[i]; leaf_index++) {
+            remove_from_leaf(schema[i].id, entry.leaves[leaf_index], seq_id);
+        }
     }
 
+    forward_index.erase(doc_leaves_it);
+
+    remove_from_sort_and_facets(seq_id);
+    num_documents -= 1;
+
     return Option<uint32_t>(seq_id);
-}
\ No newline at end of file
+}
+
+bool Index::has_forward_index() const {
+    return forward_index_enabled;
+}
+
+bool Index::has_document(const uint32_t seq_id) const {
+    // every document has a value for each of the fields that the index was created with
+    return sort_index[sort_field_ids[0]]->contains(seq_id);
+}
+
+void Index::add_field(const field & new_field) {
+    art_tree *t = new art_tree;
+    art_tree_init(t);
+    search_index.push_back(t);
+
+    facet_index.emplace_back();
+    numeric_facet_values.emplace_back();
+    search_stats.emplace_back();
+    facet_value_index.push_back(nullptr);
+    infix_indices.push_back(new_field.infix ? new infix_index : nullptr);
+    sort_index.push_back(nullptr);
+    postings_accessed_ms.push_back(postings_clock_ms());
+    postings_spilled.push_back(false);
+    num_spilled_leaves.push_back(0);
+
+    if(new_field.is_facet()) {
+        facet_field_ids.push_back(new_field.id);
+
+        if(new_field.is_string()) {
+            facet_value_index.back() = new art_tree;
+            art_tree_init(facet_value_index.back());
+        }
+    }
+
+    if(new_field.is_sortable()) {
+        sort_index.back() = new numeric_column(new_field.is_single_float());
+        sort_field_ids.push_back(new_field.id);
+    }
+
+    for(pinned_filter & pinned: pinned_filters) {
+        pinned.value_counts.resize(facet_index.size());
+    }
+
+    // field ids are dense: they are never reused, so the schema keeps the entries of dropped fields
+    schema.push_back(new_field);
+    field_indexers.push_back(get_field_indexer(new_field.type_id));
+    field_key_extractors.push_back(get_field_keys(new_field.type_id));
+    analyzers.push_back(analyzer::for_field(new_field));
+}
+
+void Index::backfill(const nlohmann::json & document, const uint32_t seq_id, const int32_t points,
+                     const std::vector<field> & backfill_fields) {
+    std::unique_lock<std::mutex> lock(write_mutex);
+
+    if(!has_document(seq_id)) {
+        // removed since the backfill started
+        return ;
+    }
+
+    std::vector<uint32_t> facet_ids;
+    auto doc_leaves_it = forward_index.find(seq_id);
+
+    for(const field & a_field: backfill_fields) {
+        (this->*field_indexers[a_field.id])(document[a_field.name], a_field, points, seq_id);
+
+        if(doc_leaves_it != forward_index.end() && doc_leaves_it->second.field_ends.size() <= a_field.id) {
+            // fields that the document has no value for end where the previous field ends
+            doc_leaves & entry = doc_leaves_it->second;
+            entry.field_ends.resize(a_field.id, (uint32_t) entry.leaves.size());
+            index_forward_field(document[a_field.name], a_field, a_field.id, entry);
+        }
+
+        if(a_field.is_facet()) {
+            facet_ids.push_back(a_field.id);
+        }
+    }
+
+    for(pinned_filter & pinned: pinned_filters) {
+        if(pinned.doc_ids.count(seq_id) != 0) {
+            count_pinned_values(pinned, seq_id, true, facet_ids);
+        }
+    }
+}
+
+void Index::publish_field(const field & new_field) {
+    field_ids.emplace(new_field.name, new_field.id);
+}
+
+void Index::drop_field(const std::string & field_name) {
+    const auto field_id_it = field_ids.find(field_name);
+    if(field_id_it == field_ids.end()) {
+        return ;
+    }
+
+    const uint32_t field_id = field_id_it->second;
+    field_ids.erase(field_id_it);
+
+    facet_field_ids.erase(std::remove(facet_field_ids.begin(), facet_field_ids.end(), field_id),
+                          facet_field_ids.end());
+    sort_field_ids.erase(std::remove(sort_field_ids.begin(), sort_field_ids.end(), field_id),
+                         sort_field_ids.end());
+
+    // the field's leaves are about to be freed, so they must not be left in the forward index
+    for(auto & doc_leaves_kv: forward_index) {
+        doc_leaves & entry = doc_leaves_kv.second;
+        if(field_id >= entry.field_ends.size()) {
+            continue;
+        }
+
+        const uint32_t field_begin = (field_id == 0) ? 0 : entry.field_ends[field_id - 1];
+        const uint32_t num_leaves = entry.field_ends[field_id] - field_begin;
+        entry.leaves.erase(entry.leaves.begin() + field_begin, entry.leaves.begin() + field_begin + num_leaves);
+
+        for(size_t i = field_id; i < entry.field_ends.size(); i++) {
+            entry.field_ends[i] -= num_leaves;
+        }
+    }
+
+    art_tree_destroy(search_index[field_id]);
+    art_tree_init(search_index[field_id]);
+    discard_postings(field_id);
+
+    if(facet_value_index[field_id] != nullptr) {
+        art_tree_destroy(facet_value_index[field_id]);
+        delete facet_value_index[field_id];
+        facet_value_index[field_id] = nullptr;
+    }
+
+    delete infix_indices[field_id];
+    infix_indices[field_id] = nullptr;
+
+    delete sort_index[field_id];
+    sort_index[field_id] = nullptr;
+
+    facet_index[field_id] = facet_value();
+    numeric_facet_values[field_id].clear();
+    search_stats[field_id] = field_stats();
+
+    for(pinned_filter & pinned: pinned_filters) {
+        pinned.value_counts[field_id].clear();
+    }
+
+    // the dropped field's values are neither indexed nor removed anymore
+    field_indexers[field_id] = &Index::index_field<field_type_t::UNKNOWN>;
+    field_key_extractors[field_id] = &Index::field_keys<field_type_t::UNKNOWN>;
+}
+
+// of the leaves whose values are in memory
+static int collect_resident_leaf_key(void *data, const unsigned char *key, uint32_t key_len, void *value) {
+    if(value != nullptr) {
+        ((std::vector<std::string>*) data)->emplace_back((const char*) key, key_len);
+    }
+
+    return 0;
+}
+
+uint64_t Index::postings_clock_ms() {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Index::set_postings_store(Store* store, const std::string & prefix) {
+    postings_store = store;
+    postings_prefix = prefix;
+}
+
+std::string Index::postings_key_prefix(const uint32_t field_id) const {
+    return postings_prefix + StringUtils::serialize_uint32_t(field_id);
+}
+
+void Index::access_postings(const std::string & field_name) {
+    const auto field_id_it = field_ids.find(field_name);
+    if(field_id_it == field_ids.end()) {
+        return ;
+    }
+
+    postings_accessed_ms[field_id_it->second] = postings_clock_ms();
+}
+
+void Index::load_leaf(const uint32_t field_id, const art_leaf* leaf) {
+    if(leaf->values != nullptr) {
+        return ;
+    }
+
+    const std::string key = postings_key_prefix(field_id) + std::string((const char *) leaf->key, leaf->key_len);
+    art_values* values = new art_values;
+    std::string value;
+
+    if(postings_store->get_postings(key, value) == StoreStatus::FOUND) {
+        size_t offset = values->ids.deserialize(value.data());
+        offset += values->offset_index.deserialize(value.data() + offset);
+        values->offsets.deserialize(value.data() + offset);
+    } else {
+        LOG(ERR) << "Could not load the spilled postings of index " << name << " from the store.";
+    }
+
+    const_cast<art_leaf*>(leaf)->values = values;
+    num_spilled_leaves[field_id]--;
+}
+
+void Index::load_leaves(const uint32_t field_id, const std::vector<art_leaf*> & leaves) {
+    for(const art_leaf* leaf: leaves) {
+        load_leaf(field_id, leaf);
+    }
+}
+
+void Index::load_document_leaves(const nlohmann::json & document) {
+    for(size_t i = 0; i < schema.size(); i++) {
+        const field & a_field = schema[i];
+        const auto value_it = document.find(a_field.name);
+        if(num_spilled_leaves[a_field.id] == 0 || value_it == document.end()) {
+            continue;
+        }
+
+        std::vector<std::string> keys;
+        (this->*field_key_extractors[i])(*value_it, a_field, keys);
+
+        for(const std::string & key: keys) {
+            const art_leaf* leaf = (const art_leaf *) art_search(search_index[a_field.id],
+                                                                 (const unsigned char *) key.data(), (int) key.length());
+            if(leaf != nullptr) {
+                load_leaf(a_field.id, leaf);
+            }
+        }
+    }
+}
+
+size_t Index::spill_postings(const uint32_t field_id) {
+    art_tree* t = search_index[field_id];
+
+    std::vector<std::string> keys;
+    art_iter(t, collect_resident_leaf_key, &keys);
+
+    const std::string key_prefix = postings_key_prefix(field_id);
+    size_t num_bytes = 0;
+
+    // in batches, so that only a batch of the field's postings is ever held twice
+    for(size_t batch_begin = 0; batch_begin < keys.size(); batch_begin += SPILL_BATCH_SIZE) {
+        const size_t batch_end = std::min(keys.size(), batch_begin + SPILL_BATCH_SIZE);
+        std::vector<art_leaf*> leaves;
+        rocksdb::WriteBatch batch;
+        size_t batch_bytes = 0;
+
+        for(size_t i = batch_begin; i < batch_end; i++) {
+            art_leaf* leaf = (art_leaf *) art_search(t, (const unsigned char *) keys[i].data(), (int) keys[i].size());
+            std::string value;
+            leaf->values->ids.serialize(value);
+            leaf->values->offset_index.serialize(value);
+            leaf->values->offsets.serialize(value);
+
+            batch_bytes += value.size();
+            batch.Put(postings_store->get_postings_cf(), key_prefix + keys[i], value);
+            leaves.push_back(leaf);
+        }
+
+        if(!postings_store->postings_batch_write(batch)) {
+            LOG(ERR) << "Could not move the postings of index " << name << " to the store.";
+            break;
+        }
+
+        for(art_leaf* leaf: leaves) {
+            leaf->spilled_length = leaf->values->ids.getLength();
+            delete leaf->values;
+            leaf->values = nullptr;
+        }
+
+        postings_spilled[field_id] = true;
+        num_spilled_leaves[field_id] += leaves.size();
+        num_bytes += batch_bytes;
+    }
+
+    return num_bytes;
+}
+
+void Index::discard_postings(const uint32_t field_id) {
+    if(!postings_spilled[field_id]) {
+        return ;
+    }
+
+    const std::string key_prefix = postings_key_prefix(field_id);
+    rocksdb::Iterator* iter = postings_store->scan_postings(key_prefix);
+    rocksdb::WriteBatch batch;
+
+    while(iter->Valid() && iter->key().starts_with(key_prefix)) {
+        batch.Delete(postings_store->get_postings_cf(), iter->key());
+        iter->Next();
+    }
+
+    delete iter;
+    postings_store->postings_batch_write(batch);
+    postings_spilled[field_id] = false;
+    num_spilled_leaves[field_id] = 0;
+}
+
+size_t Index::spill_cold_postings(const uint64_t cold_after_ms) {
+    std::unique_lock<std::mutex> lock(write_mutex);
+
+    if(postings_store == nullptr) {
+        return 0;
+    }
+
+    const uint64_t now_ms = postings_clock_ms();
+    size_t num_bytes = 0;
+
+    for(const auto & field_id_kv: field_ids) {
+        const uint32_t field_id = field_id_kv.second;
+
+        // the leaves that writes paged in since the last spill are spilled again
+        if(num_spilled_leaves[field_id] != art_size(search_index[field_id]) &&
+           now_ms - postings_accessed_ms[field_id] >= cold_after_ms) {
+            num_bytes += spill_postings(field_id);
+        }
+    }
+
+    return num_bytes;
+}
+
+size_t Index::get_num_spilled_leaves() const {
+    size_t num_leaves = 0;
+    for(const auto & field_id_kv: field_ids) {
+        num_leaves += num_spilled_leaves[field_id_kv.second];
+    }
+
+    return num_leaves;
+}
@@ -0,0 +1,256 @@
+#include "index_memory.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <unistd.h>
+#include <sys/mman.h>
+
+static bool huge_pages = false;
+
+// by the sizes that callers ask for, whichever allocator they come from
+static std::atomic<size_t> allocated_bytes(0);
+
+static size_t soft_limit_bytes = 0;
+static size_t hard_limit_bytes = 0;
+
+static bool resident_counted = false;
+static std::atomic<size_t> resident_bytes(0);
+static std::atomic<uint64_t> resident_sampled_ms(0);
+
+static std::mutex regions_mutex;
+
+// the rest of the region that blocks are being carved from
+static char* region_head = nullptr;
+static size_t region_left = 0;
+
+static index_memory_stats stats = {0, 0, 0, 0, 0};
+
+// a freed block holds the next free block of its class
+static void* free_lists[index_memory::NUM_CLASSES] = {nullptr};
+
+static char* map_region() {
+    void* region = mmap(nullptr, index_memory::REGION_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+    if(region != MAP_FAILED) {
+        stats.num_hugetlb_regions++;
+        return (char*) region;
+    }
+
+    // no huge pages are reserved: map twice the size, so that a region aligned to a huge page can be cut out of it
+    char* mapping = (char*) mmap(nullptr, 2 * index_memory::REGION_SIZE, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(mapping == (char*) MAP_FAILED) {
+        return nullptr;
+    }
+
+    const size_t misalignment = (uintptr_t) mapping % index_memory::REGION_SIZE;
+    char* aligned = (misalignment == 0) ? mapping : mapping + (index_memory::REGION_SIZE - misalignment);
+
+    if(aligned != mapping) {
+        munmap(mapping, aligned - mapping);
+    }
+
+    munmap(aligned + index_memory::REGION_SIZE, (mapping + 2 * index_memory::REGION_SIZE) -
+                                                (aligned + index_memory::REGION_SIZE));
+
+    // best effort: without transparent huge pages, the region is still usable with regular pages
+    madvise(aligned, index_memory::REGION_SIZE, MADV_HUGEPAGE);
+    return aligned;
+}
+
+void* index_memory::alloc_block(const size_t size_class) {
+    const size_t block_size = class_size(size_class);
+    std::lock_guard<std::mutex> lock(regions_mutex);
+
+    if(free_lists[size_class] != nullptr) {
+        void* block = free_lists[size_class];
+        free_lists[size_class] = *(void**) block;
+        return block;
+    }
+
+    if(region_left < block_size) {
+        // the tail of the previous region is too small for this class, and is left unused
+        char* region = map_region();
+        if(region == nullptr) {
+            // a block of the class size can be freed onto the free list like any other
+            return ::malloc(block_size);
+        }
+
+        stats.num_regions++;
+        stats.region_bytes += REGION_SIZE;
+        region_head = region;
+        region_left = REGION_SIZE;
+    }
+
+    void* block = region_head;
+    region_head += block_size;
+    region_left -= block_size;
+    return block;
+}
+
+void index_memory::free_block(void* ptr, const size_t size_class) {
+    std::lock_guard<std::mutex> lock(regions_mutex);
+    *(void**) ptr = free_lists[size_class];
+    free_lists[size_class] = ptr;
+}
+
+void index_memory::use_huge_pages(const bool enabled) {
+    huge_pages = enabled;
+}
+
+bool index_memory::huge_pages_enabled() {
+    return huge_pages;
+}
+
+void* index_memory::alloc(const size_t size) {
+    allocated_bytes += size;
+
+    if(!huge_pages || size > MAX_CLASS_SIZE) {
+        return ::malloc(size);
+    }
+
+    return alloc_block(size_class(size));
+}
+
+void* index_memory::zalloc(const size_t size) {
+    allocated_bytes += size;
+
+    if(!huge_pages || size > MAX_CLASS_SIZE) {
+        return ::calloc(1, size);
+    }
+
+    // blocks are reused, so they are not necessarily zeroed like a fresh mapping
+    void* ptr = alloc_block(size_class(size));
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+void* index_memory::realloc(void* ptr, const size_t old_size, const size_t new_size) {
+    if(!huge_pages || (old_size > MAX_CLASS_SIZE && new_size > MAX_CLASS_SIZE)) {
+        void* new_ptr = ::realloc(ptr, new_size);
+        if(new_ptr != nullptr || new_size == 0) {
+            allocated_bytes += new_size;
+            allocated_bytes -= old_size;
+        }
+
+        return new_ptr;
+    }
+
+    if(old_size <= MAX_CLASS_SIZE && new_size <= MAX_CLASS_SIZE && size_class(old_size) == size_class(new_size)) {
+        allocated_bytes += new_size;
+        allocated_bytes -= old_size;
+        return ptr;
+    }
+
+    void* new_ptr = alloc(new_size);
+    if(new_ptr == nullptr) {
+        return nullptr;
+    }
+
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    free(ptr, old_size);
+    return new_ptr;
+}
+
+void index_memory::free(void* ptr, const size_t size) {
+    if(ptr == nullptr) {
+        return ;
+    }
+
+    allocated_bytes -= size;
+
+    if(!huge_pages || size > MAX_CLASS_SIZE) {
+        return ::free(ptr);
+    }
+
+    free_block(ptr, size_class(size));
+}
+
+index_memory_stats index_memory::get_stats() {
+    std::lock_guard<std::mutex> lock(regions_mutex);
+    index_memory_stats current_stats = stats;
+    current_stats.allocated_bytes = allocated_bytes;
+    current_stats.resident_bytes = resident_bytes;
+    return current_stats;
+}
+
+void index_memory::count_resident_memory(const bool enabled) {
+    resident_counted = enabled;
+}
+
+// the bytes that the limits are held against
+static size_t limited_bytes() {
+    if(!resident_counted) {
+        return allocated_bytes;
+    }
+
+    const uint64_t now_ms = (uint64_t) std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    uint64_t sampled_ms = resident_sampled_ms;
+
+    // only one of the threads that find the sample stale takes a new one
+    if(now_ms - sampled_ms >= index_memory::RESIDENT_SAMPLE_INTERVAL_MS &&
+       resident_sampled_ms.compare_exchange_strong(sampled_ms, now_ms)) {
+        FILE* statm = fopen("/proc/self/statm", "r");
+        unsigned long num_pages = 0, num_resident_pages = 0;
+
+        if(statm != nullptr) {
+            if(fscanf(statm, "%lu %lu", &num_pages, &num_resident_pages) == 2) {
+                resident_bytes = (size_t) num_resident_pages * (size_t) sysconf(_SC_PAGESIZE);
+            }
+
+            fclose(statm);
+        }
+    }
+
+    const size_t allocated = allocated_bytes;
+    const size_t resident = resident_bytes;
+    return allocated > resident ? allocated : resident;
+}
+
+void index_memory::set_limits(const size_t soft_limit, const size_t hard_limit) {
+    soft_limit_bytes = soft_limit;
+    hard_limit_bytes = hard_limit;
+}
+
+memory_pressure index_memory::get_pressure() {
+    const size_t bytes = limited_bytes();
+
+    if(hard_limit_bytes != 0 && bytes >= hard_limit_bytes) {
+        return MEMORY_PRESSURE_HARD;
+    }
+
+    if(soft_limit_bytes != 0 && bytes >= soft_limit_bytes) {
+        return MEMORY_PRESSURE_SOFT;
+    }
+
+    return MEMORY_PRESSURE_NONE;
+}
+
+float index_memory::get_soft_pressure() {
+    const size_t bytes = limited_bytes();
+
+    if(soft_limit_bytes == 0 || bytes < soft_limit_bytes) {
+        return 0;
+    }
+
+    if(hard_limit_bytes <= soft_limit_bytes || bytes >= hard_limit_bytes) {
+        return 1;
+    }
+
+    return (float) (bytes - soft_limit_bytes) / (hard_limit_bytes - soft_limit_bytes);
+}
+
+size_t index_memory::get_soft_limit() {
+    return soft_limit_bytes;
+}
+
+size_t index_memory::get_hard_limit() {
+    return hard_limit_bytes;
+}
@@ -0,0 +1,84 @@
+#include "infix_index.h"
+
+#include <algorithm>
+
+infix_index::~infix_index() {
+    for(auto & trigram_posting: trigram_postings) {
+        delete trigram_posting.second;
+    }
+
+    trigram_postings.clear();
+}
+
+void infix_index::add(const std::string & token) {
+    if(token.size() < MIN_INFIX_LEN || token_ids.count(token) != 0) {
+        return ;
+    }
+
+    const uint32_t token_id = (uint32_t) tokens.size();
+    tokens.push_back(token);
+    token_ids.emplace(token, token_id);
+
+    // ids only grow, so they are appended to the postings in order
+    for(size_t i = 0; i + MIN_INFIX_LEN <= token.size(); i++) {
+        sorted_array* & posting = trigram_postings[trigram(token, i)];
+        if(posting == nullptr) {
+            posting = new sorted_array;
+        }
+
+        // a trigram that repeats within the token is already there: as the last and largest id of its posting
+        if(posting->getLength() == 0 || posting->getMax() != token_id) {
+            posting->append(token_id);
+        }
+    }
+}
+
+void infix_index::search(const std::string & infix, std::vector<std::string> & matching_tokens,
+                         const size_t max_tokens) const {
+    if(infix.size() < MIN_INFIX_LEN) {
+        return ;
+    }
+
+    std::vector<sorted_array*> postings;
+
+    for(size_t i = 0; i + MIN_INFIX_LEN <= infix.size(); i++) {
+        const auto posting_it = trigram_postings.find(trigram(infix, i));
+        if(posting_it == trigram_postings.end()) {
+            return ;
+        }
+
+        postings.push_back(posting_it->second);
+    }
+
+    // starting from the shortest posting keeps the intermediate candidates few
+    std::sort(postings.begin(), postings.end(), [](sorted_array* a, sorted_array* b) {
+        return a->getLength() < b->getLength();
+    });
+
+    uint32_t* candidates = postings[0]->uncompress();
+    size_t num_candidates = postings[0]->getLength();
+
+    for(size_t i = 1; i < postings.size() && num_candidates != 0; i++) {
+        if(postings[i] == postings[i-1]) {
+            continue;
+        }
+
+        uint32_t* out = nullptr;
+        num_candidates = postings[i]->intersect(candidates, num_candidates, &out);
+        delete [] candidates;
+        candidates = out;
+    }
+
+    for(size_t i = 0; i < num_candidates && matching_tokens.size() < max_tokens; i++) {
+        const std::string & token = tokens[candidates[i]];
+        if(token.find(infix) != std::string::npos) {
+            matching_tokens.push_back(token);
+        }
+    }
+
+    delete [] candidates;
+}
+
+size_t infix_index::num_tokens() const {
+    return tokens.size();
+}
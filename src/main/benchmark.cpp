@@ -7,15 +7,45 @@
 #include <art.h>
 #include <unordered_map>
 #include <queue>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 #include "collection.h"
 #include "string_utils.h"
 #include "collection_manager.h"
+#include "index_memory.h"
 
 using namespace std;
 
+// counts the data TLB misses of this process, or returns -1 when perf events are not available
+static int open_dtlb_miss_counter() {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;   // the searches run on the index threads
+
+    return (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// usage: ./benchmark <documents.jsonl> [--huge-pages]
 int main(int argc, char* argv[]) {
     system("rm -rf /tmp/typesense-data && mkdir -p /tmp/typesense-data");
 
+    // compare the TLB misses and the latencies of the searches with and without huge pages
+    const bool huge_pages = (argc > 2 && std::string(argv[2]) == "--huge-pages");
+    index_memory::use_huge_pages(huge_pages);
+
+    // opened before the collection, since only the threads that are created afterwards (its index threads) inherit it
+    const int dtlb_counter = open_dtlb_miss_counter();
+
     std::vector<field> fields_to_index = { field("title", field_types::STRING, false),
                                            field("points", field_types::INT32, false) };
 
@@ -40,23 +70,51 @@ int main(int argc, char* argv[]) {
     infile.close();
     std::cout << "FINISHED INDEXING!" << flush << std::endl;
 
-    /*std::vector<std::string> search_fields = {"title"};
+    long long int timeMillis = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - begin).count();
+    std::cout << "Time taken for indexing: " << timeMillis << "ms" << std::endl;
+
+    // search + serialization, which is what every search API call does on its way to the response body
+    std::vector<std::string> search_fields = {"title"};
+    std::vector<std::string> facets;
+    std::vector<sort_by> sort_fields = { sort_by("points", "DESC") };
 
     std::vector<string> queries = {"the", "and", "to", "of", "in"};
-    auto counter = 0;
+    const int num_searches = 3000;
     uint64_t results_total = 0; // to prevent optimizations!
 
-    auto begin = std::chrono::high_resolution_clock::now();
+    if(dtlb_counter != -1) {
+        ioctl(dtlb_counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(dtlb_counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    begin = std::chrono::high_resolution_clock::now();
 
-    while(counter < 3000) {
+    for(int counter = 0; counter < num_searches; counter++) {
         auto i = counter % 5;
-        auto results = collection->search(queries[i], search_fields, "", { }, {sort_field("points", "DESC")}, 1, 10, 1, MAX_SCORE, 0).get();
-        results_total += results.size();
-        counter++;
-    }*/
+        nlohmann::json results = collection->search(queries[i], search_fields, "", facets, sort_fields, 1, 10, 1,
+                                                    MAX_SCORE, false).get();
+        results_total += results.dump().size();
+    }
 
-    long long int timeMillis = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - begin).count();
-    std::cout << "Time taken: " << timeMillis << "ms" << std::endl;
-    //std::cout << "Total: " << results_total << std::endl;
+    long long int timeMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - begin).count();
+    std::cout << "Time taken for " << num_searches << " searches: " << (timeMicros / 1000) << "ms, "
+              << "avg: " << (timeMicros / num_searches) << "us" << std::endl;
+    std::cout << "Total bytes serialized: " << results_total << std::endl;
+
+    if(dtlb_counter != -1) {
+        uint64_t dtlb_misses = 0;
+        ioctl(dtlb_counter, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(dtlb_counter, &dtlb_misses, sizeof(dtlb_misses)) == sizeof(dtlb_misses)) {
+            std::cout << "dTLB misses during searches " << (huge_pages ? "with" : "without") << " huge pages: "
+                      << dtlb_misses << ", avg: " << (dtlb_misses / num_searches) << " per search" << std::endl;
+        }
+        close(dtlb_counter);
+    } else {
+        std::cout << "dTLB misses are not available: perf events can't be opened." << std::endl;
+    }
+
+    const index_memory_stats stats = index_memory::get_stats();
+    std::cout << "Huge page regions: " << stats.num_regions << " (" << stats.num_hugetlb_regions
+              << " reserved), " << (stats.region_bytes / (1024 * 1024)) << "MB" << std::endl;
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,151 @@
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+#include "json.hpp"
+#include "string_utils.h"
+#include "posting_codec.h"
+
+using namespace std;
+
+/*
+ * Reports the compression ratio and the decoding speed of every posting codec, and of the per list codec choice,
+ * on the posting lists of a string field in a JSONL corpus:
+ *
+ *   codec_benchmark documents.jsonl [field] [decode_rounds]
+ */
+
+struct posting_lists {
+    std::vector<std::vector<uint32_t>> ids;
+    std::vector<std::vector<uint32_t>> offset_index;
+    std::vector<std::vector<uint32_t>> offsets;
+};
+
+static void build_posting_lists(std::ifstream & infile, const std::string & field_name, posting_lists & lists) {
+    StringUtils string_utils;
+    std::unordered_map<std::string, size_t> token_lists;
+    std::string json_line;
+    uint32_t seq_id = 0;
+
+    while (std::getline(infile, json_line)) {
+        nlohmann::json document = nlohmann::json::parse(json_line);
+        if(document.count(field_name) == 0 || !document[field_name].is_string()) {
+            continue;
+        }
+
+        std::vector<std::string> tokens;
+        StringUtils::split(document[field_name].get<std::string>(), tokens, " ");
+
+        std::unordered_map<std::string, std::vector<uint32_t>> token_to_offsets;
+        for(uint32_t i = 0; i < tokens.size(); i++) {
+            string_utils.unicode_normalize(tokens[i]);
+            token_to_offsets[tokens[i]].push_back(i);
+        }
+
+        for(auto & kv: token_to_offsets) {
+            auto list_it = token_lists.find(kv.first);
+            if(list_it == token_lists.end()) {
+                list_it = token_lists.emplace(kv.first, lists.ids.size()).first;
+                lists.ids.emplace_back();
+                lists.offset_index.emplace_back();
+                lists.offsets.emplace_back();
+            }
+
+            const size_t list = list_it->second;
+            lists.ids[list].push_back(seq_id);
+            lists.offset_index[list].push_back((uint32_t) lists.offsets[list].size());
+            lists.offsets[list].insert(lists.offsets[list].end(), kv.second.begin(), kv.second.end());
+        }
+
+        seq_id++;
+    }
+}
+
+// a codec of nullptr stands for the codec that posting_codec::choose() picks for each list
+static void benchmark_codec(const std::string & list_type, const std::vector<std::vector<uint32_t>> & lists,
+                            const bool sorted, const posting_codec* codec, const int decode_rounds) {
+    std::vector<std::vector<uint8_t>> encoded_lists;
+    std::vector<const posting_codec*> list_codecs;
+    uint64_t raw_bytes = 0;
+    uint64_t encoded_bytes = 0;
+    uint64_t num_values = 0;
+
+    for(const auto & list: lists) {
+        const posting_codec* list_codec = (codec != nullptr) ? codec :
+                                          posting_codec::get(posting_codec::choose(list.data(), list.size(), sorted));
+
+        const uint32_t size = list_codec->encoded_size(list.data(), list.size(), sorted);
+        encoded_lists.emplace_back(size + sizeof(uint64_t));
+        list_codec->encode(list.data(), list.size(), sorted, encoded_lists.back().data());
+        list_codecs.push_back(list_codec);
+
+        raw_bytes += list.size() * sizeof(uint32_t);
+        encoded_bytes += size;
+        num_values += list.size();
+    }
+
+    std::vector<uint32_t> out;
+    uint64_t checksum = 0; // to prevent optimizations!
+
+    auto begin = std::chrono::high_resolution_clock::now();
+
+    for(int round = 0; round < decode_rounds; round++) {
+        for(size_t i = 0; i < lists.size(); i++) {
+            out.resize(lists[i].size());
+            list_codecs[i]->decode(encoded_lists[i].data(), lists[i].size(), sorted, out.data());
+            checksum += out.empty() ? 0 : out.back();
+        }
+    }
+
+    long long int timeMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - begin).count();
+
+    const double ratio = encoded_bytes == 0 ? 0 : (double) raw_bytes / encoded_bytes;
+    const double values_per_micro = timeMicros == 0 ? 0 : (double) num_values * decode_rounds / timeMicros;
+
+    std::cout << std::left << std::setw(14) << list_type << std::setw(8) << (codec ? codec->name() : "auto")
+              << std::right << std::setw(14) << encoded_bytes << std::setw(10) << std::fixed << std::setprecision(2)
+              << ratio << std::setw(14) << std::setprecision(1) << values_per_micro
+              << "   (checksum " << checksum << ")" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " documents.jsonl [field] [decode_rounds]" << std::endl;
+        return 1;
+    }
+
+    const std::string field_name = (argc > 2) ? argv[2] : "title";
+    const int decode_rounds = (argc > 3) ? atoi(argv[3]) : 10;
+
+    std::ifstream infile(argv[1]);
+    posting_lists lists;
+    build_posting_lists(infile, field_name, lists);
+    infile.close();
+
+    std::cout << "Posting lists of `" << field_name << "`: " << lists.ids.size() << std::endl << std::endl;
+    std::cout << std::left << std::setw(14) << "list" << std::setw(8) << "codec" << std::right << std::setw(14)
+              << "bytes" << std::setw(10) << "ratio" << std::setw(14) << "values/us" << std::endl;
+
+    const std::vector<const posting_codec*> codecs = {
+        posting_codec::get(codec_t::FOR), posting_codec::get(codec_t::BP128),
+        posting_codec::get(codec_t::VBYTE), posting_codec::get(codec_t::RAW), nullptr
+    };
+
+    for(const posting_codec* codec: codecs) {
+        benchmark_codec("ids", lists.ids, true, codec, decode_rounds);
+    }
+
+    for(const posting_codec* codec: codecs) {
+        benchmark_codec("offset_index", lists.offset_index, true, codec, decode_rounds);
+    }
+
+    for(const posting_codec* codec: codecs) {
+        benchmark_codec("offsets", lists.offsets, false, codec, decode_rounds);
+    }
+
+    return 0;
+}
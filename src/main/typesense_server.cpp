@@ -3,6 +3,10 @@
 #include <vector>
 #include <string>
 #include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <cmdline.h>
@@ -10,6 +14,10 @@
 #include "api.h"
 #include "string_utils.h"
 #include "replicator.h"
+#include "coordinator.h"
+#include "query_log.h"
+#include "search_scheduler.h"
+#include "index_memory.h"
 #include "logger.h"
 
 HttpServer* server;
@@ -20,6 +28,11 @@ void catch_interrupt(int sig) {
     server->stop();
 }
 
+// a background thread that acts on what has been idle for `idle_ms` checks a quarter as often, within limits
+uint64_t background_interval_ms(const uint64_t idle_ms) {
+    return std::min<uint64_t>(std::max<uint64_t>(idle_ms / 4, 1000), 60 * 1000);
+}
+
 bool directory_exists(const std::string & dir_path) {
     struct stat info;
     return stat(dir_path.c_str(), &info) == 0 && (info.st_mode & S_IFDIR);
@@ -30,17 +43,20 @@ void master_server_routes() {
     server->post("/collections", post_create_collection);
     server->get("/collections", get_collections);
     server->del("/collections/:collection", del_drop_collection);
+    server->put("/collections/:collection", put_alter_collection);
     server->get("/collections/:collection", get_collection_summary);
 
     // document management - `/documents/:id` end-points must be placed last in the list
     server->post("/collections/:collection/documents", post_add_document);
-    server->get("/collections/:collection/documents/search", get_search);
+    server->post("/collections/:collection/documents/import", post_import_documents, false, true);
+    server->get("/collections/:collection/documents/search", schedule_search, true);
     server->get("/collections/:collection/documents/export", get_collection_export, true);
     server->get("/collections/:collection/documents/:id", get_fetch_document);
     server->del("/collections/:collection/documents/:id", del_remove_document);
 
     // meta
     server->get("/debug", get_debug);
+    server->get("/metrics.json", get_metrics_json);
 
     // replication
     server->get("/replication/updates", get_replication_updates, true);
@@ -52,17 +68,51 @@ void replica_server_routes() {
     server->get("/collections/:collection", get_collection_summary);
 
     // document management - `/documents/:id` end-points must be placed last in the list
-    server->get("/collections/:collection/documents/search", get_search);
+    server->get("/collections/:collection/documents/search", schedule_search, true);
     server->get("/collections/:collection/documents/export", get_collection_export, true);
     server->get("/collections/:collection/documents/:id", get_fetch_document);
 
     // meta
     server->get("/debug", get_debug);
+    server->get("/metrics.json", get_metrics_json);
 
     // replication
     server->get("/replication/updates", get_replication_updates, true);
 }
 
+void coordinator_server_routes() {
+    // collection management
+    server->post("/collections", coordinator_post_create_collection, true);
+    server->get("/collections", coordinator_get_collections, true);
+    server->del("/collections/:collection", coordinator_del_drop_collection, true);
+    server->put("/collections/:collection", coordinator_put_alter_collection, true);
+    server->get("/collections/:collection", coordinator_get_collection_summary, true);
+
+    // document management - `/documents/:id` end-points must be placed last in the list
+    server->post("/collections/:collection/documents", coordinator_post_add_document, true);
+    server->get("/collections/:collection/documents/search", coordinator_get_search, true);
+    server->get("/collections/:collection/documents/:id", coordinator_get_fetch_document, true);
+    server->del("/collections/:collection/documents/:id", coordinator_del_remove_document, true);
+}
+
+// replays the most frequent searches of the query log one at a time, before the server accepts requests
+void warm_up(const std::vector<std::map<std::string, std::string>> & queries) {
+    size_t num_failed = 0;
+
+    for(const std::map<std::string, std::string> & params: queries) {
+        http_req req{nullptr, params, "", "", false, nullptr};
+        http_res res;
+        get_search(req, res);
+
+        if(res.status_code != 200) {
+            num_failed++;
+        }
+    }
+
+    LOG(INFO) << "Warmed up with " << queries.size() - num_failed << " searches from the query log, "
+              << num_failed << " of them failed.";
+}
+
 int main(int argc, char **argv) {
     // remove SIGTERM since we handle it on our own
     g3::overrideSetupSignals({{SIGABRT, "SIGABRT"}, {SIGFPE, "SIGFPE"},{SIGILL, "SIGILL"}, {SIGSEGV, "SIGSEGV"},});
@@ -82,12 +132,46 @@ int main(int argc, char **argv) {
     options.add<uint32_t>("listen-port", 'p', "Port on which Typesense server listens.", false, 8108);
     options.add<std::string>("master", 'm', "Provide the master's address in http(s)://<master_address>:<master_port> "
                                             "format to start the server as a read-only replica.", false, "");
+    options.add<std::string>("nodes", 'n', "Provide a comma separated list of node addresses in "
+                                           "http(s)://<address>:<port> format to start the server as a coordinator "
+                                           "that partitions collections across the nodes.", false, "");
 
     options.add<std::string>("ssl-certificate", 'c', "Path to the SSL certificate file.", false, "");
     options.add<std::string>("ssl-certificate-key", 'k', "Path to the SSL certificate key file.", false, "");
 
     options.add("enable-cors", '\0', "Enable CORS requests.");
+    options.add("enable-forward-index", '\0', "Keep a per-document forward index in memory, so that deletes don't "
+                "have to read the document back from the disk.");
+    options.add("huge-pages", '\0', "Allocate the memory of the indices from 2MB huge pages, which reduces TLB "
+                "misses on large indices.");
     options.add<std::string>("log-dir", '\0', "Path to the log file.", false, "");
+    options.add<std::string>("query-log", '\0', "Path to a file where a sample of the searches is recorded. Its most "
+                             "frequent searches are replayed on startup to warm up the caches.", false, "");
+    options.add<uint32_t>("query-log-sample-rate", '\0', "Record one in every N searches in the query log.", false, 10);
+    options.add<uint32_t>("warmup-searches", '\0', "Number of searches of the query log to replay on startup.",
+                          false, 100);
+    options.add<uint32_t>("memory-soft-limit", '\0', "Memory of the process (its resident set), in MB, above "
+                          "which writes are throttled. 0 for no limit.", false, 0);
+    options.add<uint32_t>("memory-hard-limit", '\0', "Memory of the process (its resident set), in MB, above "
+                          "which writes are rejected, while searches are still served. 0 for no limit.", false, 0);
+    options.add<uint32_t>("tenant-max-concurrent", '\0', "Maximum number of searches of a collection that can be "
+                          "waiting or running at the same time. 0 for no limit.", false, 0);
+    options.add<uint32_t>("tenant-max-qps", '\0', "Maximum number of searches per second on a collection. "
+                          "0 for no limit.", false, 0);
+    options.add<std::string>("tenant-limits", '\0', "Comma separated limits of individual collections, in "
+                             "<collection>:<weight>:<max concurrent>:<max qps> format. A collection with twice the "
+                             "weight gets twice the search time when searches of several collections are waiting.",
+                             false, "");
+    options.add<uint32_t>("cold-postings-after", '\0', "Move the posting lists of a field out of memory, into the "
+                          "data directory, when it was not searched for this many seconds. 0 keeps them in memory.",
+                          false, 0);
+    options.add<uint32_t>("background-threads", '\0', "Number of threads that flush and compact the data directory "
+                          "in the background.", false, 16);
+    options.add<uint32_t>("io-rate-limit", '\0', "Disk writes of the background flushes and compactions, in MB per "
+                          "second. 0 for no limit.", false, 0);
+    options.add("low-io-priority", '\0', "Run the background compactions with a lower I/O priority than searches.");
+    options.add<uint32_t>("idle-compaction-after", '\0', "Compact the data directory when there were no writes for "
+                          "this many seconds. 0 leaves compactions to the writes.", false, 300);
 
     options.parse_check(argc, argv);
 
@@ -120,15 +204,50 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    if(options.exist("huge-pages")) {
+        index_memory::use_huge_pages(true);
+    }
+
+    const size_t memory_soft_limit = (size_t) options.get<uint32_t>("memory-soft-limit") * 1024 * 1024;
+    const size_t memory_hard_limit = (size_t) options.get<uint32_t>("memory-hard-limit") * 1024 * 1024;
+
+    if(memory_soft_limit != 0 && memory_hard_limit != 0 && memory_soft_limit > memory_hard_limit) {
+        LOG(ERR) << "Typesense failed to start. The --memory-soft-limit can't be above the --memory-hard-limit.";
+        return 1;
+    }
+
+    index_memory::set_limits(memory_soft_limit, memory_hard_limit);
+
+    // the allocated bytes leave out much of what the indices hold, such as their facet and sort indices
+    index_memory::count_resident_memory(true);
+
+    Option<bool> scheduler_op = SearchScheduler::get_instance().init(
+            tenant_limits(1.0, options.get<uint32_t>("tenant-max-concurrent"), options.get<uint32_t>("tenant-max-qps")),
+            options.get<std::string>("tenant-limits"));
+
+    if(!scheduler_op.ok()) {
+        LOG(ERR) << "Typesense failed to start. " << scheduler_op.error();
+        return 1;
+    }
+
     LOG(INFO) << "Loading collections from disk...";
 
-    Store store(options.get<std::string>("data-dir"));
+    Store store(options.get<std::string>("data-dir"), 24*60*60, 1024, options.get<uint32_t>("background-threads"),
+                options.get<uint32_t>("io-rate-limit"), options.exist("low-io-priority"));
     CollectionManager & collectionManager = CollectionManager::get_instance();
     Option<bool> init_op = collectionManager.init(&store, options.get<std::string>("api-key"),
-                                                  options.get<std::string>("search-only-api-key"));
+                                                  options.get<std::string>("search-only-api-key"),
+                                                  options.exist("enable-forward-index"));
 
     if(init_op.ok()) {
         LOG(INFO) << "Finished loading collections from disk.";
+
+        if(index_memory::huge_pages_enabled()) {
+            const index_memory_stats stats = index_memory::get_stats();
+            LOG(INFO) << "Index memory is in " << stats.num_regions << " huge page regions, "
+                      << stats.num_hugetlb_regions << " of them from reserved huge pages and the rest "
+                      << "from transparent huge pages.";
+        }
     } else {
         LOG(ERR)<< "Typesense failed to start. " << "Could not load collections from disk: " << init_op.error();
         return 1;
@@ -146,8 +265,31 @@ int main(int argc, char **argv) {
 
     server->on(SEND_RESPONSE_MSG, on_send_response);
     server->on(REPLICATION_EVENT_MSG, Replicator::on_replication_event);
+    server->on(SPILL_POSTINGS_MSG, on_spill_postings);
+    server->on(RUN_SEARCH_MSG, on_run_search);
+
+    if(!options.get<std::string>("nodes").empty()) {
+        if(!options.get<std::string>("master").empty()) {
+            LOG(ERR) << "A coordinator can't be a replica: the --nodes and --master options can't be used together.";
+            return 1;
+        }
+
+        std::vector<std::string> nodes;
+        StringUtils::split(options.get<std::string>("nodes"), nodes, ",");
+
+        for(const std::string & node: nodes) {
+            std::vector<std::string> parts;
+            StringUtils::split(node, parts, ":");
+            if(parts.size() != 3) {
+                LOG(ERR) << "Invalid value for --nodes option. Usage: http(s)://<address>:<port>,...";
+                return 1;
+            }
+        }
 
-    if(options.get<std::string>("master").empty()) {
+        LOG(INFO) << "Typesense is starting as a coordinator of " << nodes.size() << " nodes.";
+        Coordinator::get_instance().init(nodes, options.get<std::string>("api-key"));
+        coordinator_server_routes();
+    } else if(options.get<std::string>("master").empty()) {
         master_server_routes();
     } else {
         replica_server_routes();
@@ -168,8 +310,100 @@ int main(int argc, char **argv) {
         replication_thread.detach();
     }
 
+    // a coordinator has no collections of its own to warm up
+    QueryLog & query_log = QueryLog::get_instance();
+    const bool log_queries = !options.get<std::string>("query-log").empty() &&
+                             options.get<std::string>("nodes").empty();
+
+    if(log_queries) {
+        Option<bool> query_log_op = query_log.init(options.get<std::string>("query-log"),
+                                                   options.get<uint32_t>("query-log-sample-rate"));
+        if(!query_log_op.ok()) {
+            LOG(ERR) << "Typesense failed to start. " << query_log_op.error();
+            return 1;
+        }
+
+        LOG(INFO) << "Warming up with the searches of the query log...";
+        warm_up(query_log.get_top_queries(options.get<uint32_t>("warmup-searches")));
+        query_log.start_recording();
+    }
+
+    // the background threads use the server and the store, so they are stopped before either is torn down
+    std::mutex background_mutex;
+    std::condition_variable background_cv;
+    bool stop_background = false;
+    std::thread spill_thread;
+    std::thread compaction_thread;
+    std::thread query_log_thread;
+
+    // a coordinator has no postings of its own
+    const uint64_t cold_postings_after_ms = (uint64_t) options.get<uint32_t>("cold-postings-after") * 1000;
+
+    if(cold_postings_after_ms != 0 && options.get<std::string>("nodes").empty()) {
+        spill_thread = std::thread([cold_postings_after_ms, &background_mutex, &background_cv, &stop_background]() {
+            const std::chrono::milliseconds interval(background_interval_ms(cold_postings_after_ms));
+            std::unique_lock<std::mutex> lock(background_mutex);
+            while(!background_cv.wait_for(lock, interval, [&]() { return stop_background; })) {
+                ::server->send_message(SPILL_POSTINGS_MSG, new uint64_t(cold_postings_after_ms));
+            }
+        });
+    }
+
+    // a compaction blocks until it is done, so it runs on its own thread rather than on the event loop
+    const uint64_t idle_compaction_after_ms = (uint64_t) options.get<uint32_t>("idle-compaction-after") * 1000;
+
+    if(idle_compaction_after_ms != 0) {
+        compaction_thread = std::thread([idle_compaction_after_ms, &store, &background_mutex, &background_cv,
+                                         &stop_background]() {
+            const std::chrono::milliseconds interval(background_interval_ms(idle_compaction_after_ms));
+            std::unique_lock<std::mutex> lock(background_mutex);
+            while(!background_cv.wait_for(lock, interval, [&]() { return stop_background; })) {
+                // a compaction can take long: the spill thread is not held up by it
+                lock.unlock();
+                store.compact_if_idle(idle_compaction_after_ms, Store::IDLE_COMPACTION_MIN_PENDING_BYTES);
+                lock.lock();
+            }
+        });
+    }
+
+    // writing the query log does not hold up the searches that are recorded in it
+    if(log_queries) {
+        query_log_thread = std::thread([&query_log, &background_mutex, &background_cv, &stop_background]() {
+            const std::chrono::milliseconds interval(QueryLog::FLUSH_INTERVAL_MS);
+            std::unique_lock<std::mutex> lock(background_mutex);
+            while(!background_cv.wait_for(lock, interval, [&]() { return stop_background; })) {
+                lock.unlock();
+                Option<bool> flush_op = query_log.flush_if_recorded();
+                if(!flush_op.ok()) {
+                    LOG(ERR) << flush_op.error();
+                }
+                lock.lock();
+            }
+        });
+    }
+
     int return_code = server->run();
 
+    {
+        std::lock_guard<std::mutex> lock(background_mutex);
+        stop_background = true;
+    }
+
+    background_cv.notify_all();
+
+    for(std::thread* background_thread: {&spill_thread, &compaction_thread, &query_log_thread}) {
+        if(background_thread->joinable()) {
+            background_thread->join();
+        }
+    }
+
+    if(log_queries) {
+        Option<bool> flush_op = query_log.flush();
+        if(!flush_op.ok()) {
+            LOG(ERR) << flush_op.error();
+        }
+    }
+
     // we are out of the event loop here
     delete server;
     CollectionManager::get_instance().dispose();
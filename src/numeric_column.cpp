@@ -0,0 +1,359 @@
+#include "numeric_column.h"
+
+#include <cstring>
+#include <algorithm>
+#include "index_memory.h"
+
+numeric_column::~numeric_column() {
+    for(block* b: blocks) {
+        if(b != nullptr) {
+            index_memory::free(b->packed, packed_size(b->count, b->bits));
+            delete b;
+        }
+    }
+
+    blocks.clear();
+}
+
+uint64_t numeric_column::to_key(const number_t & value) const {
+    if(!is_float) {
+        // flipping the sign bit orders negative integers before positive ones
+        return (uint64_t) value.intval ^ (1ULL << 63);
+    }
+
+    // negative floats are ordered backwards by their bits, so all of their bits are flipped
+    uint32_t bits;
+    memcpy(&bits, &value.floatval, sizeof(bits));
+    return (bits & 0x80000000) ? (uint64_t) ~bits : (uint64_t) (bits | 0x80000000);
+}
+
+number_t numeric_column::from_key(const uint64_t key) const {
+    if(!is_float) {
+        return number_t((int64_t) (key ^ (1ULL << 63)));
+    }
+
+    const uint32_t bits = (key & 0x80000000) ? (uint32_t) (key & 0x7FFFFFFF) : ~((uint32_t) key);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return number_t(value);
+}
+
+size_t numeric_column::rank(const block* b, const uint32_t offset) {
+    size_t rank = 0;
+    for(size_t i = 0; i < offset / 64; i++) {
+        rank += __builtin_popcountll(b->present[i]);
+    }
+
+    return rank + __builtin_popcountll(b->present[offset / 64] & ((1ULL << (offset % 64)) - 1));
+}
+
+uint64_t numeric_column::key_at(const block* b, const size_t rank) {
+    if(b->bits == 0) {
+        return b->min_key;
+    }
+
+    uint64_t word;
+
+    if(b->bits > MAX_PACKED_BITS) {
+        memcpy(&word, b->packed + rank * sizeof(uint64_t), sizeof(uint64_t));
+        return word;
+    }
+
+    // the buffer is padded, so that a value can always be read with a single unaligned load
+    const size_t bit_offset = rank * b->bits;
+    memcpy(&word, b->packed + bit_offset / 8, sizeof(uint64_t));
+    return b->min_key + ((word >> (bit_offset % 8)) & ((1ULL << b->bits) - 1));
+}
+
+size_t numeric_column::packed_size(const size_t count, const uint8_t bits) {
+    if(bits == 0) {
+        return 0;
+    }
+
+    if(bits > MAX_PACKED_BITS) {
+        return count * sizeof(uint64_t);
+    }
+
+    return (count * bits + 7) / 8 + sizeof(uint64_t);
+}
+
+void numeric_column::encode(block* b, const std::vector<uint64_t> & keys) {
+    index_memory::free(b->packed, packed_size(b->count, b->bits));
+    b->packed = nullptr;
+    b->count = (uint16_t) keys.size();
+    b->bits = 0;
+
+    if(keys.empty()) {
+        return ;
+    }
+
+    b->min_key = keys[0];
+    b->max_key = keys[0];
+    for(const uint64_t key: keys) {
+        b->min_key = std::min(b->min_key, key);
+        b->max_key = std::max(b->max_key, key);
+    }
+
+    const uint64_t range = b->max_key - b->min_key;
+    b->bits = (range == 0) ? 0 : (uint8_t) (64 - __builtin_clzll(range));
+    if(b->bits > MAX_PACKED_BITS) {
+        b->bits = 64;
+    }
+
+    const size_t size = packed_size(b->count, b->bits);
+    if(size == 0) {
+        return ;
+    }
+
+    b->packed = (uint8_t*) index_memory::zalloc(size);
+
+    if(b->bits == 64) {
+        memcpy(b->packed, keys.data(), keys.size() * sizeof(uint64_t));
+        return ;
+    }
+
+    for(size_t i = 0; i < keys.size(); i++) {
+        const size_t bit_offset = i * b->bits;
+        uint64_t word;
+        memcpy(&word, b->packed + bit_offset / 8, sizeof(uint64_t));
+        word |= (keys[i] - b->min_key) << (bit_offset % 8);
+        memcpy(b->packed + bit_offset / 8, &word, sizeof(uint64_t));
+    }
+}
+
+void numeric_column::decode(const block* b, std::vector<uint64_t> & keys) {
+    keys.resize(b->count);
+    for(size_t i = 0; i < b->count; i++) {
+        keys[i] = key_at(b, i);
+    }
+}
+
+bool numeric_column::put_in_place(block* b, const size_t value_rank, const uint64_t key, const bool append) {
+    if(b->count == 0 || key < b->min_key) {
+        return false;
+    }
+
+    if((b->bits == 0 && key != b->min_key) ||
+       (b->bits != 0 && b->bits <= MAX_PACKED_BITS && ((key - b->min_key) >> b->bits) != 0)) {
+        return false;
+    }
+
+    if(append) {
+        const size_t old_size = packed_size(b->count, b->bits);
+        const size_t new_size = packed_size(b->count + 1, b->bits);
+
+        if(new_size != old_size) {
+            uint8_t* packed = (uint8_t*) index_memory::realloc(b->packed, old_size, new_size);
+            if(packed == nullptr) {
+                return false;
+            }
+
+            b->packed = packed;
+        }
+
+        b->count++;
+    }
+
+    if(b->bits > MAX_PACKED_BITS) {
+        memcpy(b->packed + value_rank * sizeof(uint64_t), &key, sizeof(uint64_t));
+    } else if(b->bits != 0) {
+        // the bits of the value are cleared first: a grown buffer is not zeroed
+        const size_t bit_offset = value_rank * b->bits;
+        uint64_t word;
+        memcpy(&word, b->packed + bit_offset / 8, sizeof(uint64_t));
+        word &= ~(((1ULL << b->bits) - 1) << (bit_offset % 8));
+        word |= (key - b->min_key) << (bit_offset % 8);
+        memcpy(b->packed + bit_offset / 8, &word, sizeof(uint64_t));
+    }
+
+    b->max_key = std::max(b->max_key, key);
+    return true;
+}
+
+void numeric_column::set(const uint32_t seq_id, const number_t & value) {
+    const uint32_t block_index = seq_id / BLOCK_SPAN;
+    const uint32_t offset = seq_id % BLOCK_SPAN;
+
+    if(block_index >= blocks.size()) {
+        blocks.resize(block_index + 1, nullptr);
+    }
+
+    block* & b = blocks[block_index];
+    if(b == nullptr) {
+        b = new block();
+    }
+
+    const size_t value_rank = rank(b, offset);
+    const uint64_t key = to_key(value);
+    const bool present = (b->present[offset / 64] & (1ULL << (offset % 64))) != 0;
+
+    // documents are mostly added in the order of their ids, which appends to the last block
+    if(present ? put_in_place(b, value_rank, key, false) :
+                 (value_rank == b->count && put_in_place(b, value_rank, key, true))) {
+        if(!present) {
+            b->present[offset / 64] |= (1ULL << (offset % 64));
+            num_values++;
+        }
+
+        return ;
+    }
+
+    std::vector<uint64_t> keys;
+    decode(b, keys);
+
+    if(present) {
+        keys[value_rank] = key;
+    } else {
+        keys.insert(keys.begin() + value_rank, key);
+        b->present[offset / 64] |= (1ULL << (offset % 64));
+        num_values++;
+    }
+
+    encode(b, keys);
+}
+
+bool numeric_column::get(const uint32_t seq_id, number_t & value) const {
+    const uint32_t block_index = seq_id / BLOCK_SPAN;
+    const uint32_t offset = seq_id % BLOCK_SPAN;
+
+    if(block_index >= blocks.size() || blocks[block_index] == nullptr) {
+        return false;
+    }
+
+    const block* b = blocks[block_index];
+    if((b->present[offset / 64] & (1ULL << (offset % 64))) == 0) {
+        return false;
+    }
+
+    value = from_key(key_at(b, rank(b, offset)));
+    return true;
+}
+
+bool numeric_column::contains(const uint32_t seq_id) const {
+    number_t value;
+    return get(seq_id, value);
+}
+
+void numeric_column::erase(const uint32_t seq_id) {
+    const uint32_t block_index = seq_id / BLOCK_SPAN;
+    const uint32_t offset = seq_id % BLOCK_SPAN;
+
+    if(block_index >= blocks.size() || blocks[block_index] == nullptr) {
+        return ;
+    }
+
+    block* & b = blocks[block_index];
+    if((b->present[offset / 64] & (1ULL << (offset % 64))) == 0) {
+        return ;
+    }
+
+    const size_t value_rank = rank(b, offset);
+    b->present[offset / 64] &= ~(1ULL << (offset % 64));
+    num_values--;
+
+    // the last value of a block is dropped in place
+    if(value_rank + 1 == b->count && b->count > 1) {
+        const size_t old_size = packed_size(b->count, b->bits);
+        const size_t new_size = packed_size(b->count - 1, b->bits);
+        uint8_t* packed = (new_size == old_size) ? b->packed :
+                          (uint8_t*) index_memory::realloc(b->packed, old_size, new_size);
+
+        if(packed != nullptr) {
+            b->packed = packed;
+            b->count--;
+            return ;
+        }
+    }
+
+    std::vector<uint64_t> keys;
+    decode(b, keys);
+    keys.erase(keys.begin() + value_rank);
+
+    encode(b, keys);
+
+    if(b->count == 0) {
+        delete b;
+        b = nullptr;
+    }
+}
+
+size_t numeric_column::size() const {
+    return num_values;
+}
+
+void numeric_column::get_ids(uint32_t* ids) const {
+    size_t num_ids = 0;
+
+    for(size_t block_index = 0; block_index < blocks.size(); block_index++) {
+        const block* b = blocks[block_index];
+        if(b == nullptr) {
+            continue;
+        }
+
+        for(size_t word = 0; word < BLOCK_SPAN / 64; word++) {
+            uint64_t present = b->present[word];
+            while(present != 0) {
+                const uint32_t bit = (uint32_t) __builtin_ctzll(present);
+                ids[num_ids++] = (uint32_t) (block_index * BLOCK_SPAN + word * 64 + bit);
+                present &= present - 1;
+            }
+        }
+    }
+}
+
+bool numeric_column::may_match(const number_t & min, const number_t & max, const NUM_COMPARATOR compare_operator,
+                               const std::vector<number_t> & values) {
+    for(const number_t & value: values) {
+        switch(compare_operator) {
+            case LESS_THAN: if(min < value) return true; break;
+            case LESS_THAN_EQUALS: if(!(min > value)) return true; break;
+            case EQUALS: if(!(value < min) && !(value > max)) return true; break;
+            case GREATER_THAN: if(max > value) return true; break;
+            case GREATER_THAN_EQUALS: if(!(max < value)) return true; break;
+        }
+    }
+
+    return false;
+}
+
+bool numeric_column::matches(const number_t & value, const NUM_COMPARATOR compare_operator,
+                             const std::vector<number_t> & values) {
+    return may_match(value, value, compare_operator, values);
+}
+
+void numeric_column::filter(const NUM_COMPARATOR compare_operator, const std::vector<number_t> & values,
+                            std::vector<uint32_t> & ids) const {
+    for(size_t block_index = 0; block_index < blocks.size(); block_index++) {
+        const block* b = blocks[block_index];
+        if(b == nullptr || !may_match(from_key(b->min_key), from_key(b->max_key), compare_operator, values)) {
+            continue;
+        }
+
+        size_t value_rank = 0;
+
+        for(size_t word = 0; word < BLOCK_SPAN / 64; word++) {
+            uint64_t present = b->present[word];
+            while(present != 0) {
+                const uint32_t bit = (uint32_t) __builtin_ctzll(present);
+                if(matches(from_key(key_at(b, value_rank)), compare_operator, values)) {
+                    ids.push_back((uint32_t) (block_index * BLOCK_SPAN + word * 64 + bit));
+                }
+
+                value_rank++;
+                present &= present - 1;
+            }
+        }
+    }
+}
+
+size_t numeric_column::size_in_bytes() const {
+    size_t bytes = blocks.capacity() * sizeof(block*);
+
+    for(const block* b: blocks) {
+        if(b != nullptr) {
+            bytes += sizeof(block) + packed_size(b->count, b->bits);
+        }
+    }
+
+    return bytes;
+}
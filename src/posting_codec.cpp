@@ -0,0 +1,810 @@
+#include "posting_codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <for.h>
+#include "for_decoder.h"
+
+static inline uint32_t required_bits(const uint32_t v) {
+    return (uint32_t) (v == 0 ? 0 : 32 - __builtin_clz(v));
+}
+
+// merges `values` with `ids` from `id_index` onwards, appending the common values to `out`
+static inline void merge_values(const uint32_t* values, const size_t values_len, const uint32_t* ids,
+                                const size_t ids_len, size_t & id_index, uint32_t* out, size_t & out_len) {
+    size_t value_index = 0;
+
+    while(value_index < values_len && id_index < ids_len) {
+        if(values[value_index] < ids[id_index]) {
+            value_index++;
+        } else if(values[value_index] > ids[id_index]) {
+            id_index++;
+        } else {
+            out[out_len++] = values[value_index];
+            value_index++;
+            id_index++;
+        }
+    }
+}
+
+uint32_t posting_codec::linear_search(const uint8_t* in, const uint32_t length, const uint32_t value) const {
+    std::vector<uint32_t> values(length);
+    decode(in, length, false, values.data());
+    return (uint32_t) (std::find(values.begin(), values.end(), value) - values.begin());
+}
+
+void posting_codec::select_range(const uint8_t* in, const uint32_t length, const bool sorted, const uint32_t start,
+                                 const uint32_t end, uint32_t* out) const {
+    for(uint32_t index = start; index < end; index++) {
+        *out++ = select(in, length, sorted, index);
+    }
+}
+
+uint32_t posting_codec::lower_bound(const uint8_t* in, const uint32_t length, const uint32_t value,
+                                    uint32_t* actual) const {
+    if(length == 0) {
+        *actual = value + 1;
+        return 0;
+    }
+
+    uint32_t low = 0;
+    uint32_t high = length;
+
+    while(low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+        if(select(in, length, true, mid) < value) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if(low == length) {
+        low = length - 1;
+    }
+
+    *actual = select(in, length, true, low);
+    return low;
+}
+
+void posting_codec::index_of(const uint8_t* in, const uint32_t length, const uint32_t* values,
+                             const size_t values_len, uint32_t* indices) const {
+    for(size_t i = 0; i < values_len; i++) {
+        uint32_t actual;
+        const uint32_t index = (length == 0) ? 0 : lower_bound(in, length, values[i], &actual);
+        indices[i] = (length != 0 && actual == values[i]) ? index : length;
+    }
+}
+
+size_t posting_codec::intersect(const uint8_t* in, const uint32_t length, const uint32_t* ids, const size_t ids_len,
+                                uint32_t* out) const {
+    if(length == 0 || ids_len == 0) {
+        return 0;
+    }
+
+    std::vector<uint32_t> values(length);
+    decode(in, length, true, values.data());
+
+    size_t id_index = 0;
+    size_t out_len = 0;
+    merge_values(values.data(), length, ids, ids_len, id_index, out, out_len);
+    return out_len;
+}
+
+class for_codec: public posting_codec {
+public:
+    codec_t type() const override {
+        return codec_t::FOR;
+    }
+
+    const char* name() const override {
+        return "for";
+    }
+
+    uint32_t encoded_size(const uint32_t* values, const uint32_t length, const bool sorted) const override {
+        if(length == 0) {
+            return ForDecoder::HEADER_LENGTH;
+        }
+
+        uint32_t min = values[0];
+        uint32_t max = values[length - 1];
+
+        if(!sorted) {
+            auto min_max = std::minmax_element(values, values + length);
+            min = *min_max.first;
+            max = *min_max.second;
+        }
+
+        return ForDecoder::HEADER_LENGTH + for_compressed_size_bits(length, required_bits(max - min));
+    }
+
+    uint32_t encode(const uint32_t* values, const uint32_t length, const bool sorted, uint8_t* out) const override {
+        return sorted ? for_compress_sorted(values, out, length) : for_compress_unsorted(values, out, length);
+    }
+
+    void decode(const uint8_t* in, const uint32_t length, const bool sorted, uint32_t* out) const override {
+        ForDecoder::uncompress(in, length, out);
+    }
+
+    uint32_t select(const uint8_t* in, const uint32_t length, const bool sorted,
+                    const uint32_t index) const override {
+        return for_select(in, index);
+    }
+
+    uint32_t append_size_required(const uint8_t* in, const uint32_t length_bytes, const uint32_t length,
+                                  const uint32_t min, const uint32_t max, const uint32_t value) const override {
+        uint32_t m = std::min(min, value);
+        uint32_t M = std::max(max, value);
+        uint32_t bnew = required_bits(M - m);
+        return ForDecoder::HEADER_LENGTH + 4 + for_compressed_size_bits(length + 1, bnew);
+    }
+
+    uint32_t append(uint8_t* in, const uint32_t length_bytes, const uint32_t length, const bool sorted,
+                    const uint32_t max, const uint32_t value) const override {
+        return sorted ? for_append_sorted(in, length, value) : for_append_unsorted(in, length, value);
+    }
+
+    uint32_t linear_search(const uint8_t* in, const uint32_t length, const uint32_t value) const override {
+        return for_linear_search(in, length, value);
+    }
+
+    uint32_t lower_bound(const uint8_t* in, const uint32_t length, const uint32_t value,
+                         uint32_t* actual) const override {
+        return for_lower_bound_search(in, length, value, actual);
+    }
+
+    size_t intersect(const uint8_t* in, const uint32_t length, const uint32_t* ids, const size_t ids_len,
+                     uint32_t* out) const override {
+        return ForDecoder::intersect(in, length, ids, ids_len, out);
+    }
+};
+
+/*
+ * A directory with the first value and the byte offset of each full block of 128 values, then the blocks, then the
+ * remaining (length % 128) values as raw uint32_t's, which are packed into a block once there are 128 of them.
+ * Each block is a 4 byte base, a 1 byte bit width and the bit packed values in libfor's layout, so that they are
+ * decoded by the same kernels as FOR. In sorted blocks, the base is the first value and the remaining 127 values
+ * are packed as deltas from their predecessor, so that the bit width depends on the gaps between ids rather than on
+ * their range. Unsorted blocks pack all 128 values against the minimum of the block.
+ *
+ * Blocks differ in size, so the directory is what lets a lookup go straight to the one block that it needs: by
+ * index for select(), and by a binary search over the first values for the searches of sorted lists.
+ */
+class bp128_codec: public posting_codec {
+private:
+    static const uint32_t BLOCK_SIZE = 128;
+
+    // the first value of the block and its offset from the end of the directory
+    static const uint32_t DIRECTORY_ENTRY_SIZE = 2 * sizeof(uint32_t);
+
+    static inline uint32_t packed_length(const bool sorted) {
+        return sorted ? BLOCK_SIZE - 1 : BLOCK_SIZE;
+    }
+
+    static inline uint32_t block_size(const uint8_t* block, const bool sorted) {
+        return ForDecoder::HEADER_LENGTH + for_compressed_size_bits(packed_length(sorted), block[4]);
+    }
+
+    static inline uint32_t block_first(const uint8_t* block) {
+        uint32_t first;
+        memcpy(&first, block, sizeof(first));
+        return first;
+    }
+
+    static inline uint32_t directory_first(const uint8_t* in, const uint32_t block_index) {
+        uint32_t first;
+        memcpy(&first, in + block_index * DIRECTORY_ENTRY_SIZE, sizeof(first));
+        return first;
+    }
+
+    static inline const uint8_t* block_at(const uint8_t* in, const uint32_t num_blocks, const uint32_t block_index) {
+        uint32_t offset;
+        memcpy(&offset, in + block_index * DIRECTORY_ENTRY_SIZE + sizeof(uint32_t), sizeof(offset));
+        return in + num_blocks * DIRECTORY_ENTRY_SIZE + offset;
+    }
+
+    static inline const uint8_t* tail_at(const uint8_t* in, const uint32_t num_blocks, const bool sorted) {
+        if(num_blocks == 0) {
+            return in;
+        }
+
+        const uint8_t* last_block = block_at(in, num_blocks, num_blocks - 1);
+        return last_block + block_size(last_block, sorted);
+    }
+
+    static void block_header(const uint32_t* values, const bool sorted, uint32_t & base, uint32_t & bits) {
+        if(sorted) {
+            uint32_t max_delta = 0;
+            for(uint32_t i = 1; i < BLOCK_SIZE; i++) {
+                max_delta = std::max(max_delta, values[i] - values[i-1]);
+            }
+
+            base = values[0];
+            bits = required_bits(max_delta);
+        } else {
+            auto min_max = std::minmax_element(values, values + BLOCK_SIZE);
+            base = *min_max.first;
+            bits = required_bits(*min_max.second - *min_max.first);
+        }
+    }
+
+    static uint8_t* encode_block(const uint32_t* values, const bool sorted, uint8_t* out) {
+        uint32_t base, bits;
+        block_header(values, sorted, base, bits);
+
+        memcpy(out, &base, sizeof(base));
+        out[4] = (uint8_t) bits;
+        uint8_t* payload = out + ForDecoder::HEADER_LENGTH;
+
+        if(sorted) {
+            uint32_t deltas[BLOCK_SIZE - 1];
+            for(uint32_t i = 1; i < BLOCK_SIZE; i++) {
+                deltas[i-1] = values[i] - values[i-1];
+            }
+
+            return payload + for_compress_bits(deltas, payload, BLOCK_SIZE - 1, 0, bits);
+        }
+
+        return payload + for_compress_bits(values, payload, BLOCK_SIZE, base, bits);
+    }
+
+    static const uint8_t* decode_block(const uint8_t* block, const bool sorted, uint32_t* out) {
+        const uint32_t base = block_first(block);
+        const uint32_t bits = block[4];
+        const uint32_t payload_len = for_compressed_size_bits(packed_length(sorted), bits);
+        const uint8_t* payload = block + ForDecoder::HEADER_LENGTH;
+
+        if(sorted) {
+            ForDecoder::get_unpacker()(payload, payload_len, 0, bits, 0, BLOCK_SIZE - 1, out + 1);
+            out[0] = base;
+            for(uint32_t i = 1; i < BLOCK_SIZE; i++) {
+                out[i] += out[i-1];
+            }
+        } else {
+            ForDecoder::get_unpacker()(payload, payload_len, base, bits, 0, BLOCK_SIZE, out);
+        }
+
+        return payload + payload_len;
+    }
+
+    // Sorted lists only. The tail counts as one more block. Returns the number of the blocks from `low` onwards
+    // whose first value is <= `value`, plus `low`: the block that can hold `value` is the one before.
+    static uint32_t upper_block(const uint8_t* in, const uint32_t length, const uint8_t* tail, uint32_t low,
+                                const uint32_t value) {
+        const uint32_t num_blocks = length / BLOCK_SIZE;
+        uint32_t high = num_blocks + ((length % BLOCK_SIZE) != 0 ? 1 : 0);
+
+        while(low < high) {
+            const uint32_t mid = low + (high - low) / 2;
+            const uint32_t first = (mid < num_blocks) ? directory_first(in, mid) : block_first(tail);
+            if(first <= value) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+
+        return low;
+    }
+
+    // values of the given block, or of the tail, of a sorted list: returns how many there are
+    static uint32_t block_values(const uint8_t* in, const uint32_t length, const uint8_t* tail,
+                                 const uint32_t block_index, uint32_t* out) {
+        const uint32_t num_blocks = length / BLOCK_SIZE;
+
+        if(block_index == num_blocks) {
+            memcpy(out, tail, (length % BLOCK_SIZE) * sizeof(uint32_t));
+            return length % BLOCK_SIZE;
+        }
+
+        decode_block(block_at(in, num_blocks, block_index), true, out);
+        return BLOCK_SIZE;
+    }
+
+public:
+    codec_t type() const override {
+        return codec_t::BP128;
+    }
+
+    const char* name() const override {
+        return "bp128";
+    }
+
+    uint32_t encoded_size(const uint32_t* values, const uint32_t length, const bool sorted) const override {
+        const uint32_t num_blocks = length / BLOCK_SIZE;
+        uint32_t size = num_blocks * DIRECTORY_ENTRY_SIZE + (length % BLOCK_SIZE) * sizeof(uint32_t);
+
+        for(uint32_t i = 0; i < num_blocks; i++) {
+            uint32_t base, bits;
+            block_header(values + i * BLOCK_SIZE, sorted, base, bits);
+            size += ForDecoder::HEADER_LENGTH + for_compressed_size_bits(packed_length(sorted), bits);
+        }
+
+        return size;
+    }
+
+    uint32_t encode(const uint32_t* values, const uint32_t length, const bool sorted, uint8_t* out) const override {
+        const uint32_t num_blocks = length / BLOCK_SIZE;
+        uint8_t* blocks = out + num_blocks * DIRECTORY_ENTRY_SIZE;
+        uint8_t* end = blocks;
+
+        for(uint32_t i = 0; i < num_blocks; i++) {
+            const uint32_t offset = (uint32_t) (end - blocks);
+            end = encode_block(values + i * BLOCK_SIZE, sorted, end);
+
+            const uint32_t entry[2] = {block_first(blocks + offset), offset};
+            memcpy(out + i * DIRECTORY_ENTRY_SIZE, entry, sizeof(entry));
+        }
+
+        const uint32_t tail_bytes = (length % BLOCK_SIZE) * sizeof(uint32_t);
+        memcpy(end, values + num_blocks * BLOCK_SIZE, tail_bytes);
+
+        return (uint32_t) (end - out) + tail_bytes;
+    }
+
+    void decode(const uint8_t* in, const uint32_t length, const bool sorted, uint32_t* out) const override {
+        const uint32_t num_blocks = length / BLOCK_SIZE;
+        const uint8_t* block = in + num_blocks * DIRECTORY_ENTRY_SIZE;
+
+        for(uint32_t i = 0; i < num_blocks; i++) {
+            block = decode_block(block, sorted, out + i * BLOCK_SIZE);
+        }
+
+        memcpy(out + num_blocks * BLOCK_SIZE, block, (length % BLOCK_SIZE) * sizeof(uint32_t));
+    }
+
+    uint32_t select(const uint8_t* in, const uint32_t length, const bool sorted,
+                    const uint32_t index) const override {
+        const uint32_t num_blocks = length / BLOCK_SIZE;
+        const uint32_t block_index = index / BLOCK_SIZE;
+        uint32_t value;
+
+        if(block_index == num_blocks) {
+            memcpy(&value, tail_at(in, num_blocks, sorted) + (index % BLOCK_SIZE) * sizeof(uint32_t), sizeof(value));
+            return value;
+        }
+
+        const uint8_t* block = block_at(in, num_blocks, block_index);
+
+        if(sorted) {
+            uint32_t values[BLOCK_SIZE];
+            decode_block(block, sorted, values);
+            value = values[index % BLOCK_SIZE];
+        } else {
+            ForDecoder::unpack_scalar(block + ForDecoder::HEADER_LENGTH,
+                                      for_compressed_size_bits(BLOCK_SIZE, block[4]), block_first(block),
+                                      block[4], index % BLOCK_SIZE, 1, &value);
+        }
+
+        return value;
+    }
+
+    uint32_t append_size_required(const uint8_t* in, const uint32_t length_bytes, const uint32_t length,
+                                  const uint32_t min, const uint32_t max, const uint32_t value) const override {
+        // a packed block can be larger than the raw values when they need all 32 bits
+        return length_bytes + sizeof(uint32_t) + DIRECTORY_ENTRY_SIZE + ForDecoder::HEADER_LENGTH;
+    }
+
+    uint32_t append(uint8_t* in, const uint32_t length_bytes, const uint32_t length, const bool sorted,
+                    const uint32_t max, const uint32_t value) const override {
+        memcpy(in + length_bytes, &value, sizeof(value));
+        const uint32_t new_length_bytes = length_bytes + sizeof(value);
+
+        if((length + 1) % BLOCK_SIZE != 0) {
+            return new_length_bytes;
+        }
+
+        // the full tail becomes a block: the blocks before it move up to make room for its directory entry
+        const uint32_t num_blocks = length / BLOCK_SIZE;
+        uint8_t* blocks = in + num_blocks * DIRECTORY_ENTRY_SIZE;
+        uint8_t* tail = in + new_length_bytes - BLOCK_SIZE * sizeof(uint32_t);
+
+        uint32_t values[BLOCK_SIZE];
+        memcpy(values, tail, sizeof(values));
+
+        uint8_t block[ForDecoder::HEADER_LENGTH + BLOCK_SIZE * sizeof(uint32_t)];
+        const uint32_t size = (uint32_t) (encode_block(values, sorted, block) - block);
+
+        const uint32_t offset = (uint32_t) (tail - blocks);
+        memmove(blocks + DIRECTORY_ENTRY_SIZE, blocks, offset);
+
+        const uint32_t entry[2] = {block_first(block), offset};
+        memcpy(blocks, entry, sizeof(entry));
+        memcpy(tail + DIRECTORY_ENTRY_SIZE, block, size);
+
+        return (uint32_t) (tail + DIRECTORY_ENTRY_SIZE + size - in);
+    }
+
+    void select_range(const uint8_t* in, const uint32_t length, const bool sorted, const uint32_t start,
+                      const uint32_t end, uint32_t* out) const override {
+        const uint32_t num_blocks = length / BLOCK_SIZE;
+        const uint8_t* tail = tail_at(in, num_blocks, sorted);
+        uint32_t values[BLOCK_SIZE];
+        uint32_t index = start;
+
+        while(index < end) {
+            const uint32_t block_index = index / BLOCK_SIZE;
+            const uint32_t block_end = std::min(end, (block_index + 1) * BLOCK_SIZE);
+
+            if(block_index == num_blocks) {
+                memcpy(values, tail, (length % BLOCK_SIZE) * sizeof(uint32_t));
+            } else {
+                decode_block(block_at(in, num_blocks, block_index), sorted, values);
+            }
+
+            for(; index < block_end; index++) {
+                *out++ = values[index % BLOCK_SIZE];
+            }
+        }
+    }
+
+    uint32_t lower_bound(const uint8_t* in, const uint32_t length, const uint32_t value,
+                         uint32_t* actual) const override {
+        if(length == 0) {
+            *actual = value + 1;
+            return 0;
+        }
+
+        const uint32_t num_blocks = length / BLOCK_SIZE;
+        const uint8_t* tail = tail_at(in, num_blocks, true);
+        const uint32_t block_index = upper_block(in, length, tail, 0, value);
+        uint32_t values[BLOCK_SIZE];
+
+        if(block_index == 0) {
+            // every value is larger
+            *actual = (num_blocks != 0) ? directory_first(in, 0) : block_first(tail);
+            return 0;
+        }
+
+        // values of the block before are >= its first value, and < the first value of the block that follows
+        const uint32_t num_values = block_values(in, length, tail, block_index - 1, values);
+        const uint32_t* it = std::lower_bound(values, values + num_values, value);
+
+        if(it != values + num_values) {
+            *actual = *it;
+            return (block_index - 1) * BLOCK_SIZE + (uint32_t) (it - values);
+        }
+
+        if(block_index * BLOCK_SIZE >= length) {
+            *actual = values[num_values - 1];
+            return length - 1;
+        }
+
+        *actual = (block_index < num_blocks) ? directory_first(in, block_index) : block_first(tail);
+        return block_index * BLOCK_SIZE;
+    }
+
+    void index_of(const uint8_t* in, const uint32_t length, const uint32_t* values, const size_t values_len,
+                  uint32_t* indices) const override {
+        const uint32_t num_blocks = length / BLOCK_SIZE;
+        const uint8_t* tail = tail_at(in, num_blocks, true);
+
+        // the values are sorted, so each one is searched for from the block of the one before, and a block is
+        // decoded once for all of its values
+        uint32_t decoded[BLOCK_SIZE];
+        uint32_t num_block_values = 0;
+        uint32_t decoded_block = std::numeric_limits<uint32_t>::max();
+        uint32_t low = 0;
+
+        for(size_t i = 0; i < values_len; i++) {
+            indices[i] = length;
+
+            const uint32_t block_index = (length == 0) ? 0 : upper_block(in, length, tail, low, values[i]);
+            if(block_index == 0) {
+                continue;
+            }
+
+            low = block_index - 1;
+
+            if(decoded_block != low) {
+                num_block_values = block_values(in, length, tail, low, decoded);
+                decoded_block = low;
+            }
+
+            const uint32_t* it = std::lower_bound(decoded, decoded + num_block_values, values[i]);
+            if(it != decoded + num_block_values && *it == values[i]) {
+                indices[i] = low * BLOCK_SIZE + (uint32_t) (it - decoded);
+            }
+        }
+    }
+
+    size_t intersect(const uint8_t* in, const uint32_t length, const uint32_t* ids, const size_t ids_len,
+                     uint32_t* out) const override {
+        if(length == 0 || ids_len == 0) {
+            return 0;
+        }
+
+        const uint32_t num_blocks = length / BLOCK_SIZE;
+        const uint32_t tail_length = length % BLOCK_SIZE;
+        const uint8_t* block = in + num_blocks * DIRECTORY_ENTRY_SIZE;
+        uint32_t values[BLOCK_SIZE];
+
+        size_t id_index = 0;
+        size_t out_len = 0;
+
+        for(uint32_t i = 0; i < num_blocks && id_index < ids_len; i++) {
+            const uint8_t* next = block + block_size(block, true);
+            const bool is_last = (i + 1 == num_blocks && tail_length == 0);
+
+            // skip blocks that lie entirely below the next id without decoding them
+            if(!is_last && block_first(next) < ids[id_index]) {
+                block = next;
+                continue;
+            }
+
+            decode_block(block, true, values);
+            merge_values(values, BLOCK_SIZE, ids, ids_len, id_index, out, out_len);
+            block = next;
+        }
+
+        if(tail_length != 0 && id_index < ids_len) {
+            memcpy(values, block, tail_length * sizeof(uint32_t));
+            merge_values(values, tail_length, ids, ids_len, id_index, out, out_len);
+        }
+
+        return out_len;
+    }
+};
+
+/*
+ * 7 bits per byte, with the high bit set on every byte but the last one of a value. Sorted lists store the
+ * difference from the previous value. Values can only be reached by decoding everything before them.
+ */
+class vbyte_codec: public posting_codec {
+private:
+    static inline uint32_t varint_size(const uint32_t value) {
+        return value < (1U << 7) ? 1 : value < (1U << 14) ? 2 : value < (1U << 21) ? 3 : value < (1U << 28) ? 4 : 5;
+    }
+
+    static inline uint8_t* put_varint(uint32_t value, uint8_t* out) {
+        while(value >= 128) {
+            *out++ = (uint8_t) ((value & 127) | 128);
+            value >>= 7;
+        }
+
+        *out++ = (uint8_t) value;
+        return out;
+    }
+
+    static inline const uint8_t* get_varint(const uint8_t* in, uint32_t & value) {
+        value = 0;
+        uint32_t shift = 0;
+
+        while(true) {
+            const uint8_t byte = *in++;
+            value |= (uint32_t) (byte & 127) << shift;
+            if(byte < 128) {
+                return in;
+            }
+            shift += 7;
+        }
+    }
+
+public:
+    codec_t type() const override {
+        return codec_t::VBYTE;
+    }
+
+    const char* name() const override {
+        return "vbyte";
+    }
+
+    uint32_t encoded_size(const uint32_t* values, const uint32_t length, const bool sorted) const override {
+        uint32_t size = 0;
+        uint32_t previous = 0;
+
+        for(uint32_t i = 0; i < length; i++) {
+            size += varint_size(sorted ? values[i] - previous : values[i]);
+            previous = values[i];
+        }
+
+        return size;
+    }
+
+    uint32_t encode(const uint32_t* values, const uint32_t length, const bool sorted, uint8_t* out) const override {
+        uint8_t* end = out;
+        uint32_t previous = 0;
+
+        for(uint32_t i = 0; i < length; i++) {
+            end = put_varint(sorted ? values[i] - previous : values[i], end);
+            previous = values[i];
+        }
+
+        return (uint32_t) (end - out);
+    }
+
+    void decode(const uint8_t* in, const uint32_t length, const bool sorted, uint32_t* out) const override {
+        uint32_t previous = 0;
+
+        for(uint32_t i = 0; i < length; i++) {
+            in = get_varint(in, out[i]);
+            if(sorted) {
+                out[i] += previous;
+                previous = out[i];
+            }
+        }
+    }
+
+    uint32_t select(const uint8_t* in, const uint32_t length, const bool sorted,
+                    const uint32_t index) const override {
+        uint32_t value = 0;
+        uint32_t previous = 0;
+
+        for(uint32_t i = 0; i <= index; i++) {
+            in = get_varint(in, value);
+            if(sorted) {
+                value += previous;
+                previous = value;
+            }
+        }
+
+        return value;
+    }
+
+    // walks up to `start` once, rather than once for every value like select() would
+    void select_range(const uint8_t* in, const uint32_t length, const bool sorted, const uint32_t start,
+                      const uint32_t end, uint32_t* out) const override {
+        uint32_t value = 0;
+        uint32_t previous = 0;
+
+        for(uint32_t i = 0; i < end; i++) {
+            in = get_varint(in, value);
+            if(sorted) {
+                value += previous;
+                previous = value;
+            }
+
+            if(i >= start) {
+                *out++ = value;
+            }
+        }
+    }
+
+    uint32_t append_size_required(const uint8_t* in, const uint32_t length_bytes, const uint32_t length,
+                                  const uint32_t min, const uint32_t max, const uint32_t value) const override {
+        return length_bytes + 5;
+    }
+
+    uint32_t append(uint8_t* in, const uint32_t length_bytes, const uint32_t length, const bool sorted,
+                    const uint32_t max, const uint32_t value) const override {
+        // the last value of a sorted list is its maximum
+        const uint32_t delta = (sorted && length != 0) ? value - max : value;
+        return (uint32_t) (put_varint(delta, in + length_bytes) - in);
+    }
+
+    uint32_t lower_bound(const uint8_t* in, const uint32_t length, const uint32_t value,
+                         uint32_t* actual) const override {
+        if(length == 0) {
+            *actual = value + 1;
+            return 0;
+        }
+
+        uint32_t current = 0;
+
+        for(uint32_t i = 0; i < length; i++) {
+            uint32_t delta;
+            in = get_varint(in, delta);
+            current += delta;
+
+            if(current >= value) {
+                *actual = current;
+                return i;
+            }
+        }
+
+        *actual = current;
+        return length - 1;
+    }
+};
+
+class raw_codec: public posting_codec {
+public:
+    codec_t type() const override {
+        return codec_t::RAW;
+    }
+
+    const char* name() const override {
+        return "raw";
+    }
+
+    uint32_t encoded_size(const uint32_t* values, const uint32_t length, const bool sorted) const override {
+        return length * sizeof(uint32_t);
+    }
+
+    uint32_t encode(const uint32_t* values, const uint32_t length, const bool sorted, uint8_t* out) const override {
+        memcpy(out, values, length * sizeof(uint32_t));
+        return length * sizeof(uint32_t);
+    }
+
+    void decode(const uint8_t* in, const uint32_t length, const bool sorted, uint32_t* out) const override {
+        memcpy(out, in, length * sizeof(uint32_t));
+    }
+
+    uint32_t select(const uint8_t* in, const uint32_t length, const bool sorted,
+                    const uint32_t index) const override {
+        return ((const uint32_t*) in)[index];
+    }
+
+    uint32_t append_size_required(const uint8_t* in, const uint32_t length_bytes, const uint32_t length,
+                                  const uint32_t min, const uint32_t max, const uint32_t value) const override {
+        return length_bytes + sizeof(uint32_t);
+    }
+
+    uint32_t append(uint8_t* in, const uint32_t length_bytes, const uint32_t length, const bool sorted,
+                    const uint32_t max, const uint32_t value) const override {
+        memcpy(in + length_bytes, &value, sizeof(value));
+        return length_bytes + sizeof(value);
+    }
+
+    uint32_t linear_search(const uint8_t* in, const uint32_t length, const uint32_t value) const override {
+        const uint32_t* values = (const uint32_t*) in;
+        return (uint32_t) (std::find(values, values + length, value) - values);
+    }
+
+    uint32_t lower_bound(const uint8_t* in, const uint32_t length, const uint32_t value,
+                         uint32_t* actual) const override {
+        if(length == 0) {
+            *actual = value + 1;
+            return 0;
+        }
+
+        const uint32_t* values = (const uint32_t*) in;
+        uint32_t index = (uint32_t) (std::lower_bound(values, values + length, value) - values);
+        if(index == length) {
+            index = length - 1;
+        }
+
+        *actual = values[index];
+        return index;
+    }
+
+    size_t intersect(const uint8_t* in, const uint32_t length, const uint32_t* ids, const size_t ids_len,
+                     uint32_t* out) const override {
+        size_t id_index = 0;
+        size_t out_len = 0;
+        merge_values((const uint32_t*) in, length, ids, ids_len, id_index, out, out_len);
+        return out_len;
+    }
+};
+
+static for_codec for_codec_instance;
+static bp128_codec bp128_codec_instance;
+static vbyte_codec vbyte_codec_instance;
+static raw_codec raw_codec_instance;
+
+// indexed by codec_t
+static const posting_codec* const codecs[] = {
+    &for_codec_instance, &bp128_codec_instance, &vbyte_codec_instance, &raw_codec_instance
+};
+
+const posting_codec* posting_codec::get(const codec_t type) {
+    return codecs[static_cast<uint8_t>(type)];
+}
+
+codec_t posting_codec::choose(const uint32_t* values, const uint32_t length, const bool sorted) {
+    if(length <= RAW_MAX_LENGTH) {
+        return codec_t::RAW;
+    }
+
+    const uint32_t for_size = get(codec_t::FOR)->encoded_size(values, length, sorted);
+
+    const uint64_t range = sorted ? (uint64_t) values[length - 1] - values[0] + 1 : 0;
+
+    if(sorted && length >= 128 && (uint64_t) length * BP128_MAX_AVERAGE_GAP >= range) {
+        // a lookup decodes a whole block where FOR unpacks a single value, so BP128 must be a clear saving
+        const uint32_t bp128_size = get(codec_t::BP128)->encoded_size(values, length, sorted);
+        if((uint64_t) bp128_size * 4 < (uint64_t) for_size * 3) {
+            return codec_t::BP128;
+        }
+    }
+
+    if(!sorted && length <= VBYTE_MAX_LENGTH) {
+        if(get(codec_t::VBYTE)->encoded_size(values, length, sorted) < for_size) {
+            return codec_t::VBYTE;
+        }
+    }
+
+    return codec_t::FOR;
+}
@@ -0,0 +1,163 @@
+#include "query_log.h"
+
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+#include <json.hpp>
+#include "logger.h"
+
+// most frequent first, so that the log can be cut at any point
+static std::vector<std::pair<std::string, size_t>> sorted_counts(const std::map<std::string, size_t> & query_counts) {
+    std::vector<std::pair<std::string, size_t>> counts(query_counts.begin(), query_counts.end());
+    std::stable_sort(counts.begin(), counts.end(),
+                     [](const std::pair<std::string, size_t> & a, const std::pair<std::string, size_t> & b) {
+                         return a.second > b.second;
+                     });
+    return counts;
+}
+
+Option<bool> QueryLog::init(const std::string & path, const size_t sample_rate) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->path = path;
+    this->sample_rate = std::max((size_t) 1, sample_rate);
+    num_searches = 0;
+    recording = false;
+    query_counts.clear();
+    num_recorded_since_flush = 0;
+    num_recorded_since_decay = 0;
+
+    std::ifstream infile(path);
+    if(!infile.is_open()) {
+        // nothing was logged yet
+        return Option<bool>(true);
+    }
+
+    std::string line;
+    while(std::getline(infile, line)) {
+        nlohmann::json entry;
+        try {
+            entry = nlohmann::json::parse(line);
+        } catch(...) {
+            return Option<bool>(400, "Could not parse the query log at " + path + ".");
+        }
+
+        if(!entry.is_object() || !entry["params"].is_object() || !entry["count"].is_number_unsigned() ||
+           !std::all_of(entry["params"].begin(), entry["params"].end(),
+                        [](const nlohmann::json & value) { return value.is_string(); })) {
+            return Option<bool>(400, "Could not parse the query log at " + path + ".");
+        }
+
+        query_counts[entry["params"].dump()] += entry["count"].get<size_t>();
+    }
+
+    return Option<bool>(true);
+}
+
+std::vector<std::map<std::string, std::string>> QueryLog::get_top_queries(const size_t n) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<std::map<std::string, std::string>> queries;
+    for(const auto & query_count: sorted_counts(query_counts)) {
+        if(queries.size() == n) {
+            break;
+        }
+
+        const nlohmann::json params = nlohmann::json::parse(query_count.first);
+        std::map<std::string, std::string> query;
+        for(auto it = params.begin(); it != params.end(); ++it) {
+            query[it.key()] = it.value().get<std::string>();
+        }
+
+        queries.push_back(query);
+    }
+
+    return queries;
+}
+
+void QueryLog::start_recording() {
+    recording = true;
+}
+
+void QueryLog::record(const std::map<std::string, std::string> & params) {
+    // every search passes through here, so they are sampled without taking the lock
+    if(!recording || num_searches++ % sample_rate != 0) {
+        return ;
+    }
+
+    nlohmann::json params_json = nlohmann::json::object();
+    for(const auto & param: params) {
+        if(param.first != AUTH_PARAM && param.first != CALLBACK_PARAM) {
+            params_json[param.first] = param.second;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    query_counts[params_json.dump()]++;
+    num_recorded_since_flush++;
+
+    if(++num_recorded_since_decay == DECAY_EVERY) {
+        decay();
+    }
+}
+
+void QueryLog::decay() {
+    for(auto it = query_counts.begin(); it != query_counts.end(); ) {
+        it->second /= 2;
+        it = (it->second == 0) ? query_counts.erase(it) : std::next(it);
+    }
+
+    num_recorded_since_decay = 0;
+}
+
+Option<bool> QueryLog::flush() {
+    std::lock_guard<std::mutex> flush_lock(flush_mutex);
+
+    std::vector<std::pair<std::string, size_t>> counts;
+    std::string path;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        counts = sorted_counts(query_counts);
+        if(counts.size() > MAX_QUERIES) {
+            counts.resize(MAX_QUERIES);
+            query_counts = std::map<std::string, size_t>(counts.begin(), counts.end());
+        }
+
+        path = this->path;
+        num_recorded_since_flush = 0;
+    }
+
+    // written aside and then moved over the log, so that a crash while writing does not lose the log
+    const std::string tmp_path = path + ".tmp";
+    std::ofstream outfile(tmp_path, std::ios::trunc);
+
+    for(const auto & query_count: counts) {
+        nlohmann::json entry;
+        entry["count"] = query_count.second;
+        entry["params"] = nlohmann::json::parse(query_count.first);
+        outfile << entry.dump() << "\n";
+    }
+
+    outfile.close();
+
+    if(outfile.fail() || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        // the next flush tries again
+        std::lock_guard<std::mutex> lock(mutex);
+        num_recorded_since_flush++;
+        return Option<bool>(500, "Could not write the query log to " + path + ".");
+    }
+
+    return Option<bool>(true);
+}
+
+Option<bool> QueryLog::flush_if_recorded() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(num_recorded_since_flush == 0) {
+            return Option<bool>(true);
+        }
+    }
+
+    return flush();
+}
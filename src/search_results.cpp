@@ -0,0 +1,174 @@
+#include "search_results.h"
+
+#include <cstring>
+#include <algorithm>
+
+static nlohmann::json number_json(const number_t & number) {
+    return number.is_float ? nlohmann::json(number.floatval) : nlohmann::json(number.intval);
+}
+
+Option<nlohmann::json> search_results::to_json(const bool mergeable) {
+    nlohmann::json result = nlohmann::json::object();
+
+    result["hits"] = nlohmann::json::array();
+    result["found"] = found;
+
+    if(explain_plan) {
+        result["search_plans"] = nlohmann::json::array();
+        for(const search_plan & plan: plans) {
+            nlohmann::json plan_json;
+            plan_json["execution"] = (plan.execution == TEXT_ONLY) ? "text_only" :
+                                     (plan.execution == FILTER_FIRST) ? "filter_first" : "text_first";
+            plan_json["estimated_filter_matches"] = plan.estimated_filter_matches;
+            plan_json["estimated_text_matches"] = plan.estimated_text_matches;
+            result["search_plans"].push_back(plan_json);
+        }
+    }
+
+    if(out_of_range) {
+        return Option<nlohmann::json>(std::move(result));
+    }
+
+    for(search_hit & hit: hits) {
+        nlohmann::json wrapper_doc;
+
+        if(hit.parsed_document.is_null()) {
+            try {
+                hit.parsed_document = nlohmann::json::parse(hit.document);
+            } catch(...) {
+                return Option<nlohmann::json>(500, "Error while parsing stored document.");
+            }
+        }
+
+        if(mergeable) {
+            // results of several collections are merged on the keys that the hits of the shards are sorted on
+            wrapper_doc["sort_keys"] = { hit.match_score, number_json(hit.primary_attr),
+                                         number_json(hit.secondary_attr), hit.field_order };
+        }
+
+        if(!hit.highlight_field.empty()) {
+            wrapper_doc["highlight"] = nlohmann::json::object();
+            wrapper_doc["highlight"][hit.highlight_field] = hit.snippet;
+        }
+
+        wrapper_doc["document"] = std::move(hit.parsed_document);
+        result["hits"].push_back(std::move(wrapper_doc));
+    }
+
+    result["facet_counts"] = nlohmann::json::array();
+
+    for(const facet_result & a_facet: facets) {
+        nlohmann::json facet_json = nlohmann::json::object();
+        facet_json["field_name"] = a_facet.field_name;
+        facet_json["counts"] = nlohmann::json::array();
+
+        if(a_facet.sampled) {
+            // the counts are estimates from a sample of the results
+            facet_json["sampled"] = true;
+        }
+
+        // keep only the top values of a string facet, unless the counts are to be merged with those of others
+        const size_t num_values = (a_facet.is_numeric || mergeable) ? a_facet.values.size() :
+                                  std::min(MAX_FACET_VALUES, a_facet.values.size());
+
+        for(size_t i = 0; i < num_values; i++) {
+            nlohmann::json facet_value_count = nlohmann::json::object();
+            facet_value_count["value"] = a_facet.values[i];
+            facet_value_count["count"] = a_facet.counts[i];
+            facet_json["counts"].push_back(std::move(facet_value_count));
+        }
+
+        if(a_facet.is_numeric) {
+            nlohmann::json stats = nlohmann::json::object();
+            stats["count"] = a_facet.stats.count;
+            if(a_facet.stats.count != 0) {
+                stats["min"] = a_facet.stats.min;
+                stats["max"] = a_facet.stats.max;
+                stats["sum"] = a_facet.stats.sum;
+                stats["avg"] = a_facet.stats.sum / a_facet.stats.count;
+            }
+
+            facet_json["stats"] = std::move(stats);
+        }
+
+        if(mergeable && a_facet.auto_ranges) {
+            facet_json["auto_bounds"] = {{"min", a_facet.auto_min}, {"max", a_facet.auto_max}};
+        }
+
+        result["facet_counts"].push_back(std::move(facet_json));
+    }
+
+    return Option<nlohmann::json>(std::move(result));
+}
+
+static void put_uint(std::string & out, const uint64_t value, const size_t num_bytes) {
+    for(size_t i = 0; i < num_bytes; i++) {
+        out.push_back((char) ((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static void put_double(std::string & out, const double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_uint(out, bits, sizeof(bits));
+}
+
+static void put_str(std::string & out, const std::string & str) {
+    put_uint(out, str.size(), 4);
+    out.append(str);
+}
+
+std::string search_results::to_binary(const uint64_t search_time_ms, const uint32_t page) const {
+    std::string out = "TSR1";
+    put_uint(out, 0, 4);  // length of the rest: filled in at the end
+
+    put_uint(out, found, 8);
+    put_uint(out, search_time_ms, 8);
+    put_uint(out, page, 4);
+
+    // a page that is out of range has neither hits nor facets
+    put_uint(out, hits.size(), 4);
+    for(const search_hit & hit: hits) {
+        put_str(out, hit.document);
+        put_str(out, hit.highlight_field);
+        put_str(out, hit.snippet);
+    }
+
+    put_uint(out, facets.size(), 4);
+    for(const facet_result & a_facet: facets) {
+        const size_t num_values = a_facet.is_numeric ? a_facet.values.size() :
+                                  std::min(MAX_FACET_VALUES, a_facet.values.size());
+
+        put_str(out, a_facet.field_name);
+        put_uint(out, (a_facet.is_numeric ? 1 : 0) | (a_facet.sampled ? 2 : 0), 1);
+        put_uint(out, num_values, 4);
+
+        for(size_t vi = 0; vi < num_values; vi++) {
+            put_str(out, a_facet.values[vi]);
+        }
+
+        for(size_t vi = 0; vi < num_values; vi++) {
+            put_uint(out, a_facet.counts[vi], 8);
+        }
+
+        if(a_facet.is_numeric) {
+            put_uint(out, a_facet.stats.count, 8);
+            put_double(out, a_facet.stats.min);
+            put_double(out, a_facet.stats.max);
+            put_double(out, a_facet.stats.sum);
+        }
+    }
+
+    put_uint(out, plans.size(), 4);
+    for(const search_plan & plan: plans) {
+        put_uint(out, (plan.execution == TEXT_ONLY) ? 0 : (plan.execution == FILTER_FIRST) ? 1 : 2, 1);
+        put_uint(out, plan.estimated_filter_matches, 8);
+        put_uint(out, plan.estimated_text_matches, 8);
+    }
+
+    std::string length;
+    put_uint(length, out.size() - 8, 4);
+    out.replace(4, 4, length);
+
+    return out;
+}
@@ -0,0 +1,181 @@
+#include "search_scheduler.h"
+
+#include <ctime>
+#include <chrono>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include "string_utils.h"
+
+Option<bool> SearchScheduler::init(const tenant_limits & default_limits, const std::string & limits_by_tenant) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->default_limits = default_limits;
+    this->limits_by_tenant.clear();
+    tenants.clear();
+    virtual_time = 0;
+
+    std::vector<std::string> tenant_limit_strs;
+    StringUtils::split(limits_by_tenant, tenant_limit_strs, ",");
+
+    for(const std::string & tenant_limit_str: tenant_limit_strs) {
+        std::vector<std::string> parts;
+        StringUtils::split(tenant_limit_str, parts, ":");
+
+        if(parts.size() != 4 || !StringUtils::is_float(parts[1]) || std::stof(parts[1]) <= 0 ||
+           !StringUtils::is_uint64_t(parts[2]) || !StringUtils::is_uint64_t(parts[3])) {
+            return Option<bool>(400, "Tenant limits should be of the form "
+                                     "`<collection>:<weight>:<max concurrent>:<max qps>`.");
+        }
+
+        this->limits_by_tenant[parts[0]] = tenant_limits(std::stof(parts[1]), std::stoull(parts[2]),
+                                                         std::stoull(parts[3]));
+    }
+
+    return Option<bool>(true);
+}
+
+SearchScheduler::tenant_state & SearchScheduler::get_tenant(const std::string & tenant) {
+    auto tenant_it = tenants.find(tenant);
+    if(tenant_it != tenants.end()) {
+        return tenant_it->second;
+    }
+
+    tenant_state & state = tenants[tenant];
+    state.limits = limits_by_tenant.count(tenant) != 0 ? limits_by_tenant.at(tenant) : default_limits;
+    state.mean_cost_us = INITIAL_COST_US;
+    state.tokens = state.limits.max_qps;
+    return state;
+}
+
+Option<bool> SearchScheduler::admit(const std::string & tenant, const uint64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tenant_state & state = get_tenant(tenant);
+
+    if(state.limits.max_concurrent != 0 && state.num_in_flight >= state.limits.max_concurrent) {
+        state.usage.num_rejected++;
+        return Option<bool>(429, "Too many concurrent searches on this collection.");
+    }
+
+    if(state.limits.max_qps != 0) {
+        if(state.last_refill_us != 0 && now_us > state.last_refill_us) {
+            state.tokens = std::min<double>(state.limits.max_qps,
+                                            state.tokens + (now_us - state.last_refill_us) *
+                                                           state.limits.max_qps / 1000000.0);
+        }
+
+        state.last_refill_us = std::max(state.last_refill_us, now_us);
+
+        if(state.tokens < 1) {
+            state.usage.num_rejected++;
+            return Option<bool>(429, "Too many searches per second on this collection.");
+        }
+
+        state.tokens -= 1;
+    }
+
+    state.num_in_flight++;
+    return Option<bool>(true);
+}
+
+void SearchScheduler::enqueue(const std::string & tenant, void* data) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tenant_state & state = get_tenant(tenant);
+
+    // a tenant that had nothing waiting starts at the current virtual time, without credit for the time it was idle
+    const double start_time = std::max(virtual_time, state.last_finish_time);
+    const double finish_time = start_time + state.mean_cost_us / state.limits.weight;
+
+    state.last_finish_time = finish_time;
+    state.queue.push_back(queued_search{data, start_time, finish_time});
+}
+
+bool SearchScheduler::next(std::string & tenant, void* & data) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    tenant_state* next_state = nullptr;
+    double min_finish_time = std::numeric_limits<double>::max();
+
+    for(auto & name_state: tenants) {
+        tenant_state & state = name_state.second;
+        if(!state.queue.empty() && state.queue.front().finish_time < min_finish_time) {
+            min_finish_time = state.queue.front().finish_time;
+            next_state = &state;
+            tenant = name_state.first;
+        }
+    }
+
+    if(next_state == nullptr) {
+        return false;
+    }
+
+    const queued_search search = next_state->queue.front();
+    next_state->queue.pop_front();
+
+    virtual_time = std::max(virtual_time, search.start_time);
+    data = search.data;
+    return true;
+}
+
+void SearchScheduler::complete(const std::string & tenant) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tenant_state & state = get_tenant(tenant);
+
+    if(state.num_in_flight != 0) {
+        state.num_in_flight--;
+    }
+}
+
+void SearchScheduler::record_usage(const std::string & tenant, const tenant_usage & usage) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tenant_state & state = get_tenant(tenant);
+
+    state.usage.num_searches += usage.num_searches;
+    state.usage.cpu_time_us += usage.cpu_time_us;
+    state.usage.num_scored_docs += usage.num_scored_docs;
+    state.usage.num_bytes_read += usage.num_bytes_read;
+
+    if(usage.num_searches != 0) {
+        const double cost_us = (double) usage.cpu_time_us / usage.num_searches;
+        state.mean_cost_us = (1 - COST_SMOOTHING) * state.mean_cost_us + COST_SMOOTHING * cost_us;
+    }
+}
+
+tenant_usage SearchScheduler::get_usage(const std::string & tenant) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return get_tenant(tenant).usage;
+}
+
+nlohmann::json SearchScheduler::get_metrics() {
+    std::lock_guard<std::mutex> lock(mutex);
+    nlohmann::json metrics = nlohmann::json::object();
+
+    for(const auto & name_state: tenants) {
+        const tenant_state & state = name_state.second;
+        nlohmann::json & tenant_metrics = metrics[name_state.first];
+
+        tenant_metrics["searches"] = state.usage.num_searches;
+        tenant_metrics["rejected_searches"] = state.usage.num_rejected;
+        tenant_metrics["cpu_time_us"] = state.usage.cpu_time_us;
+        tenant_metrics["scored_documents"] = state.usage.num_scored_docs;
+        tenant_metrics["bytes_read"] = state.usage.num_bytes_read;
+        tenant_metrics["waiting_searches"] = state.queue.size();
+        tenant_metrics["running_searches"] = state.num_in_flight - state.queue.size();
+        tenant_metrics["weight"] = state.limits.weight;
+        tenant_metrics["max_concurrent"] = state.limits.max_concurrent;
+        tenant_metrics["max_qps"] = state.limits.max_qps;
+    }
+
+    return metrics;
+}
+
+uint64_t SearchScheduler::clock_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t SearchScheduler::thread_cpu_time_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
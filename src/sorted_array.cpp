@@ -4,53 +4,20 @@
 void sorted_array::load(const uint32_t *sorted_array, const uint32_t array_length) {
     min = array_length != 0 ? sorted_array[0] : 0;
     max = array_length > 1 ? sorted_array[array_length-1] : min;
-
-    uint32_t size_required = (uint32_t) (sorted_append_size_required(max, array_length) * FOR_GROWTH_FACTOR);
-    uint8_t *out = new uint8_t[size_required];
-    uint32_t actual_size = for_compress_sorted(sorted_array, out, array_length);
-
-    delete[] in;
-    in = nullptr;
-
-    in = out;
-    length = array_length;
-    size_bytes = size_required;
-    length_bytes = actual_size;
+    encode(sorted_array, array_length);
 }
 
 bool sorted_array::append(uint32_t value) {
-    uint32_t size_required = sorted_append_size_required(value, length+1);
-
-    if(size_required+FOR_ELE_SIZE > size_bytes) {
-        // grow the array first
-        size_t new_size = (size_t) (size_required * FOR_GROWTH_FACTOR);
-        uint8_t *new_location = (uint8_t *) realloc(in, new_size);
-        if(new_location == NULL) {
-            abort();
-        }
-        in = new_location;
-        size_bytes = (uint32_t) new_size;
-    }
-
-    uint32_t new_length_bytes = for_append_sorted(in, length, value);
-    if(new_length_bytes == 0) return false;
-
-    length_bytes = new_length_bytes;
-    length++;
-
-    if(value < min) min = value;
-    if(value > max) max = value;
-
-    return true;
+    return append_value(value);
 }
 
 uint32_t sorted_array::at(uint32_t index) {
-    return for_select(in, index);
+    return get_codec()->select(in, length, sorted, index);
 }
 
 bool sorted_array::contains(uint32_t value) {
     uint32_t actual;
-    for_lower_bound_search(in, length, value, &actual);
+    get_codec()->lower_bound(in, length, value, &actual);
     return actual == value;
 }
 
@@ -60,7 +27,7 @@ uint32_t sorted_array::indexOf(uint32_t value) {
     }
 
     uint32_t actual;
-    uint32_t index = for_lower_bound_search(in, length, value, &actual);
+    uint32_t index = get_codec()->lower_bound(in, length, value, &actual);
     if(actual == value) return index;
     return length;
 }
@@ -119,6 +86,12 @@ void sorted_array::indexOf(const uint32_t *values, const size_t values_len, uint
         return ;
     }
 
+    if(codec != codec_t::FOR) {
+        // the narrowing binary search below works directly on FOR's bit packed values
+        get_codec()->index_of(in, length, values, values_len, indices);
+        return ;
+    }
+
     uint32_t base = *(uint32_t *)(in + 0);
     uint32_t bits = *(in + 4);
 
@@ -171,4 +144,13 @@ void sorted_array::remove_values(uint32_t *sorted_values, uint32_t values_length
     load(new_array, new_index);
     delete[] curr_array;
     delete[] new_array;
-}
\ No newline at end of file
+}
+
+size_t sorted_array::intersect(const uint32_t *ids, const size_t ids_len, uint32_t** out) {
+    if(length == 0 || ids_len == 0) {
+        return 0;
+    }
+
+    *out = new uint32_t[std::min((size_t) length, ids_len)];
+    return get_codec()->intersect(in, length, ids, ids_len, *out);
+}
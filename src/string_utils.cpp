@@ -1,12 +1,20 @@
 #include "string_utils.h"
 
-void StringUtils::unicode_normalize(std::string& str) const {
+void StringUtils::unicode_normalize(std::string& str) {
+    bool is_ascii = true;
+
     // remove special chars within ASCII range
-    str.erase(std::remove_if(str.begin(), str.end(), [](char c) {
+    str.erase(std::remove_if(str.begin(), str.end(), [&is_ascii](char c) {
+        is_ascii = is_ascii && (int)(c) >= 0;
         return !std::isalnum(c) && (int)(c) >= 0;
     }), str.end());
 
+    if(is_ascii) {
+        std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+        return ;
+    }
+
     icu::UnicodeString u_str = icu::UnicodeString::fromUTF8(str);
     str.clear();
     u_str.toLower().toUTF8String(str);
-}
\ No newline at end of file
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include "analyzer.h"
+
+static std::vector<std::string> analyze(const analyzer & field_analyzer, const std::string & text) {
+    std::vector<std::string> tokens;
+    field_analyzer.analyze(text, tokens);
+    return tokens;
+}
+
+TEST(AnalyzerTest, StandardMatchesUnicodeNormalization) {
+    analyzer standard;
+    ASSERT_EQ(std::vector<std::string>({"the", "quick", "brown", "fox"}), analyze(standard, "The  quick, Brown fox!"));
+    ASSERT_EQ(std::vector<std::string>({"abcåà123", "ab123"}), analyze(standard, "abcÅà123 AB-123"));
+
+    std::string token = "Aa12Zz@W-_?,.R";
+    standard.normalize(token);
+    ASSERT_EQ("aa12zzwr", token);
+}
+
+TEST(AnalyzerTest, VerbatimAsciiAndSeparators) {
+    ASSERT_EQ(std::vector<std::string>({"Shelf 1 - A"}), analyze(analyzer(analyzer_t::VERBATIM), "Shelf 1 - A"));
+
+    // non-ASCII characters are left as they are
+    std::vector<std::string> tokens = analyze(analyzer(analyzer_t::ASCII), "SKU AB-123 Åx");
+    ASSERT_EQ(std::vector<std::string>({"sku", "ab123", "Åx"}), tokens);
+
+    analyzer separators(analyzer_t::SEPARATORS, "-/");
+    ASSERT_EQ(std::vector<std::string>({"ab", "123", "x", "9"}), analyze(separators, "AB-123/x  9"));
+    ASSERT_EQ(std::vector<std::string>({"a", "b"}), analyze(separators, "--a//b-"));
+
+    field sku_field("sku", field_types::STRING, false);
+    sku_field.analyzer = analyzers::SEPARATORS;
+    ASSERT_FALSE(analyzer::validate(sku_field).ok());
+    sku_field.separators = "-";
+    ASSERT_TRUE(analyzer::validate(sku_field).ok());
+    ASSERT_EQ(analyzer_t::SEPARATORS, analyzer::for_field(sku_field).get_type());
+
+    field tags_field("tags", field_types::STRING_ARRAY, true);
+    ASSERT_EQ(analyzer_t::VERBATIM, analyzer::for_field(tags_field).get_type());
+    tags_field.analyzer = analyzers::ASCII;
+    ASSERT_FALSE(analyzer::validate(tags_field).ok());
+
+    field points_field("points", field_types::INT32, false);
+    points_field.analyzer = analyzers::VERBATIM;
+    ASSERT_FALSE(analyzer::validate(points_field).ok());
+
+    field title_field("title", field_types::STRING, false);
+    title_field.analyzer = "stemmed";
+    ASSERT_FALSE(analyzer::validate(title_field).ok());
+}
+
+TEST(AnalyzerTest, WordBreakSplitsTextWithoutSpaces) {
+    analyzer word_break(analyzer_t::WORD_BREAK);
+
+    ASSERT_EQ(std::vector<std::string>({"hello", "world", "42"}), analyze(word_break, "Hello, world! 42"));
+
+    // Japanese has no spaces between words, but is split into more than one token
+    std::vector<std::string> tokens = analyze(word_break, "東京都に住んでいます");
+    ASSERT_GT(tokens.size(), 1);
+
+    std::string joined;
+    for(const std::string & token: tokens) {
+        joined += token;
+    }
+    ASSERT_EQ("東京都に住んでいます", joined);
+}
@@ -88,6 +88,18 @@ TEST_F(CollectionManagerTest, CollectionCreation) {
     ASSERT_EQ("1", next_collection_id);
 }
 
+TEST_F(CollectionManagerTest, RepeatedFieldsAreRejected) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false),
+                                 field("title", field_types::STRING_ARRAY, true)};
+
+    Option<Collection*> create_op = collectionManager.create_collection("repeated", fields, "points");
+    ASSERT_FALSE(create_op.ok());
+    ASSERT_EQ(400, create_op.code());
+    ASSERT_EQ("Field `title` is declared more than once in the schema.", create_op.error());
+    ASSERT_EQ(nullptr, collectionManager.get_collection("repeated"));
+}
+
 TEST_F(CollectionManagerTest, GetAllCollections) {
     std::vector<Collection*> collection_vec = collectionManager.get_collections();
     ASSERT_EQ(1, collection_vec.size());
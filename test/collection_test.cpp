@@ -1264,9 +1264,244 @@ TEST_F(CollectionTest, FacetCounts) {
     ASSERT_EQ("silver", results["facet_counts"][0]["counts"][1]["value"]);
     ASSERT_EQ("bronze", results["facet_counts"][0]["counts"][2]["value"]);
 
+    // per_page=0 returns only the count and the facets, which must match those of a regular search
+    nlohmann::json count_only_results = coll_array_fields->search("Jeremy", query_fields, "age: >24", facets,
+                                                                  sort_fields, 0, 0, 1, FREQUENCY, false).get();
+
+    ASSERT_EQ(0, count_only_results["hits"].size());
+    ASSERT_EQ(results["found"], count_only_results["found"]);
+    ASSERT_EQ(results["facet_counts"], count_only_results["facet_counts"]);
+
+    results = coll_array_fields->search("Jeremy", query_fields, "", facets, sort_fields, 1, 10, 1, FREQUENCY, false).get();
+    count_only_results = coll_array_fields->search("Jeremy", query_fields, "", facets, sort_fields, 1, 0, 1,
+                                                   FREQUENCY, false).get();
+
+    ASSERT_EQ(0, count_only_results["hits"].size());
+    ASSERT_EQ(results["found"], count_only_results["found"]);
+    ASSERT_EQ(results["facet_counts"], count_only_results["facet_counts"]);
+
+    collectionManager.drop_collection("coll_array_fields");
+}
+
+TEST_F(CollectionTest, NumericFacetRangesAndStats) {
+    Collection *coll_array_fields;
+
+    std::ifstream infile(std::string(ROOT_DIR)+"test/numeric_array_documents.jsonl");
+    std::vector<field> fields = {field("name", field_types::STRING, false),
+                                 field("age", field_types::INT32, true),
+                                 field("rating", field_types::FLOAT, true),
+                                 field("years", field_types::INT32_ARRAY, false),
+                                 field("tags", field_types::STRING_ARRAY, true)};
+
+    std::vector<sort_by> sort_fields = { sort_by("age", "DESC") };
+
+    coll_array_fields = collectionManager.get_collection("coll_array_fields");
+    if(coll_array_fields == nullptr) {
+        coll_array_fields = collectionManager.create_collection("coll_array_fields", fields, "age").get();
+    }
+
+    std::string json_line;
+
+    while (std::getline(infile, json_line)) {
+        coll_array_fields->add(json_line);
+    }
+
+    infile.close();
+
+    query_fields = {"name"};
+    std::vector<std::string> facets = {"age(:30, 30:50, 50:)", "tags"};
+
+    nlohmann::json results = coll_array_fields->search("Jeremy", query_fields, "", facets, sort_fields, 0, 10, 1,
+                                                       FREQUENCY, false).get();
+    ASSERT_EQ(5, results["hits"].size());
+    ASSERT_EQ(2, results["facet_counts"].size());
+
+    // ranges are returned in the order they were asked for
+    nlohmann::json age_facet = results["facet_counts"][0];
+    ASSERT_EQ("age", age_facet["field_name"]);
+    ASSERT_EQ(3, age_facet["counts"].size());
+    ASSERT_EQ(":30", age_facet["counts"][0]["value"]);
+    ASSERT_EQ(2, (int) age_facet["counts"][0]["count"]);
+    ASSERT_EQ("30:50", age_facet["counts"][1]["value"]);
+    ASSERT_EQ(2, (int) age_facet["counts"][1]["count"]);
+    ASSERT_EQ("50:", age_facet["counts"][2]["value"]);
+    ASSERT_EQ(1, (int) age_facet["counts"][2]["count"]);
+
+    ASSERT_EQ(5, (int) age_facet["stats"]["count"]);
+    ASSERT_EQ(21, (int) age_facet["stats"]["min"]);
+    ASSERT_EQ(63, (int) age_facet["stats"]["max"]);
+    ASSERT_EQ(184, (int) age_facet["stats"]["sum"]);
+    ASSERT_FLOAT_EQ(36.8, age_facet["stats"]["avg"].get<float>());
+
+    ASSERT_EQ("tags", results["facet_counts"][1]["field_name"]);
+    ASSERT_EQ("gold", results["facet_counts"][1]["counts"][0]["value"]);
+
+    // filtered, and with automatic ranges over the field's values in the collection: 0.0 to 9.999
+    results = coll_array_fields->search("Jeremy", query_fields, "age:>24", {"rating"}, sort_fields, 0, 0, 1,
+                                        FREQUENCY, false).get();
+    nlohmann::json rating_facet = results["facet_counts"][0];
+    ASSERT_EQ(10, rating_facet["counts"].size());
+
+    size_t total_count = 0;
+    for(const nlohmann::json & range_count: rating_facet["counts"]) {
+        total_count += range_count["count"].get<size_t>();
+    }
+
+    ASSERT_EQ(3, total_count);
+    ASSERT_EQ(1, (int) rating_facet["counts"][0]["count"]);   // 0.0
+    ASSERT_EQ(1, (int) rating_facet["counts"][5]["count"]);   // 5.5
+    ASSERT_EQ(1, (int) rating_facet["counts"][9]["count"]);   // 9.999, the largest value
+    ASSERT_EQ(3, (int) rating_facet["stats"]["count"]);
+    ASSERT_FLOAT_EQ(9.999, rating_facet["stats"]["max"].get<float>());
+    ASSERT_FLOAT_EQ(0.0, rating_facet["stats"]["min"].get<float>());
+
+    // the match-all query scans the column for numeric facets
+    results = coll_array_fields->search("*", query_fields, "", {"age(40:)"}, sort_fields, 0, 0, 1,
+                                        FREQUENCY, false).get();
+    ASSERT_EQ(5, results["found"].get<size_t>());
+    ASSERT_EQ(2, (int) results["facet_counts"][0]["counts"][0]["count"]);
+
+    // bad ranges and ranges on a string facet
+    Option<nlohmann::json> bad_op = coll_array_fields->search("Jeremy", query_fields, "", {"age(10-20)"},
+                                                              sort_fields, 0, 10, 1, FREQUENCY, false);
+    ASSERT_FALSE(bad_op.ok());
+    ASSERT_EQ(400, bad_op.code());
+
+    bad_op = coll_array_fields->search("Jeremy", query_fields, "", {"age(a:b)"}, sort_fields, 0, 10, 1,
+                                       FREQUENCY, false);
+    ASSERT_FALSE(bad_op.ok());
+
+    bad_op = coll_array_fields->search("Jeremy", query_fields, "", {"tags(0:10)"}, sort_fields, 0, 10, 1,
+                                       FREQUENCY, false);
+    ASSERT_FALSE(bad_op.ok());
+    ASSERT_EQ(400, bad_op.code());
+
+    // a removed document leaves the bounds of the automatic ranges: 9.999 is gone, so 7.812 is the largest
+    ASSERT_TRUE(coll_array_fields->remove("1").ok());
+
+    results = coll_array_fields->search("*", query_fields, "", {"rating"}, sort_fields, 0, 0, 1,
+                                        FREQUENCY, false).get();
+    rating_facet = results["facet_counts"][0];
+    const std::string last_label = rating_facet["counts"][9]["value"];
+    ASSERT_EQ("7.812", last_label.substr(last_label.find(':') + 1));
+    ASSERT_EQ(1, (int) rating_facet["counts"][9]["count"]);
+    ASSERT_EQ(4, (int) rating_facet["stats"]["count"]);
+    ASSERT_FLOAT_EQ(7.812, rating_facet["stats"]["max"].get<float>());
+
     collectionManager.drop_collection("coll_array_fields");
 }
 
+TEST_F(CollectionTest, SampledFacetCounts) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("tags", field_types::STRING_ARRAY, true),
+                                 field("points", field_types::INT32, true)};
+
+    Collection* coll_sampled = collectionManager.create_collection("coll_sampled", fields, "points").get();
+
+    for(size_t i = 0; i < 5000; i++) {
+        nlohmann::json doc;
+        doc["title"] = "archive item " + std::to_string(i);
+        doc["tags"] = {"Shelf " + std::to_string(i % 5)};
+        doc["points"] = i % 10;
+        ASSERT_TRUE(coll_sampled->add(doc.dump()).ok());
+    }
+
+    // above the threshold: counted on 20% of the results and scaled
+    nlohmann::json results = coll_sampled->search("archive", {"title"}, "", {"tags", "points(:5)"}, sort_fields, 0,
+                                                  10, 1, FREQUENCY, false, false, 20, 100).get();
+    ASSERT_EQ(5000, results["found"].get<size_t>());
+    ASSERT_EQ(5, results["facet_counts"][0]["counts"].size());
+    ASSERT_TRUE(results["facet_counts"][0]["sampled"].get<bool>());
+    ASSERT_TRUE(results["facet_counts"][1]["sampled"].get<bool>());
+
+    for(const nlohmann::json & value_count: results["facet_counts"][0]["counts"]) {
+        ASSERT_NEAR(1000, value_count["count"].get<size_t>(), 200);
+    }
+
+    ASSERT_NEAR(2500, results["facet_counts"][1]["counts"][0]["count"].get<size_t>(), 250);
+    ASSERT_NEAR(5000, results["facet_counts"][1]["stats"]["count"].get<size_t>(), 10);
+
+    // within the threshold: exact counts
+    results = coll_sampled->search("archive", {"title"}, "", {"tags"}, sort_fields, 0, 10, 1, FREQUENCY, false,
+                                   false, 20, 5000).get();
+    ASSERT_EQ(0, results["facet_counts"][0].count("sampled"));
+
+    for(const nlohmann::json & value_count: results["facet_counts"][0]["counts"]) {
+        ASSERT_EQ(1000, value_count["count"].get<size_t>());
+    }
+
+    Option<nlohmann::json> bad_op = coll_sampled->search("archive", {"title"}, "", {"tags"}, sort_fields, 0, 10, 1,
+                                                         FREQUENCY, false, false, 0, 100);
+    ASSERT_FALSE(bad_op.ok());
+    ASSERT_EQ(400, bad_op.code());
+
+    collectionManager.drop_collection("coll_sampled");
+}
+
+TEST_F(CollectionTest, FacetQueryCountsMatchingValues) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("brand", field_types::STRING, true),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll_brands = collectionManager.create_collection("coll_brands", fields, "points").get();
+
+    const std::vector<std::string> brands = {"Ocean Labs", "Oceanic Foods", "Sea Co", "Coral Reef Supplies",
+                                             "Labs of the Ocean"};
+
+    for(size_t i = 0; i < 20; i++) {
+        nlohmann::json doc;
+        doc["title"] = (i < 15) ? "diving gear" : "fishing gear";
+        doc["brand"] = brands[i % brands.size()];
+        doc["points"] = i;
+        ASSERT_TRUE(coll_brands->add(doc.dump()).ok());
+    }
+
+    // the last token is a prefix
+    nlohmann::json results = coll_brands->search("gear", {"title"}, "", {"brand"}, sort_fields, 0, 10, 1,
+                                                 FREQUENCY, false, false, 100, 0, "brand: oce").get();
+    ASSERT_EQ(20, results["found"].get<size_t>());
+    ASSERT_EQ(3, results["facet_counts"][0]["counts"].size());
+
+    std::map<std::string, size_t> value_counts;
+    for(const nlohmann::json & value_count: results["facet_counts"][0]["counts"]) {
+        value_counts[value_count["value"]] = value_count["count"];
+    }
+
+    std::map<std::string, size_t> expected = {{"Ocean Labs", 4}, {"Oceanic Foods", 4}, {"Labs of the Ocean", 4}};
+    ASSERT_EQ(expected, value_counts);
+
+    // every token has to match, and the counts are those of the results
+    results = coll_brands->search("diving", {"title"}, "", {"brand"}, sort_fields, 0, 10, 1, FREQUENCY, false,
+                                  false, 100, 0, "brand:labs oce").get();
+    ASSERT_EQ(2, results["facet_counts"][0]["counts"].size());
+    ASSERT_EQ(3, (int) results["facet_counts"][0]["counts"][0]["count"]);
+    ASSERT_EQ(3, (int) results["facet_counts"][0]["counts"][1]["count"]);
+
+    // with a typo
+    results = coll_brands->search("gear", {"title"}, "", {"brand"}, sort_fields, 1, 0, 1, FREQUENCY, false,
+                                  false, 100, 0, "brand:corl").get();
+    ASSERT_EQ(1, results["facet_counts"][0]["counts"].size());
+    ASSERT_EQ("Coral Reef Supplies", results["facet_counts"][0]["counts"][0]["value"]);
+
+    // on the live counts of a match-all query
+    results = coll_brands->search("*", {"title"}, "", {"brand"}, sort_fields, 0, 0, 1, FREQUENCY, false,
+                                  false, 100, 0, "brand:se").get();
+    ASSERT_EQ(1, results["facet_counts"][0]["counts"].size());
+    ASSERT_EQ("Sea Co", results["facet_counts"][0]["counts"][0]["value"]);
+    ASSERT_EQ(4, (int) results["facet_counts"][0]["counts"][0]["count"]);
+
+    results = coll_brands->search("gear", {"title"}, "", {"brand"}, sort_fields, 0, 10, 1, FREQUENCY, false,
+                                  false, 100, 0, "brand:zzz").get();
+    ASSERT_EQ(0, results["facet_counts"][0]["counts"].size());
+
+    Option<nlohmann::json> bad_op = coll_brands->search("gear", {"title"}, "", {"brand"}, sort_fields, 0, 10, 1,
+                                                        FREQUENCY, false, false, 100, 0, "title:oce");
+    ASSERT_FALSE(bad_op.ok());
+    ASSERT_EQ(400, bad_op.code());
+
+    collectionManager.drop_collection("coll_brands");
+}
+
 TEST_F(CollectionTest, SortingOrder) {
     Collection *coll_mul_fields;
 
@@ -1644,4 +1879,802 @@ TEST_F(CollectionTest, DeletionOfADocument) {
     ASSERT_EQ(3, num_keys);
 
     collectionManager.drop_collection("collection_for_del");
-}
\ No newline at end of file
+}
+
+TEST_F(CollectionTest, DeletionOfStringArrayAndFacetValues) {
+    Collection *coll1;
+
+    std::vector<field> fields = {field("tags", field_types::STRING_ARRAY, false),
+                                 field("brand", field_types::STRING, true),
+                                 field("average", field_types::FLOAT, false)};
+
+    std::vector<sort_by> sort_fields = { sort_by("average", "DESC") };
+
+    coll1 = collectionManager.get_collection("coll1");
+    if(coll1 == nullptr) {
+        coll1 = collectionManager.create_collection("coll1", fields, "average").get();
+    }
+
+    nlohmann::json doc;
+    doc["id"] = "100";
+    doc["tags"] = {"Deep Sea Fishing", "Coral Reefs"};
+    doc["brand"] = "Ocean Labs";
+    doc["average"] = 4;
+
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    doc["id"] = "101";
+    doc["tags"] = {"Coral Reefs"};
+    doc["brand"] = "Sea Co";
+    ASSERT_TRUE(coll1->add(doc.dump()).ok());
+
+    nlohmann::json results = coll1->search("reefs", {"tags"}, "", {"brand"}, sort_fields, 0, 10, 1, FREQUENCY,
+                                           false).get();
+    ASSERT_EQ(2, results["hits"].size());
+    ASSERT_EQ(2, results["facet_counts"][0]["counts"].size());
+
+    coll1->remove("100");
+
+    // every token of a multi-word array element must be gone from the index, along with the facet value
+    results = coll1->search("fishing", {"tags"}, "", {}, sort_fields, 0, 10, 1, FREQUENCY, false).get();
+    ASSERT_EQ(0, results["hits"].size());
+
+    results = coll1->search("reefs", {"tags"}, "", {"brand"}, sort_fields, 0, 10, 1, FREQUENCY, false).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ(1, results["facet_counts"][0]["counts"].size());
+    ASSERT_EQ("Sea Co", results["facet_counts"][0]["counts"][0]["value"]);
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionTest, SearchPlanChoosesExecutionOrder) {
+    Collection *coll1;
+
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false)};
+
+    std::vector<sort_by> sort_fields = { sort_by("points", "DESC") };
+
+    coll1 = collectionManager.get_collection("coll1");
+    if(coll1 == nullptr) {
+        coll1 = collectionManager.create_collection("coll1", fields, "points").get();
+    }
+
+    for(size_t i = 0; i < 200; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = (i == 7) ? "common rare word" : "common word " + std::to_string(i);
+        doc["points"] = i;
+        ASSERT_TRUE(coll1->add(doc.dump()).ok());
+    }
+
+    // plan is reported only when asked for
+    nlohmann::json results = coll1->search("rare", {"title"}, "points:>=5", {}, sort_fields, 0, 10, 1,
+                                           FREQUENCY, false).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ(0, results.count("search_plans"));
+
+    // a rare token and a broad range filter: text matches are checked against the filter
+    results = coll1->search("rare", {"title"}, "points:>=5", {}, sort_fields, 0, 10, 1, FREQUENCY, false, true).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_STREQ("7", results["hits"][0]["document"]["id"].get<std::string>().c_str());
+    ASSERT_EQ(4, results["search_plans"].size());
+
+    for(const auto & plan: results["search_plans"]) {
+        ASSERT_STREQ("text_first", plan["execution"].get<std::string>().c_str());
+    }
+
+    results = coll1->search("rare", {"title"}, "points:>10", {}, sort_fields, 0, 10, 1, FREQUENCY, false, true).get();
+    ASSERT_EQ(0, results["hits"].size());
+
+    // a common token and a selective filter: filter is materialized first
+    results = coll1->search("common", {"title"}, "points:5", {}, sort_fields, 0, 10, 1, FREQUENCY, false, true).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_STREQ("5", results["hits"][0]["document"]["id"].get<std::string>().c_str());
+
+    for(const auto & plan: results["search_plans"]) {
+        ASSERT_STREQ("filter_first", plan["execution"].get<std::string>().c_str());
+    }
+
+    results = coll1->search("common", {"title"}, "", {}, sort_fields, 0, 10, 1, FREQUENCY, false, true).get();
+    ASSERT_EQ(10, results["hits"].size());
+    ASSERT_STREQ("text_only", results["search_plans"][0]["execution"].get<std::string>().c_str());
+
+    collectionManager.drop_collection("coll1");
+}
+
+TEST_F(CollectionTest, DeletionThroughForwardIndex) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("tags", field_types::STRING_ARRAY, true),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll_fwd = new Collection("coll_fwd", 100, 0, store, fields, "points",
+                                          Collection::DEFAULT_NUM_INDICES, true);
+
+    for(size_t i = 0; i < 10; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = (i % 2 == 0) ? "is it or is is not" : "the cryogenic archives " + std::to_string(i);
+        doc["tags"] = {"Shelf " + std::to_string(i % 3), "Archive"};
+        doc["points"] = i;
+        ASSERT_TRUE(coll_fwd->add(doc.dump()).ok());
+    }
+
+    nlohmann::json results = coll_fwd->search("cryogenic", {"title"}, "", {"tags"}, sort_fields, 0, 10, 1,
+                                              FREQUENCY, false).get();
+    ASSERT_EQ(5, results["hits"].size());
+
+    ASSERT_TRUE(coll_fwd->remove("1").ok());
+    ASSERT_TRUE(coll_fwd->remove("2").ok());
+    ASSERT_FALSE(coll_fwd->remove("1").ok());
+
+    results = coll_fwd->search("cryogenic", {"title"}, "", {"tags"}, sort_fields, 0, 10, 1, FREQUENCY, false).get();
+    ASSERT_EQ(4, results["hits"].size());
+    ASSERT_EQ(8, coll_fwd->get_num_documents());
+
+    results = coll_fwd->search("shelf", {"title"}, "points:1", {}, sort_fields, 0, 10, 1, FREQUENCY, false).get();
+    ASSERT_EQ(0, results["hits"].size());
+
+    // remove everything: leaves that lose their last document are freed
+    for(size_t i = 0; i < 10; i++) {
+        coll_fwd->remove(std::to_string(i));
+    }
+
+    ASSERT_EQ(0, coll_fwd->get_num_documents());
+
+    results = coll_fwd->search("archives", {"title"}, "", {}, sort_fields, 0, 10, 1, FREQUENCY, false).get();
+    ASSERT_EQ(0, results["hits"].size());
+
+    results = coll_fwd->search("is", {"title"}, "", {}, sort_fields, 0, 10, 1, FREQUENCY, false).get();
+    ASSERT_EQ(0, results["hits"].size());
+
+    delete coll_fwd;
+}
+
+TEST_F(CollectionTest, LiveFacetCountsForWildcardAndPinnedFilters) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("tags", field_types::STRING_ARRAY, true),
+                                 field("category", field_types::STRING, true),
+                                 field("years", field_types::INT32_ARRAY, false),
+                                 field("in_stock", field_types::BOOL, false),
+                                 field("points", field_types::INT32, false)};
+
+    Option<Collection*> bad_pin_op = collectionManager.create_collection("coll_pinned", fields, "points",
+                                                                         {"unknown_field:1"});
+    ASSERT_FALSE(bad_pin_op.ok());
+    ASSERT_EQ(404, bad_pin_op.code());
+    ASSERT_EQ(nullptr, collectionManager.get_collection("coll_pinned"));
+
+    Collection* coll_pinned = collectionManager.create_collection("coll_pinned", fields, "points",
+                                                                  {"in_stock:true"}).get();
+
+    auto add_doc = [&](const size_t i) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = (i % 5 == 0) ? "cryogenic archives" : "the archives of " + std::to_string(i);
+        doc["tags"] = {"Shelf " + std::to_string(i % 3), "Archive"};
+        doc["category"] = "Category " + std::to_string(i % 4);
+        doc["years"] = {2000 + (int) (i % 4), 2010};
+        doc["in_stock"] = (i % 2 == 0);
+        doc["points"] = i;
+        ASSERT_TRUE(coll_pinned->add(doc.dump()).ok());
+    };
+
+    for(size_t i = 0; i < 10; i++) {
+        add_doc(i);
+    }
+
+    // pinned after some of the documents are indexed, and maintained for the rest
+    ASSERT_EQ(5, coll_pinned->pin_filter("years:[2001,2002]").get());
+    ASSERT_EQ(2, coll_pinned->pin_filter("title:cryogenic").get());
+    ASSERT_FALSE(coll_pinned->pin_filter("in_stock:maybe").ok());
+
+    for(size_t i = 10; i < 30; i++) {
+        add_doc(i);
+    }
+
+    std::vector<std::string> expected_pinned = {"in_stock:true", "years:[2001,2002]", "title:cryogenic"};
+    ASSERT_EQ(expected_pinned, coll_pinned->get_pinned_filters());
+
+    const std::vector<std::string> facets = {"tags", "category"};
+
+    // facets from the live counts must match the ones counted from the matching documents: `points:>=0` matches
+    // every document but isn't pinned
+    auto check_counts = [&](const std::string & pinned_filter, const std::string & equivalent_filter) {
+        for(size_t per_page: {0, 10}) {
+            nlohmann::json live = coll_pinned->search("*", {"title"}, pinned_filter, facets, sort_fields, 0,
+                                                      per_page, 1, FREQUENCY, false).get();
+            nlohmann::json counted = coll_pinned->search("*", {"title"}, equivalent_filter, facets, sort_fields, 0,
+                                                         per_page, 1, FREQUENCY, false).get();
+            ASSERT_EQ(counted["found"], live["found"]);
+            ASSERT_EQ(counted["facet_counts"], live["facet_counts"]);
+            ASSERT_EQ(counted["hits"], live["hits"]);
+        }
+    };
+
+    check_counts("", "points:>=0");
+    check_counts("in_stock:true", "in_stock:true && points:>=0");
+    check_counts("years:[2001,2002]", "years:[2001,2002] && points:>=0");
+    check_counts("title:cryogenic", "title:cryogenic && points:>=0");
+
+    nlohmann::json results = coll_pinned->search("*", {"title"}, "", facets, sort_fields, 0, 10, 1,
+                                                 FREQUENCY, false).get();
+    ASSERT_EQ(30, results["found"].get<size_t>());
+    ASSERT_EQ(10, results["hits"].size());
+    ASSERT_EQ("29", results["hits"][0]["document"]["id"]);
+    ASSERT_EQ("Archive", results["facet_counts"][0]["counts"][0]["value"]);
+    ASSERT_EQ(30, (int) results["facet_counts"][0]["counts"][0]["count"]);
+
+    results = coll_pinned->search("*", {"title"}, "in_stock:true", facets, sort_fields, 0, 0, 1,
+                                  FREQUENCY, false).get();
+    ASSERT_EQ(15, results["found"].get<size_t>());
+    ASSERT_EQ(0, results["hits"].size());
+
+    // removals are reflected in the live counts
+    for(size_t i = 0; i < 30; i += 3) {
+        ASSERT_TRUE(coll_pinned->remove(std::to_string(i)).ok());
+    }
+
+    check_counts("", "points:>=0");
+    check_counts("in_stock:true", "in_stock:true && points:>=0");
+    check_counts("years:[2001,2002]", "years:[2001,2002] && points:>=0");
+    check_counts("title:cryogenic", "title:cryogenic && points:>=0");
+
+    results = coll_pinned->search("*", {"title"}, "", {"tags"}, sort_fields, 0, 0, 1, FREQUENCY, false).get();
+    ASSERT_EQ(20, results["found"].get<size_t>());
+    ASSERT_EQ(3, results["facet_counts"][0]["counts"].size());
+    ASSERT_EQ("Archive", results["facet_counts"][0]["counts"][0]["value"]);
+    ASSERT_EQ(20, (int) results["facet_counts"][0]["counts"][0]["count"]);
+    ASSERT_EQ(10, (int) results["facet_counts"][0]["counts"][1]["count"]);
+
+    collectionManager.drop_collection("coll_pinned");
+}
+
+TEST_F(CollectionTest, PinnedFilterOnInt64ArrayBeyondInt32) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("timestamps", field_types::INT64_ARRAY, false),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll_int64 = collectionManager.create_collection("coll_int64", fields, "points",
+                                                                 {"timestamps:>10000000000"}).get();
+
+    // the pinned filter is evaluated on every add
+    for(size_t i = 0; i < 6; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "event " + std::to_string(i);
+        doc["timestamps"] = {(int64_t) 1000, (int64_t) 10000000000 + (int64_t) (i % 2)};
+        doc["points"] = i;
+        ASSERT_TRUE(coll_int64->add(doc.dump()).ok());
+    }
+
+    nlohmann::json results = coll_int64->search("*", {"title"}, "timestamps:>10000000000", {}, sort_fields, 0,
+                                                10, 1, FREQUENCY, false).get();
+    ASSERT_EQ(3, results["found"].get<size_t>());
+
+    results = coll_int64->search("*", {"title"}, "timestamps:10000000001 && points:>=0", {}, sort_fields, 0,
+                                 10, 1, FREQUENCY, false).get();
+    ASSERT_EQ(3, results["found"].get<size_t>());
+
+    collectionManager.drop_collection("coll_int64");
+}
+
+TEST_F(CollectionTest, AlterSchemaBackfillsAddedFields) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll_alter = collectionManager.create_collection("coll_alter", fields, "points").get();
+
+    // the documents have attributes that are not in the schema yet, and some don't have a `year`
+    for(size_t i = 0; i < 30; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "Title " + std::to_string(i);
+        doc["points"] = i;
+        doc["genre"] = (i % 3 == 0) ? "fiction" : "poetry";
+        if(i % 10 != 0) {
+            doc["year"] = 2000 + i;
+        }
+        ASSERT_TRUE(coll_alter->add(doc.dump()).ok());
+    }
+
+    ASSERT_FALSE(coll_alter->search("*", {"title"}, "", {"genre"}, sort_fields, 0).ok());
+
+    ASSERT_EQ(400, collectionManager.alter_collection("coll_alter", {}, {"points"}).code());
+    ASSERT_EQ(404, collectionManager.alter_collection("coll_alter", {}, {"rating"}).code());
+    ASSERT_EQ(409, collectionManager.alter_collection("coll_alter", {field("title", field_types::STRING, false)},
+                                                      {}).code());
+    ASSERT_EQ(400, collectionManager.alter_collection("coll_alter", {field("rating", "decimal", false)}, {}).code());
+
+    Option<bool> alter_op = collectionManager.alter_collection("coll_alter",
+                                                               {field("genre", field_types::STRING, true),
+                                                                field("year", field_types::INT32, false)}, {});
+    ASSERT_TRUE(alter_op.ok());
+
+    // documents written during the backfill are validated against, and indexed with, the added fields
+    ASSERT_TRUE(coll_alter->add("{\"id\": \"30\", \"title\": \"Title 30\", \"points\": 30, \"genre\": \"fiction\", "
+                                "\"year\": 2030}").ok());
+    ASSERT_FALSE(coll_alter->add("{\"id\": \"31\", \"title\": \"Title 31\", \"points\": 31, \"genre\": 31}").ok());
+    ASSERT_TRUE(coll_alter->remove("3").ok());
+
+    coll_alter->await_backfill();
+    ASSERT_FALSE(coll_alter->is_backfilling());
+    ASSERT_EQ(30, coll_alter->get_num_backfilled());
+    ASSERT_EQ(4, coll_alter->get_fields().size());
+
+    nlohmann::json results = coll_alter->search("*", {"title"}, "", {"genre"}, sort_fields, 0).get();
+    ASSERT_EQ(30, results["found"].get<size_t>());
+    ASSERT_EQ("poetry", results["facet_counts"][0]["counts"][0]["value"]);
+    ASSERT_EQ(20, (int) results["facet_counts"][0]["counts"][0]["count"]);
+    ASSERT_EQ("fiction", results["facet_counts"][0]["counts"][1]["value"]);
+    ASSERT_EQ(10, (int) results["facet_counts"][0]["counts"][1]["count"]);
+
+    std::vector<sort_by> sort_year = { sort_by("year", "DESC") };
+    results = coll_alter->search("title", {"title"}, "year:>2025", {}, sort_year, 0).get();
+    ASSERT_EQ(5, results["found"].get<size_t>());
+    ASSERT_EQ("30", results["hits"][0]["document"]["id"]);
+    ASSERT_EQ("26", results["hits"][4]["document"]["id"]);
+
+    // both added fields are optional, as stored documents need not have them
+    std::string meta_json;
+    store->get(Collection::get_meta_key("coll_alter"), meta_json);
+    nlohmann::json meta = nlohmann::json::parse(meta_json);
+    ASSERT_EQ(4, meta["fields"].size());
+    ASSERT_EQ("year", meta["fields"][3]["name"]);
+    ASSERT_TRUE(meta["fields"][3]["optional"].get<bool>());
+    ASSERT_EQ(0, meta["fields"][0].count("optional"));
+
+    ASSERT_TRUE(collectionManager.alter_collection("coll_alter", {}, {"genre"}).ok());
+    ASSERT_FALSE(coll_alter->is_backfilling());
+    ASSERT_EQ(404, coll_alter->search("*", {"title"}, "", {"genre"}, sort_fields, 0).code());
+    ASSERT_TRUE(coll_alter->add("{\"id\": \"32\", \"title\": \"Title 32\", \"points\": 32, \"genre\": 32}").ok());
+    ASSERT_TRUE(coll_alter->remove("32").ok());
+
+    store->get(Collection::get_meta_key("coll_alter"), meta_json);
+    ASSERT_EQ(3, nlohmann::json::parse(meta_json)["fields"].size());
+
+    collectionManager.drop_collection("coll_alter");
+
+    // through the forward index, removals must also drop the leaves of backfilled fields and not of dropped ones
+    Collection* coll_fwd = new Collection("coll_alter_fwd", 101, 0, store, fields, "points",
+                                          Collection::DEFAULT_NUM_INDICES, true);
+
+    for(size_t i = 0; i < 10; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "the cryogenic archives " + std::to_string(i);
+        doc["points"] = i;
+        doc["subtitle"] = "Shelf " + std::to_string(i);
+        doc["tags"] = {"Shelf " + std::to_string(i % 2)};
+        ASSERT_TRUE(coll_fwd->add(doc.dump()).ok());
+    }
+
+    ASSERT_TRUE(coll_fwd->alter_schema({field("subtitle", field_types::STRING, false),
+                                        field("tags", field_types::STRING_ARRAY, true)}, {}).ok());
+    coll_fwd->await_backfill();
+
+    results = coll_fwd->search("shelf", {"subtitle"}, "", {"tags"}, sort_fields, 0).get();
+    ASSERT_EQ(10, results["found"].get<size_t>());
+    ASSERT_EQ(5, (int) results["facet_counts"][0]["counts"][0]["count"]);
+
+    ASSERT_TRUE(coll_fwd->remove("1").ok());
+    results = coll_fwd->search("shelf", {"subtitle"}, "", {"tags"}, sort_fields, 0).get();
+    ASSERT_EQ(9, results["found"].get<size_t>());
+    ASSERT_EQ("Shelf 0", results["facet_counts"][0]["counts"][0]["value"]);
+    ASSERT_EQ(4, (int) results["facet_counts"][0]["counts"][1]["count"]);
+
+    ASSERT_TRUE(coll_fwd->alter_schema({}, {"title"}).ok());
+    for(size_t i = 0; i < 10; i++) {
+        coll_fwd->remove(std::to_string(i));
+    }
+
+    results = coll_fwd->search("shelf", {"subtitle"}, "", {}, sort_fields, 0).get();
+    ASSERT_EQ(0, results["found"].get<size_t>());
+
+    delete coll_fwd;
+}
+
+TEST_F(CollectionTest, AnalyzersPerField) {
+    field sku("sku", field_types::STRING, false);
+    sku.analyzer = analyzers::SEPARATORS;
+    sku.separators = "-/";
+
+    field code("code", field_types::STRING, false);
+    code.analyzer = analyzers::VERBATIM;
+
+    field body("body", field_types::STRING, false);
+    body.analyzer = analyzers::WORD_BREAK;
+
+    std::vector<field> fields = {field("title", field_types::STRING, false), sku, code, body,
+                                 field("points", field_types::INT32, false)};
+    std::vector<sort_by> sort_fields = { sort_by("points", "DESC") };
+
+    Collection* coll_analyzers = collectionManager.create_collection("coll_analyzers", fields, "points").get();
+
+    ASSERT_TRUE(coll_analyzers->add("{\"id\": \"0\", \"title\": \"Rubber Duck\", \"sku\": \"AB-123-X\", "
+                                    "\"code\": \"Duck.Yellow\", \"body\": \"a yellow duck\", \"points\": 1}").ok());
+    ASSERT_TRUE(coll_analyzers->add("{\"id\": \"1\", \"title\": \"Tea Cup\", \"sku\": \"CD/456/Y\", "
+                                    "\"code\": \"cup.white\", \"body\": \"東京都の紅茶\", \"points\": 2}").ok());
+
+    nlohmann::json results = coll_analyzers->search("123", {"sku"}, "", {}, sort_fields, 0).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ("0", results["hits"][0]["document"]["id"]);
+    // snippets are made of the field's tokens
+    ASSERT_EQ("AB <mark>123</mark> X", results["hits"][0]["highlight"]["sku"]);
+
+    results = coll_analyzers->search("456", {"sku"}, "", {}, sort_fields, 0).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ("1", results["hits"][0]["document"]["id"]);
+
+    // verbatim values keep their case and punctuation, on both ingest and query
+    results = coll_analyzers->search("Duck.Yellow", {"code"}, "", {}, sort_fields, 0, 10, 1, FREQUENCY, false).get();
+    ASSERT_EQ(1, results["hits"].size());
+    results = coll_analyzers->search("*", {"code"}, "code: cup.white", {}, sort_fields, 0).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ("1", results["hits"][0]["document"]["id"]);
+    results = coll_analyzers->search("*", {"code"}, "code: Cup.White", {}, sort_fields, 0).get();
+    ASSERT_EQ(0, results["hits"].size());
+
+    // text without spaces is split into words
+    results = coll_analyzers->search("紅茶", {"body"}, "", {}, sort_fields, 0, 10, 1, FREQUENCY, false).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ("1", results["hits"][0]["document"]["id"]);
+
+    field facet_field("tags", field_types::STRING_ARRAY, true);
+    facet_field.analyzer = analyzers::WORD_BREAK;
+    ASSERT_EQ(400, collectionManager.create_collection("coll_bad_analyzer", {facet_field,
+              field("points", field_types::INT32, false)}, "points").code());
+
+    field unknown("title", field_types::STRING, false);
+    unknown.analyzer = "klingon";
+    ASSERT_EQ(400, collectionManager.create_collection("coll_bad_analyzer", {unknown,
+              field("points", field_types::INT32, false)}, "points").code());
+
+    collectionManager.drop_collection("coll_analyzers");
+}
+
+TEST_F(CollectionTest, InfixSearch) {
+    field part_number("part_number", field_types::STRING, false);
+    part_number.analyzer = analyzers::VERBATIM;
+    part_number.infix = true;
+
+    field emails("emails", field_types::STRING_ARRAY, false);
+    emails.infix = true;
+
+    std::vector<field> fields = {field("title", field_types::STRING, false), part_number, emails,
+                                 field("points", field_types::INT32, false)};
+    std::vector<sort_by> sort_fields = { sort_by("points", "DESC") };
+
+    Collection* coll_infix = collectionManager.create_collection("coll_infix", fields, "points").get();
+
+    ASSERT_TRUE(coll_infix->add("{\"id\": \"0\", \"title\": \"Gear\", \"part_number\": \"XR-20931-B\", "
+                                "\"emails\": [\"sales@acme.com\"], \"points\": 3}").ok());
+    ASSERT_TRUE(coll_infix->add("{\"id\": \"1\", \"title\": \"Bolt\", \"part_number\": \"ZT-20931\", "
+                                "\"emails\": [\"ops@globex.com\", \"jane.acme@gmail.com\"], \"points\": 2}").ok());
+    ASSERT_TRUE(coll_infix->add("{\"id\": \"2\", \"title\": \"Nut\", \"part_number\": \"ZT-88000\", "
+                                "\"emails\": [\"info@initech.com\"], \"points\": 1}").ok());
+
+    // without infix, only prefixes match
+    nlohmann::json results = coll_infix->search("20931", {"part_number"}, "", {}, sort_fields, 0, 10, 1,
+                                                FREQUENCY, true).get();
+    ASSERT_EQ(0, results["hits"].size());
+
+    results = coll_infix->search("20931", {"part_number"}, "", {}, sort_fields, 0, 10, 1, FREQUENCY, true,
+                                 false, 100, 0, "", true).get();
+    ASSERT_EQ(2, results["hits"].size());
+    ASSERT_EQ("0", results["hits"][0]["document"]["id"]);
+    ASSERT_EQ("1", results["hits"][1]["document"]["id"]);
+    ASSERT_EQ("<mark>XR-20931-B</mark>", results["hits"][0]["highlight"]["part_number"]);
+
+    results = coll_infix->search("acme", {"emails"}, "", {}, sort_fields, 0, 10, 1, FREQUENCY, false,
+                                 false, 100, 0, "", true).get();
+    ASSERT_EQ(2, results["hits"].size());
+
+    // removed documents are not matched, although their tokens stay in the infix index
+    ASSERT_TRUE(coll_infix->remove("0").ok());
+    results = coll_infix->search("acme", {"emails"}, "", {}, sort_fields, 0, 10, 1, FREQUENCY, false,
+                                 false, 100, 0, "", true).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ("1", results["hits"][0]["document"]["id"]);
+
+    // fields without an infix index are searched as usual
+    results = coll_infix->search("ear", {"title"}, "", {}, sort_fields, 0, 10, 1, FREQUENCY, false,
+                                 false, 100, 0, "", true).get();
+    ASSERT_EQ(0, results["hits"].size());
+
+    field facet_field("tags", field_types::STRING_ARRAY, true);
+    facet_field.infix = true;
+    ASSERT_EQ(400, collectionManager.create_collection("coll_bad_infix", {facet_field,
+              field("points", field_types::INT32, false)}, "points").code());
+
+    collectionManager.drop_collection("coll_infix");
+}
+
+// reads the little-endian fields of a binary search response, in order
+struct binary_reader {
+    const std::string & data;
+    size_t pos;
+
+    uint64_t uint(const size_t num_bytes) {
+        uint64_t value = 0;
+        for(size_t i = 0; i < num_bytes; i++) {
+            value |= (uint64_t) (uint8_t) data[pos++] << (8 * i);
+        }
+        return value;
+    }
+
+    std::string str() {
+        const size_t len = uint(4);
+        pos += len;
+        return data.substr(pos - len, len);
+    }
+};
+
+TEST_F(CollectionTest, BinarySearchResults) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("tags", field_types::STRING_ARRAY, true),
+                                 field("points", field_types::INT32, true)};
+    std::vector<sort_by> sort_fields = { sort_by("points", "DESC") };
+
+    Collection* coll_binary = collectionManager.create_collection("coll_binary", fields, "points").get();
+
+    ASSERT_TRUE(coll_binary->add("{\"id\": \"0\", \"title\": \"The quick brown fox\", \"tags\": [\"animal\"], "
+                                 "\"points\": 7}").ok());
+    ASSERT_TRUE(coll_binary->add("{\"id\": \"1\", \"title\": \"A brown dog\", \"tags\": [\"animal\", \"pet\"], "
+                                 "\"points\": 12}").ok());
+
+    Option<search_results> results_op = coll_binary->run_search("brown", {"title"}, "", {"tags", "points(0:10)"},
+                                                                sort_fields, 0, 10, 1, FREQUENCY, false);
+    ASSERT_TRUE(results_op.ok());
+
+    const std::string binary = results_op.get().to_binary(3, 1);
+    binary_reader reader{binary, 0};
+
+    ASSERT_EQ("TSR1", binary.substr(0, 4));
+    reader.pos = 4;
+    ASSERT_EQ(binary.size() - 8, reader.uint(4));
+    ASSERT_EQ(2, reader.uint(8));
+    ASSERT_EQ(3, reader.uint(8));
+    ASSERT_EQ(1, reader.uint(4));
+
+    // hits are the documents as they were stored, in the order of the JSON response
+    nlohmann::json results = coll_binary->search("brown", {"title"}, "", {"tags", "points(0:10)"},
+                                                 sort_fields, 0, 10, 1, FREQUENCY, false).get();
+    ASSERT_EQ(2, reader.uint(4));
+    for(size_t i = 0; i < 2; i++) {
+        ASSERT_EQ(results["hits"][i]["document"], nlohmann::json::parse(reader.str()));
+        ASSERT_EQ("title", reader.str());
+        ASSERT_EQ(results["hits"][i]["highlight"]["title"], reader.str());
+    }
+
+    ASSERT_EQ(2, reader.uint(4));
+
+    ASSERT_EQ("tags", reader.str());
+    ASSERT_EQ(0, reader.uint(1));
+    ASSERT_EQ(2, reader.uint(4));
+    ASSERT_EQ("animal", reader.str());
+    ASSERT_EQ("pet", reader.str());
+    ASSERT_EQ(2, reader.uint(8));
+    ASSERT_EQ(1, reader.uint(8));
+
+    ASSERT_EQ("points", reader.str());
+    ASSERT_EQ(1, reader.uint(1));
+    ASSERT_EQ(1, reader.uint(4));
+    ASSERT_EQ("0:10", reader.str());
+    ASSERT_EQ(1, reader.uint(8));
+    ASSERT_EQ(2, reader.uint(8));   // stats: count, then min, max and sum as doubles
+    reader.pos += 3 * sizeof(double);
+
+    ASSERT_EQ(0, reader.uint(4));
+    ASSERT_EQ(binary.size(), reader.pos);
+
+    collectionManager.drop_collection("coll_binary");
+}
+
+TEST_F(CollectionTest, UnindexedFieldsAreStoredApart) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("description", field_types::STRING, false),
+                                 field("points", field_types::INT32, false)};
+    fields[1].index = false;
+
+    // an unindexed field can't be a facet or the default sorting field
+    std::vector<field> bad_fields = fields;
+    bad_fields[1].facet = true;
+    ASSERT_EQ(400, collectionManager.create_collection("coll_unindexed", bad_fields, "points").code());
+
+    bad_fields = fields;
+    bad_fields[2].index = false;
+    ASSERT_EQ(400, collectionManager.create_collection("coll_unindexed", bad_fields, "points").code());
+
+    Collection* coll_unindexed = collectionManager.create_collection("coll_unindexed", fields, "points").get();
+
+    const std::string description = std::string(2000, 'x') + " with \"quotes\"";
+    nlohmann::json doc;
+    doc["id"] = "0";
+    doc["title"] = "The quick brown fox";
+    doc["description"] = description;
+    doc["points"] = 10;
+
+    nlohmann::json added = coll_unindexed->add(doc.dump()).get();
+    ASSERT_EQ(description, added["description"]);
+
+    // a document without a value for the unindexed field
+    ASSERT_TRUE(coll_unindexed->add("{\"id\": \"1\", \"title\": \"The lazy dog\", \"points\": 20}").ok());
+
+    // an unindexed value must still be of the field's type
+    Option<nlohmann::json> bad_add_op = coll_unindexed->add("{\"id\": \"9\", \"title\": \"A cat\", "
+                                                            "\"description\": 42, \"points\": 5}");
+    ASSERT_FALSE(bad_add_op.ok());
+    ASSERT_EQ(400, bad_add_op.code());
+    ASSERT_EQ("Field `description` must be a string.", bad_add_op.error());
+    ASSERT_FALSE(coll_unindexed->get("9").ok());
+
+    // the stored document holds only the indexed fields
+    std::string stored_document;
+    const std::string seq_id_key = std::to_string(coll_unindexed->get_collection_id()) + "_" +
+                                   Collection::SEQ_ID_PREFIX + "_" + StringUtils::serialize_uint32_t(0);
+    ASSERT_EQ(StoreStatus::FOUND, store->get(seq_id_key, stored_document));
+    ASSERT_EQ(0, nlohmann::json::parse(stored_document).count("description"));
+
+    nlohmann::json results = coll_unindexed->search("fox", {"title"}, "", {}, sort_fields, 0).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ(doc, results["hits"][0]["document"]);
+
+    results = coll_unindexed->search("*", {"title"}, "", {}, sort_fields, 0, 10, 1, FREQUENCY, false, false, 100, 0,
+                                     "", false, false, false).get();
+    ASSERT_EQ(2, results["hits"].size());
+    ASSERT_EQ(0, results["hits"][1]["document"].count("description"));
+
+    ASSERT_EQ(doc, coll_unindexed->get("0").get());
+    ASSERT_EQ(0, coll_unindexed->get("1").get().count("description"));
+
+    // not searchable
+    ASSERT_EQ(404, coll_unindexed->search("xxx", {"description"}, "", {}, sort_fields, 0).code());
+    ASSERT_EQ(404, coll_unindexed->search("*", {"title"}, "description: xxx", {}, sort_fields, 0).code());
+
+    // added unindexed fields need no backfill
+    field author("author", field_types::STRING, false);
+    author.index = false;
+    ASSERT_TRUE(collectionManager.alter_collection("coll_unindexed", {author}, {}).ok());
+    ASSERT_FALSE(coll_unindexed->is_backfilling());
+    ASSERT_TRUE(coll_unindexed->add("{\"id\": \"2\", \"title\": \"A fox\", \"points\": 30, \"author\": \"Jane\"}").ok());
+    ASSERT_EQ("Jane", coll_unindexed->get("2").get()["author"]);
+
+    // the unindexed values are removed along with the document
+    ASSERT_TRUE(coll_unindexed->remove("0").ok());
+    ASSERT_TRUE(coll_unindexed->remove("2").ok());
+
+    rocksdb::Iterator* it = store->get_iterator();
+    const std::string unindexed_prefix = std::to_string(coll_unindexed->get_collection_id()) + "_" +
+                                         Collection::UNINDEXED_PREFIX;
+    size_t num_unindexed_keys = 0;
+    for(it->SeekToFirst(); it->Valid(); it->Next()) {
+        num_unindexed_keys += it->key().starts_with(unindexed_prefix);
+    }
+    delete it;
+    ASSERT_EQ(0, num_unindexed_keys);
+
+    collectionManager.drop_collection("coll_unindexed");
+}
+
+TEST_F(CollectionTest, ColdPostingsAreSpilledAndLoadedBack) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("tags", field_types::STRING_ARRAY, true),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll_cold = collectionManager.create_collection("coll_cold", fields, "points").get();
+
+    for(size_t i = 0; i < 200; i++) {
+        nlohmann::json doc;
+        doc["id"] = std::to_string(i);
+        doc["title"] = "title " + std::to_string(i) + (i % 2 == 0 ? " even" : " odd");
+        doc["tags"] = {"tag" + std::to_string(i % 5)};
+        doc["points"] = (int32_t) i;
+        ASSERT_TRUE(coll_cold->add(doc.dump()).ok());
+    }
+
+    const std::string results_before = coll_cold->search("even", {"title"}, "tags: tag2 && points: >= 0", {"tags"},
+                                                         sort_fields, 0, 50).get()["hits"].dump();
+
+    // every field of every shard is cold right away
+    ASSERT_GT(coll_cold->spill_cold_postings(0), 0);
+    const size_t num_spilled_leaves = coll_cold->get_num_spilled_leaves();
+    ASSERT_GT(num_spilled_leaves, 0);
+
+    const std::string postings_prefix = std::to_string(coll_cold->get_collection_id()) + "_";
+    auto num_postings_keys = [&]() {
+        rocksdb::Iterator* it = store->scan_postings(postings_prefix);
+        size_t num_keys = 0;
+        for(; it->Valid() && it->key().starts_with(postings_prefix); it->Next()) {
+            num_keys++;
+        }
+        delete it;
+        return num_keys;
+    };
+
+    ASSERT_EQ(num_spilled_leaves, num_postings_keys());
+
+    // nothing is left to spill
+    ASSERT_EQ(0, coll_cold->spill_cold_postings(0));
+
+    // only the leaves that a search needs are paged back in, with the same results, and the store keeps them
+    ASSERT_EQ(results_before, coll_cold->search("even", {"title"}, "tags: tag2 && points: >= 0", {"tags"},
+                                                sort_fields, 0, 50).get()["hits"].dump());
+    const size_t num_searched_leaves = num_spilled_leaves - coll_cold->get_num_spilled_leaves();
+    ASSERT_GT(num_searched_leaves, 0);
+    ASSERT_LT(num_searched_leaves, num_spilled_leaves / 2);
+    ASSERT_EQ(num_spilled_leaves, num_postings_keys());
+
+    // searched just now, so not cold
+    ASSERT_EQ(0, coll_cold->spill_cold_postings(60 * 1000));
+
+    // a write pages in only the leaves of its document
+    coll_cold->spill_cold_postings(0);
+    ASSERT_EQ(num_spilled_leaves, coll_cold->get_num_spilled_leaves());
+
+    ASSERT_TRUE(coll_cold->remove("2").ok());
+    ASSERT_TRUE(coll_cold->add("{\"id\": \"500\", \"title\": \"another even\", \"tags\": [\"tag2\"], "
+                               "\"points\": 500}").ok());
+    ASSERT_LT(coll_cold->get_num_spilled_leaves(), num_spilled_leaves);
+    ASSERT_GT(coll_cold->get_num_spilled_leaves(), num_spilled_leaves - 10);
+
+    nlohmann::json results = coll_cold->search("even", {"title"}, "tags: tag2 && points: >= 0", {"tags"},
+                                               sort_fields, 0, 50).get();
+    ASSERT_EQ(20, results["found"].get<size_t>());
+    ASSERT_EQ("500", results["hits"][0]["document"]["id"]);
+
+    // nothing is left behind for a spilled field that is dropped
+    coll_cold->spill_cold_postings(0);
+    ASSERT_TRUE(collectionManager.alter_collection("coll_cold", {}, {"title"}).ok());
+
+    results = coll_cold->search("*", {}, "tags: tag2 && points: >= 0", {}, sort_fields, 0, 50).get();
+    ASSERT_EQ(40, results["found"].get<size_t>());
+
+    coll_cold->spill_cold_postings(0);
+    ASSERT_LT(coll_cold->get_num_spilled_leaves(), num_spilled_leaves);
+    ASSERT_EQ(coll_cold->get_num_spilled_leaves(), num_postings_keys());
+
+    collectionManager.drop_collection("coll_cold");
+}
+
+TEST_F(CollectionTest, ImportDocumentsInChunks) {
+    std::vector<field> fields = {field("title", field_types::STRING, false),
+                                 field("points", field_types::INT32, false)};
+
+    Collection* coll_import = collectionManager.create_collection("coll_import", fields, "points").get();
+
+    std::string body;
+    for(size_t i = 0; i < 50; i++) {
+        body += "{\"id\": \"" + std::to_string(i) + "\", \"title\": \"Title " + std::to_string(i) + "\", "
+                "\"points\": " + std::to_string(i) + "}" + (i % 10 == 0 ? "\r\n" : "\n");
+    }
+
+    // a blank line, a document that is not JSON, one that is missing a field, and a last line without a newline
+    body += "\n{\"id\": \"50\", \"title\"\n{\"id\": \"51\", \"title\": \"No points\"}\n";
+    body += "{\"id\": \"52\", \"title\": \"Last line\", \"points\": 52}";
+
+    // chunks that end anywhere, in the middle of a line or right after its newline
+    import_state state;
+    for(size_t offset = 0; offset < body.size(); offset += 7) {
+        const bool last_chunk = (offset + 7 >= body.size());
+        coll_import->import_documents(body.substr(offset, 7), last_chunk, state);
+    }
+
+    ASSERT_EQ(54, state.num_lines);
+    ASSERT_EQ(51, state.num_imported);
+    ASSERT_EQ(2, state.num_failed);
+    ASSERT_EQ(2, state.errors.size());
+    ASSERT_EQ(52, state.errors[0].first);
+    ASSERT_EQ("Bad JSON.", state.errors[0].second);
+    ASSERT_EQ(53, state.errors[1].first);
+    ASSERT_TRUE(state.partial_line.empty());
+
+    ASSERT_EQ(51, coll_import->get_num_documents());
+    ASSERT_EQ("Title 10", coll_import->get("10").get()["title"]);
+
+    nlohmann::json results = coll_import->search("last", {"title"}, "", {}, sort_fields, 0).get();
+    ASSERT_EQ(1, results["hits"].size());
+    ASSERT_EQ("52", results["hits"][0]["document"]["id"]);
+
+    collectionManager.drop_collection("coll_import");
+}
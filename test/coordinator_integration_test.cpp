@@ -0,0 +1,252 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <json.hpp>
+#include "coordinator.h"
+#include "http_client.h"
+#include "string_utils.h"
+
+/*
+ * Starts typesense-server processes on localhost: several nodes, a coordinator of those nodes, and a single server
+ * that holds the whole collection. Searches through the coordinator must give what the whole collection gives.
+ */
+class CoordinatorIntegrationTest : public ::testing::Test {
+protected:
+    const std::string state_dir_path = "/tmp/typesense_test/coordinator_integration";
+    const std::string api_key = "auth_key";
+
+    const std::vector<uint32_t> node_ports = {18108, 18109, 18110};
+    const uint32_t coordinator_port = 18111;
+    const uint32_t whole_port = 18112;
+
+    std::vector<pid_t> pids;
+
+    static std::string base_url(const uint32_t port) {
+        return "http://127.0.0.1:" + std::to_string(port);
+    }
+
+    pid_t start_server(const std::string & name, const uint32_t port, const std::vector<std::string> & extra_args) {
+        const std::string data_dir = state_dir_path + "/" + name;
+        system(("mkdir -p " + data_dir).c_str());
+
+        std::vector<std::string> args = {TYPESENSE_SERVER_PATH, "--data-dir", data_dir, "--api-key", api_key,
+                                         "--listen-address", "127.0.0.1", "--listen-port", std::to_string(port),
+                                         "--log-dir", data_dir};
+        args.insert(args.end(), extra_args.begin(), extra_args.end());
+
+        pid_t pid = fork();
+        if(pid == 0) {
+            std::vector<char*> argv;
+            for(std::string & arg: args) {
+                argv.push_back(&arg[0]);
+            }
+
+            argv.push_back(nullptr);
+            execv(argv[0], argv.data());
+            _exit(127);
+        }
+
+        return pid;
+    }
+
+    long request(const uint32_t port, const std::string & method, const std::string & path,
+                 const std::string & body, std::string & response) {
+        HttpClient client(base_url(port) + path, api_key);
+
+        if(method == "POST") {
+            return client.post_response(body, response);
+        }
+
+        return client.get_reponse(response);
+    }
+
+    nlohmann::json get_json(const uint32_t port, const std::string & path) {
+        std::string response;
+        EXPECT_EQ(200, request(port, "GET", path, "", response)) << path << ": " << response;
+        return nlohmann::json::parse(response);
+    }
+
+    bool wait_until_ready(const uint32_t port) {
+        for(size_t attempt = 0; attempt < 100; attempt++) {
+            std::string response;
+            if(request(port, "GET", "/collections", "", response) == 200) {
+                return true;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        return false;
+    }
+
+    // the same documents, added through the coordinator and to the whole collection
+    void add_document(const nlohmann::json & document) {
+        std::string response;
+        const std::string path = "/collections/products/documents";
+        ASSERT_EQ(201, request(coordinator_port, "POST", path, document.dump(), response)) << response;
+        ASSERT_EQ(201, request(whole_port, "POST", path, document.dump(), response)) << response;
+    }
+
+    std::string search_path(const std::map<std::string, std::string> & params) {
+        std::string path = "/collections/products/documents/search?";
+        for(const auto & param: params) {
+            path += StringUtils::url_encode(param.first) + "=" + StringUtils::url_encode(param.second) + "&";
+        }
+
+        return path;
+    }
+
+    virtual void SetUp() {
+        system(("rm -rf " + state_dir_path + " && mkdir -p " + state_dir_path).c_str());
+
+        std::vector<std::string> nodes;
+        for(size_t node = 0; node < node_ports.size(); node++) {
+            pids.push_back(start_server("node_" + std::to_string(node), node_ports[node], {}));
+            nodes.push_back(base_url(node_ports[node]));
+        }
+
+        std::string nodes_arg;
+        for(const std::string & node: nodes) {
+            nodes_arg += (nodes_arg.empty() ? "" : ",") + node;
+        }
+
+        pids.push_back(start_server("coordinator", coordinator_port, {"--nodes", nodes_arg}));
+        pids.push_back(start_server("whole", whole_port, {}));
+
+        // the owners of the documents are checked from here, and the nodes are asked directly
+        Coordinator::get_instance().init(nodes, api_key);
+
+        for(const uint32_t port: {node_ports[0], node_ports[1], node_ports[2], coordinator_port, whole_port}) {
+            ASSERT_TRUE(wait_until_ready(port)) << "Server on port " << port << " did not start.";
+        }
+
+        nlohmann::json schema = {
+            {"name", "products"},
+            {"fields", {
+                {{"name", "title"}, {"type", "string"}},
+                {{"name", "tags"}, {"type", "string[]"}, {"facet", true}},
+                {{"name", "points"}, {"type", "int32"}, {"facet", true}}
+            }},
+            {"default_sorting_field", "points"}
+        };
+
+        std::string response;
+        ASSERT_EQ(201, request(coordinator_port, "POST", "/collections", schema.dump(), response)) << response;
+        ASSERT_EQ(201, request(whole_port, "POST", "/collections", schema.dump(), response)) << response;
+
+        std::ifstream infile(std::string(ROOT_DIR)+"test/documents.jsonl");
+        std::string json_line;
+        size_t line = 0;
+
+        while (std::getline(infile, json_line)) {
+            nlohmann::json document = nlohmann::json::parse(json_line);
+            document["id"] = "doc-" + std::to_string(line);
+            document["tags"] = {"tag-" + std::to_string(line % 4), "tag-" + std::to_string(line % 7)};
+            add_document(document);
+            line++;
+        }
+    }
+
+    virtual void TearDown() {
+        for(const pid_t pid: pids) {
+            kill(pid, SIGTERM);
+        }
+
+        for(const pid_t pid: pids) {
+            waitpid(pid, nullptr, 0);
+        }
+
+        pids.clear();
+    }
+};
+
+TEST_F(CoordinatorIntegrationTest, DocumentsArePartitionedAcrossTheNodes) {
+    const size_t num_documents = get_json(whole_port, "/collections/products")["num_documents"].get<size_t>();
+    ASSERT_EQ(num_documents, get_json(coordinator_port, "/collections/products")["num_documents"].get<size_t>());
+
+    // every node has the collection, and only the documents that it owns
+    std::vector<node_response> responses = Coordinator::get_instance().broadcast("GET", "/collections/products");
+    ASSERT_EQ(node_ports.size(), responses.size());
+
+    size_t num_node_documents = 0;
+    for(const node_response & response: responses) {
+        ASSERT_EQ(200, response.status_code);
+        const size_t node_documents = nlohmann::json::parse(response.body)["num_documents"].get<size_t>();
+        ASSERT_LT(node_documents, num_documents);
+        num_node_documents += node_documents;
+    }
+
+    ASSERT_EQ(num_documents, num_node_documents);
+
+    const size_t owner = Coordinator::get_instance().get_owner("doc-3");
+    ASSERT_EQ(200, Coordinator::get_instance().send(owner, "GET", "/collections/products/documents/doc-3").status_code);
+    ASSERT_EQ("doc-3", get_json(coordinator_port, "/collections/products/documents/doc-3")["id"]);
+}
+
+TEST_F(CoordinatorIntegrationTest, SearchesThroughTheCoordinatorMatchTheWholeCollection) {
+    for(const std::string & query: std::vector<std::string>({"the", "*", "rocket"})) {
+        for(const std::string & page: std::vector<std::string>({"1", "2", "3"})) {
+            // the filter has characters that must be encoded again when the search is forwarded to the nodes
+            const std::string path = search_path({{"q", query}, {"query_by", "title"},
+                                                  {"filter_by", "points:>2 && points:<14"},
+                                                  {"facet_by", "tags,points(0:5,5:20)"}, {"sort_by", "points:DESC"},
+                                                  {"per_page", "4"}, {"page", page}});
+
+            nlohmann::json expected = get_json(whole_port, path);
+            nlohmann::json merged = get_json(coordinator_port, path);
+
+            ASSERT_EQ(expected["found"], merged["found"]) << query;
+            ASSERT_EQ(expected["hits"].size(), merged["hits"].size()) << query << ", page " << page;
+
+            for(size_t i = 0; i < expected["hits"].size(); i++) {
+                ASSERT_EQ(expected["hits"][i]["document"]["points"], merged["hits"][i]["document"]["points"]);
+            }
+
+            if(expected.count("facet_counts") != 0) {
+                ASSERT_EQ(expected["facet_counts"][1], merged["facet_counts"][1]) << query;
+            }
+        }
+    }
+
+    // the callback wraps the merged results, and is not forwarded to the nodes
+    std::string response;
+    ASSERT_EQ(200, request(coordinator_port, "GET", search_path({{"q", "*"}, {"query_by", "title"},
+                                                                 {"callback", "cb"}}), "", response));
+    ASSERT_EQ(0, response.find("cb({"));
+}
+
+TEST_F(CoordinatorIntegrationTest, AutoFacetRangesAreResolvedAcrossTheNodes) {
+    // the largest value is on one node only, so each node has bounds of its own
+    add_document({{"id", "doc-outlier"}, {"title", "an outlier"}, {"tags", {"tag-0"}}, {"points", 1000}});
+
+    const std::map<std::string, std::string> params = {{"q", "*"}, {"query_by", "title"},
+                                                       {"facet_by", "tags,points"}};
+
+    std::vector<node_response> responses = Coordinator::get_instance().broadcast(
+            "GET", search_path({{"q", "*"}, {"query_by", "title"}, {"facet_by", "tags,points"},
+                                {"mergeable", "true"}}));
+
+    std::set<std::string> node_bounds;
+    for(const node_response & response: responses) {
+        ASSERT_EQ(200, response.status_code);
+        node_bounds.insert(nlohmann::json::parse(response.body)["facet_counts"][1]["auto_bounds"].dump());
+    }
+
+    ASSERT_GT(node_bounds.size(), 1);
+
+    // the coordinator searches the nodes again with the bounds of all the nodes
+    nlohmann::json expected = get_json(whole_port, search_path(params));
+    nlohmann::json merged = get_json(coordinator_port, search_path(params));
+
+    ASSERT_EQ(expected["found"], merged["found"]);
+    ASSERT_EQ(expected["facet_counts"][1], merged["facet_counts"][1]);
+    ASSERT_EQ(1000, merged["facet_counts"][1]["stats"]["max"].get<size_t>());
+}
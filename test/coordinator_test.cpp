@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <fstream>
+#include <collection_manager.h>
+#include "collection.h"
+#include "coordinator.h"
+
+class CoordinatorTest : public ::testing::Test {
+protected:
+    Store *store;
+    CollectionManager & collectionManager = CollectionManager::get_instance();
+    std::vector<sort_by> sort_fields = { sort_by("points", "DESC") };
+
+    // the whole collection, and its partitions: each partition stands in for the collection of a node
+    Collection* whole;
+    std::vector<Collection*> partitions;
+
+    virtual void SetUp() {
+        std::string state_dir_path = "/tmp/typesense_test/coordinator";
+        system(("rm -rf "+state_dir_path+" && mkdir -p "+state_dir_path).c_str());
+
+        store = new Store(state_dir_path);
+        collectionManager.init(store, "auth_key", "search_auth_key");
+
+        Coordinator & coordinator = Coordinator::get_instance();
+        coordinator.init({"http://localhost:8108", "http://localhost:8109", "http://localhost:8110"}, "auth_key");
+
+        std::vector<field> fields = {
+            field("title", field_types::STRING, false),
+            field("tags", field_types::STRING_ARRAY, true),
+            field("points", field_types::INT32, true)
+        };
+
+        whole = collectionManager.create_collection("whole", fields, "points").get();
+        for(size_t node = 0; node < coordinator.get_num_nodes(); node++) {
+            partitions.push_back(collectionManager.create_collection("node_" + std::to_string(node),
+                                                                     fields, "points").get());
+        }
+
+        std::ifstream infile(std::string(ROOT_DIR)+"test/documents.jsonl");
+        std::string json_line;
+        size_t line = 0;
+
+        while (std::getline(infile, json_line)) {
+            nlohmann::json document = nlohmann::json::parse(json_line);
+            document["id"] = "doc-" + std::to_string(line);
+            document["tags"] = {"tag-" + std::to_string(line % 4), "tag-" + std::to_string(line % 7)};
+
+            ASSERT_TRUE(whole->add(document.dump()).ok());
+            ASSERT_TRUE(partitions[coordinator.get_owner(document["id"])]->add(document.dump()).ok());
+            line++;
+        }
+    }
+
+    virtual void TearDown() {
+        collectionManager.drop_collection("whole");
+        for(Collection* partition: partitions) {
+            collectionManager.drop_collection(partition->get_name());
+        }
+
+        delete store;
+    }
+
+    std::vector<nlohmann::json> search_nodes(const std::string & query, const std::vector<std::string> & facet_fields,
+                                             const size_t per_page, const size_t page) {
+        std::vector<nlohmann::json> node_results;
+        for(Collection* partition: partitions) {
+            node_results.push_back(partition->search(query, {"title"}, "", facet_fields, sort_fields, 0,
+                                                     page * per_page, 1, FREQUENCY, false, false, 100, 0, "",
+                                                     false, true).get());
+        }
+
+        return node_results;
+    }
+
+    nlohmann::json search_partitions(const std::string & query, const std::vector<std::string> & facet_fields,
+                                     const size_t per_page, const size_t page) {
+        std::vector<nlohmann::json> node_results = search_nodes(query, facet_fields, per_page, page);
+        return Coordinator::merge_search_results(node_results, per_page, page);
+    }
+};
+
+TEST_F(CoordinatorTest, OwnersAreStableAndSpread) {
+    Coordinator & coordinator = Coordinator::get_instance();
+    ASSERT_EQ(coordinator.get_owner("doc-7"), coordinator.get_owner("doc-7"));
+
+    for(Collection* partition: partitions) {
+        ASSERT_GT(partition->get_num_documents(), 0);
+    }
+
+    ASSERT_EQ(whole->get_num_documents(), partitions[0]->get_num_documents() +
+                                          partitions[1]->get_num_documents() +
+                                          partitions[2]->get_num_documents());
+}
+
+TEST_F(CoordinatorTest, MergedResultsMatchTheWholeCollection) {
+    for(const std::string & query: {"the", "*", "rocket", "missing"}) {
+        for(size_t page: {1, 2, 3}) {
+            nlohmann::json expected = whole->search(query, {"title"}, "", {"tags", "points(0:10,10:20)"},
+                                                    sort_fields, 0, 4, page, FREQUENCY, false).get();
+            nlohmann::json merged = search_partitions(query, {"tags", "points(0:10,10:20)"}, 4, page);
+
+            ASSERT_EQ(expected["found"], merged["found"]) << query;
+            ASSERT_EQ(expected["hits"].size(), merged["hits"].size()) << query << ", page " << page;
+
+            for(size_t i = 0; i < expected["hits"].size(); i++) {
+                ASSERT_EQ(expected["hits"][i]["document"]["points"], merged["hits"][i]["document"]["points"]);
+                ASSERT_EQ(0, merged["hits"][i].count("sort_keys"));
+            }
+
+            // a page past the last hit comes without facet counts from a collection, but not from a coordinator
+            if(expected.count("facet_counts") == 0) {
+                continue;
+            }
+
+            ASSERT_EQ(expected["facet_counts"][1], merged["facet_counts"][1]) << query;
+
+            // the same top values, although values of the same count can come in a different order
+            std::map<std::string, size_t> expected_counts, merged_counts;
+            for(const nlohmann::json & value_count: expected["facet_counts"][0]["counts"]) {
+                expected_counts[value_count["value"]] = value_count["count"];
+            }
+
+            for(const nlohmann::json & value_count: merged["facet_counts"][0]["counts"]) {
+                merged_counts[value_count["value"]] = value_count["count"];
+            }
+
+            ASSERT_EQ(expected_counts, merged_counts) << query;
+        }
+    }
+}
+
+TEST_F(CoordinatorTest, AutoFacetRangesAreSpreadOverTheBoundsOfAllNodes) {
+    // the largest value is on one node only, so each node has bounds of its own
+    nlohmann::json outlier = {{"id", "doc-outlier"}, {"title", "an outlier"}, {"tags", {"tag-0"}}, {"points", 1000}};
+    ASSERT_TRUE(whole->add(outlier.dump()).ok());
+    ASSERT_TRUE(partitions[Coordinator::get_instance().get_owner("doc-outlier")]->add(outlier.dump()).ok());
+
+    std::vector<std::string> facet_fields = {"tags", "points"};
+    std::vector<nlohmann::json> node_results = search_nodes("*", facet_fields, 10, 1);
+
+    std::set<std::string> node_bounds;
+    for(const nlohmann::json & node_result: node_results) {
+        node_bounds.insert(node_result["facet_counts"][1]["auto_bounds"].dump());
+    }
+
+    ASSERT_GT(node_bounds.size(), 1);
+
+    // searched again with the bounds of all the nodes, which every node then spreads the ranges over
+    ASSERT_TRUE(Coordinator::resolve_auto_facet_ranges(node_results, facet_fields));
+    ASSERT_EQ("tags", facet_fields[0]);
+    ASSERT_EQ(0, facet_fields[1].find("points(auto "));
+
+    node_results = search_nodes("*", facet_fields, 10, 1);
+    ASSERT_FALSE(Coordinator::resolve_auto_facet_ranges(node_results, facet_fields));
+
+    nlohmann::json expected = whole->search("*", {"title"}, "", {"tags", "points"}, sort_fields, 0, 10).get();
+    nlohmann::json merged = Coordinator::merge_search_results(node_results, 10, 1);
+
+    ASSERT_EQ(expected["found"], merged["found"]);
+    ASSERT_EQ(expected["facet_counts"][1], merged["facet_counts"][1]);
+    ASSERT_EQ(1000, merged["facet_counts"][1]["stats"]["max"].get<size_t>());
+
+    // a malformed auto range is rejected
+    ASSERT_FALSE(whole->search("*", {"title"}, "", {"points(auto 10)"}, sort_fields, 0, 10).ok());
+    ASSERT_FALSE(whole->search("*", {"title"}, "", {"points(auto 10:5)"}, sort_fields, 0, 10).ok());
+}
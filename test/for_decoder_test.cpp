@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <for.h>
+#include <vector>
+#include <random>
+#include "for_decoder.h"
+#include "sorted_array.h"
+#include "array_utils.h"
+
+static std::vector<ForDecoder::unpack_fn> supported_unpackers() {
+    std::vector<ForDecoder::unpack_fn> unpackers = {&ForDecoder::unpack_scalar};
+
+    if(ForDecoder::has_sse4()) {
+        unpackers.push_back(&ForDecoder::unpack_sse4);
+    }
+
+    if(ForDecoder::has_avx2()) {
+        unpackers.push_back(&ForDecoder::unpack_avx2);
+    }
+
+    return unpackers;
+}
+
+TEST(ForDecoderTest, UnpackMatchesLibforForAllBitWidths) {
+    std::mt19937 rng(42);
+    const std::vector<uint32_t> lengths = {1, 3, 4, 7, 8, 33, 128, 1001};
+
+    for(uint32_t bits = 0; bits <= 32; bits++) {
+        const uint64_t range = (bits == 32) ? 0xFFFFFFFFULL : ((1ULL << bits) - 1);
+
+        for(uint32_t length: lengths) {
+            std::vector<uint32_t> values(length);
+            const uint32_t base = (bits == 32) ? 0 : 1000;
+            for(uint32_t i = 0; i < length; i++) {
+                values[i] = base + (uint32_t) (rng() % (range + 1));
+            }
+
+            // forces the bit width to be exactly `bits`
+            values[length / 2] = (uint32_t) (base + range);
+            values[0] = base;
+
+            std::vector<uint8_t> compressed(ForDecoder::HEADER_LENGTH + length * sizeof(uint32_t) + 16, 0);
+            for_compress_unsorted(values.data(), compressed.data(), length);
+
+            std::vector<uint32_t> expected(length);
+            for_uncompress(compressed.data(), expected.data(), length);
+            ASSERT_EQ(values, expected);
+
+            std::vector<uint32_t> actual(length);
+            ForDecoder::uncompress(compressed.data(), length, actual.data());
+            ASSERT_EQ(expected, actual) << "bits: " << bits << ", length: " << length;
+
+            const uint8_t* payload = compressed.data() + ForDecoder::HEADER_LENGTH;
+            const uint32_t payload_len = (uint32_t) (((uint64_t) length * compressed[4] + 7) / 8);
+
+            for(ForDecoder::unpack_fn unpack: supported_unpackers()) {
+                // unaligned starting offsets exercise the other shuffle patterns and the scalar tails
+                for(uint32_t start = 0; start < std::min(length, 10U); start++) {
+                    std::vector<uint32_t> out(length - start);
+                    unpack(payload, payload_len, base, compressed[4], start, length - start, out.data());
+                    ASSERT_TRUE(std::equal(out.begin(), out.end(), expected.begin() + start))
+                                << "bits: " << bits << ", length: " << length << ", start: " << start;
+                }
+            }
+        }
+    }
+}
+
+TEST(ForDecoderTest, IntersectMatchesScalarIntersection) {
+    std::mt19937 rng(7);
+
+    for(uint32_t gap: {1, 3, 100, 5000}) {
+        std::vector<uint32_t> postings;
+        uint32_t value = rng() % 10;
+        for(size_t i = 0; i < 2000; i++) {
+            postings.push_back(value);
+            value += 1 + (rng() % gap);
+        }
+
+        sorted_array arr;
+        arr.load(postings.data(), (uint32_t) postings.size());
+
+        for(uint32_t ids_gap: {1, 7, 500, 100000}) {
+            std::vector<uint32_t> ids;
+            uint32_t id = rng() % 20;
+            while(ids.size() < 300 && id <= value + 10) {
+                ids.push_back(id);
+                id += 1 + (rng() % ids_gap);
+            }
+
+            uint32_t* expected = nullptr;
+            size_t expected_len = ArrayUtils::and_scalar(postings.data(), postings.size(), ids.data(), ids.size(),
+                                                         &expected);
+
+            uint32_t* actual = nullptr;
+            size_t actual_len = arr.intersect(ids.data(), ids.size(), &actual);
+
+            ASSERT_EQ(expected_len, actual_len);
+            for(size_t i = 0; i < expected_len; i++) {
+                ASSERT_EQ(expected[i], actual[i]);
+            }
+
+            // sorted_array might have picked another codec, so check the FOR intersection directly as well
+            std::vector<uint8_t> compressed(ForDecoder::HEADER_LENGTH + postings.size() * sizeof(uint32_t) + 16);
+            for_compress_sorted(postings.data(), compressed.data(), (uint32_t) postings.size());
+            actual_len = ForDecoder::intersect(compressed.data(), (uint32_t) postings.size(), ids.data(), ids.size(),
+                                               actual);
+
+            ASSERT_EQ(expected_len, actual_len);
+            for(size_t i = 0; i < expected_len; i++) {
+                ASSERT_EQ(expected[i], actual[i]);
+            }
+
+            delete [] expected;
+            delete [] actual;
+        }
+    }
+
+    sorted_array empty;
+    uint32_t ids[] = {1, 2, 3};
+    uint32_t* out = nullptr;
+    ASSERT_EQ(0, empty.intersect(ids, 3, &out));
+    ASSERT_EQ(nullptr, out);
+}
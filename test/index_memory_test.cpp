@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <art.h>
+#include "index_memory.h"
+#include "sorted_array.h"
+
+// every test allocates and frees its index memory in between, so huge pages can be switched on and off
+class IndexMemoryTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        index_memory::use_huge_pages(true);
+    }
+
+    virtual void TearDown() {
+        index_memory::use_huge_pages(false);
+    }
+};
+
+TEST_F(IndexMemoryTest, FreedBlocksAreReusedBySize) {
+    void* a = index_memory::alloc(40);
+    void* b = index_memory::alloc(40);
+    ASSERT_NE(a, b);
+    ASSERT_EQ(0, (uintptr_t) a % 16);
+
+    index_memory::free(a, 40);
+
+    // the same size class
+    void* c = index_memory::alloc(48);
+    ASSERT_EQ(a, c);
+
+    // zeroed, even when the block is reused
+    memset(b, 0xFF, 40);
+    index_memory::free(b, 40);
+    char* d = (char*) index_memory::zalloc(33);
+    ASSERT_EQ(b, (void*) d);
+    for(size_t i = 0; i < 33; i++) {
+        ASSERT_EQ(0, d[i]);
+    }
+
+    index_memory::free(c, 48);
+    index_memory::free(d, 33);
+
+    ASSERT_GT(index_memory::get_stats().num_regions, 0);
+}
+
+TEST_F(IndexMemoryTest, ReallocKeepsContentsAcrossClasses) {
+    char* ptr = (char*) index_memory::alloc(10);
+    memcpy(ptr, "0123456789", 10);
+
+    // within a class, across classes, and beyond the largest class
+    const std::vector<size_t> sizes = {12, 600, 2000, 100000, 300000, 64};
+    size_t old_size = 10;
+
+    for(const size_t size: sizes) {
+        ptr = (char*) index_memory::realloc(ptr, old_size, size);
+        ASSERT_EQ(0, memcmp(ptr, "0123456789", 10));
+        old_size = size;
+    }
+
+    index_memory::free(ptr, old_size);
+}
+
+TEST_F(IndexMemoryTest, TreeAndPostingsOnHugePages) {
+    art_tree t;
+    art_tree_init(&t);
+
+    for(uint32_t i = 0; i < 5000; i++) {
+        const std::string key = "token" + std::to_string(i);
+        art_document document;
+        document.score = i;
+        document.id = i;
+        document.offsets = new uint32_t[1]{0};
+        document.offsets_len = 1;
+
+        art_insert(&t, (const unsigned char*) key.c_str(), key.size() + 1, &document, 1);
+        delete [] document.offsets;
+    }
+
+    ASSERT_EQ(5000, art_size(&t));
+
+    for(uint32_t i = 0; i < 5000; i += 2) {
+        const std::string key = "token" + std::to_string(i);
+        art_values* values = (art_values*) art_delete(&t, (const unsigned char*) key.c_str(), key.size() + 1);
+        ASSERT_EQ(i, values->ids.at(0));
+        delete values;
+    }
+
+    for(uint32_t i = 1; i < 5000; i += 2) {
+        const std::string key = "token" + std::to_string(i);
+        art_leaf* leaf = (art_leaf*) art_search(&t, (const unsigned char*) key.c_str(), key.size() + 1);
+        ASSERT_NE(nullptr, leaf);
+        ASSERT_EQ(i, leaf->values->ids.at(0));
+    }
+
+    art_tree_destroy(&t);
+
+    // a posting list that grows well beyond the largest size class
+    sorted_array ids;
+    for(uint32_t i = 0; i < 100000; i++) {
+        ids.append(i * 7);
+    }
+
+    ASSERT_EQ(100000, ids.getLength());
+    ASSERT_EQ(7 * 99999, ids.at(99999));
+}
+
+TEST_F(IndexMemoryTest, PressureFollowsAllocatedBytes) {
+    const size_t base_bytes = index_memory::get_stats().allocated_bytes;
+    index_memory::set_limits(base_bytes + 1000, base_bytes + 3000);
+
+    ASSERT_EQ(MEMORY_PRESSURE_NONE, index_memory::get_pressure());
+    ASSERT_FLOAT_EQ(0, index_memory::get_soft_pressure());
+
+    void* a = index_memory::alloc(1500);
+    ASSERT_EQ(MEMORY_PRESSURE_SOFT, index_memory::get_pressure());
+    ASSERT_FLOAT_EQ(0.25, index_memory::get_soft_pressure());
+
+    a = index_memory::realloc(a, 1500, 2500);
+    ASSERT_FLOAT_EQ(0.75, index_memory::get_soft_pressure());
+
+    // beyond the largest size class, from libc
+    void* b = index_memory::zalloc(100000);
+    ASSERT_EQ(MEMORY_PRESSURE_HARD, index_memory::get_pressure());
+    ASSERT_FLOAT_EQ(1, index_memory::get_soft_pressure());
+
+    index_memory::free(b, 100000);
+    ASSERT_EQ(MEMORY_PRESSURE_SOFT, index_memory::get_pressure());
+
+    index_memory::free(a, 2500);
+    ASSERT_EQ(MEMORY_PRESSURE_NONE, index_memory::get_pressure());
+    ASSERT_EQ(base_bytes, index_memory::get_stats().allocated_bytes);
+
+    index_memory::set_limits(0, 0);
+}
+
+TEST_F(IndexMemoryTest, PressureFollowsResidentMemoryWhenCounted) {
+    const size_t base_bytes = index_memory::get_stats().allocated_bytes;
+    index_memory::set_limits(base_bytes + 1000, base_bytes + 3000);
+    ASSERT_EQ(MEMORY_PRESSURE_NONE, index_memory::get_pressure());
+
+    // the process holds far more than the indices have allocated
+    index_memory::count_resident_memory(true);
+    ASSERT_EQ(MEMORY_PRESSURE_HARD, index_memory::get_pressure());
+    ASSERT_GT(index_memory::get_stats().resident_bytes, base_bytes + 3000);
+
+    index_memory::count_resident_memory(false);
+    ASSERT_EQ(MEMORY_PRESSURE_NONE, index_memory::get_pressure());
+
+    index_memory::set_limits(0, 0);
+}
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "infix_index.h"
+
+static std::vector<std::string> search(const infix_index & index, const std::string & infix) {
+    std::vector<std::string> tokens;
+    index.search(infix, tokens);
+    return tokens;
+}
+
+TEST(InfixIndexTest, FindsTokensContainingSubstring) {
+    infix_index index;
+
+    for(const std::string & token: {"ab12345x", "zz1234", "john.doe@example.com", "jane@example.org", "12"}) {
+        index.add(token);
+    }
+
+    // tokens are deduplicated, and those that are too short for a trigram are not kept
+    index.add("zz1234");
+    ASSERT_EQ(4, index.num_tokens());
+
+    ASSERT_EQ(std::vector<std::string>({"ab12345x", "zz1234"}), search(index, "234"));
+    ASSERT_EQ(std::vector<std::string>({"ab12345x"}), search(index, "2345"));
+    ASSERT_EQ(std::vector<std::string>({"john.doe@example.com", "jane@example.org"}), search(index, "@example."));
+    ASSERT_EQ(std::vector<std::string>({"jane@example.org"}), search(index, "jane"));
+
+    // every trigram is there, but not the substring itself
+    ASSERT_TRUE(search(index, "1234512").empty());
+
+    ASSERT_TRUE(search(index, "xyz").empty());
+    ASSERT_TRUE(search(index, "12").empty());
+}
+
+TEST(InfixIndexTest, MatchesRepeatedTrigramsAndMultiByteChars) {
+    infix_index index;
+    index.add("aaaaaa");
+    index.add("aaab");
+    index.add("東京都");
+
+    ASSERT_EQ(std::vector<std::string>({"aaaaaa", "aaab"}), search(index, "aaa"));
+    ASSERT_EQ(std::vector<std::string>({"aaaaaa"}), search(index, "aaaaa"));
+    ASSERT_EQ(std::vector<std::string>({"東京都"}), search(index, "京都"));
+}
+
+TEST(InfixIndexTest, StopsAtMaxTokens) {
+    infix_index index;
+
+    for(const std::string & token: {"abc1", "xabc", "nomatch", "abcabc", "zzabczz"}) {
+        index.add(token);
+    }
+
+    std::vector<std::string> tokens;
+    index.search("abc", tokens, 2);
+    ASSERT_EQ(std::vector<std::string>({"abc1", "xabc"}), tokens);
+
+    tokens.clear();
+    index.search("abc", tokens, 0);
+    ASSERT_TRUE(tokens.empty());
+}
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <limits>
+#include <sparsepp.h>
+#include "numeric_column.h"
+#include "index_memory.h"
+
+TEST(NumericColumnTest, SetGetAndErase) {
+    numeric_column column(false);
+
+    for(uint32_t seq_id = 0; seq_id < 1000; seq_id += 3) {
+        column.set(seq_id, (int64_t) seq_id * 10 - 5000);
+    }
+
+    ASSERT_EQ(334, column.size());
+
+    for(uint32_t seq_id = 0; seq_id < 1000; seq_id++) {
+        number_t value;
+        if(seq_id % 3 == 0) {
+            ASSERT_TRUE(column.get(seq_id, value));
+            ASSERT_FALSE(value.is_float);
+            ASSERT_EQ((int64_t) seq_id * 10 - 5000, value.intval);
+        } else {
+            ASSERT_FALSE(column.contains(seq_id));
+        }
+    }
+
+    // overwriting a value does not add one
+    column.set(300, (int64_t) 42);
+    ASSERT_EQ(334, column.size());
+
+    number_t value;
+    ASSERT_TRUE(column.get(300, value));
+    ASSERT_EQ(42, value.intval);
+
+    column.erase(300);
+    column.erase(301);
+    ASSERT_EQ(333, column.size());
+    ASSERT_FALSE(column.contains(300));
+
+    // the neighbours of an erased value stay in place
+    ASSERT_TRUE(column.get(297, value));
+    ASSERT_EQ(2970 - 5000, value.intval);
+    ASSERT_TRUE(column.get(303, value));
+    ASSERT_EQ(3030 - 5000, value.intval);
+
+    // ids beyond the last block
+    ASSERT_FALSE(column.contains(100000));
+    column.erase(100000);
+}
+
+TEST(NumericColumnTest, WritesWithinTheFrameOfABlock) {
+    const size_t base_bytes = index_memory::get_stats().allocated_bytes;
+
+    {
+        numeric_column column(false);
+        std::vector<int64_t> expected;
+
+        // appended in the order of the ids: most fit the smallest value and bits of their block, some don't
+        for(uint32_t seq_id = 0; seq_id < 600; seq_id++) {
+            const int64_t value = (seq_id % 97 == 50) ? -1000 : (seq_id % 89 == 40) ? 1000000 :
+                                  100 + (int64_t) (seq_id % 100);
+            column.set(seq_id, value);
+            expected.push_back(value);
+        }
+
+        // overwritten within the frame, and outside of it
+        column.set(10, (int64_t) 150);
+        expected[10] = 150;
+        column.set(20, (int64_t) -5000);
+        expected[20] = -5000;
+
+        // the last value of a block, then one in its middle
+        column.erase(255);
+        column.erase(599);
+        column.erase(300);
+
+        for(uint32_t seq_id = 0; seq_id < 600; seq_id++) {
+            number_t value;
+            if(seq_id == 255 || seq_id == 599 || seq_id == 300) {
+                ASSERT_FALSE(column.contains(seq_id));
+                continue;
+            }
+
+            ASSERT_TRUE(column.get(seq_id, value));
+            ASSERT_EQ(expected[seq_id], value.intval) << seq_id;
+        }
+
+        ASSERT_EQ(597, column.size());
+
+        std::vector<uint32_t> ids;
+        column.filter(GREATER_THAN_EQUALS, {number_t((int64_t) 1000000)}, ids);
+        ASSERT_EQ(7, ids.size());
+        ASSERT_EQ(40, ids[0]);
+
+        // appended again to blocks whose last value was erased
+        column.set(599, (int64_t) 120);
+        number_t value;
+        ASSERT_TRUE(column.get(599, value));
+        ASSERT_EQ(120, value.intval);
+    }
+
+    ASSERT_EQ(base_bytes, index_memory::get_stats().allocated_bytes);
+}
+
+TEST(NumericColumnTest, FloatsAndExtremeValues) {
+    numeric_column floats(true);
+    const std::vector<float> float_values = {-1000.5f, -0.25f, 0.0f, 0.25f, 3.14f,
+                                             std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()};
+
+    for(size_t i = 0; i < float_values.size(); i++) {
+        floats.set(i, float_values[i]);
+    }
+
+    for(size_t i = 0; i < float_values.size(); i++) {
+        number_t value;
+        ASSERT_TRUE(floats.get(i, value));
+        ASSERT_TRUE(value.is_float);
+        ASSERT_FLOAT_EQ(float_values[i], value.floatval);
+    }
+
+    // a block whose range needs all 64 bits
+    numeric_column ints(false);
+    ints.set(0, std::numeric_limits<int64_t>::min());
+    ints.set(1, std::numeric_limits<int64_t>::max());
+    ints.set(2, (int64_t) 0);
+
+    number_t value;
+    ASSERT_TRUE(ints.get(0, value));
+    ASSERT_EQ(std::numeric_limits<int64_t>::min(), value.intval);
+    ASSERT_TRUE(ints.get(1, value));
+    ASSERT_EQ(std::numeric_limits<int64_t>::max(), value.intval);
+    ASSERT_TRUE(ints.get(2, value));
+    ASSERT_EQ(0, value.intval);
+}
+
+TEST(NumericColumnTest, FilterAndIds) {
+    numeric_column column(true);
+
+    for(uint32_t seq_id = 0; seq_id < 5000; seq_id++) {
+        column.set(seq_id, (float) seq_id / 2);
+    }
+
+    std::vector<uint32_t> ids;
+    column.filter(GREATER_THAN_EQUALS, {number_t(2400.0f)}, ids);
+    ASSERT_EQ(200, ids.size());
+    ASSERT_EQ(4800, ids.front());
+    ASSERT_EQ(4999, ids.back());
+
+    ids.clear();
+    column.filter(LESS_THAN, {number_t(-1.0f)}, ids);
+    ASSERT_EQ(0, ids.size());
+
+    // multiple values are ORed
+    ids.clear();
+    column.filter(LESS_THAN, {number_t(1.0f), number_t(2.0f)}, ids);
+    ASSERT_EQ(4, ids.size());
+
+    std::vector<uint32_t> all_ids(column.size());
+    column.get_ids(&all_ids[0]);
+    for(uint32_t seq_id = 0; seq_id < 5000; seq_id++) {
+        ASSERT_EQ(seq_id, all_ids[seq_id]);
+    }
+}
+
+TEST(NumericColumnTest, SmallerThanHashMap) {
+    numeric_column column(false);
+    spp::sparse_hash_map<uint32_t, number_t> map;
+
+    // timestamps that are close to each other pack into a few bits
+    for(uint32_t seq_id = 0; seq_id < 100000; seq_id++) {
+        const int64_t timestamp = 1500000000 + seq_id * 7;
+        column.set(seq_id, timestamp);
+        map.emplace(seq_id, timestamp);
+    }
+
+    const size_t map_bytes = map.size() * (sizeof(uint32_t) + sizeof(number_t));
+    ASSERT_LT(column.size_in_bytes() * 3, map_bytes);
+}
@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "posting_codec.h"
+#include "sorted_array.h"
+#include "array.h"
+#include "array_utils.h"
+
+static const std::vector<codec_t> all_codecs = {codec_t::FOR, codec_t::BP128, codec_t::VBYTE, codec_t::RAW};
+
+static std::vector<uint32_t> make_values(std::mt19937 & rng, const uint32_t length, const uint32_t gap,
+                                         const bool sorted) {
+    std::vector<uint32_t> values;
+    uint32_t value = rng() % 100;
+
+    for(uint32_t i = 0; i < length; i++) {
+        values.push_back(sorted ? value : (rng() % (gap * 10 + 1)));
+        value += 1 + (rng() % gap);
+    }
+
+    return values;
+}
+
+TEST(PostingCodecTest, EncodeDecodeAndSelect) {
+    std::mt19937 rng(13);
+
+    for(codec_t type: all_codecs) {
+        const posting_codec* codec = posting_codec::get(type);
+        ASSERT_EQ(type, codec->type());
+
+        for(bool sorted: {true, false}) {
+            for(uint32_t length: {0, 1, 9, 127, 128, 129, 300, 1000}) {
+                for(uint32_t gap: {1, 50, 1000000}) {
+                    std::vector<uint32_t> values = make_values(rng, length, gap, sorted);
+                    const uint32_t size = codec->encoded_size(values.data(), length, sorted);
+
+                    std::vector<uint8_t> encoded(size + 64);
+                    ASSERT_EQ(size, codec->encode(values.data(), length, sorted, encoded.data()));
+
+                    std::vector<uint32_t> decoded(length);
+                    codec->decode(encoded.data(), length, sorted, decoded.data());
+                    ASSERT_EQ(values, decoded) << codec->name() << ", length: " << length;
+
+                    for(uint32_t i = 0; i < length; i++) {
+                        ASSERT_EQ(values[i], codec->select(encoded.data(), length, sorted, i));
+                    }
+
+                    for(uint32_t start = 0; start < length; start += 61) {
+                        const uint32_t end = std::min(length, start + 150);
+                        std::vector<uint32_t> range(end - start);
+                        codec->select_range(encoded.data(), length, sorted, start, end, range.data());
+                        ASSERT_TRUE(std::equal(range.begin(), range.end(), values.begin() + start)) << codec->name();
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(PostingCodecTest, AppendMatchesEncode) {
+    std::mt19937 rng(17);
+
+    for(codec_t type: all_codecs) {
+        const posting_codec* codec = posting_codec::get(type);
+
+        for(bool sorted: {true, false}) {
+            std::vector<uint32_t> values = make_values(rng, 700, 40, sorted);
+            std::vector<uint8_t> encoded(values.size() * 8 + 64);
+
+            uint32_t length_bytes = codec->encode(values.data(), 1, sorted, encoded.data());
+            uint32_t min = values[0];
+            uint32_t max = values[0];
+
+            for(uint32_t i = 1; i < values.size(); i++) {
+                ASSERT_LE(codec->append_size_required(encoded.data(), length_bytes, i, min, max, values[i]),
+                          encoded.size());
+                length_bytes = codec->append(encoded.data(), length_bytes, i, sorted, max, values[i]);
+                min = std::min(min, values[i]);
+                max = std::max(max, values[i]);
+            }
+
+            std::vector<uint32_t> decoded(values.size());
+            codec->decode(encoded.data(), values.size(), sorted, decoded.data());
+            ASSERT_EQ(values, decoded) << codec->name();
+        }
+    }
+}
+
+TEST(PostingCodecTest, SearchesMatchDecodedValues) {
+    std::mt19937 rng(19);
+
+    for(codec_t type: all_codecs) {
+        const posting_codec* codec = posting_codec::get(type);
+
+        for(uint32_t length: {1, 100, 128, 1000}) {
+            std::vector<uint32_t> values = make_values(rng, length, 10, true);
+            std::vector<uint8_t> encoded(codec->encoded_size(values.data(), length, true) + 64);
+            codec->encode(values.data(), length, true, encoded.data());
+
+            for(uint32_t value = 0; value <= values.back() + 2; value++) {
+                uint32_t expected = (uint32_t) (std::lower_bound(values.begin(), values.end(), value) - values.begin());
+                if(expected == length) {
+                    expected = length - 1;
+                }
+
+                uint32_t actual_value;
+                ASSERT_EQ(expected, codec->lower_bound(encoded.data(), length, value, &actual_value));
+                ASSERT_EQ(values[expected], actual_value);
+            }
+
+            // every other value, and values that are not in the list
+            std::vector<uint32_t> lookups;
+            for(uint32_t value = 0; value <= values.back() + 2; value += 2) {
+                lookups.push_back(value);
+            }
+
+            std::vector<uint32_t> indices(lookups.size());
+            codec->index_of(encoded.data(), length, lookups.data(), lookups.size(), indices.data());
+
+            for(size_t i = 0; i < lookups.size(); i++) {
+                auto it = std::lower_bound(values.begin(), values.end(), lookups[i]);
+                const uint32_t expected_index = (it != values.end() && *it == lookups[i]) ?
+                                                (uint32_t) (it - values.begin()) : length;
+                ASSERT_EQ(expected_index, indices[i]) << codec->name() << ", value: " << lookups[i];
+            }
+
+            std::vector<uint32_t> ids = make_values(rng, 200, 30, true);
+            uint32_t* expected = nullptr;
+            size_t expected_len = ArrayUtils::and_scalar(values.data(), length, ids.data(), ids.size(), &expected);
+
+            std::vector<uint32_t> actual(std::min((size_t) length, ids.size()));
+            ASSERT_EQ(expected_len, codec->intersect(encoded.data(), length, ids.data(), ids.size(), actual.data()));
+            ASSERT_TRUE(std::equal(expected, expected + expected_len, actual.begin())) << codec->name();
+            delete [] expected;
+
+            std::vector<uint32_t> unsorted = make_values(rng, length, 10, false);
+            std::vector<uint8_t> unsorted_encoded(codec->encoded_size(unsorted.data(), length, false) + 64);
+            codec->encode(unsorted.data(), length, false, unsorted_encoded.data());
+
+            for(uint32_t value = 0; value <= 101; value++) {
+                uint32_t expected_index = (uint32_t) (std::find(unsorted.begin(), unsorted.end(), value) -
+                                                      unsorted.begin());
+                ASSERT_EQ(expected_index, codec->linear_search(unsorted_encoded.data(), length, value));
+            }
+        }
+    }
+}
+
+TEST(PostingCodecTest, ChoosesCodecFromLengthAndDensity) {
+    std::mt19937 rng(23);
+
+    std::vector<uint32_t> short_list = make_values(rng, 5, 1000, true);
+    ASSERT_EQ(codec_t::RAW, posting_codec::choose(short_list.data(), short_list.size(), true));
+
+    // dense ids: deltas fit in a couple of bits, while FOR needs enough bits for the whole range
+    std::vector<uint32_t> dense = make_values(rng, 5000, 3, true);
+    ASSERT_EQ(codec_t::BP128, posting_codec::choose(dense.data(), dense.size(), true));
+
+    std::vector<uint32_t> sparse = make_values(rng, 5000, 100000, true);
+    ASSERT_EQ(codec_t::FOR, posting_codec::choose(sparse.data(), sparse.size(), true));
+
+    // small positions within a document, but one large outlier that makes FOR use wide values
+    std::vector<uint32_t> positions = {1, 2, 3, 5, 8, 13, 21, 34, 55, 90000};
+    ASSERT_EQ(codec_t::VBYTE, posting_codec::choose(positions.data(), positions.size(), false));
+}
+
+TEST(PostingCodecTest, ArraysSwitchCodecsAsTheyGrow) {
+    sorted_array ids;
+    array offsets;
+
+    for(uint32_t i = 0; i < 5000; i++) {
+        ids.append(i * 2);
+        offsets.append(i % 7);
+
+        if(i == 3) {
+            ASSERT_EQ(codec_t::RAW, ids.getCodec());
+            ASSERT_EQ(codec_t::RAW, offsets.getCodec());
+        }
+    }
+
+    ASSERT_EQ(codec_t::BP128, ids.getCodec());
+    ASSERT_EQ(codec_t::FOR, offsets.getCodec());
+
+    for(uint32_t i = 0; i < 5000; i++) {
+        ASSERT_EQ(i * 2, ids.at(i));
+        ASSERT_TRUE(ids.contains(i * 2));
+        ASSERT_FALSE(ids.contains(i * 2 + 1));
+        ASSERT_EQ(i, ids.indexOf(i * 2));
+        ASSERT_EQ(i % 7, offsets.at(i));
+    }
+
+    uint32_t values[] = {0, 3, 20, 9998, 10001};
+    uint32_t indices[5];
+    ids.indexOf(values, 5, indices);
+    ASSERT_EQ(0, indices[0]);
+    ASSERT_EQ(5000, indices[1]);
+    ASSERT_EQ(10, indices[2]);
+    ASSERT_EQ(4999, indices[3]);
+    ASSERT_EQ(5000, indices[4]);
+
+    uint32_t to_remove[] = {2, 4000};
+    ids.remove_values(to_remove, 2);
+    ASSERT_EQ(4998, ids.getLength());
+    ASSERT_FALSE(ids.contains(2));
+    ASSERT_EQ(4, ids.at(1));
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <fstream>
+#include "query_log.h"
+
+class QueryLogTest : public ::testing::Test {
+protected:
+    std::string log_path = "/tmp/typesense_test/query_log/queries.jsonl";
+
+    virtual void SetUp() {
+        system("rm -rf /tmp/typesense_test/query_log && mkdir -p /tmp/typesense_test/query_log");
+    }
+
+    std::map<std::string, std::string> search_params(const std::string & query) {
+        return {{"collection", "products"}, {"q", query}, {"query_by", "title"},
+                {"x-typesense-api-key", "secret"}, {"callback", "cb"}};
+    }
+};
+
+TEST_F(QueryLogTest, MostFrequentSearchesSurviveARestart) {
+    QueryLog & query_log = QueryLog::get_instance();
+    ASSERT_TRUE(query_log.init(log_path, 1).ok());
+    ASSERT_TRUE(query_log.get_top_queries(10).empty());
+
+    // searches that are replayed before recording starts are not counted again
+    query_log.record(search_params("shoes"));
+    ASSERT_TRUE(query_log.get_top_queries(10).empty());
+
+    query_log.start_recording();
+    query_log.record(search_params("socks"));
+    query_log.record(search_params("shoes"));
+    query_log.record(search_params("shoes"));
+    query_log.record(search_params("hats"));
+    query_log.record(search_params("shoes"));
+    query_log.record(search_params("hats"));
+    ASSERT_TRUE(query_log.flush().ok());
+
+    ASSERT_TRUE(query_log.init(log_path, 1).ok());
+    std::vector<std::map<std::string, std::string>> queries = query_log.get_top_queries(2);
+
+    ASSERT_EQ(2, queries.size());
+    ASSERT_EQ("shoes", queries[0]["q"]);
+    ASSERT_EQ("hats", queries[1]["q"]);
+
+    // neither the API key nor the callback is kept
+    ASSERT_EQ(3, queries[0].size());
+    ASSERT_EQ("products", queries[0]["collection"]);
+    ASSERT_EQ("title", queries[0]["query_by"]);
+}
+
+TEST_F(QueryLogTest, SampledSearches) {
+    QueryLog & query_log = QueryLog::get_instance();
+    ASSERT_TRUE(query_log.init(log_path, 3).ok());
+    query_log.start_recording();
+
+    for(size_t i = 0; i < 7; i++) {
+        query_log.record(search_params("query-" + std::to_string(i)));
+    }
+
+    std::vector<std::map<std::string, std::string>> queries = query_log.get_top_queries(10);
+    ASSERT_EQ(3, queries.size());
+}
+
+TEST_F(QueryLogTest, RecentSearchesOutweighOlderOnes) {
+    QueryLog & query_log = QueryLog::get_instance();
+    ASSERT_TRUE(query_log.init(log_path, 1).ok());
+    query_log.start_recording();
+
+    query_log.record(search_params("once"));
+
+    for(size_t i = 0; i < QueryLog::DECAY_EVERY - 1; i++) {
+        query_log.record(search_params("boots"));
+    }
+
+    // halved once, which forgets a search that was only recorded once
+    std::vector<std::map<std::string, std::string>> queries = query_log.get_top_queries(10);
+    ASSERT_EQ(1, queries.size());
+    ASSERT_EQ("boots", queries[0]["q"]);
+
+    // fewer searches in all than the older ones, but more than their halved count
+    for(size_t i = 0; i < QueryLog::DECAY_EVERY / 2 + 1; i++) {
+        query_log.record(search_params("sandals"));
+    }
+
+    queries = query_log.get_top_queries(10);
+    ASSERT_EQ(2, queries.size());
+    ASSERT_EQ("sandals", queries[0]["q"]);
+    ASSERT_EQ("boots", queries[1]["q"]);
+}
+
+TEST_F(QueryLogTest, SearchesAreSavedOnlyByAFlush) {
+    QueryLog & query_log = QueryLog::get_instance();
+    ASSERT_TRUE(query_log.init(log_path, 1).ok());
+
+    // nothing recorded yet: there is nothing to save
+    ASSERT_TRUE(query_log.flush_if_recorded().ok());
+    ASSERT_FALSE(std::ifstream(log_path).is_open());
+
+    query_log.start_recording();
+    for(size_t i = 0; i < 500; i++) {
+        query_log.record(search_params("shoes"));
+    }
+
+    ASSERT_FALSE(std::ifstream(log_path).is_open());
+
+    ASSERT_TRUE(query_log.flush_if_recorded().ok());
+    ASSERT_TRUE(std::ifstream(log_path).is_open());
+
+    // saved already, so it is not written again until more searches are recorded
+    std::remove(log_path.c_str());
+    ASSERT_TRUE(query_log.flush_if_recorded().ok());
+    ASSERT_FALSE(std::ifstream(log_path).is_open());
+
+    query_log.record(search_params("hats"));
+    ASSERT_TRUE(query_log.flush_if_recorded().ok());
+    ASSERT_TRUE(query_log.init(log_path, 1).ok());
+    ASSERT_EQ(2, query_log.get_top_queries(10).size());
+}
+
+TEST_F(QueryLogTest, BadLogIsAnError) {
+    std::ofstream outfile(log_path);
+    outfile << "{\"count\": 1, \"params\": {\"q\": 10}}\n";
+    outfile.close();
+
+    Option<bool> init_op = QueryLog::get_instance().init(log_path, 1);
+    ASSERT_FALSE(init_op.ok());
+    ASSERT_EQ(400, init_op.code());
+}
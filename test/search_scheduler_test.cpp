@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "search_scheduler.h"
+
+class SearchSchedulerTest : public ::testing::Test {
+protected:
+    SearchScheduler & scheduler = SearchScheduler::get_instance();
+
+    // runs every waiting search, each one costing its tenant `cost_us` of CPU time
+    std::vector<std::string> run_all(const uint64_t cost_us) {
+        std::vector<std::string> tenants;
+        std::string tenant;
+        void* data;
+
+        while(scheduler.next(tenant, data)) {
+            tenant_usage usage;
+            usage.num_searches = 1;
+            usage.cpu_time_us = cost_us;
+            scheduler.record_usage(tenant, usage);
+            scheduler.complete(tenant);
+            tenants.push_back(tenant);
+        }
+
+        return tenants;
+    }
+
+    void admit_and_enqueue(const std::string & tenant, const size_t num_searches) {
+        for(size_t i = 0; i < num_searches; i++) {
+            ASSERT_TRUE(scheduler.admit(tenant, 0).ok());
+            scheduler.enqueue(tenant, nullptr);
+        }
+    }
+
+    virtual void TearDown() {
+        scheduler.init(tenant_limits(), "");
+    }
+};
+
+TEST_F(SearchSchedulerTest, HeavyTenantDoesNotStarveOthers) {
+    ASSERT_TRUE(scheduler.init(tenant_limits(), "").ok());
+
+    // the heavy tenant's searches have been taking far longer
+    for(size_t i = 0; i < 20; i++) {
+        admit_and_enqueue("heavy", 1);
+        run_all(100000);
+    }
+
+    admit_and_enqueue("heavy", 10);
+    admit_and_enqueue("light", 10);
+
+    std::vector<std::string> order = run_all(1000);
+    ASSERT_EQ(20, order.size());
+
+    // the light tenant's searches, queued after the heavy tenant's, run first
+    for(size_t i = 0; i < 10; i++) {
+        ASSERT_EQ("light", order[i]);
+    }
+}
+
+TEST_F(SearchSchedulerTest, WeightsShareTheSearchTime) {
+    ASSERT_TRUE(scheduler.init(tenant_limits(), "gold:3:0:0").ok());
+
+    admit_and_enqueue("gold", 30);
+    admit_and_enqueue("basic", 30);
+
+    // with equal costs, the tenant of thrice the weight runs thrice as many of the first searches
+    std::vector<std::string> order = run_all(1000);
+    size_t num_gold = 0;
+    for(size_t i = 0; i < 20; i++) {
+        num_gold += (order[i] == "gold");
+    }
+
+    ASSERT_EQ(15, num_gold);
+}
+
+TEST_F(SearchSchedulerTest, ConcurrencyAndQPSLimits) {
+    ASSERT_EQ(400, scheduler.init(tenant_limits(), "gold:3:0").code());
+    ASSERT_EQ(400, scheduler.init(tenant_limits(), "gold:0:1:1").code());
+
+    ASSERT_TRUE(scheduler.init(tenant_limits(1.0, 2, 0), "fast:1:0:5").ok());
+
+    // waiting searches count towards the concurrency limit until they are completed
+    admit_and_enqueue("coll", 2);
+    ASSERT_EQ(429, scheduler.admit("coll", 0).code());
+    ASSERT_EQ(2, run_all(0).size());
+    ASSERT_TRUE(scheduler.admit("coll", 0).ok());
+    scheduler.complete("coll");
+
+    // a second's worth of searches, and then more as time passes
+    for(size_t i = 0; i < 5; i++) {
+        ASSERT_TRUE(scheduler.admit("fast", 1000000).ok());
+        scheduler.complete("fast");
+    }
+
+    ASSERT_EQ(429, scheduler.admit("fast", 1000000).code());
+    ASSERT_EQ(429, scheduler.admit("fast", 1100000).code());
+    ASSERT_TRUE(scheduler.admit("fast", 1200000).ok());
+    scheduler.complete("fast");
+
+    ASSERT_EQ(1, scheduler.get_usage("coll").num_rejected);
+    ASSERT_EQ(2, scheduler.get_usage("fast").num_rejected);
+    ASSERT_EQ(2, scheduler.get_usage("coll").num_searches);
+
+    nlohmann::json metrics = scheduler.get_metrics();
+    ASSERT_EQ(2, metrics["fast"]["rejected_searches"].get<size_t>());
+    ASSERT_EQ(0, metrics["coll"]["waiting_searches"].get<size_t>());
+    ASSERT_EQ(2, metrics["coll"]["max_concurrent"].get<size_t>());
+}
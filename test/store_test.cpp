@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include <vector>
+#include <limits>
+#include <thread>
 #include <store.h>
 #include <string_utils.h>
 
@@ -130,4 +132,43 @@ TEST(StoreTest, GetUpdateSinceInvalidIterator) {
     ASSERT_FALSE(updates_op.ok());
     ASSERT_EQ("Invalid iterator. Master's latest sequence number is 4 but updates are requested from sequence number 2. "
                       "The master's WAL entries might have expired (they are kept only for 24 hours).", updates_op.error());
-}
\ No newline at end of file
+}
+
+TEST(StoreTest, IdleCompactionAndIOStats) {
+    std::string store_path = "/tmp/typesense_test/idle_compaction_store_test";
+    LOG(INFO) << "Truncating and creating: " << store_path;
+    const std::string unlimited_store_path = store_path + "_unlimited";
+    system(("rm -rf "+store_path+" "+unlimited_store_path+" && mkdir -p "+store_path+" "+unlimited_store_path).c_str());
+
+    Store store(store_path, 24*60*60, 1024, 4, 8, true);
+
+    store_io_stats stats = store.get_io_stats();
+    ASSERT_EQ(8 * 1024 * 1024, stats.io_rate_limit);
+    ASSERT_EQ(0, stats.num_idle_compactions);
+    ASSERT_FALSE(stats.writes_stopped);
+
+    // the store is not idle right after a write
+    store.insert("foo1", "bar1");
+    ASSERT_FALSE(store.compact_if_idle(60*1000, 0));
+
+    // nor is it compacted when compactions are not behind by enough
+    ASSERT_FALSE(store.compact_if_idle(0, std::numeric_limits<uint64_t>::max()));
+
+    ASSERT_TRUE(store.compact_if_idle(0, 0));
+    ASSERT_EQ(1, store.get_io_stats().num_idle_compactions);
+
+    // until there are new writes, there is nothing more to compact
+    ASSERT_FALSE(store.compact_if_idle(0, 0));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    store.remove("foo1");
+    ASSERT_TRUE(store.compact_if_idle(0, 0));
+    ASSERT_EQ(2, store.get_io_stats().num_idle_compactions);
+
+    std::string value;
+    ASSERT_EQ(StoreStatus::NOT_FOUND, store.get("foo1", value));
+
+    // no limit by default
+    Store unlimited_store(unlimited_store_path);
+    ASSERT_EQ(0, unlimited_store.get_io_stats().io_rate_limit);
+}
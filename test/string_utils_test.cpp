@@ -23,4 +23,12 @@ TEST(StringUtilsTest, ShouldNormalizeString) {
     std::string tamil_unicodechars = "தமிழ் நாடு";
     string_utils.unicode_normalize(tamil_unicodechars);
     ASSERT_STREQ("தமிழ்நாடு", tamil_unicodechars.c_str());
-}
\ No newline at end of file
+}
+
+TEST(StringUtilsTest, ShouldURLEncodeWhatURLDecodeReverses) {
+    ASSERT_STREQ("title%3A%20rocket%2Cpoints%3A%3E10", StringUtils::url_encode("title: rocket,points:>10").c_str());
+    ASSERT_STREQ("a-b_c.d~e", StringUtils::url_encode("a-b_c.d~e").c_str());
+
+    const std::string text = "東京 & more+?=%";
+    ASSERT_STREQ(text.c_str(), StringUtils::url_decode(StringUtils::url_encode(text)).c_str());
+}